@@ -0,0 +1,74 @@
+/**
+    * @file: access_log.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares the binary access log, which keeps
+    * one compact record per answered request (method, path, status,
+    * sent bytes, latency and client address).
+    *
+    * Records are appended to an in-memory buffer and written to the
+    * file in large blocks by a background thread. Only every N-th request is logged, but
+    * failed and slow requests are logged always. The file is read by
+    * the access_log_decoder tool.
+*/
+
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <stdint.h>
+#include "http_messages.h"
+
+#define ACCESS_LOG_MAGIC "HTTPACC"
+#define ACCESS_LOG_VERSION 1
+
+/**
+    * @struct AccessLogHeader
+    * @brief Header written once at the beginning of access log file.
+*/
+struct AccessLogHeader {
+    char magic[8];                  /**< ACCESS_LOG_MAGIC with terminator. */
+    uint32_t version;               /**< ACCESS_LOG_VERSION. */
+    uint32_t record_size;           /**< Size of struct AccessLogRecord. */
+};
+
+/**
+    * @struct AccessLogRecord
+    * @brief Fixed part of a logged request, followed by path_length
+    * bytes of the path without terminator.
+*/
+struct AccessLogRecord {
+    uint64_t timestamp_us;          /**< Wall-clock time the request was received, in microseconds. */
+    uint64_t bytes_sent;            /**< Number of response bytes sent to the client. */
+    uint32_t latency_us;            /**< Time from receiving headers to sending the response. */
+    uint32_t client_ip;             /**< Client IPv4 address in network byte order, 0 if unknown. */
+    uint16_t client_port;           /**< Client port, 0 if unknown. */
+    uint16_t status_code;           /**< Response status code, 0 if nothing was sent. */
+    uint8_t method;                 /**< Value of enum Method. */
+    uint8_t reserved;
+    uint16_t path_length;           /**< Number of path bytes following the record. */
+};
+
+/**
+    * Opens the access log configured by access_log_file.
+    *
+    * @return Returns 0 on success or when the access log is disabled,
+    * or error code on failure.
+*/
+enum ReturnCode open_access_log();
+
+/**
+    * Records an answered request if it is sampled, failed or slow.
+    *
+    * @param[in] client_socket The client socket descriptor, used to
+    * look up client address of logged requests.
+    * @param[in] request The pointer to answered Request structure.
+*/
+void write_access_log(int client_socket, const struct Request* request);
+
+/**
+    * Writes buffered records, stops the flush thread and closes the
+    * access log.
+*/
+void close_access_log();
+
+#endif // ACCESS_LOG_H
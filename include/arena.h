@@ -0,0 +1,76 @@
+/**
+    * @file: arena.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares a bump allocator owned by a single
+    * connection.
+    *
+    * Everything allocated while answering a request (response headers,
+    * raw response) comes from the arena of its connection and is
+    * released at once when the arena is reset after the request, so
+    * answering a request doesn't call malloc() and free() per object
+    * and threads don't contend in the allocator.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+struct ArenaBlock;
+
+/**
+    * @struct Arena
+    * @brief Represents a list of memory blocks allocations are carved from.
+*/
+struct Arena {
+    struct ArenaBlock* first;       /**< Block kept between resets. */
+    struct ArenaBlock* current;     /**< Block allocations are made from. */
+};
+
+/**
+    * Initializes an empty arena, the first block is allocated lazily.
+    *
+    * @param[out] arena The pointer to arena to initialize.
+*/
+void initialize_arena(struct Arena* arena);
+
+/**
+    * Allocates memory from the arena.
+    *
+    * @param[in,out] arena The pointer to arena.
+    * @param[in] size The number of bytes to allocate.
+    *
+    * @return Returns pointer aligned for any type, or NULL if memory
+    * is not allocated.
+    *
+    * @note The memory is valid until the arena is reset or freed.
+*/
+void* arena_allocate(struct Arena* arena, size_t size);
+
+/**
+    * Copies a string into the arena.
+    *
+    * @param[in,out] arena The pointer to arena.
+    * @param[in] string The string to copy.
+    *
+    * @return Returns the copy or NULL if memory is not allocated.
+*/
+char* arena_strdup(struct Arena* arena, const char* string);
+
+/**
+    * Releases all allocations at once, keeping the first block for
+    * the next request.
+    *
+    * @param[in,out] arena The pointer to arena.
+*/
+void reset_arena(struct Arena* arena);
+
+/**
+    * Frees all memory blocks of the arena.
+    *
+    * @param[in,out] arena The pointer to arena.
+*/
+void free_arena(struct Arena* arena);
+
+#endif // ARENA_H
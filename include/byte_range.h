@@ -0,0 +1,90 @@
+/**
+    * @file: byte_range.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares parsing of the Range request header
+    * and the layout of a partial response body.
+    *
+    * A single range is sent as the bytes of the file alone. Several
+    * ranges are sent as a multipart/byteranges body, where every range
+    * is preceded by its part head and the body is closed by a tail.
+*/
+
+#ifndef BYTE_RANGE_H
+#define BYTE_RANGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "http_messages.h"
+#include "arena.h"
+#include "common.h"
+
+/**
+    * @enum RangeStatus
+    * @brief Represents how a GET request with Range has to be answered.
+*/
+enum RangeStatus {
+    RANGES_IGNORED,             /**< The header is missing or invalid, the whole file is sent. */
+    RANGES_SATISFIABLE,         /**< At least one range overlaps the file, 206 is sent. */
+    RANGES_NOT_SATISFIABLE      /**< No range overlaps the file, 416 is sent. */
+};
+
+/**
+    * @struct ByteRange
+    * @brief Represents one range of the file sent in a partial response.
+*/
+struct ByteRange {
+    uint64_t offset;            /**< Offset of the first byte in the file. */
+    uint64_t length;            /**< Number of bytes, never 0. */
+    const char* part_head;      /**< Delimiter and headers of the part, NULL for a single range. */
+    size_t part_head_size;
+};
+
+/**
+    * @struct ByteRanges
+    * @brief Represents all ranges sent in a partial response.
+*/
+struct ByteRanges {
+    struct ByteRange items[MAX_BYTE_RANGES];
+    size_t count;
+    const char* tail;           /**< Closing delimiter of multipart body, NULL for a single range. */
+    size_t tail_size;
+    char boundary[MULTIPART_BOUNDARY_SIZE];
+};
+
+/**
+    * Parses the value of Range header against the size of the file.
+    *
+    * @param[in] value The value of Range header.
+    * @param[in] file_size The size of the requested file.
+    * @param[out] ranges The ranges which overlap the file, in the
+    * order they were requested and clipped to its end.
+    *
+    * @return Returns RANGES_IGNORED if the header has unknown unit,
+    * invalid syntax or more than MAX_BYTE_RANGES ranges.
+*/
+enum RangeStatus parse_byte_ranges(struct StringView value, uint64_t file_size, struct ByteRanges* ranges);
+
+/**
+    * Formats part heads and the tail of a multipart/byteranges body.
+    *
+    * @param[in,out] ranges The satisfiable ranges, at least two.
+    * @param[in] file_size The size of the requested file.
+    * @param[in] content_type The content type of the file.
+    * @param[in,out] arena The arena part heads are allocated from.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode prepare_multipart_ranges(struct ByteRanges* ranges, uint64_t file_size, const char* content_type,
+                                         struct Arena* arena);
+
+/**
+    * Calculates Content-Length of a partial response.
+    *
+    * @param[in] ranges The satisfiable ranges.
+    *
+    * @return Returns the size of file bytes, part heads and tail.
+*/
+uint64_t get_ranges_body_size(const struct ByteRanges* ranges);
+
+#endif // BYTE_RANGE_H
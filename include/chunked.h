@@ -0,0 +1,97 @@
+/**
+    * @file: chunked.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares the chunked transfer coding: an
+    * incremental decoder of request bodies and an encoder of response
+    * bodies whose size is not known before they are sent.
+    *
+    * The decoder keeps its position between calls, so a body may be
+    * passed in pieces of any size, as they are received. It decodes
+    * in place and never allocates memory.
+*/
+
+#ifndef CHUNKED_H
+#define CHUNKED_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include "common.h"
+
+/**
+    * @enum ChunkedState
+    * @brief Part of the chunked body the decoder expects next.
+*/
+enum ChunkedState {
+    CHUNKED_SIZE,               /**< Hexadecimal digits of the chunk size. */
+    CHUNKED_EXTENSION,          /**< Chunk extension, ignored up to CR. */
+    CHUNKED_SIZE_LF,            /**< LF ending the chunk size line. */
+    CHUNKED_DATA,               /**< Chunk data. */
+    CHUNKED_DATA_CR,            /**< CR after chunk data. */
+    CHUNKED_DATA_LF,            /**< LF after chunk data. */
+    CHUNKED_TRAILER,            /**< Start of a trailer field or of the final CRLF. */
+    CHUNKED_TRAILER_FIELD,      /**< Trailer field, ignored up to CR. */
+    CHUNKED_TRAILER_LF,         /**< LF ending a trailer field. */
+    CHUNKED_FINAL_LF,           /**< LF ending the body. */
+    CHUNKED_DONE                /**< The whole body is decoded. */
+};
+
+/**
+    * @struct ChunkedDecoder
+    * @brief Represents position of the decoder in a chunked body.
+*/
+struct ChunkedDecoder {
+    enum ChunkedState state;
+    uint64_t chunk_size;        /**< Size of the current chunk, or digits parsed so far. */
+    int has_size_digits;        /**< Whether the size line has at least one digit. */
+};
+
+/**
+    * Initializes the decoder for a new body.
+    *
+    * @param[out] decoder The pointer to decoder to initialize.
+*/
+void initialize_chunked_decoder(struct ChunkedDecoder* decoder);
+
+/**
+    * Decodes the next piece of a chunked body in place.
+    *
+    * @param[in,out] decoder The pointer to decoder.
+    * @param[in,out] data The received bytes, overwritten with chunk
+    * data from the start.
+    * @param[in] size The number of received bytes.
+    * @param[out] decoded_size The number of chunk data bytes now at
+    * the start of data.
+    * @param[out] consumed_size The number of received bytes which
+    * belong to the body. It is less than size only when the body is
+    * complete and bytes of the next request follow it.
+    *
+    * @return Returns 0 on success or error code if the body is malformed.
+*/
+enum ReturnCode decode_chunked(struct ChunkedDecoder* decoder, char* data, size_t size,
+                               size_t* decoded_size, size_t* consumed_size);
+
+/**
+    * Checks whether the decoder reached the end of the body.
+    *
+    * @param[in] decoder The pointer to decoder.
+    *
+    * @return Returns 1 if the body is complete, or 0 otherwise.
+*/
+int is_chunked_body_complete(const struct ChunkedDecoder* decoder);
+
+/**
+    * Fills buffers of one chunk of a response body for one writev() call.
+    *
+    * @param[out] size_line The buffer of CHUNK_SIZE_LINE_SIZE bytes
+    * for the chunk size line.
+    * @param[in] data The chunk data.
+    * @param[in] size The size of the chunk data, 0 for the last chunk.
+    * @param[out] iov The array of CHUNK_IOV_COUNT buffers.
+    *
+    * @return Returns the number of filled buffers.
+*/
+int prepare_chunk(char* size_line, const char* data, size_t size, struct iovec* iov);
+
+#endif // CHUNKED_H
@@ -5,13 +5,35 @@
 #define HTTP_VERSION_SIZE 32
 #define HTTP_HEADER_FIELD_SIZE 256
 #define HTTP_STATUS_SIZE 64
+#define MAX_REQUEST_HEADERS 64
 
 // === Config ===
+#define CONFIG_FILE "config.json"
 #define DEFAULT_IP_VALUE INADDR_LOOPBACK
 #define DEFAULT_PORT_VALUE 8080
 #define DEFAULT_MAX_CLIENTS_COUNT 5
 #define DEFAULT_ROOT_DIR "./storage"
 #define DEFAULT_LOG_FILENAME "log.txt"
+#define DEFAULT_CONNECTION_MODE CONNECTION_MODE_THREADS
+#define DEFAULT_WORKER_THREADS 0
+#define DEFAULT_LISTEN_BACKLOG 128
+#define DEFAULT_REUSE_PORT 0
+#define DEFAULT_IO_BACKEND IO_BACKEND_POSIX
+#define DEFAULT_COROUTINE_STACK_SIZE 65536
+#define MIN_COROUTINE_STACK_SIZE 32768
+#define DEFAULT_FILE_CACHE_ENTRIES 256
+#define DEFAULT_CONTENT_CACHE_SIZE 0
+#define DEFAULT_INDEX_SNAPSHOT_FILE ""
+#define DEFAULT_INDEX_SNAPSHOT_INTERVAL 300
+#define DEFAULT_LOG_BUFFER_RECORDS 4096
+#define MIN_LOG_BUFFER_RECORDS 16
+#define DEFAULT_LOG_OVERFLOW_POLICY LOG_OVERFLOW_BLOCK
+#define DEFAULT_LOG_LEVEL DEBUG
+#define DEFAULT_ACCESS_LOG_FILE ""
+#define DEFAULT_ACCESS_LOG_SAMPLE_RATE 1
+#define DEFAULT_ACCESS_LOG_SLOW_MS 1000
+#define DEFAULT_MAX_HEADER_SIZE 65536
+#define MIN_MAX_HEADER_SIZE 1024
 
 #define FIELD_PATTERN_SIZE 64
 #define CONFIG_FIELD_BUFFER_SIZE 256
@@ -21,13 +43,38 @@
 // === HTTP statuses ===
 #define STATUS_200_OK                       "HTTP/1.1 200 OK"
 #define STATUS_201_CREATED                  "HTTP/1.1 201 Created"
+#define STATUS_206_PARTIAL_CONTENT          "HTTP/1.1 206 Partial Content"
+#define STATUS_304_NOT_MODIFIED             "HTTP/1.1 304 Not Modified"
 #define STATUS_404_NOT_FOUND                "HTTP/1.1 404 Not Found"
 #define STATUS_405_METHOD_NOT_ALLOWED       "HTTP/1.1 405 Method Not Allowed"
+#define STATUS_416_RANGE_NOT_SATISFIABLE    "HTTP/1.1 416 Range Not Satisfiable"
 #define STATUS_500_INTERNAL_SERVER_ERROR    "HTTP/1.1 500 Internal Server Error"
 
+#define HTTP_STATUS_CODE_OK                 200
+#define HTTP_STATUS_CODE_PARTIAL_CONTENT    206
+
+#define FILE_CONTENT_TYPE                   "application/octet-stream"
+
+// === Raw responses ===
+#define RAW_RESPONSE_100_CONTINUE   "HTTP/1.1 100 Continue\r\n\r\n"
+#define RAW_HEADERS_KEEP_ALIVE      "Connection: keep-alive\r\nKeep-Alive: timeout=5, max=100\r\n\r\n"
+#define RAW_HEADERS_CLOSE           "Connection: close\r\n\r\n"
+
 // === Other ===
 #define MAX_PATH_LEN 256
-#define RESPONSE_EXTRA_BYTES 10
+#define LOG_STATISTICS_SIZE 128
+#define CACHED_HEADERS_SIZE 512
+#define RESPONSE_IOV_COUNT 4
+#define DATE_HEADER_SIZE 38
+#define CHUNK_SIZE_LINE_SIZE 24
+#define CHUNK_IOV_COUNT 3
+#define HTTP_DATE_SIZE 30
+#define ENTITY_TAG_SIZE 64
+#define MAX_BYTE_RANGES 16
+#define MULTIPART_BOUNDARY_SIZE 17
+#define CLIENT_TIMEOUT_SEC 5
+#define EVENT_LOOP_MAX_EVENTS 256
+#define EVENT_LOOP_TIMEOUT_MS 1000
 
 // === Return codes ===
 enum ReturnCode {
@@ -36,7 +83,9 @@ enum ReturnCode {
     RET_ARGUMENT_IS_NULL = -2,
     RET_CONFIG_PARSING_ERROR = -3,
     RET_FILE_NOT_OPENED = -4,
-    RET_RESPONSE_NOT_SENT = -5
+    RET_RESPONSE_NOT_SENT = -5,
+    RET_WOULD_BLOCK = -6,
+    RET_CACHE_MISS = -7
 };
 
 #endif // COMMON_H
\ No newline at end of file
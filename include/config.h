@@ -6,13 +6,44 @@
     * related to configuration handling for the server application.
     *
     * The configuration includes parameters such as IP address, port,
-    * maximum number of clients, root directory, and log file path.
+    * maximum number of clients, root directory, and log file path,
+    * as well as the way connections are accepted and served.
 */
 
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <stddef.h>
 #include "common.h"
+#include "logger.h"
+
+/**
+    * @enum ConnectionMode
+    * @brief Represents the way server serves accepted connections.
+*/
+enum ConnectionMode {
+    CONNECTION_MODE_THREADS,    /**< Connections are served by blocking handlers in worker pool. */
+    CONNECTION_MODE_EPOLL,      /**< All connections are multiplexed by single epoll event loop. */
+    CONNECTION_MODE_COROUTINES  /**< Every connection is served by its own small-stack coroutine. */
+};
+
+/**
+    * @enum IoBackend
+    * @brief Represents the way blocking socket and file I/O is performed.
+*/
+enum IoBackend {
+    IO_BACKEND_POSIX,       /**< Regular read/write/send/recv system calls. */
+    IO_BACKEND_IO_URING     /**< Batched operations submitted through io_uring. */
+};
+
+/**
+    * @enum LogOverflowPolicy
+    * @brief Represents what logging thread does when log buffer is full.
+*/
+enum LogOverflowPolicy {
+    LOG_OVERFLOW_BLOCK,     /**< Thread waits until the flush thread frees a record. */
+    LOG_OVERFLOW_DROP       /**< Record is dropped and counted. */
+};
 
 /**
     * @struct Config
@@ -24,6 +55,23 @@ struct Config {
     unsigned int max_clients;     /**< Maximum number of clients the server can handle concurrently. */
     char root_directory[MAX_PATH_LEN];     /**< Path to the root directory of the server's file storage. */
     char log_file[MAX_PATH_LEN];           /**< Path to the server's log file. */
+    enum ConnectionMode connection_mode;   /**< The way accepted connections are served. */
+    unsigned int worker_threads;  /**< Number of workers executing requests, 0 means number of CPU cores. */
+    unsigned int listen_backlog;  /**< Maximum length of the queue of pending connections. */
+    int reuse_port;               /**< Whether every CPU core gets its own SO_REUSEPORT listener. */
+    enum IoBackend io_backend;    /**< The way blocking socket and file I/O is performed. */
+    unsigned int coroutine_stack_size;     /**< Stack size of a connection coroutine in bytes. */
+    unsigned int file_cache_entries;       /**< Maximum number of cached open files, 0 disables caching. */
+    size_t content_cache_size;    /**< Byte budget of in-memory response cache, 0 disables it. */
+    char index_snapshot_file[MAX_PATH_LEN];  /**< Path to the metadata index snapshot, empty disables it. */
+    unsigned int index_snapshot_interval;    /**< Seconds between background snapshots, 0 saves only on stop. */
+    unsigned int log_buffer_records;         /**< Number of records in asynchronous log buffer. */
+    enum LogOverflowPolicy log_overflow_policy;  /**< What happens to records when log buffer is full. */
+    enum Level log_level;         /**< Minimum level of logged messages. */
+    char access_log_file[MAX_PATH_LEN];      /**< Path to the binary access log, empty disables it. */
+    unsigned int access_log_sample_rate;     /**< Every N-th request is logged, 0 logs only errors and slow ones. */
+    unsigned int access_log_slow_ms;         /**< Requests slower than this are always logged, 0 disables it. */
+    size_t max_header_size;       /**< Maximum size of request line and headers in bytes. */
 };
 
 /**
@@ -41,6 +89,18 @@ struct Config {
 */
 enum ReturnCode load_config(const char* path);
 
+/**
+    * Reads only the log level from a configuration file, leaving the
+    * loaded configuration untouched.
+    *
+    * @param[in] path The path to the configuration file.
+    * @param[out] level The log level set in the file.
+    *
+    * @return Returns 0 on success or error code if the file can't be
+    * read or has no valid log_level.
+*/
+enum ReturnCode load_log_level(const char* path, enum Level* level);
+
 /**
     * Retrieves the const pointer to the const loaded configuration.
     *
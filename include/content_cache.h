@@ -0,0 +1,181 @@
+/**
+    * @file: content_cache.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares the in-memory cache of hot file
+    * responses.
+    *
+    * Every entry keeps status line and entity headers followed by the
+    * whole file body, ready to be sent with one writev() together
+    * with connection headers of the request. Memory is bounded by a
+    * byte budget and entries are evicted with segmented LRU: new
+    * entries start in the probation segment and move to the protected
+    * segment on their second hit, so one scan of cold files can't
+    * flush the hot ones.
+    *
+    * Concurrent misses of one path are coalesced: the first caller
+    * becomes the leader and reads the file, the others wait for its
+    * entry instead of reading the same file from disk again. This
+    * doesn't depend on the budget, an entry which can't be cached is
+    * handed over to the followers and freed after them.
+*/
+
+#ifndef CONTENT_CACHE_H
+#define CONTENT_CACHE_H
+
+#include <stddef.h>
+#include "common.h"
+
+/**
+    * @struct CachedContent
+    * @brief Structure representing a cached file response.
+    *
+    * Only data, headers_size and body_size are meant to be read by
+    * users, the rest is owned by the cache.
+*/
+struct CachedContent {
+    char path[MAX_PATH_LEN];    /**< Resolved path of the file. */
+    char* data;                 /**< Status line and headers immediately followed by body. */
+    size_t headers_size;        /**< Size of headers part, without final empty line. */
+    size_t body_size;           /**< Size of body part. */
+    unsigned int references;    /**< Number of users holding this entry. */
+    int is_cached;              /**< Whether entry is still reachable through the table. */
+    int is_protected;           /**< Whether entry is in protected segment. */
+    struct CachedContent* bucket_next;
+    struct CachedContent* prev;
+    struct CachedContent* next;
+};
+
+/**
+    * @struct ContentFill
+    * @brief Opaque structure representing a cache fill in progress.
+*/
+struct ContentFill;
+
+/**
+    * @struct ContentCacheStatistics
+    * @brief Structure representing counters of the content cache.
+*/
+struct ContentCacheStatistics {
+    unsigned long long hits;        /**< Lookups served from memory. */
+    unsigned long long misses;      /**< Lookups which had to read the file. */
+    unsigned long long coalesced;   /**< Lookups answered by a fill of another one. */
+    unsigned long long evictions;   /**< Entries dropped to fit the byte budget. */
+    size_t used_bytes;              /**< Bytes currently held by entries. */
+    unsigned int waiting;           /**< Lookups waiting for fills right now. */
+};
+
+/**
+    * Checks whether content caching is enabled by configuration.
+    *
+    * @return Returns 1 if enabled, 0 otherwise.
+*/
+int is_content_cache_enabled();
+
+/**
+    * Checks whether a response of given size may be cached.
+    *
+    * @param[in] size The size of headers and body together.
+    *
+    * @return Returns 1 if it fits into an entry, 0 otherwise.
+*/
+int is_content_cacheable(size_t size);
+
+/**
+    * Looks up a cached response and counts the hit or miss.
+    *
+    * @param[in] path The resolved path of the file.
+    * @param[in] may_wait Whether the calling thread may block until
+    * a fill of another caller is completed.
+    * @param[out] fill Set on a miss when the caller becomes the leader
+    * of the fill of this path, NULL otherwise.
+    *
+    * @return Returns pointer to the entry, or NULL on miss. When the
+    * same path is being filled by another caller and may_wait is set,
+    * this function waits for it and returns its entry, or NULL if it
+    * wasn't loaded. Otherwise the caller gets a miss without a fill.
+    *
+    * @note Every returned entry must be passed to release_content().
+    * Every returned fill must be passed to complete_content_fill()
+    * without waiting for a socket in between, as followers block
+    * their thread until it is completed. Event loop and coroutine
+    * threads serve many connections and must not wait.
+*/
+struct CachedContent* acquire_content(const char* path, int may_wait, struct ContentFill** fill);
+
+/**
+    * Checks whether the leader of a fill should read the response
+    * into memory.
+    *
+    * @param[in] fill The fill returned by acquire_content().
+    * @param[in] size The size of headers and body together.
+    *
+    * @return Returns 1 if the response may be cached, or it is small
+    * enough to be shared with followers already waiting for it,
+    * 0 otherwise.
+*/
+int should_load_content(const struct ContentFill* fill, size_t size);
+
+/**
+    * Completes a fill and hands its entry over to waiting followers.
+    *
+    * @param[in] fill The fill returned by acquire_content(), may be NULL.
+    * @param[in] content The loaded entry or NULL if the file couldn't
+    * be loaded.
+*/
+void complete_content_fill(struct ContentFill* fill, struct CachedContent* content);
+
+/**
+    * Returns the current invalidation generation, to be taken before
+    * reading a file which is going to be inserted.
+    *
+    * @return Returns the generation counter.
+*/
+unsigned long long get_content_generation();
+
+/**
+    * Creates an entry and inserts it into the cache if no invalidation
+    * happened since the generation was taken, the entry is cacheable
+    * and the budget allows.
+    *
+    * @param[in] path The resolved path of the file.
+    * @param[in] data Headers followed by body, ownership is taken.
+    * @param[in] headers_size The size of headers part.
+    * @param[in] body_size The size of body part.
+    * @param[in] generation The generation taken before reading file.
+    *
+    * @return Returns pointer to the entry (cached or not) or NULL if
+    * memory couldn't be allocated, in which case data is freed.
+    *
+    * @note Every returned entry must be passed to release_content().
+*/
+struct CachedContent* insert_content(const char* path, char* data, size_t headers_size,
+                                     size_t body_size, unsigned long long generation);
+
+/**
+    * Releases an entry returned by acquire_content() or insert_content().
+    *
+    * @param[in] content The entry to release.
+*/
+void release_content(struct CachedContent* content);
+
+/**
+    * Removes the entry of a file which is modified or deleted.
+    *
+    * @param[in] path The resolved path of the file.
+*/
+void invalidate_content(const char* path);
+
+/**
+    * Copies current counters of the cache.
+    *
+    * @param[out] statistics The structure to fill.
+*/
+void get_content_cache_statistics(struct ContentCacheStatistics* statistics);
+
+/**
+    * Frees all unused entries and resets the cache.
+*/
+void clear_content_cache();
+
+#endif // CONTENT_CACHE_H
@@ -0,0 +1,69 @@
+/**
+    * @file: coroutine.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares the interface of the stackful
+    * coroutine runtime.
+    *
+    * Every accepted connection is served by a coroutine with a small
+    * stack instead of a thread. When a socket operation would block,
+    * the coroutine is parked and the scheduler resumes it once epoll
+    * reports the socket ready, so blocking-style handler code can
+    * serve a large number of mostly idle connections in one thread.
+*/
+
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include "common.h"
+
+/**
+    * Function which serves one accepted connection inside a coroutine.
+    *
+    * @param[in] client_socket The client socket descriptor, the
+    * function is responsible for closing it.
+*/
+typedef void (*ConnectionHandler)(int client_socket);
+
+/**
+    * Runs scheduler which accepts clients of a listening socket and
+    * serves each of them in its own coroutine.
+    *
+    * @param[in] server_fd The listening server socket descriptor.
+    * @param[in] handler The function serving accepted connection.
+    *
+    * This function returns when the server stops running, after all
+    * coroutines are resumed and finished.
+*/
+void run_coroutine_scheduler(int server_fd, ConnectionHandler handler);
+
+/**
+    * Checks whether the caller runs inside a coroutine.
+    *
+    * @return Returns 1 inside a coroutine, 0 otherwise.
+*/
+int is_in_coroutine();
+
+/**
+    * Parks the current coroutine until the socket becomes ready.
+    *
+    * @param[in] fd The socket descriptor to wait for.
+    * @param[in] events The epoll events to wait for (EPOLLIN or EPOLLOUT).
+    * @param[in] timeout_sec The maximum waiting time in seconds.
+    *
+    * @return Returns 0 when the socket is ready or error code on
+    * timeout, server shutdown or when called outside of a coroutine.
+*/
+enum ReturnCode wait_in_coroutine(int fd, unsigned int events, int timeout_sec);
+
+/**
+    * Requests all coroutine schedulers to stop.
+    *
+    * Running schedulers resume every parked coroutine with an error
+    * within one epoll timeout and then return.
+    *
+    * @note Safe to call from a signal handler.
+*/
+void stop_coroutine_schedulers();
+
+#endif // COROUTINE_H
@@ -0,0 +1,27 @@
+/**
+    * @file: event_loop.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares the interface of the event-driven
+    * connection engine.
+    *
+    * The engine multiplexes all client connections of a listening
+    * socket in one thread using epoll and non-blocking sockets,
+    * keeping a small state machine for every connection instead
+    * of a dedicated thread.
+*/
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+/**
+    * Runs event loop which accepts and serves clients of a listening socket.
+    *
+    * @param[in] server_fd The listening server socket descriptor.
+    *
+    * This function returns when the server stops running. All
+    * connections which are still open at that moment get closed.
+*/
+void run_event_loop(int server_fd);
+
+#endif // EVENT_LOOP_H
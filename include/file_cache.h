@@ -0,0 +1,82 @@
+/**
+    * @file: file_cache.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares the cache of open file descriptors
+    * and their fstat() results used by the GET path.
+    *
+    * Entries are keyed by resolved path and reference counted, so an
+    * entry may be invalidated or evicted while a response still
+    * sends from its descriptor. The descriptor is closed when the
+    * last reference is released.
+*/
+
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include "common.h"
+
+/**
+    * @struct CachedFile
+    * @brief Structure representing a file opened for reading.
+    *
+    * Only fd and stat are meant to be read by users, the rest is
+    * owned by the cache.
+*/
+struct CachedFile {
+    char path[MAX_PATH_LEN];        /**< Resolved path of the file. */
+    int fd;                         /**< Descriptor opened read-only. */
+    struct stat stat;               /**< fstat() result taken right after opening. */
+    unsigned int references;        /**< Number of users holding this entry. */
+    int is_cached;                  /**< Whether entry is still reachable through the table. */
+    struct CachedFile* bucket_next;
+    struct CachedFile* lru_prev;
+    struct CachedFile* lru_next;
+};
+
+/**
+    * Returns an entry for the file, opening and caching it on miss.
+    *
+    * @param[in] path The resolved path of the file.
+    *
+    * @return Returns pointer to the entry or NULL if the file couldn't
+    * be opened.
+    *
+    * @note Every successful call must be paired with release_file().
+*/
+struct CachedFile* acquire_file(const char* path);
+
+/**
+    * Releases an entry returned by acquire_file().
+    *
+    * @param[in] file The entry to release.
+*/
+void release_file(struct CachedFile* file);
+
+/**
+    * Removes the entry of a file which is modified or deleted.
+    *
+    * @param[in] path The resolved path of the file.
+    *
+    * Entries which are still in use keep their descriptor until they
+    * are released, new lookups open the file again.
+*/
+void invalidate_file(const char* path);
+
+/**
+    * Closes all unused cached descriptors and frees the cache.
+*/
+void clear_file_cache();
+
+/**
+    * Computes FNV-1a hash of a path.
+    *
+    * @param[in] path The null-terminated path.
+    *
+    * @return Returns 32-bit hash of the path.
+*/
+uint32_t hash_path(const char* path);
+
+#endif // FILE_CACHE_H
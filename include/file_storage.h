@@ -14,16 +14,68 @@
 #define FILE_STORAGE_H
 
 #include <unistd.h>
+#include "file_cache.h"
+#include "metadata_index.h"
+#include "chunked.h"
+#include "byte_range.h"
+
+/**
+    * @struct UploadFile
+    * @brief Represents a file being received.
+    *
+    * Data is written into a temporary file next to the target, which
+    * replaces the target only when the whole body is received.
+*/
+struct UploadFile {
+    int fd;                         /**< Descriptor of the temporary file. */
+    char temp_path[MAX_PATH_LEN];   /**< Path of the temporary file. */
+};
+
+/**
+    * Resolves a file name into path inside the server’s storage.
+    *
+    * @param[out] output The buffer of MAX_PATH_LEN bytes for the path.
+    * @param[in] filename The name of the file.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode set_file_location(char* output, const char* filename);
 
 /**
     * Sends a file to the specified client socket.
     *
     * @param[in] client_socket The client socket descriptor.
     * @param[in] filename The name of the file to send.
+    * @param[in] ranges The ranges of the file to send with their part
+    * heads, or NULL to send the whole file.
+    * @param[in,out] bytes_sent The counter increased by the number of sent bytes.
+    *
+    * @return Returns 0 on success or error code on failure.
+    *
+    * @note Content of a file which is not regular (a pipe or a device)
+    * is sent in chunked transfer coding until its end.
+*/
+enum ReturnCode send_file(int client_socket, const char* filename, const struct ByteRanges* ranges,
+                          unsigned long long* bytes_sent);
+
+/**
+    * Sends a file opened by open_file_for_reading() to the specified
+    * client socket.
+    *
+    * @param[in] client_socket The client socket descriptor.
+    * @param[in] file The opened file, whose stat the response head
+    * was created from.
+    * @param[in] ranges The ranges of the file to send with their part
+    * heads, or NULL to send the whole file.
+    * @param[in] is_close_delimited Whether content of a file which is
+    * not regular is sent as is, ended by closing the connection,
+    * instead of chunked transfer coding.
+    * @param[in,out] bytes_sent The counter increased by the number of sent bytes.
     *
     * @return Returns 0 on success or error code on failure.
 */
-enum ReturnCode send_file(int client_socket, const char* filename);
+enum ReturnCode send_opened_file(int client_socket, const struct CachedFile* file, const struct ByteRanges* ranges,
+                                 int is_close_delimited, unsigned long long* bytes_sent);
 
 /**
     * Receives a file from the specified client socket.
@@ -36,10 +88,114 @@ enum ReturnCode send_file(int client_socket, const char* filename);
     * @param[in] received_body_size The size of the initial received data.
     *
     * @return Returns 0 on success or error code on failure.
+    *
+    * @note An existing file is replaced only when the new one is
+    * received completely.
 */
 enum ReturnCode receive_file(int client_socket, const char* filename, size_t content_size,
                  const void* received_body, size_t received_body_size);
 
+/**
+    * Receives a file sent in chunked transfer coding, decoding it
+    * while it is received.
+    *
+    * @param[in] client_socket The client socket descriptor.
+    * @param[in] filename The name of the file to save as.
+    * @param[in,out] buffer The buffer holding the first part of the
+    * body, also used to receive the rest of it.
+    * @param[in] buffer_capacity The size of the buffer.
+    * @param[in,out] buffered_size The number of body bytes in the
+    * buffer. On return the bytes received after the body are at the
+    * start of the buffer and this is their count.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode receive_chunked_file(int client_socket, const char* filename, char* buffer,
+                                     size_t buffer_capacity, size_t* buffered_size);
+
+/**
+    * Opens a file from the server’s storage for reading through the
+    * descriptor cache.
+    *
+    * @param[in] filename The name of the file to open.
+    * @param[out] file The cache entry holding descriptor and stat of
+    * opened file.
+    *
+    * @return Returns 0 on success or error code on failure.
+    *
+    * @note Caller is responsible for passing the entry to
+    * close_file_for_reading(), the descriptor must not be closed.
+*/
+enum ReturnCode open_file_for_reading(const char* filename, struct CachedFile** file);
+
+/**
+    * Releases a file opened by open_file_for_reading().
+    *
+    * @param[in] file The cache entry of opened file.
+*/
+void close_file_for_reading(struct CachedFile* file);
+
+/**
+    * Creates a temporary file for receiving a file into the server’s
+    * storage.
+    *
+    * @param[in] filename The name of the file to receive.
+    * @param[out] file The opened temporary file.
+    *
+    * @return Returns 0 on success or error code on failure.
+    *
+    * @note Caller is responsible for passing the file to
+    * close_file_for_writing() or discard_file_for_writing().
+*/
+enum ReturnCode open_file_for_writing(const char* filename, struct UploadFile* file);
+
+/**
+    * Closes a completely received file and moves it into place, so
+    * next reads see the new content.
+    *
+    * @param[in] filename The name of the received file.
+    * @param[in,out] file The file opened by open_file_for_writing().
+    *
+    * @return Returns 0 on success or error code if the file couldn't
+    * replace the old one.
+*/
+enum ReturnCode close_file_for_writing(const char* filename, struct UploadFile* file);
+
+/**
+    * Closes and removes a partially received file, the old file is
+    * left untouched.
+    *
+    * @param[in,out] file The file opened by open_file_for_writing().
+*/
+void discard_file_for_writing(struct UploadFile* file);
+
+/**
+    * Writes the whole buffer into an opened file.
+    *
+    * @param[in] fd The descriptor of the file opened for writing.
+    * @param[in] data The data to write.
+    * @param[in] size The size of the data.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode write_to_file(int fd, const void* data, size_t size);
+
+/**
+    * Decodes received part of a chunked body and writes its data
+    * into an opened file.
+    *
+    * @param[in] fd The descriptor of the file opened for writing.
+    * @param[in,out] decoder The decoder of the body.
+    * @param[in,out] data The received bytes, decoded in place.
+    * @param[in,out] size The number of received bytes. On return the
+    * bytes following the complete body are at the start of data and
+    * this is their count, otherwise it is 0.
+    *
+    * @return Returns 0 on success or error code if the body is
+    * malformed or couldn't be written.
+*/
+enum ReturnCode write_chunked_to_file(int fd, struct ChunkedDecoder* decoder, char* data, size_t* size);
+
 /**
     * Deletes a file from the server’s file system.
     *
@@ -58,6 +214,16 @@ enum ReturnCode delete_file(const char* filename);
 */
 enum ReturnCode check_file_exists(const char* filename);
 
+/**
+    * Retrieves metadata of a file in the server’s storage.
+    *
+    * @param[in] filename The name of the file.
+    * @param[out] metadata The metadata of the file.
+    *
+    * @return Returns 0 if the file exists, or error code if it does not.
+*/
+enum ReturnCode get_file_metadata(const char* filename, struct FileMetadata* metadata);
+
 /**
     * Retrieves the size of a file in bytes.
     *
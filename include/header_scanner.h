@@ -0,0 +1,110 @@
+/**
+    * @file: header_scanner.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares functions used while receiving request
+    * headers: an incremental search of the blank line terminating
+    * them, and the receive buffer kept by every connection.
+    *
+    * The search resumes where the previous call stopped, so headers
+    * arriving in many small pieces are still scanned only once.
+*/
+
+#ifndef HEADER_SCANNER_H
+#define HEADER_SCANNER_H
+
+#include <stddef.h>
+#include "common.h"
+
+/**
+    * Finds the end of request headers in the received bytes.
+    *
+    * @param[in] buffer The buffer with received bytes.
+    * @param[in] size The number of received bytes.
+    * @param[in,out] scanned_size The number of bytes scanned by previous
+    * calls, must be 0 for a new request.
+    *
+    * @return Returns the size of headers including the terminating
+    * blank line, or 0 if the headers are not complete yet.
+    *
+    * @note SSE2 or AVX2 is used when the CPU supports it.
+*/
+size_t find_headers_end(const char* buffer, size_t size, size_t* scanned_size);
+
+/**
+    * @struct InputBuffer
+    * @brief Represents bytes received from a connection and not
+    * consumed by answered requests yet.
+    *
+    * The buffer lives as long as the connection, so bytes of pipelined
+    * requests received together with the current one are kept for
+    * the next request.
+*/
+struct InputBuffer {
+    char* data;                     /**< Received bytes. */
+    size_t size;                    /**< Number of received bytes. */
+    size_t capacity;                /**< Size of the allocated buffer. */
+    size_t scanned;                 /**< Part of data already searched for end of headers. */
+};
+
+/**
+    * Allocates a receive buffer of the initial capacity.
+    *
+    * @param[out] input The pointer to the buffer to initialize.
+    *
+    * @return Returns 0 on success or error code if memory is not allocated.
+*/
+enum ReturnCode initialize_input_buffer(struct InputBuffer* input);
+
+/**
+    * Frees memory of a receive buffer.
+    *
+    * @param[in,out] input The pointer to the buffer.
+*/
+void free_input_buffer(struct InputBuffer* input);
+
+/**
+    * Finds the end of request headers at the start of a receive buffer.
+    *
+    * @param[in,out] input The pointer to the buffer.
+    *
+    * @return Returns the size of headers including the terminating
+    * blank line, or 0 if the headers are not complete yet.
+    *
+    * @note When the headers are found the buffer may grow, so at least
+    * some space is left after them for receiving the body.
+*/
+size_t find_input_headers_end(struct InputBuffer* input);
+
+/**
+    * Checks whether complete headers of the next request follow the
+    * first request_size bytes of a receive buffer.
+    *
+    * @param[in] input The pointer to the buffer.
+    * @param[in] request_size The number of bytes of the current request.
+    *
+    * @return Returns 1 if the next request can be parsed without
+    * receiving, or 0 otherwise.
+*/
+int has_next_request(const struct InputBuffer* input, size_t request_size);
+
+/**
+    * Removes an answered request from the start of a receive buffer,
+    * moving bytes of the next requests to its start.
+    *
+    * @param[in,out] input The pointer to the buffer.
+    * @param[in] request_size The number of bytes of the answered request.
+*/
+void consume_input(struct InputBuffer* input, size_t request_size);
+
+/**
+    * Doubles the capacity of a receive buffer, up to max_header_size.
+    *
+    * @param[in,out] input The pointer to the buffer to reallocate.
+    *
+    * @return Returns 0 on success or error code if the buffer already
+    * reached max_header_size or memory is not allocated.
+*/
+enum ReturnCode grow_input_buffer(struct InputBuffer* input);
+
+#endif // HEADER_SCANNER_H
@@ -7,14 +7,16 @@
     *
     * It provides functionality for parsing HTTP requests, generating
     * responses, and managing various HTTP methods such as GET, POST,
-    * and DELETE. Additionally, it handles conversion between structured
-    * response data and raw HTTP message strings.
+    * and DELETE. Additionally, it splits structured response data into
+    * buffers sent with a single writev() call.
 */
 
 #ifndef HTTP_COMMUNICATION_H
 #define HTTP_COMMUNICATION_H
 
+#include <sys/uio.h>
 #include "http_messages.h"
+#include "content_cache.h"
 
 /**
     * Creates response and sends it.
@@ -27,36 +29,174 @@
 enum ReturnCode handle_request(int client_socket, struct Request* request);
 
 /**
-    * Parses a raw HTTP request string into a structured Request object.
+    * Sends a created response, without the file of a GET response.
     *
-    * @param[in] raw_request The raw HTTP request string.
+    * @param[in] client_socket The client socket descriptor.
+    * @param[in,out] request The pointer to parsed Request structure,
+    * its status code is set when the response is sent.
+    * @param[in,out] response The pointer to Response structure.
+    * @param[in] keep_alive Whether connection stays open after response.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode send_prepared_response(int client_socket, struct Request* request, struct Response* response,
+                                       int keep_alive);
+
+/**
+    * Sends response of a GET request from the in-memory content cache,
+    * loading the file into the cache on miss, or from the memory read
+    * by a concurrent request of the same file.
+    *
+    * @param[in] client_socket The client socket descriptor.
+    * @param[in] request The pointer to parsed Request structure.
+    *
+    * @return Returns 0 when response was sent, RET_CACHE_MISS when the
+    * request can't be served from cache and has to be answered
+    * regularly, or error code on failure.
+*/
+enum ReturnCode send_cached_response(int client_socket, struct Request* request);
+
+/**
+    * Finds cached response of a GET request, loading the file into
+    * the cache on miss.
+    *
+    * @param[in] request The pointer to parsed Request structure.
+    * @param[in] may_wait Whether the calling thread may block until
+    * a concurrent request of the same file reads it.
+    *
+    * @return Returns cache entry or NULL when the request can't be
+    * served from memory.
+    *
+    * @note Returned entry must be passed to release_content().
+*/
+struct CachedContent* find_cached_response(const struct Request* request, int may_wait);
+
+/**
+    * Fills buffers of a cached response for one writev() call.
+    *
+    * @param[in] content The cache entry.
+    * @param[in] keep_alive Whether connection stays open after response.
+    * @param[out] date_header The buffer of DATE_HEADER_SIZE bytes for
+    * the Date header, it must live until the response is sent.
+    * @param[out] iov The array of RESPONSE_IOV_COUNT buffers.
+    *
+    * @return Returns the number of filled buffers.
+*/
+int prepare_cached_response(const struct CachedContent* content, int keep_alive, char* date_header,
+                            struct iovec* iov);
+
+/**
+    * Serializes heads of the constant responses (404, 405, 201, 500, ...).
+    *
+    * @note Must be called once before requests are served.
+*/
+void initialize_responses();
+
+/**
+    * Creates response for the given request.
+    *
+    * @param[in] request The pointer to parsed Request structure.
+    *
+    * @return Returns a struct Response with status, headers and body.
     *
-    * @return Returns a struct Request containing the parsed request data.
+    * @note For successful GET response the file content is not
+    * included into body, it has to be sent separately from the file
+    * field: the whole file, or its ranges when the ranges field is
+    * set. The file must be passed to close_response_file().
 */
-struct Request parse_request(const char* raw_request);
+struct Response create_response(const struct Request* request);
 
 /**
-    * Determines whether the HTTP connection should remain open.
+    * Releases the file a response was created from, if any.
     *
-    * @param[in] headers The HTTP headers list.
+    * @param[in,out] response The response, its file field is reset.
+*/
+void close_response_file(struct Response* response);
+
+/**
+    * Creates an empty 500 Internal Server Error response.
+    *
+    * @param[in] arena The arena of the connection.
+    *
+    * @return Returns a struct Response with pre-serialized head.
+*/
+struct Response create_error_response(struct Arena* arena);
+
+/**
+    * Sends an empty 500 Internal Server Error response, after which
+    * the connection has to be closed.
+    *
+    * @param[in] client_socket The client socket descriptor.
+    * @param[in,out] request The pointer to parsed Request structure.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode send_error_response(int client_socket, struct Request* request);
+
+/**
+    * Fills buffers of a response for one writev() call: the head
+    * (status line and headers), the Date header, the connection
+    * headers and the body.
+    *
+    * @param[in,out] response The pointer to Response structure, its
+    * head is serialized into the arena unless it is pre-serialized.
+    * @param[in] keep_alive Whether connection stays open after response.
+    * @param[out] iov The array of RESPONSE_IOV_COUNT buffers.
     *
-    * @return Returns 1 if the connection should be kept alive,
-    * or 0 if it should be closed.
+    * @return Returns the number of filled buffers, or error code if
+    * memory for the head is not allocated.
+    *
+    * @note Buffers point into the response, which must live until
+    * the response is sent.
+*/
+int prepare_response(struct Response* response, int keep_alive, struct iovec* iov);
+
+/**
+    * Parses a raw HTTP request in a single pass, without copying it.
+    *
+    * @param[in,out] raw_request The buffer holding received request,
+    * which must contain the whole header block.
+    * @param[in] raw_request_size The number of received bytes, including
+    * the part of the body and pipelined requests received with the headers.
+    * @param[out] request The pointer to Request structure to fill.
+    *
+    * @return Returns 0 on success or error code if the request is malformed.
+    *
+    * @note Fields of the request point into raw_request. The byte after
+    * the path is overwritten with NUL, so the path is a regular string.
+    * The body is limited by Content-Length, the size field tells where
+    * the next request starts.
+*/
+enum ReturnCode parse_request(char* raw_request, size_t raw_request_size, struct Request* request);
+
+/**
+    * Checks whether part of the request body is still to be received.
+    *
+    * @param[in] request The pointer to parsed Request structure.
+    *
+    * @return Returns 1 if the body is chunked or longer than its part
+    * received with the headers, or 0 otherwise.
 */
-int is_keep_alive(const struct HeaderList headers);
+int is_body_pending(const struct Request* request);
 
 /**
-    * Deallocates memory of request and headers list.
+    * Checks whether the file has to be sent after the response head.
+    *
+    * @param[in] request The pointer to parsed Request structure.
+    * @param[in] response The pointer to created Response structure.
     *
-    * @param[in] request The pointer to Request structure.
+    * @return Returns 1 for 200 and 206 responses to GET created from
+    * an opened file, or 0 otherwise.
 */
-void free_request(struct Request* request);
+int is_file_response(const struct Request* request, const struct Response* response);
 
 /**
-    * Deallocates memory of response and headers list.
+    * Extracts numeric status code from a response status line.
+    *
+    * @param[in] status_line The status line (e.g., HTTP/1.1 200 OK).
     *
-    * @param[in] response The pointer to Response structure.
+    * @return Returns status code or 0 if the line is malformed.
 */
-void free_response(struct Response* response);
+int parse_status_code(const char* status_line);
 
 #endif // HTTP_COMMUNICATION_H
\ No newline at end of file
@@ -7,7 +7,7 @@
     * check, and free HTTP headers in a structured HeaderList.
     *
     * The HeaderList structure allows dynamic storage of multiple
-    * headers and ensures proper memory management.
+    * headers in the arena of the connection.
 */
 
 #ifndef HTTP_HEADER_H
@@ -45,12 +45,70 @@ void add_header_formatted(struct HeaderList* list, const char* key, const char*
 const char* get_header_value(const struct HeaderList* list, const char* key);
 
 /**
-    * Frees all memory associated with a HeaderList.
+    * Retrieves the value of a header of received request by its key.
     *
-    * @param[in,out] list Pointer to the HeaderList to be freed.
+    * @param[in] request Pointer to the parsed Request.
+    * @param[in] key The name of the header to retrieve, compared case-insensitively.
     *
-    * @note After calling this function, the list will be empty.
+    * @return Returns the view of header value, or a view with NULL data
+    * if the header does not exist.
 */
-void free_headers(struct HeaderList* list);
+struct StringView get_request_header(const struct Request* request, const char* key);
+
+/**
+    * Classifies a header name using a perfect hash of known names.
+    *
+    * @param[in] key The header name.
+    *
+    * @return Returns the known header or HEADER_UNKNOWN.
+*/
+enum KnownHeader classify_header(struct StringView key);
+
+/**
+    * Compares a view with a string case-insensitively.
+    *
+    * @param[in] view The view to compare.
+    * @param[in] string The NUL-terminated string to compare with.
+    *
+    * @return Returns 1 if they are equal, or 0 otherwise.
+*/
+int is_view_equal(struct StringView view, const char* string);
+
+/**
+    * Copies the Date header line of the current second, ending with CRLF.
+    *
+    * @param[out] buffer The buffer of DATE_HEADER_SIZE bytes.
+    *
+    * @note The line is formatted at most once per second in every thread.
+*/
+void get_date_header(char* buffer);
+
+/**
+    * Formats a time as HTTP-date, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+    *
+    * @param[in] time The time to format.
+    * @param[out] buffer The buffer of HTTP_DATE_SIZE bytes.
+*/
+void format_http_date(time_t time, char* buffer);
+
+/**
+    * Parses HTTP-date in the IMF-fixdate format.
+    *
+    * @param[in] value The date, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+    * @param[out] time The parsed time.
+    *
+    * @return Returns 0 on success or error code if the date is invalid.
+    *
+    * @note The obsolete RFC 850 and asctime() formats are not accepted.
+*/
+enum ReturnCode parse_http_date(struct StringView value, time_t* time);
+
+/**
+    * Initializes an empty HeaderList.
+    *
+    * @param[out] list Pointer to the HeaderList to initialize.
+    * @param[in] arena The arena headers will be allocated from.
+*/
+void initialize_headers(struct HeaderList* list, struct Arena* arena);
 
 #endif // HTTP_HEADER_H
\ No newline at end of file
@@ -7,15 +7,26 @@
     *
     * It contains structure used for containing parsed requests
     * and responses.
+    *
+    * Parsed requests don't own any memory: their fields are views
+    * into the buffer the request was received into, so the buffer
+    * must outlive the request. Responses are allocated from the arena
+    * of the connection.
 */
 
 #ifndef HTTP_MESSAGES_H
 #define HTTP_MESSAGES_H
 
+#include <time.h>
+#include <stdint.h>
 #include "common.h"
+#include "arena.h"
 
 typedef unsigned long size_t;
 
+struct ByteRanges;
+struct CachedFile;
+
 enum Method {
     UNKNOWN,
     GET,
@@ -23,6 +34,44 @@ enum Method {
     DELETE
 };
 
+/**
+    * @enum KnownHeader
+    * @brief Represents request headers the server interprets, which
+    * are classified once while parsing.
+*/
+enum KnownHeader {
+    HEADER_CONNECTION,
+    HEADER_CONTENT_LENGTH,
+    HEADER_EXPECT,
+    HEADER_HOST,
+    HEADER_TRANSFER_ENCODING,
+    HEADER_RANGE,
+    HEADER_IF_RANGE,
+    HEADER_IF_NONE_MATCH,
+    HEADER_IF_MODIFIED_SINCE,
+    KNOWN_HEADERS_COUNT,
+    HEADER_UNKNOWN = KNOWN_HEADERS_COUNT
+};
+
+/**
+    * @struct StringView
+    * @brief Represents a byte range of another buffer, which isn't
+    * necessarily terminated.
+*/
+struct StringView {
+    const char* data;
+    size_t length;
+};
+
+/**
+    * @struct RequestHeader
+    * @brief Represents HTTP header of received request.
+*/
+struct RequestHeader {
+    struct StringView key;
+    struct StringView value;    /**< The value without surrounding whitespace. */
+};
+
 /**
     * @struct Header
     * @brief Represents HTTP header in packet.
@@ -39,6 +88,8 @@ struct Header {
 struct HeaderList {
     struct Header* items;
     size_t size;
+    size_t capacity;
+    struct Arena* arena;        /**< Arena headers are allocated from. */
 };
 
 /**
@@ -47,11 +98,21 @@ struct HeaderList {
 */
 struct Request {
     enum Method method;                 /**< The HTTP method (e.g., GET, POST, DELETE). */
-    char path[MAX_PATH_LEN];            /**< The requested path or resource URI. */
-    char version[HTTP_VERSION_SIZE];    /**< The HTTP version (e.g., HTTP/1.1). */
-    struct HeaderList headers;          /**< Parsed headers as key-value pairs. */
-    char* body;                         /**< Pointer to the request body (optional). */
-    size_t body_size;                   /**< Size of the request body in bytes. */
+    struct StringView path;             /**< The requested path, also terminated in the receive buffer. */
+    struct StringView version;          /**< The HTTP version (e.g., HTTP/1.1). */
+    struct RequestHeader headers[MAX_REQUEST_HEADERS];  /**< Parsed headers as key-value pairs. */
+    size_t headers_count;               /**< Number of parsed headers. */
+    struct StringView known_headers[KNOWN_HEADERS_COUNT];  /**< Values of known headers, NULL data if missing. */
+    uint64_t content_length;            /**< Value of Content-Length, 0 if it is missing. */
+    int is_chunked;                     /**< Whether the body is sent in chunked transfer coding. */
+    int keep_alive;                     /**< Whether connection stays open, by default for HTTP/1.1. */
+    int expect_continue;                /**< Whether client waits for 100 Continue before sending body. */
+    struct StringView body;             /**< Part of the body received with the headers (optional). */
+    size_t size;                        /**< Number of received bytes of the request: headers and buffered body. */
+    struct Arena* arena;                /**< Arena of the connection, reset after the request is answered. */
+    struct timespec received_time;      /**< Monotonic time the request headers were received. */
+    int status_code;                    /**< Status code of the sent response, 0 if nothing was sent. */
+    unsigned long long bytes_sent;      /**< Number of response bytes sent to the client. */
 };
 
 /**
@@ -64,8 +125,14 @@ struct Request {
 struct Response {
     char status[HTTP_STATUS_SIZE];      /**< The HTTP status line (e.g., 200 OK). */
     struct HeaderList headers;          /**< Parsed headers as key-value pairs. */
-    char* body;                         /**< Pointer to the response body (optional). */
+    const char* head;                   /**< Serialized status line and headers, NULL until prepared. */
+    size_t head_size;                   /**< Size of the serialized head in bytes. */
+    char date[DATE_HEADER_SIZE];        /**< Date header line of the response. */
+    const char* body;                   /**< Pointer to the response body (optional). */
     size_t body_size;                   /**< Size of the response body in bytes. */
+    const struct ByteRanges* ranges;    /**< Ranges of the file sent after the head, NULL for the whole file. */
+    struct CachedFile* file;            /**< Opened file the head was created from, NULL if it has no file body. */
+    int is_close_delimited;             /**< Whether the body ends when the connection is closed, for HTTP/1.0. */
 };
 
 #endif // HTTP_MESSAGES_h
\ No newline at end of file
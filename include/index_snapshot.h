@@ -0,0 +1,59 @@
+/**
+    * @file: index_snapshot.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares functions responsible for persisting
+    * the metadata index between runs of the server.
+    *
+    * A snapshot is a single file which is mapped into memory at
+    * startup and validated before any of it is used, so restarting
+    * with a huge storage root doesn't have to walk it before serving.
+    * Snapshots are written on stop and periodically in background.
+*/
+
+#ifndef INDEX_SNAPSHOT_H
+#define INDEX_SNAPSHOT_H
+
+#include "common.h"
+
+/**
+    * Writes the current metadata index into a snapshot file.
+    *
+    * @param[in] snapshot_file The path to the snapshot file.
+    * @param[in] root_directory The root directory the index belongs to.
+    *
+    * @return Returns 0 on success or error code on failure.
+    *
+    * @note The snapshot is written into a temporary file which is then
+    * renamed, so a crash never leaves a truncated snapshot behind.
+*/
+enum ReturnCode save_index_snapshot(const char* snapshot_file, const char* root_directory);
+
+/**
+    * Maps a snapshot file, validates it and restores its entries into
+    * the metadata index.
+    *
+    * @param[in] snapshot_file The path to the snapshot file.
+    * @param[in] root_directory The root directory the index belongs to.
+    *
+    * @return Returns 0 on success or error code if the snapshot is
+    * missing or invalid, in which case the index is left empty.
+*/
+enum ReturnCode load_index_snapshot(const char* snapshot_file, const char* root_directory);
+
+/**
+    * Restores the metadata index from the configured snapshot or
+    * builds it by scanning the root directory, then starts background
+    * rescan and periodic snapshots.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode start_metadata_index();
+
+/**
+    * Stops background work, saves the final snapshot and frees the
+    * metadata index.
+*/
+void stop_metadata_index();
+
+#endif // INDEX_SNAPSHOT_H
@@ -0,0 +1,90 @@
+/**
+    * @file: io_uring_backend.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares the io_uring based I/O backend.
+    *
+    * The backend submits accept, recv, send, file read/write and
+    * open/close operations as batched submission queue entries, so
+    * disk and network transfers of one request overlap and every
+    * step costs fewer system calls. Every thread lazily gets its
+    * own ring which is released when the thread exits.
+*/
+
+#ifndef IO_URING_BACKEND_H
+#define IO_URING_BACKEND_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "common.h"
+
+/**
+    * Checks whether io_uring can be used by the calling thread.
+    *
+    * @return Returns 1 if the ring of calling thread is ready, 0 if
+    * the kernel does not support io_uring or refused to set it up.
+*/
+int is_io_uring_available();
+
+/**
+    * Opens a file using io_uring.
+    *
+    * @param[in] path The path of the file.
+    * @param[in] flags The open(2) flags.
+    * @param[in] mode The mode for created file.
+    *
+    * @return Returns file descriptor or -1 on failure.
+*/
+int io_uring_open_file(const char* path, int flags, mode_t mode);
+
+/**
+    * Closes a descriptor using io_uring.
+    *
+    * @param[in] fd The descriptor to close.
+*/
+void io_uring_close_file(int fd);
+
+/**
+    * Accepts a connection on listening socket using io_uring.
+    *
+    * @param[in] server_fd The listening socket descriptor.
+    *
+    * @return Returns client socket descriptor or -1 on failure.
+*/
+int io_uring_accept_connection(int server_fd);
+
+/**
+    * Sends a part of an opened file to the client socket.
+    *
+    * Reading the next chunk of file is submitted together with
+    * sending the current one, so disk and network work overlap.
+    *
+    * @param[in] client_socket The client socket descriptor.
+    * @param[in] fd The descriptor of the file to send.
+    * @param[in] offset The offset of the first byte to send.
+    * @param[in] size The number of bytes to send.
+    *
+    * @return Returns 0 on success or error code on failure, also when
+    * the file ends before size bytes are sent.
+*/
+enum ReturnCode io_uring_send_file(int client_socket, int fd, off_t offset, size_t size);
+
+/**
+    * Receives data from the client socket into an opened file.
+    *
+    * Writing of the current chunk is submitted together with
+    * receiving the next one. Every receive is limited by the
+    * client timeout.
+    *
+    * @param[in] client_socket The client socket descriptor.
+    * @param[in] fd The descriptor of the file to write.
+    * @param[in] file_size The total size of the file to receive.
+    * @param[in] received_body Optional data already received with headers.
+    * @param[in] received_body_size The size of already received data.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode io_uring_receive_file(int client_socket, int fd, size_t file_size,
+                                      const void* received_body, size_t received_body_size);
+
+#endif // IO_URING_BACKEND_H
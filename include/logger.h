@@ -7,12 +7,27 @@
     *
     * It provides functions for writing formatted log messages
     * to log file, categorized by levels such as DEBUG, INFO,
-    * WARN, ERROR, and FATAL.
+    * WARN, ERROR, and FATAL. Messages are buffered and written
+    * by a background thread, so logging never waits for the file.
+    *
+    * Messages below the configured level are filtered before their
+    * arguments are evaluated, and messages below LOG_COMPILE_LEVEL
+    * are removed by the compiler altogether.
 */
 
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <stdatomic.h>
+
+/**
+    * Messages below this level are removed at compile time, numbers
+    * follow enum Level (0 keeps DEBUG, 2 keeps only WARN and above).
+*/
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
 /**
     * @enum Level
     * @brief Represents the severity level of a log message.
@@ -25,10 +40,17 @@ enum Level {
     FATAL   /**< Critical errors that cause program exit. */
 };
 
+/** Current minimum level of logged messages, use set_log_level() to change it. */
+extern atomic_int g_log_level;
+
 /**
-    * Initializes logger by opening log file.
+    * Initializes logger by opening log file and starting the thread
+    * which writes buffered records into it.
     *
     * @return Returns 0 on success or error code if log file opening fails.
+    *
+    * @note If the thread can't be started, messages are written
+    * synchronously.
 */
 enum ReturnCode initialize_logger();
 
@@ -37,18 +59,58 @@ enum ReturnCode initialize_logger();
     *
     * @param[in] level The severity level of the message.
     * @param[in] message The message string to log.
+    *
+    * @note Once the logger is initialized, messages longer than 511
+    * bytes are cut and end with "...".
 */
 void log_message(enum Level level, const char* message);
 
 /**
-    * Deinitializes logger by closing log file.
+    * Formats and logs a message with the specified severity level.
+    *
+    * @param[in] level The severity level of the message.
+    * @param[in] format The printf-style format of the message.
+    *
+    * @note Use LOG_*F macros, which skip formatting of disabled levels.
+    * Messages longer than 511 bytes are cut and end with "...".
+*/
+void log_formatted(enum Level level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+    * Changes the minimum level of logged messages at runtime.
+    *
+    * @param[in] level The new minimum level.
+*/
+void set_log_level(enum Level level);
+
+/**
+    * Deinitializes logger by writing buffered records, stopping the
+    * flush thread and closing log file.
+    *
+    * @note Must be called when no other thread logs anymore.
 */
 void deinitialize_logger();
 
-#define LOG_DEBUG(msg)  log_message(DEBUG, (msg))
-#define LOG_INFO(msg)   log_message(INFO, (msg))
-#define LOG_WARN(msg)   log_message(WARN, (msg))
-#define LOG_ERROR(msg)  log_message(ERROR, (msg))
-#define LOG_FATAL(msg)  log_message(FATAL, (msg))
+#define IS_LOG_LEVEL_ENABLED(level) \
+    ((level) >= LOG_COMPILE_LEVEL && (level) >= atomic_load_explicit(&g_log_level, memory_order_relaxed))
+
+#define LOG_AT_LEVEL(level, msg) \
+    do { if (IS_LOG_LEVEL_ENABLED(level)) log_message((level), (msg)); } while (0)
+
+// Arguments are evaluated only when the level is enabled.
+#define LOG_FORMATTED_AT_LEVEL(level, ...) \
+    do { if (IS_LOG_LEVEL_ENABLED(level)) log_formatted((level), __VA_ARGS__); } while (0)
+
+#define LOG_DEBUG(msg)  LOG_AT_LEVEL(DEBUG, msg)
+#define LOG_INFO(msg)   LOG_AT_LEVEL(INFO, msg)
+#define LOG_WARN(msg)   LOG_AT_LEVEL(WARN, msg)
+#define LOG_ERROR(msg)  LOG_AT_LEVEL(ERROR, msg)
+#define LOG_FATAL(msg)  LOG_AT_LEVEL(FATAL, msg)
+
+#define LOG_DEBUGF(...) LOG_FORMATTED_AT_LEVEL(DEBUG, __VA_ARGS__)
+#define LOG_INFOF(...)  LOG_FORMATTED_AT_LEVEL(INFO, __VA_ARGS__)
+#define LOG_WARNF(...)  LOG_FORMATTED_AT_LEVEL(WARN, __VA_ARGS__)
+#define LOG_ERRORF(...) LOG_FORMATTED_AT_LEVEL(ERROR, __VA_ARGS__)
+#define LOG_FATALF(...) LOG_FORMATTED_AT_LEVEL(FATAL, __VA_ARGS__)
 
 #endif // LOGGER_H
\ No newline at end of file
@@ -0,0 +1,122 @@
+/**
+    * @file: metadata_index.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares the in-memory index of file metadata
+    * used to answer existence checks, sizes and 404 decisions
+    * without system calls.
+    *
+    * The index is built by scanning the root directory at startup, or
+    * restored from a snapshot and rescanned in the background, and
+    * kept current by uploads and deletions made through the server.
+    * Paths which are not in the index are looked up with stat() once
+    * and recent misses are remembered for a short time, so repeated
+    * requests for a missing file don't reach the filesystem either.
+*/
+
+#ifndef METADATA_INDEX_H
+#define METADATA_INDEX_H
+
+#include <time.h>
+#include <sys/stat.h>
+#include "common.h"
+
+/**
+    * @struct FileMetadata
+    * @brief Structure representing metadata of an indexed file.
+*/
+struct FileMetadata {
+    off_t size;                 /**< Size of the file in bytes. */
+    struct timespec mtime;      /**< Time of last modification. */
+    ino_t inode;                /**< Inode number of the file. */
+    int is_regular;             /**< Whether size is the length of the content, false for devices and pipes. */
+};
+
+/**
+    * @brief Function called for every entry of the index.
+    *
+    * @param[in] path The resolved path of the entry.
+    * @param[in] metadata The metadata of the entry.
+    * @param[in] is_directory Whether the entry is a directory.
+    * @param[in] context The context passed to for_each_metadata().
+*/
+typedef void (*MetadataVisitor)(const char* path, const struct FileMetadata* metadata,
+                                int is_directory, void* context);
+
+/**
+    * Scans a directory recursively and indexes every regular file.
+    *
+    * @param[in] root_directory The root directory of the storage.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode build_metadata_index(const char* root_directory);
+
+/**
+    * Looks up metadata of a file, consulting the filesystem only if
+    * the path is neither indexed nor recently missed.
+    *
+    * @param[in] path The resolved path of the file.
+    * @param[out] metadata The structure to fill, may be NULL.
+    *
+    * @return Returns 0 if the file exists or error code otherwise,
+    * directories are reported as missing.
+*/
+enum ReturnCode lookup_metadata(const char* path, struct FileMetadata* metadata);
+
+/**
+    * Stores metadata of a file which was written by the server.
+    *
+    * @param[in] path The resolved path of the file.
+    * @param[in] stat The result of fstat() on the written file.
+*/
+void update_metadata(const char* path, const struct stat* stat);
+
+/**
+    * Forgets everything known about a modified or deleted file, so
+    * the next lookup reaches the filesystem.
+    *
+    * @param[in] path The resolved path of the file.
+*/
+void invalidate_metadata(const char* path);
+
+/**
+    * Adds an entry loaded from a snapshot. It is answered with stat()
+    * until rescan_metadata_index() confirms it.
+    *
+    * @param[in] path The resolved path of the entry.
+    * @param[in] metadata The saved metadata of the entry.
+    * @param[in] is_directory Whether the entry is a directory.
+*/
+void restore_metadata(const char* path, const struct FileMetadata* metadata, int is_directory);
+
+/**
+    * Compares restored directories with the filesystem, lists those
+    * which changed and confirms or drops restored entries.
+    *
+    * @note Runs until finished or stop_metadata_rescan() is called.
+*/
+void rescan_metadata_index();
+
+/**
+    * Asks a running rescan or scan to return as soon as possible.
+*/
+void stop_metadata_rescan();
+
+/**
+    * Calls a visitor for every entry of the index.
+    *
+    * @param[in] visitor The function to call, it must not use the index.
+    * @param[in] context The pointer passed to the visitor.
+    *
+    * @note Directories listed by an unfinished rescan are reported with
+    * zero mtime, so a snapshot taken meanwhile lists them again.
+*/
+void for_each_metadata(MetadataVisitor visitor, void* context);
+
+/**
+    * Frees all entries of the index.
+*/
+void clear_metadata_index();
+
+#endif // METADATA_INDEX_H
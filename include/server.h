@@ -23,14 +23,26 @@
 /**
     * Starts the server and initializes all required components.
     *
-    * This function sets up signal handling, loads configuration,
-    * creates and binds the server socket, and begins handling client
+    * This function loads configuration, creates and binds the server
+    * socket, starts the signal thread and begins handling client
     * requests until termination.
 */
 void server_start();
 
+/**
+    * Asks the server to stop: serving loops return, and accept()
+    * blocked on a listener is woken up.
+    *
+    * @note It doesn't release anything, so it can be called from any
+    * thread while connections are still being served.
+*/
+void request_server_stop();
+
 /**
     * Stops the server and closes server socket.
+    *
+    * @note Must be called once, after server_start() returned and all
+    * threads serving connections were joined.
 */
 void server_stop();
 
@@ -0,0 +1,124 @@
+/**
+    * @file: socket_io.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares socket I/O functions shared by all
+    * connection modes.
+    *
+    * Outside of a coroutine they behave exactly like blocking recv()
+    * and send(). Inside a coroutine the socket is non-blocking, and
+    * the current coroutine is parked instead of blocking the thread.
+*/
+
+#ifndef SOCKET_IO_H
+#define SOCKET_IO_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "common.h"
+
+/**
+    * Receives data from the socket.
+    *
+    * @param[in] socket The socket descriptor.
+    * @param[out] buffer The buffer for received data.
+    * @param[in] length The size of the buffer.
+    * @param[in] flags The recv() flags.
+    *
+    * @return Returns number of received bytes, 0 if peer closed
+    * connection or -1 on failure or timeout.
+*/
+ssize_t socket_recv(int socket, void* buffer, size_t length, int flags);
+
+/**
+    * Sends data to the socket.
+    *
+    * @param[in] socket The socket descriptor.
+    * @param[in] buffer The data to send.
+    * @param[in] length The size of the data.
+    * @param[in] flags The send() flags.
+    *
+    * @return Returns number of sent bytes or -1 on failure or timeout.
+    *
+    * @note Inside a coroutine the whole buffer is sent before return,
+    * same as blocking send() does.
+*/
+ssize_t socket_send(int socket, const void* buffer, size_t length, int flags);
+
+/**
+    * Sends data gathered from several buffers with one system call.
+    *
+    * @param[in] socket The socket descriptor.
+    * @param[in,out] iov The buffers to send, advanced past sent bytes
+    * so the same array can be passed again to send the rest.
+    * @param[in] iov_count The number of buffers.
+    *
+    * @return Returns number of sent bytes or -1 on failure or timeout.
+    * Outside a coroutine a non-blocking socket which is not ready
+    * fails with errno EAGAIN.
+    *
+    * @note Inside a coroutine all buffers are sent before return,
+    * outside of it only one sendmsg() is made.
+*/
+ssize_t socket_writev(int socket, struct iovec* iov, int iov_count);
+
+/**
+    * Sends part of a file to the socket with sendfile(), so file data
+    * never crosses into user space.
+    *
+    * @param[in] socket The socket descriptor.
+    * @param[in] fd The descriptor of the file to send.
+    * @param[in,out] offset The file offset to send from, advanced by
+    * the number of sent bytes.
+    * @param[in] count The maximum number of bytes to send.
+    *
+    * @return Returns number of sent bytes, 0 at the end of file or -1
+    * on failure or timeout. Outside a coroutine a non-blocking socket
+    * which is not ready fails with errno EAGAIN.
+    *
+    * @note Fewer than count bytes may be sent, the caller is expected
+    * to call it again for the rest. When the file does not support
+    * sendfile() one buffer is copied with pread() and send() instead.
+*/
+ssize_t socket_sendfile(int socket, int fd, off_t* offset, size_t count);
+
+/**
+    * Receives data from the socket straight into a file with splice()
+    * through a pipe, so data never crosses into user space.
+    *
+    * @param[in] socket The socket descriptor.
+    * @param[in] fd The descriptor of the file opened for writing.
+    * @param[in] count The maximum number of bytes to receive.
+    *
+    * @return Returns number of received bytes, all of them already
+    * written into the file, 0 if peer closed connection or -1 on
+    * failure or timeout. Outside a coroutine a non-blocking socket
+    * which is not ready fails with errno EAGAIN.
+    *
+    * @note Fewer than count bytes may be received, the caller is
+    * expected to call it again for the rest. When a pipe couldn't be
+    * created one buffer is copied with recv() and write() instead.
+*/
+ssize_t socket_splice_to_file(int socket, int fd, size_t count);
+
+/**
+    * Corks or uncorks the socket, so responses to pipelined requests
+    * are coalesced into full segments instead of one send each.
+    *
+    * @param[in] socket The socket descriptor.
+    * @param[in,out] is_corked The current state of the socket, updated
+    * on success.
+    * @param[in] should_cork Whether the socket has to be corked.
+    *
+    * @note Uncorking flushes everything written while the socket was corked.
+*/
+void socket_set_cork(int socket, int* is_corked, int should_cork);
+
+/**
+    * Returns the number of file bytes sent through the zero-copy path.
+    *
+    * @return Returns total count of bytes sent by sendfile().
+*/
+unsigned long long get_zero_copy_bytes_count();
+
+#endif // SOCKET_IO_H
@@ -0,0 +1,55 @@
+/**
+    * @file: thread_pool.h
+    * @author: Dmytro Kovalchuk
+    *
+    * This header file declares the interface of the fixed-size
+    * worker pool used for request execution.
+    *
+    * Every worker owns a deque of tasks. Workers take tasks from
+    * the bottom of their own deque and steal from the top of other
+    * workers' deques when they run out of work, so the load stays
+    * balanced without creating threads on the hot path.
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "common.h"
+
+/**
+    * Function executed by a worker as a task.
+    *
+    * @param[in] arg The argument passed on task submission.
+*/
+typedef void (*TaskFunction)(void* arg);
+
+/**
+    * Starts worker threads of the pool.
+    *
+    * @param[in] workers_count The number of workers to start,
+    * 0 means the number of online CPU cores.
+    *
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode initialize_thread_pool(unsigned int workers_count);
+
+/**
+    * Submits a task for execution by the pool.
+    *
+    * @param[in] function The function to execute.
+    * @param[in] arg The argument passed to the function.
+    *
+    * @return Returns 0 on success or error code on failure.
+    *
+    * @note Tasks submitted by a worker are put into its own deque,
+    * tasks submitted by other threads are distributed round-robin.
+*/
+enum ReturnCode submit_task(TaskFunction function, void* arg);
+
+/**
+    * Stops the pool after all queued tasks are executed and joins
+    * worker threads.
+*/
+void deinitialize_thread_pool();
+
+#endif // THREAD_POOL_H
@@ -5,22 +5,40 @@
     * This header file declares utility functions used across
     * the server application.
     *
-    * It primarily includes signal handling function that allow
-    * the server to terminate safely upon receiving SIGINT.
+    * It primarily includes signal handling functions that allow
+    * the server to terminate safely upon receiving SIGINT and to
+    * change its log level upon receiving SIGHUP.
+    *
+    * Signals are never handled asynchronously: they are blocked in
+    * every thread and a dedicated thread receives them with sigwait(),
+    * so whatever they trigger runs in a regular thread context.
 */
 
 #ifndef UTILS_H
 #define UTILS_H
 
+#include "common.h"
+
 /**
-    * @brief Handles SIGINT (Ctrl+C) signal for safe shutdown.
+    * Blocks signals handled by the signal thread in the calling thread.
     *
-    * This function is triggered when the server process receives
-    * a SIGINT signal. It ensures that all that the server shuts down
-    * in a safely manner.
+    * @note Must be called by main() before any other thread is
+    * created, so that all of them inherit the blocked mask.
+*/
+void block_server_signals();
+
+/**
+    * Starts the thread which waits for SIGINT (Ctrl+C) and asks the
+    * server to stop when it arrives. On SIGHUP it re-reads log_level
+    * from the configuration file and applies it.
     *
-    * @param sig The signal number received by the process.
+    * @return Returns 0 on success or error code on failure.
+*/
+enum ReturnCode start_signal_thread();
+
+/**
+    * Stops and joins the signal thread if it was started.
 */
-void handle_sigint(int sig);
+void stop_signal_thread();
 
-#endif
\ No newline at end of file
+#endif
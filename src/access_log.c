@@ -0,0 +1,260 @@
+/**
+    * @file: access_log.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the binary access log.
+    *
+    * Deciding whether a request is logged costs one atomic increment,
+    * so unsampled requests don't pay for anything else. Records of
+    * logged requests are copied into the active buffer under a mutex.
+    * A full buffer is handed to the flush thread, which writes it to
+    * the file outside the mutex, so request threads never wait for
+    * the disk. The flush thread also takes the active buffer once per
+    * ACCESS_LOG_FLUSH_INTERVAL_SEC and on stop. When all buffers wait
+    * for the disk, new records are dropped and counted. Records are
+    * in native byte order.
+*/
+
+#include "../include/access_log.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "../include/logger.h"
+#include "../include/config.h"
+
+#define ACCESS_LOG_BUFFER_SIZE (64 * 1024)
+#define ACCESS_LOG_BUFFERS_COUNT 4
+#define ACCESS_LOG_FLUSH_INTERVAL_SEC 1
+
+/**
+    * @struct AccessLogBuffer
+    * @brief Block of records written to the file with one write().
+*/
+struct AccessLogBuffer {
+    char data[ACCESS_LOG_BUFFER_SIZE];
+    size_t size;
+};
+
+static int access_log_fd = -1;
+static pthread_mutex_t access_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flush_wakeup;
+static pthread_t flush_thread;
+static int is_flush_thread_stopping = 0;
+// Buffers before active_buffer (modulo ACCESS_LOG_BUFFERS_COUNT) wait for the flush thread.
+static struct AccessLogBuffer buffers[ACCESS_LOG_BUFFERS_COUNT];
+static size_t active_buffer = 0;
+static size_t full_buffers_count = 0;
+static unsigned long long dropped_records_count = 0;
+static atomic_ullong requests_count = 0;
+
+static void write_buffer(const char* data, size_t size) {
+    size_t written_bytes = 0;
+    while (written_bytes < size) {
+        ssize_t result = write(access_log_fd, data + written_bytes, size - written_bytes);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERRORF("Couldn't write access log: %s", strerror(errno));
+            break;
+        }
+        written_bytes += (size_t)result;
+    }
+}
+
+static enum ReturnCode write_file_header() {
+    struct stat file_stat;
+    if (fstat(access_log_fd, &file_stat) != RET_SUCCESS) return RET_ERROR;
+    if (file_stat.st_size > 0) return RET_SUCCESS;
+
+    struct AccessLogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ACCESS_LOG_MAGIC, sizeof(ACCESS_LOG_MAGIC));
+    header.version = ACCESS_LOG_VERSION;
+    header.record_size = sizeof(struct AccessLogRecord);
+
+    write_buffer((const char*)&header, sizeof(header));
+    return RET_SUCCESS;
+}
+
+// Must be called with access_log_mutex held.
+static void hand_off_active_buffer() {
+    full_buffers_count++;
+    active_buffer = (active_buffer + 1) % ACCESS_LOG_BUFFERS_COUNT;
+    pthread_cond_signal(&flush_wakeup);
+}
+
+static void wait_for_full_buffer() {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ACCESS_LOG_FLUSH_INTERVAL_SEC;
+
+    while (full_buffers_count == 0 && !is_flush_thread_stopping) {
+        if (pthread_cond_timedwait(&flush_wakeup, &access_log_mutex, &deadline) == ETIMEDOUT) break;
+    }
+    if (full_buffers_count == 0 && buffers[active_buffer].size > 0) hand_off_active_buffer();
+}
+
+static void* run_flush_thread(void* argument) {
+    (void)argument;
+
+    pthread_mutex_lock(&access_log_mutex);
+    for (;;) {
+        wait_for_full_buffer();
+        if (full_buffers_count == 0) {
+            if (is_flush_thread_stopping) break;
+            continue;
+        }
+
+        size_t index = (active_buffer + ACCESS_LOG_BUFFERS_COUNT - full_buffers_count) % ACCESS_LOG_BUFFERS_COUNT;
+        unsigned long long dropped = dropped_records_count;
+        dropped_records_count = 0;
+        pthread_mutex_unlock(&access_log_mutex);
+
+        // Producers never touch a full buffer, so it is written without the mutex.
+        write_buffer(buffers[index].data, buffers[index].size);
+        if (dropped > 0) LOG_WARNF("%llu access log records were dropped, writing is behind", dropped);
+
+        pthread_mutex_lock(&access_log_mutex);
+        buffers[index].size = 0;
+        full_buffers_count--;
+    }
+    pthread_mutex_unlock(&access_log_mutex);
+    return NULL;
+}
+
+static enum ReturnCode start_flush_thread() {
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&flush_wakeup, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    active_buffer = 0;
+    full_buffers_count = 0;
+    dropped_records_count = 0;
+    is_flush_thread_stopping = 0;
+    if (pthread_create(&flush_thread, NULL, run_flush_thread, NULL) != RET_SUCCESS) {
+        pthread_cond_destroy(&flush_wakeup);
+        return RET_ERROR;
+    }
+    return RET_SUCCESS;
+}
+
+enum ReturnCode open_access_log() {
+    const struct Config* config = get_config();
+    if (config->access_log_file[0] == '\0') return RET_SUCCESS;
+
+    access_log_fd = open(config->access_log_file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (access_log_fd == -1) {
+        LOG_ERRORF("Couldn't open access log %s: %s", config->access_log_file, strerror(errno));
+        return RET_FILE_NOT_OPENED;
+    }
+
+    if (write_file_header() != RET_SUCCESS) {
+        LOG_ERROR("Couldn't write access log header");
+        close(access_log_fd);
+        access_log_fd = -1;
+        return RET_ERROR;
+    }
+
+    if (start_flush_thread() != RET_SUCCESS) {
+        LOG_ERROR("Couldn't start access log flush thread");
+        close(access_log_fd);
+        access_log_fd = -1;
+        return RET_ERROR;
+    }
+
+    LOG_INFOF("Access log %s is opened, sample rate 1/%u", config->access_log_file,
+              config->access_log_sample_rate);
+    return RET_SUCCESS;
+}
+
+static unsigned long long get_elapsed_us(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long elapsed_us = (long long)(now.tv_sec - start->tv_sec) * 1000000LL +
+                           (now.tv_nsec - start->tv_nsec) / 1000;
+    return elapsed_us > 0 ? (unsigned long long)elapsed_us : 0;
+}
+
+static int is_request_sampled(const struct Request* request, unsigned long long latency_us) {
+    const struct Config* config = get_config();
+    unsigned long long request_number = atomic_fetch_add_explicit(&requests_count, 1, memory_order_relaxed);
+
+    if (request->status_code == 0 || request->status_code >= 400) return 1;
+    if (config->access_log_slow_ms > 0 && latency_us >= config->access_log_slow_ms * 1000ULL) return 1;
+    return config->access_log_sample_rate > 0 && request_number % config->access_log_sample_rate == 0;
+}
+
+static void fill_client_address(int client_socket, struct AccessLogRecord* record) {
+    struct sockaddr_in client_addr;
+    socklen_t client_addr_len = sizeof(client_addr);
+    if (getpeername(client_socket, (struct sockaddr*)&client_addr, &client_addr_len) != RET_SUCCESS ||
+        client_addr.sin_family != AF_INET) {
+        return;
+    }
+
+    record->client_ip = client_addr.sin_addr.s_addr;
+    record->client_port = ntohs(client_addr.sin_port);
+}
+
+void write_access_log(int client_socket, const struct Request* request) {
+    if (access_log_fd == -1 || request == NULL) return;
+
+    unsigned long long latency_us = get_elapsed_us(&request->received_time);
+    if (!is_request_sampled(request, latency_us)) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    struct AccessLogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp_us = (uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000 - latency_us;
+    record.bytes_sent = request->bytes_sent;
+    record.latency_us = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    record.status_code = (uint16_t)request->status_code;
+    record.method = (uint8_t)request->method;
+    record.path_length = (uint16_t)request->path.length;
+    fill_client_address(client_socket, &record);
+
+    size_t record_size = sizeof(record) + record.path_length;
+
+    pthread_mutex_lock(&access_log_mutex);
+    struct AccessLogBuffer* buffer = &buffers[active_buffer];
+    if (buffer->size + record_size > sizeof(buffer->data)) {
+        if (full_buffers_count == ACCESS_LOG_BUFFERS_COUNT - 1) {
+            dropped_records_count++;
+            pthread_mutex_unlock(&access_log_mutex);
+            return;
+        }
+        hand_off_active_buffer();
+        buffer = &buffers[active_buffer];
+    }
+
+    memcpy(buffer->data + buffer->size, &record, sizeof(record));
+    memcpy(buffer->data + buffer->size + sizeof(record), request->path.data, record.path_length);
+    buffer->size += record_size;
+    pthread_mutex_unlock(&access_log_mutex);
+}
+
+void close_access_log() {
+    if (access_log_fd == -1) return;
+
+    pthread_mutex_lock(&access_log_mutex);
+    is_flush_thread_stopping = 1;
+    pthread_cond_signal(&flush_wakeup);
+    pthread_mutex_unlock(&access_log_mutex);
+
+    pthread_join(flush_thread, NULL);
+    pthread_cond_destroy(&flush_wakeup);
+    close(access_log_fd);
+    access_log_fd = -1;
+}
@@ -0,0 +1,99 @@
+/**
+    * @file: arena.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the connection arena.
+    *
+    * Allocations bump an offset in the current block. When the block
+    * is full a new one, large enough for the allocation, is chained
+    * after it. Reset frees every block except the first one, which is
+    * sized for a typical response, so a keep-alive connection reuses
+    * the same block for all of its requests.
+*/
+
+#include "../include/arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_BLOCK_SIZE 4096
+#define ARENA_ALIGNMENT alignof(max_align_t)
+
+struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t capacity;
+    size_t used;
+    alignas(max_align_t) char data[];
+};
+
+static size_t align_size(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+static struct ArenaBlock* create_block(size_t capacity) {
+    struct ArenaBlock* block = malloc(sizeof(struct ArenaBlock) + capacity);
+    if (block == NULL) return NULL;
+
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+void initialize_arena(struct Arena* arena) {
+    arena->first = NULL;
+    arena->current = NULL;
+}
+
+void* arena_allocate(struct Arena* arena, size_t size) {
+    // Aligned size and block header mustn't wrap around, such a request is never satisfiable.
+    if (size > SIZE_MAX - ARENA_ALIGNMENT - sizeof(struct ArenaBlock)) return NULL;
+    size = align_size(size);
+
+    struct ArenaBlock* block = arena->current;
+    if (block == NULL || block->capacity - block->used < size) {
+        struct ArenaBlock* new_block = create_block(size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+        if (new_block == NULL) return NULL;
+
+        if (block == NULL) arena->first = new_block;
+        else block->next = new_block;
+        arena->current = new_block;
+        block = new_block;
+    }
+
+    void* memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+char* arena_strdup(struct Arena* arena, const char* string) {
+    size_t size = strlen(string) + 1;
+    char* copy = arena_allocate(arena, size);
+    if (copy != NULL) memcpy(copy, string, size);
+    return copy;
+}
+
+static void free_blocks(struct ArenaBlock* block) {
+    while (block != NULL) {
+        struct ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+void reset_arena(struct Arena* arena) {
+    if (arena->first == NULL) return;
+
+    free_blocks(arena->first->next);
+    arena->first->next = NULL;
+    arena->first->used = 0;
+    arena->current = arena->first;
+}
+
+void free_arena(struct Arena* arena) {
+    free_blocks(arena->first);
+    initialize_arena(arena);
+}
@@ -0,0 +1,174 @@
+/**
+    * @file: byte_range.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of Range header parsing
+    * and of multipart/byteranges body layout.
+    *
+    * A header which can't be parsed is ignored as a whole, so the
+    * client gets the full file instead of an error. The number of
+    * ranges is limited, so a request can't make the server send many
+    * small overlapping pieces of one file.
+    *
+    * Part heads are formatted into the arena of the connection, while
+    * the file bytes between them are sent with sendfile() as usual.
+*/
+
+#include "../include/byte_range.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <strings.h>
+#include <time.h>
+#include "../include/logger.h"
+
+#define RANGE_UNIT_PREFIX "bytes="
+#define RANGE_UNIT_PREFIX_LEN 6
+#define MULTIPART_PART_HEAD_SIZE 256
+#define MULTIPART_TAIL_SIZE 32
+
+static _Thread_local uint64_t boundary_state = 0;
+
+static int is_whitespace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static const char* skip_whitespace(const char* position, const char* end) {
+    while (position < end && is_whitespace(*position)) position++;
+    return position;
+}
+
+static const char* parse_position(const char* position, const char* end, uint64_t* value, int* has_value) {
+    uint64_t result = 0;
+    const char* start = position;
+    while (position < end && *position >= '0' && *position <= '9') {
+        uint64_t digit = (uint64_t)(*position - '0');
+        if (result > (UINT64_MAX - digit) / 10) return NULL;
+        result = result * 10 + digit;
+        position++;
+    }
+
+    *value = result;
+    *has_value = position != start;
+    return position;
+}
+
+static void add_range(struct ByteRanges* ranges, uint64_t offset, uint64_t length) {
+    struct ByteRange* range = &ranges->items[ranges->count++];
+    range->offset = offset;
+    range->length = length;
+    range->part_head = NULL;
+    range->part_head_size = 0;
+}
+
+enum RangeStatus parse_byte_ranges(struct StringView value, uint64_t file_size, struct ByteRanges* ranges) {
+    ranges->count = 0;
+    ranges->tail = NULL;
+    ranges->tail_size = 0;
+    ranges->boundary[0] = '\0';
+
+    if (value.length < RANGE_UNIT_PREFIX_LEN ||
+        strncasecmp(value.data, RANGE_UNIT_PREFIX, RANGE_UNIT_PREFIX_LEN) != 0) {
+        return RANGES_IGNORED;
+    }
+
+    const char* position = value.data + RANGE_UNIT_PREFIX_LEN;
+    const char* end = value.data + value.length;
+    int has_range_spec = 0;
+
+    while (position < end) {
+        position = skip_whitespace(position, end);
+        // Empty elements of the list are allowed.
+        if (position < end && *position == ',') {
+            position++;
+            continue;
+        }
+        if (position == end) break;
+
+        uint64_t first = 0, last = 0;
+        int has_first = 0, has_last = 0;
+        position = parse_position(position, end, &first, &has_first);
+        if (position == NULL || position == end || *position != '-') return RANGES_IGNORED;
+        position = parse_position(position + 1, end, &last, &has_last);
+        if (position == NULL || (!has_first && !has_last) || (has_first && has_last && last < first)) {
+            return RANGES_IGNORED;
+        }
+
+        position = skip_whitespace(position, end);
+        if (position < end && *position != ',') return RANGES_IGNORED;
+        has_range_spec = 1;
+
+        // Ranges outside of the file are skipped, the rest is clipped to its end.
+        int is_satisfiable = has_first ? first < file_size : last > 0 && file_size > 0;
+        if (!is_satisfiable) continue;
+        if (ranges->count == MAX_BYTE_RANGES) {
+            LOG_WARN("Range header has too many ranges, ignoring it");
+            return RANGES_IGNORED;
+        }
+
+        if (!has_first) {
+            uint64_t length = last < file_size ? last : file_size;
+            add_range(ranges, file_size - length, length);
+        } else {
+            uint64_t range_end = has_last && last < file_size - 1 ? last : file_size - 1;
+            add_range(ranges, first, range_end - first + 1);
+        }
+    }
+
+    if (!has_range_spec) return RANGES_IGNORED;
+    return ranges->count > 0 ? RANGES_SATISFIABLE : RANGES_NOT_SATISFIABLE;
+}
+
+static void generate_boundary(char* boundary) {
+    if (boundary_state == 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        boundary_state = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec + (uint64_t)(uintptr_t)&boundary_state;
+    }
+
+    // splitmix64, boundaries only have to be unlikely to appear in the file.
+    uint64_t value = (boundary_state += 0x9e3779b97f4a7c15ULL);
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    snprintf(boundary, MULTIPART_BOUNDARY_SIZE, "%016" PRIx64, value);
+}
+
+enum ReturnCode prepare_multipart_ranges(struct ByteRanges* ranges, uint64_t file_size, const char* content_type,
+                                         struct Arena* arena) {
+    generate_boundary(ranges->boundary);
+
+    for (size_t i = 0; i < ranges->count; ++i) {
+        struct ByteRange* range = &ranges->items[i];
+        char* part_head = arena_allocate(arena, MULTIPART_PART_HEAD_SIZE);
+        if (part_head == NULL) {
+            LOG_ERROR("Memory not allocated for multipart part head");
+            return RET_ERROR;
+        }
+
+        int part_head_size = snprintf(part_head, MULTIPART_PART_HEAD_SIZE,
+                                      "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %" PRIu64 "-%" PRIu64
+                                      "/%" PRIu64 "\r\n\r\n", ranges->boundary, content_type, range->offset,
+                                      range->offset + range->length - 1, file_size);
+        if (part_head_size < 0 || part_head_size >= MULTIPART_PART_HEAD_SIZE) return RET_ERROR;
+        range->part_head = part_head;
+        range->part_head_size = (size_t)part_head_size;
+    }
+
+    char* tail = arena_allocate(arena, MULTIPART_TAIL_SIZE);
+    if (tail == NULL) {
+        LOG_ERROR("Memory not allocated for multipart tail");
+        return RET_ERROR;
+    }
+    ranges->tail_size = (size_t)snprintf(tail, MULTIPART_TAIL_SIZE, "\r\n--%s--\r\n", ranges->boundary);
+    ranges->tail = tail;
+    return RET_SUCCESS;
+}
+
+uint64_t get_ranges_body_size(const struct ByteRanges* ranges) {
+    uint64_t size = ranges->tail_size;
+    for (size_t i = 0; i < ranges->count; ++i) {
+        size += ranges->items[i].part_head_size + ranges->items[i].length;
+    }
+    return size;
+}
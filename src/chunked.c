@@ -0,0 +1,140 @@
+/**
+    * @file: chunked.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the chunked transfer
+    * coding.
+    *
+    * The decoder is a state machine advanced byte by byte over size
+    * lines, extensions and trailers, while chunk data is moved with
+    * memmove() as a whole. Decoded data never gets ahead of the
+    * received bytes, so it can overwrite them in the same buffer.
+    * Extensions and trailer fields are skipped.
+*/
+
+#include "../include/chunked.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "../include/logger.h"
+
+#define CHUNK_SIZE_MAX_BEFORE_DIGIT (UINT64_MAX >> 4)
+
+static int get_hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void initialize_chunked_decoder(struct ChunkedDecoder* decoder) {
+    decoder->state = CHUNKED_SIZE;
+    decoder->chunk_size = 0;
+    decoder->has_size_digits = 0;
+}
+
+static enum ReturnCode decode_size(struct ChunkedDecoder* decoder, char c) {
+    int digit = get_hex_digit(c);
+    if (digit >= 0) {
+        if (decoder->chunk_size > CHUNK_SIZE_MAX_BEFORE_DIGIT) return RET_ERROR;
+        decoder->chunk_size = (decoder->chunk_size << 4) | (uint64_t)digit;
+        decoder->has_size_digits = 1;
+        return RET_SUCCESS;
+    }
+
+    if (!decoder->has_size_digits) return RET_ERROR;
+    if (c == '\r') decoder->state = CHUNKED_SIZE_LF;
+    else if (c == ';' || c == ' ' || c == '\t') decoder->state = CHUNKED_EXTENSION;
+    else return RET_ERROR;
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode decode_control_byte(struct ChunkedDecoder* decoder, char c) {
+    switch (decoder->state) {
+        case CHUNKED_SIZE:
+            return decode_size(decoder, c);
+        case CHUNKED_EXTENSION:
+            if (c == '\r') decoder->state = CHUNKED_SIZE_LF;
+            else if (c == '\n') return RET_ERROR;
+            return RET_SUCCESS;
+        case CHUNKED_SIZE_LF:
+            if (c != '\n') return RET_ERROR;
+            decoder->state = decoder->chunk_size > 0 ? CHUNKED_DATA : CHUNKED_TRAILER;
+            return RET_SUCCESS;
+        case CHUNKED_DATA_CR:
+            if (c != '\r') return RET_ERROR;
+            decoder->state = CHUNKED_DATA_LF;
+            return RET_SUCCESS;
+        case CHUNKED_DATA_LF:
+            if (c != '\n') return RET_ERROR;
+            initialize_chunked_decoder(decoder);
+            return RET_SUCCESS;
+        case CHUNKED_TRAILER:
+            if (c == '\n') return RET_ERROR;
+            decoder->state = c == '\r' ? CHUNKED_FINAL_LF : CHUNKED_TRAILER_FIELD;
+            return RET_SUCCESS;
+        case CHUNKED_TRAILER_FIELD:
+            if (c == '\r') decoder->state = CHUNKED_TRAILER_LF;
+            else if (c == '\n') return RET_ERROR;
+            return RET_SUCCESS;
+        case CHUNKED_TRAILER_LF:
+            if (c != '\n') return RET_ERROR;
+            decoder->state = CHUNKED_TRAILER;
+            return RET_SUCCESS;
+        case CHUNKED_FINAL_LF:
+            if (c != '\n') return RET_ERROR;
+            decoder->state = CHUNKED_DONE;
+            return RET_SUCCESS;
+        case CHUNKED_DATA:
+        case CHUNKED_DONE:
+        default:
+            return RET_ERROR;
+    }
+}
+
+enum ReturnCode decode_chunked(struct ChunkedDecoder* decoder, char* data, size_t size,
+                               size_t* decoded_size, size_t* consumed_size) {
+    size_t position = 0;
+    size_t decoded = 0;
+
+    while (position < size && decoder->state != CHUNKED_DONE) {
+        if (decoder->state == CHUNKED_DATA) {
+            size_t data_size = size - position;
+            if (data_size > decoder->chunk_size) data_size = (size_t)decoder->chunk_size;
+
+            memmove(data + decoded, data + position, data_size);
+            decoded += data_size;
+            position += data_size;
+            decoder->chunk_size -= data_size;
+            if (decoder->chunk_size == 0) decoder->state = CHUNKED_DATA_CR;
+            continue;
+        }
+
+        if (decode_control_byte(decoder, data[position]) != RET_SUCCESS) {
+            LOG_ERROR("Request has malformed chunked body");
+            return RET_ERROR;
+        }
+        position++;
+    }
+
+    *decoded_size = decoded;
+    *consumed_size = position;
+    return RET_SUCCESS;
+}
+
+int is_chunked_body_complete(const struct ChunkedDecoder* decoder) {
+    return decoder->state == CHUNKED_DONE;
+}
+
+int prepare_chunk(char* size_line, const char* data, size_t size, struct iovec* iov) {
+    int size_line_length = snprintf(size_line, CHUNK_SIZE_LINE_SIZE, "%zx\r\n", size);
+
+    iov[0].iov_base = size_line;
+    iov[0].iov_len = (size_t)size_line_length;
+    iov[1].iov_base = (void*)data;
+    iov[1].iov_len = size;
+    // After the last chunk the same CRLF ends the empty trailer section.
+    iov[2].iov_base = "\r\n";
+    iov[2].iov_len = 2;
+    return CHUNK_IOV_COUNT;
+}
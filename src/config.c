@@ -61,6 +61,23 @@ static int get_value_from_config(const char* config_str, const char* field, char
     return RET_SUCCESS;
 }
 
+static enum ReturnCode parse_log_level(const char* value, enum Level* level) {
+    if (strcmp(value, "debug") == 0) {
+        *level = DEBUG;
+    } else if (strcmp(value, "info") == 0) {
+        *level = INFO;
+    } else if (strcmp(value, "warn") == 0) {
+        *level = WARN;
+    } else if (strcmp(value, "error") == 0) {
+        *level = ERROR;
+    } else if (strcmp(value, "fatal") == 0) {
+        *level = FATAL;
+    } else {
+        return RET_CONFIG_PARSING_ERROR;
+    }
+    return RET_SUCCESS;
+}
+
 static enum ReturnCode parse_and_set_config(const char* config_str) {
     if (config_str == NULL) return RET_ARGUMENT_IS_NULL;
 
@@ -106,6 +123,170 @@ static enum ReturnCode parse_and_set_config(const char* config_str) {
         strncpy(config.log_file, buffer, sizeof(config.log_file));
     }
 
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "connection_mode", buffer) == RET_SUCCESS) {
+        if (strcmp(buffer, "threads") == 0) {
+            config.connection_mode = CONNECTION_MODE_THREADS;
+        } else if (strcmp(buffer, "epoll") == 0) {
+            config.connection_mode = CONNECTION_MODE_EPOLL;
+        } else if (strcmp(buffer, "coroutines") == 0) {
+            config.connection_mode = CONNECTION_MODE_COROUTINES;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "worker_threads", buffer) == RET_SUCCESS) {
+        int workers = atoi(buffer);
+        if (workers >= 0) {
+            config.worker_threads = workers;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "listen_backlog", buffer) == RET_SUCCESS) {
+        int backlog = atoi(buffer);
+        if (backlog > 0) {
+            config.listen_backlog = backlog;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "reuse_port", buffer) == RET_SUCCESS) {
+        if (strncmp(buffer, "true", strlen("true")) == 0) {
+            config.reuse_port = 1;
+        } else if (strncmp(buffer, "false", strlen("false")) == 0) {
+            config.reuse_port = 0;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "io_backend", buffer) == RET_SUCCESS) {
+        if (strcmp(buffer, "posix") == 0) {
+            config.io_backend = IO_BACKEND_POSIX;
+        } else if (strcmp(buffer, "io_uring") == 0) {
+            config.io_backend = IO_BACKEND_IO_URING;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "coroutine_stack_size", buffer) == RET_SUCCESS) {
+        int stack_size = atoi(buffer);
+        if (stack_size >= MIN_COROUTINE_STACK_SIZE) {
+            config.coroutine_stack_size = stack_size;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "file_cache_entries", buffer) == RET_SUCCESS) {
+        int entries = atoi(buffer);
+        if (entries >= 0) {
+            config.file_cache_entries = entries;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "content_cache_size", buffer) == RET_SUCCESS) {
+        char* end = NULL;
+        long long cache_size = strtoll(buffer, &end, 10);
+        if (end != buffer && cache_size >= 0) {
+            config.content_cache_size = (size_t)cache_size;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "index_snapshot_file", buffer) == RET_SUCCESS) {
+        strncpy(config.index_snapshot_file, buffer, sizeof(config.index_snapshot_file));
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "index_snapshot_interval", buffer) == RET_SUCCESS) {
+        int interval = atoi(buffer);
+        if (interval >= 0) {
+            config.index_snapshot_interval = interval;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "log_buffer_records", buffer) == RET_SUCCESS) {
+        int records = atoi(buffer);
+        if (records >= MIN_LOG_BUFFER_RECORDS) {
+            config.log_buffer_records = records;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "log_overflow_policy", buffer) == RET_SUCCESS) {
+        if (strcmp(buffer, "block") == 0) {
+            config.log_overflow_policy = LOG_OVERFLOW_BLOCK;
+        } else if (strcmp(buffer, "drop") == 0) {
+            config.log_overflow_policy = LOG_OVERFLOW_DROP;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "log_level", buffer) == RET_SUCCESS &&
+        parse_log_level(buffer, &config.log_level) != RET_SUCCESS) {
+        return RET_CONFIG_PARSING_ERROR;
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "access_log_file", buffer) == RET_SUCCESS) {
+        strncpy(config.access_log_file, buffer, sizeof(config.access_log_file));
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "access_log_sample_rate", buffer) == RET_SUCCESS) {
+        int sample_rate = atoi(buffer);
+        if (sample_rate >= 0) {
+            config.access_log_sample_rate = sample_rate;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "access_log_slow_ms", buffer) == RET_SUCCESS) {
+        int slow_ms = atoi(buffer);
+        if (slow_ms >= 0) {
+            config.access_log_slow_ms = slow_ms;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    if (get_value_from_config(config_str, "max_header_size", buffer) == RET_SUCCESS) {
+        char* end = NULL;
+        long long header_size = strtoll(buffer, &end, 10);
+        if (end != buffer && header_size >= MIN_MAX_HEADER_SIZE) {
+            config.max_header_size = (size_t)header_size;
+        } else {
+            return RET_CONFIG_PARSING_ERROR;
+        }
+    }
+
     return RET_SUCCESS;
 }
 
@@ -147,6 +328,23 @@ static void initialize_config() {
     config.max_clients = DEFAULT_MAX_CLIENTS_COUNT;
     strncpy(config.root_directory, DEFAULT_ROOT_DIR, sizeof(config.root_directory));
     strncpy(config.log_file, DEFAULT_LOG_FILENAME, sizeof(config.log_file));
+    config.connection_mode = DEFAULT_CONNECTION_MODE;
+    config.worker_threads = DEFAULT_WORKER_THREADS;
+    config.listen_backlog = DEFAULT_LISTEN_BACKLOG;
+    config.reuse_port = DEFAULT_REUSE_PORT;
+    config.io_backend = DEFAULT_IO_BACKEND;
+    config.coroutine_stack_size = DEFAULT_COROUTINE_STACK_SIZE;
+    config.file_cache_entries = DEFAULT_FILE_CACHE_ENTRIES;
+    config.content_cache_size = DEFAULT_CONTENT_CACHE_SIZE;
+    strncpy(config.index_snapshot_file, DEFAULT_INDEX_SNAPSHOT_FILE, sizeof(config.index_snapshot_file));
+    config.index_snapshot_interval = DEFAULT_INDEX_SNAPSHOT_INTERVAL;
+    config.log_buffer_records = DEFAULT_LOG_BUFFER_RECORDS;
+    config.log_overflow_policy = DEFAULT_LOG_OVERFLOW_POLICY;
+    config.log_level = DEFAULT_LOG_LEVEL;
+    strncpy(config.access_log_file, DEFAULT_ACCESS_LOG_FILE, sizeof(config.access_log_file));
+    config.access_log_sample_rate = DEFAULT_ACCESS_LOG_SAMPLE_RATE;
+    config.access_log_slow_ms = DEFAULT_ACCESS_LOG_SLOW_MS;
+    config.max_header_size = DEFAULT_MAX_HEADER_SIZE;
 }
 
 enum ReturnCode load_config(const char* path) {
@@ -163,6 +361,22 @@ enum ReturnCode load_config(const char* path) {
     return parsing_return_code;
 }
 
+enum ReturnCode load_log_level(const char* path, enum Level* level) {
+    if (level == NULL) return RET_ARGUMENT_IS_NULL;
+
+    char* config_str = NULL;
+    enum ReturnCode reading_return_code = read_config(path, &config_str);
+    if (reading_return_code != RET_SUCCESS) return reading_return_code;
+
+    char buffer[CONFIG_FIELD_BUFFER_SIZE];
+    memset(buffer, 0, sizeof(buffer));
+    enum ReturnCode parsing_return_code = get_value_from_config(config_str, "log_level", buffer);
+    if (parsing_return_code == RET_SUCCESS) parsing_return_code = parse_log_level(buffer, level);
+    free(config_str);
+
+    return parsing_return_code;
+}
+
 const struct Config* get_config() {
     return &config;
 }
\ No newline at end of file
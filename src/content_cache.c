@@ -0,0 +1,331 @@
+/**
+    * @file: content_cache.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the in-memory cache of
+    * hot file responses.
+    *
+    * The table is a chained hash map guarded by one mutex, and file
+    * bodies are read by callers outside of it. Both SLRU segments are
+    * doubly linked lists with most recently used entry at the head.
+    * The protected segment may hold up to 80% of the budget, entries
+    * pushed out of it get one more chance at the head of probation.
+    * Eviction takes unreferenced entries from the tail of probation
+    * first and from the tail of protected segment after that.
+    * Fills in progress are kept in a short list, their followers
+    * sleep on one condition variable shared by all fills. Fills work
+    * the same with caching disabled, a response which doesn't fit the
+    * budget is still read once for waiting followers, up to a limit,
+    * and freed by the last of them.
+*/
+
+#include "../include/content_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/file_cache.h"
+#include "../include/logger.h"
+#include "../include/config.h"
+
+#define CONTENT_CACHE_BUCKETS 1024
+#define PROTECTED_SEGMENT_PERCENT 80
+#define MAX_OBJECT_SHARE 8          /**< Single entry may take at most 1/8 of the budget. */
+#define MAX_SHARED_FILL_SIZE (16 * 1024 * 1024)    /**< Largest uncacheable response read for followers. */
+
+struct ContentFill {
+    char path[MAX_PATH_LEN];
+    struct CachedContent* result;
+    int is_done;
+    unsigned int waiters;
+    struct ContentFill* next;
+};
+
+struct Segment {
+    struct CachedContent* head;
+    struct CachedContent* tail;
+    size_t bytes;
+};
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct CachedContent* buckets[CONTENT_CACHE_BUCKETS];
+static struct Segment probation;
+static struct Segment protected;
+static struct ContentFill* fills = NULL;
+static pthread_cond_t fill_done = PTHREAD_COND_INITIALIZER;
+static unsigned long long generation = 0;
+static struct ContentCacheStatistics statistics;
+
+static size_t get_entry_size(const struct CachedContent* content) {
+    return content->headers_size + content->body_size;
+}
+
+static struct CachedContent** find_slot(const char* path) {
+    struct CachedContent** slot = &buckets[hash_path(path) % CONTENT_CACHE_BUCKETS];
+    while (*slot != NULL && strcmp((*slot)->path, path) != 0) {
+        slot = &(*slot)->bucket_next;
+    }
+    return slot;
+}
+
+static struct Segment* get_segment(const struct CachedContent* content) {
+    return content->is_protected ? &protected : &probation;
+}
+
+static void unlink_segment(struct CachedContent* content) {
+    struct Segment* segment = get_segment(content);
+    if (content->prev != NULL) content->prev->next = content->next;
+    else segment->head = content->next;
+    if (content->next != NULL) content->next->prev = content->prev;
+    else segment->tail = content->prev;
+    content->prev = NULL;
+    content->next = NULL;
+    segment->bytes -= get_entry_size(content);
+}
+
+static void push_segment(struct CachedContent* content, int is_protected) {
+    content->is_protected = is_protected;
+    struct Segment* segment = get_segment(content);
+    content->next = segment->head;
+    if (segment->head != NULL) segment->head->prev = content;
+    segment->head = content;
+    if (segment->tail == NULL) segment->tail = content;
+    segment->bytes += get_entry_size(content);
+}
+
+static void remove_entry(struct CachedContent* content) {
+    struct CachedContent** slot = find_slot(content->path);
+    *slot = content->bucket_next;
+    content->bucket_next = NULL;
+    unlink_segment(content);
+    content->is_cached = 0;
+    statistics.used_bytes -= get_entry_size(content);
+}
+
+static void destroy_entry(struct CachedContent* content) {
+    free(content->data);
+    free(content);
+}
+
+static size_t get_budget() {
+    const struct Config* config = get_config();
+    return config->content_cache_size;
+}
+
+static void promote_entry(struct CachedContent* content) {
+    unlink_segment(content);
+    push_segment(content, 1);
+
+    size_t protected_budget = get_budget() / 100 * PROTECTED_SEGMENT_PERCENT;
+    while (protected.bytes > protected_budget && protected.tail != content) {
+        struct CachedContent* demoted = protected.tail;
+        unlink_segment(demoted);
+        push_segment(demoted, 0);
+    }
+}
+
+static int evict_from(struct Segment* segment) {
+    for (struct CachedContent* content = segment->tail; content != NULL; content = content->prev) {
+        if (content->references > 0) continue;
+        remove_entry(content);
+        destroy_entry(content);
+        statistics.evictions++;
+        return 1;
+    }
+    return 0;
+}
+
+static int make_room(size_t size) {
+    size_t budget = get_budget();
+    while (statistics.used_bytes + size > budget) {
+        if (!evict_from(&probation) && !evict_from(&protected)) return 0;
+    }
+    return 1;
+}
+
+int is_content_cache_enabled() {
+    return get_budget() > 0;
+}
+
+int is_content_cacheable(size_t size) {
+    size_t budget = get_budget();
+    return budget > 0 && size <= budget / MAX_OBJECT_SHARE;
+}
+
+static struct ContentFill** find_fill(const char* path) {
+    struct ContentFill** fill = &fills;
+    while (*fill != NULL && strcmp((*fill)->path, path) != 0) {
+        fill = &(*fill)->next;
+    }
+    return fill;
+}
+
+static struct CachedContent* wait_for_fill(struct ContentFill* fill) {
+    fill->waiters++;
+    statistics.waiting++;
+    while (!fill->is_done) {
+        pthread_cond_wait(&fill_done, &cache_mutex);
+    }
+    statistics.waiting--;
+
+    // Reference for every waiter was taken by the leader.
+    struct CachedContent* content = fill->result;
+    if (content != NULL) statistics.coalesced++;
+    if (--fill->waiters == 0) free(fill);
+    return content;
+}
+
+static void start_fill(const char* path, struct ContentFill** fill) {
+    struct ContentFill* new_fill = calloc(1, sizeof(struct ContentFill));
+    if (new_fill == NULL) return;
+
+    strncpy(new_fill->path, path, sizeof(new_fill->path) - 1);
+    new_fill->next = fills;
+    fills = new_fill;
+    *fill = new_fill;
+}
+
+struct CachedContent* acquire_content(const char* path, int may_wait, struct ContentFill** fill) {
+    if (path == NULL || fill == NULL) return NULL;
+    *fill = NULL;
+
+    pthread_mutex_lock(&cache_mutex);
+    struct CachedContent* content = *find_slot(path);
+    if (content == NULL) {
+        struct ContentFill* pending_fill = *find_fill(path);
+        if (pending_fill != NULL && may_wait) {
+            content = wait_for_fill(pending_fill);
+        } else if (pending_fill != NULL) {
+            statistics.misses++;
+        } else {
+            statistics.misses++;
+            start_fill(path, fill);
+        }
+        pthread_mutex_unlock(&cache_mutex);
+        return content;
+    }
+
+    statistics.hits++;
+    content->references++;
+    if (content->is_protected) {
+        unlink_segment(content);
+        push_segment(content, 1);
+    } else {
+        promote_entry(content);
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    return content;
+}
+
+int should_load_content(const struct ContentFill* fill, size_t size) {
+    if (is_content_cacheable(size)) return 1;
+    if (fill == NULL || size > MAX_SHARED_FILL_SIZE) return 0;
+
+    pthread_mutex_lock(&cache_mutex);
+    int has_waiters = fill->waiters > 0;
+    pthread_mutex_unlock(&cache_mutex);
+    return has_waiters;
+}
+
+unsigned long long get_content_generation() {
+    pthread_mutex_lock(&cache_mutex);
+    unsigned long long current_generation = generation;
+    pthread_mutex_unlock(&cache_mutex);
+    return current_generation;
+}
+
+struct CachedContent* insert_content(const char* path, char* data, size_t headers_size,
+                                     size_t body_size, unsigned long long opened_generation) {
+    struct CachedContent* content = calloc(1, sizeof(struct CachedContent));
+    if (content == NULL) {
+        LOG_ERROR("Memory not allocated for content cache entry");
+        free(data);
+        return NULL;
+    }
+
+    strncpy(content->path, path, sizeof(content->path) - 1);
+    content->data = data;
+    content->headers_size = headers_size;
+    content->body_size = body_size;
+    content->references = 1;
+
+    pthread_mutex_lock(&cache_mutex);
+    struct CachedContent** slot = find_slot(path);
+    if (*slot == NULL && opened_generation == generation && is_content_cacheable(get_entry_size(content)) &&
+        make_room(get_entry_size(content))) {
+        content->is_cached = 1;
+        *slot = content;
+        push_segment(content, 0);
+        statistics.used_bytes += get_entry_size(content);
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    return content;
+}
+
+void complete_content_fill(struct ContentFill* fill, struct CachedContent* content) {
+    if (fill == NULL) return;
+
+    pthread_mutex_lock(&cache_mutex);
+    struct ContentFill** slot = find_fill(fill->path);
+    *slot = fill->next;
+
+    fill->result = content;
+    if (content != NULL) content->references += fill->waiters;
+    fill->is_done = 1;
+    int is_unused = fill->waiters == 0;
+    pthread_cond_broadcast(&fill_done);
+    pthread_mutex_unlock(&cache_mutex);
+
+    if (is_unused) free(fill);
+}
+
+void release_content(struct CachedContent* content) {
+    if (content == NULL) return;
+
+    pthread_mutex_lock(&cache_mutex);
+    content->references--;
+    int is_unused = !content->is_cached && content->references == 0;
+    pthread_mutex_unlock(&cache_mutex);
+
+    if (is_unused) destroy_entry(content);
+}
+
+void invalidate_content(const char* path) {
+    if (path == NULL) return;
+
+    pthread_mutex_lock(&cache_mutex);
+    generation++;
+
+    struct CachedContent* content = *find_slot(path);
+    int is_unused = 0;
+    if (content != NULL) {
+        remove_entry(content);
+        is_unused = content->references == 0;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+    if (is_unused) destroy_entry(content);
+}
+
+void get_content_cache_statistics(struct ContentCacheStatistics* output) {
+    if (output == NULL) return;
+
+    pthread_mutex_lock(&cache_mutex);
+    *output = statistics;
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void clear_content_cache() {
+    pthread_mutex_lock(&cache_mutex);
+    struct Segment* segments[] = {&probation, &protected};
+    for (size_t i = 0; i < sizeof(segments) / sizeof(segments[0]); ++i) {
+        struct CachedContent* content = segments[i]->head;
+        while (content != NULL) {
+            struct CachedContent* next = content->next;
+            remove_entry(content);
+            if (content->references == 0) destroy_entry(content);
+            content = next;
+        }
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,287 @@
+/**
+    * @file: coroutine.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the stackful
+    * coroutine runtime based on ucontext.
+    *
+    * Every scheduler owns an epoll instance and runs in one thread.
+    * Coroutine stacks are small anonymous mappings with a guard page
+    * below them, so a stack overflow crashes loudly instead of
+    * corrupting memory. Stacks of finished coroutines are cached and
+    * reused by new connections to avoid a mmap() per connection.
+*/
+
+#define _GNU_SOURCE
+
+#include "../include/coroutine.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "../include/logger.h"
+#include "../include/config.h"
+
+#define STACK_CACHE_SIZE 1024
+
+struct Coroutine {
+    ucontext_t context;
+    void* stack;                    /**< Mapping with guard page at its lowest address. */
+    int client_socket;
+    int is_finished;
+    int is_waiting;
+    time_t deadline;
+    enum ReturnCode wait_result;
+    struct Coroutine* prev;
+    struct Coroutine* next;
+};
+
+struct Scheduler {
+    ucontext_t context;
+    int epoll_fd;
+    int server_fd;
+    ConnectionHandler handler;
+    size_t page_size;
+    size_t stack_size;              /**< Usable stack size, guard page excluded. */
+    struct Coroutine* current;
+    struct Coroutine* coroutines;
+    void* stack_cache[STACK_CACHE_SIZE];
+    size_t stack_cache_size;
+    time_t last_timeout_check;
+};
+
+static volatile sig_atomic_t is_scheduler_running = 1;
+static atomic_uint active_coroutines = 0;
+static _Thread_local struct Scheduler* current_scheduler = NULL;
+
+static void* allocate_stack(struct Scheduler* scheduler) {
+    if (scheduler->stack_cache_size > 0) {
+        return scheduler->stack_cache[--scheduler->stack_cache_size];
+    }
+
+    size_t mapping_size = scheduler->stack_size + scheduler->page_size;
+    void* stack = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) return NULL;
+
+    if (mprotect(stack, scheduler->page_size, PROT_NONE) == RET_ERROR) {
+        munmap(stack, mapping_size);
+        return NULL;
+    }
+    return stack;
+}
+
+static void release_stack(struct Scheduler* scheduler, void* stack) {
+    if (scheduler->stack_cache_size < STACK_CACHE_SIZE) {
+        scheduler->stack_cache[scheduler->stack_cache_size++] = stack;
+        return;
+    }
+    munmap(stack, scheduler->stack_size + scheduler->page_size);
+}
+
+static void destroy_coroutine(struct Scheduler* scheduler, struct Coroutine* coroutine) {
+    if (coroutine->prev != NULL) coroutine->prev->next = coroutine->next;
+    else scheduler->coroutines = coroutine->next;
+    if (coroutine->next != NULL) coroutine->next->prev = coroutine->prev;
+
+    release_stack(scheduler, coroutine->stack);
+    free(coroutine);
+    atomic_fetch_sub(&active_coroutines, 1);
+}
+
+static void resume_coroutine(struct Scheduler* scheduler, struct Coroutine* coroutine, enum ReturnCode wait_result) {
+    coroutine->is_waiting = 0;
+    coroutine->wait_result = wait_result;
+
+    scheduler->current = coroutine;
+    swapcontext(&scheduler->context, &coroutine->context);
+    scheduler->current = NULL;
+
+    if (coroutine->is_finished) {
+        destroy_coroutine(scheduler, coroutine);
+    }
+}
+
+static void run_coroutine() {
+    struct Coroutine* coroutine = current_scheduler->current;
+    current_scheduler->handler(coroutine->client_socket);
+    coroutine->is_finished = 1;
+}
+
+static void spawn_coroutine(struct Scheduler* scheduler, int client_socket) {
+    struct Coroutine* coroutine = calloc(1, sizeof(*coroutine));
+    void* stack = coroutine != NULL ? allocate_stack(scheduler) : NULL;
+    if (stack == NULL) {
+        LOG_ERROR("Memory not allocated for coroutine");
+        free(coroutine);
+        close(client_socket);
+        atomic_fetch_sub(&active_coroutines, 1);
+        return;
+    }
+
+    coroutine->stack = stack;
+    coroutine->client_socket = client_socket;
+    getcontext(&coroutine->context);
+    coroutine->context.uc_stack.ss_sp = (char*)stack + scheduler->page_size;
+    coroutine->context.uc_stack.ss_size = scheduler->stack_size;
+    coroutine->context.uc_link = &scheduler->context;
+    makecontext(&coroutine->context, run_coroutine, 0);
+
+    coroutine->next = scheduler->coroutines;
+    if (scheduler->coroutines != NULL) scheduler->coroutines->prev = coroutine;
+    scheduler->coroutines = coroutine;
+
+    resume_coroutine(scheduler, coroutine, RET_SUCCESS);
+}
+
+static void accept_coroutine_connections(struct Scheduler* scheduler) {
+    const struct Config* config = get_config();
+
+    while (1) {
+        int client_socket = accept4(scheduler->server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket == RET_ERROR) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) LOG_ERROR("Couldn't accept connection");
+            return;
+        }
+        LOG_INFO("Connection successfully accepted");
+
+        if (atomic_fetch_add(&active_coroutines, 1) >= config->max_clients) {
+            atomic_fetch_sub(&active_coroutines, 1);
+            LOG_WARN("Reached max clients count, connection rejected");
+            close(client_socket);
+            continue;
+        }
+
+        spawn_coroutine(scheduler, client_socket);
+    }
+}
+
+static void wake_timed_out_coroutines(struct Scheduler* scheduler) {
+    time_t now = time(NULL);
+    if (now == scheduler->last_timeout_check) return;
+    scheduler->last_timeout_check = now;
+
+    struct Coroutine* coroutine = scheduler->coroutines;
+    while (coroutine != NULL) {
+        struct Coroutine* next = coroutine->next;
+        if (coroutine->is_waiting && coroutine->deadline <= now) {
+            LOG_WARN("Client timed out while coroutine was waiting");
+            resume_coroutine(scheduler, coroutine, RET_ERROR);
+        }
+        coroutine = next;
+    }
+}
+
+static void finish_coroutines(struct Scheduler* scheduler) {
+    while (scheduler->coroutines != NULL) {
+        resume_coroutine(scheduler, scheduler->coroutines, RET_ERROR);
+    }
+}
+
+int is_in_coroutine() {
+    return current_scheduler != NULL && current_scheduler->current != NULL;
+}
+
+enum ReturnCode wait_in_coroutine(int fd, unsigned int events, int timeout_sec) {
+    if (!is_in_coroutine() || !is_scheduler_running) return RET_ERROR;
+    struct Scheduler* scheduler = current_scheduler;
+    struct Coroutine* coroutine = scheduler->current;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = coroutine;
+    if (epoll_ctl(scheduler->epoll_fd, EPOLL_CTL_MOD, fd, &event) == RET_ERROR &&
+        (errno != ENOENT || epoll_ctl(scheduler->epoll_fd, EPOLL_CTL_ADD, fd, &event) == RET_ERROR)) {
+        LOG_ERROR("Couldn't register coroutine socket in epoll");
+        return RET_ERROR;
+    }
+
+    coroutine->is_waiting = 1;
+    coroutine->deadline = time(NULL) + timeout_sec;
+    swapcontext(&coroutine->context, &scheduler->context);
+    return coroutine->wait_result;
+}
+
+void stop_coroutine_schedulers() {
+    is_scheduler_running = 0;
+}
+
+void run_coroutine_scheduler(int server_fd, ConnectionHandler handler) {
+    struct Scheduler* scheduler = calloc(1, sizeof(struct Scheduler));
+    if (scheduler == NULL) {
+        LOG_FATAL("Memory not allocated for coroutine scheduler");
+        return;
+    }
+
+    const struct Config* config = get_config();
+    scheduler->server_fd = server_fd;
+    scheduler->handler = handler;
+    scheduler->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    scheduler->stack_size = (config->coroutine_stack_size + scheduler->page_size - 1)
+                          / scheduler->page_size * scheduler->page_size;
+
+    scheduler->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (scheduler->epoll_fd == RET_ERROR) {
+        LOG_FATAL("Couldn't create epoll instance");
+        free(scheduler);
+        return;
+    }
+
+    struct epoll_event server_event;
+    memset(&server_event, 0, sizeof(server_event));
+    server_event.events = EPOLLIN;
+    server_event.data.ptr = NULL;
+    int flags = fcntl(server_fd, F_GETFL, 0);
+    if (flags == RET_ERROR || fcntl(server_fd, F_SETFL, flags | O_NONBLOCK) == RET_ERROR ||
+        epoll_ctl(scheduler->epoll_fd, EPOLL_CTL_ADD, server_fd, &server_event) == RET_ERROR) {
+        LOG_FATAL("Couldn't register server socket in epoll");
+        close(scheduler->epoll_fd);
+        free(scheduler);
+        return;
+    }
+
+    current_scheduler = scheduler;
+    LOG_INFO("Coroutine scheduler started");
+
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    while (is_scheduler_running) {
+        int events_count = epoll_wait(scheduler->epoll_fd, events, EVENT_LOOP_MAX_EVENTS, EVENT_LOOP_TIMEOUT_MS);
+        if (events_count == RET_ERROR) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait() failed");
+            break;
+        }
+
+        for (int i = 0; i < events_count; ++i) {
+            if (events[i].data.ptr == NULL) {
+                accept_coroutine_connections(scheduler);
+            } else {
+                resume_coroutine(scheduler, events[i].data.ptr, RET_SUCCESS);
+            }
+        }
+
+        wake_timed_out_coroutines(scheduler);
+    }
+
+    finish_coroutines(scheduler);
+    current_scheduler = NULL;
+
+    while (scheduler->stack_cache_size > 0) {
+        munmap(scheduler->stack_cache[--scheduler->stack_cache_size],
+               scheduler->stack_size + scheduler->page_size);
+    }
+    close(scheduler->epoll_fd);
+    free(scheduler);
+    LOG_INFO("Coroutine scheduler stopped");
+}
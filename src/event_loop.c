@@ -0,0 +1,715 @@
+/**
+    * @file: event_loop.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the event-driven
+    * connection engine based on epoll.
+    *
+    * Accepted sockets are switched to non-blocking mode and
+    * registered in a single epoll instance. Every connection keeps
+    * a state machine which remembers whether request headers,
+    * request body, response headers or file content are being
+    * transferred, so a slow client never blocks the other ones.
+    *
+    * The engine reuses request parsing, response creation and file
+    * storage modules, so responses are identical to the ones sent
+    * by thread-per-connection mode.
+    *
+    * Only socket I/O is non-blocking. Opening files, reading chunks
+    * of non-regular files and writing uploads to disk are done on the
+    * loop thread and block every connection while they last.
+*/
+
+#define _GNU_SOURCE
+
+#include "../include/event_loop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include "../include/http_communication.h"
+#include "../include/http_header.h"
+#include "../include/header_scanner.h"
+#include "../include/file_storage.h"
+#include "../include/socket_io.h"
+#include "../include/access_log.h"
+#include "../include/logger.h"
+#include "../include/config.h"
+#include "../include/common.h"
+
+extern volatile sig_atomic_t is_server_running;
+
+enum ConnectionState {
+    STATE_READING_HEADERS,
+    STATE_READING_BODY,
+    STATE_READING_CHUNKED_BODY,
+    STATE_SENDING_CONTINUE,
+    STATE_SENDING_HEADERS,
+    STATE_SENDING_FILE,
+    STATE_SENDING_CHUNKS
+};
+
+struct Connection {
+    int socket;
+    enum ConnectionState state;
+    enum ConnectionState body_state;    /**< State reading the body after 100 Continue is sent. */
+    unsigned int events;            /**< Events connection is registered for in epoll. */
+    struct InputBuffer input;       /**< Received bytes kept between pipelined requests. */
+    struct Request request;
+    int has_request;
+    int is_next_request_received;   /**< Whether input holds the next request after the current one. */
+    int is_corked;
+    struct Arena arena;             /**< Memory of the response, reset after every request. */
+    struct Response response;       /**< Response whose head and body are being sent. */
+    struct iovec output[RESPONSE_IOV_COUNT];    /**< Unsent part of response head and in-memory body. */
+    int output_count;
+    int output_status_code;
+    int file_fd;                    /**< File being sent (GET) or received (POST). */
+    struct CachedFile* cached_file; /**< Cache entry owning file_fd of GET. */
+    struct UploadFile upload;       /**< Temporary file owning file_fd of POST. */
+    struct CachedContent* content;  /**< Cached response being sent. */
+    size_t file_offset;
+    size_t file_remaining;
+    size_t range_index;             /**< Index of the next range of a partial response to send. */
+    struct ChunkedDecoder decoder;  /**< Decoder of a chunked upload. */
+    int is_chunked_output;          /**< Whether the file is sent in chunks, its size is unknown. */
+    int is_close_delimited;         /**< Whether the chunks are sent as is, ended by closing the connection. */
+    int is_last_chunk_prepared;
+    char* chunk;                    /**< Data of the chunk being sent, allocated from the arena. */
+    char chunk_size_line[CHUNK_SIZE_LINE_SIZE];
+    int keep_alive;
+    time_t last_activity;
+    struct Connection* prev;
+    struct Connection* next;
+};
+
+struct EventLoop {
+    int epoll_fd;
+    int server_fd;
+    struct Connection* connections;
+    time_t last_timeout_check;
+};
+
+static atomic_uint active_connections = 0;
+
+static int set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == RET_ERROR || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == RET_ERROR) {
+        LOG_ERROR("Couldn't switch descriptor to non-blocking mode");
+        return RET_ERROR;
+    }
+    return RET_SUCCESS;
+}
+
+static int is_would_block_error() {
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+static void close_connection_file(struct Connection* connection) {
+    if (connection->cached_file != NULL) {
+        close_file_for_reading(connection->cached_file);
+        connection->cached_file = NULL;
+    } else if (connection->file_fd != -1) {
+        // A completed upload is already moved into place, this one is partial.
+        discard_file_for_writing(&connection->upload);
+    }
+    connection->file_fd = -1;
+    connection->file_remaining = 0;
+}
+
+static void release_connection_content(struct Connection* connection) {
+    release_content(connection->content);
+    connection->content = NULL;
+}
+
+static void close_connection(struct EventLoop* loop, struct Connection* connection) {
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, connection->socket, NULL);
+    if (connection->has_request) write_access_log(connection->socket, &connection->request);
+    close(connection->socket);
+
+    close_connection_file(connection);
+    release_connection_content(connection);
+    free_input_buffer(&connection->input);
+    free_arena(&connection->arena);
+
+    if (connection->prev != NULL) connection->prev->next = connection->next;
+    else loop->connections = connection->next;
+    if (connection->next != NULL) connection->next->prev = connection->prev;
+
+    atomic_fetch_sub(&active_connections, 1);
+    free(connection);
+    LOG_INFO("Client socket closed");
+}
+
+static void update_connection_events(struct EventLoop* loop, struct Connection* connection) {
+    unsigned int events = EPOLLIN;
+    if (connection->state == STATE_SENDING_CONTINUE || connection->state == STATE_SENDING_HEADERS ||
+        connection->state == STATE_SENDING_FILE || connection->state == STATE_SENDING_CHUNKS) {
+        events = EPOLLOUT;
+    }
+    if (events == connection->events) return;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = connection;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, connection->socket, &event) == RET_ERROR) {
+        LOG_ERROR("Couldn't update connection events in epoll");
+        return;
+    }
+    connection->events = events;
+}
+
+static void set_output(struct Connection* connection, int output_count, int status_code) {
+    connection->output_count = output_count;
+    connection->output_status_code = status_code;
+    connection->state = STATE_SENDING_HEADERS;
+}
+
+static enum ReturnCode start_error_response(struct Connection* connection) {
+    close_connection_file(connection);
+    connection->keep_alive = 0;
+    connection->response = create_error_response(&connection->arena);
+
+    int output_count = prepare_response(&connection->response, connection->keep_alive, connection->output);
+    if (output_count < 0) return RET_ERROR;
+    set_output(connection, output_count, parse_status_code(connection->response.status));
+    return RET_SUCCESS;
+}
+
+static void take_response_file(struct Connection* connection) {
+    // The head was created from this file, so the connection sends exactly the length it announced.
+    connection->cached_file = connection->response.file;
+    connection->response.file = NULL;
+    connection->file_fd = connection->cached_file->fd;
+    connection->file_offset = 0;
+    connection->file_remaining = (size_t)connection->cached_file->stat.st_size;
+}
+
+static enum ReturnCode start_response(struct Connection* connection) {
+    struct Request* request = &connection->request;
+    struct Response* response = &connection->response;
+    *response = create_response(request);
+    int has_file_body = is_file_response(request, response);
+
+    if (has_file_body) take_response_file(connection);
+    close_response_file(response);
+    if (response->is_close_delimited) connection->keep_alive = 0;
+
+    int output_count = prepare_response(response, connection->keep_alive, connection->output);
+    if (output_count < 0) return start_error_response(connection);
+
+    connection->is_chunked_output = has_file_body && !S_ISREG(connection->cached_file->stat.st_mode);
+    connection->is_close_delimited = response->is_close_delimited;
+    if (connection->is_chunked_output) {
+        connection->chunk = arena_allocate(&connection->arena, BUFSIZ);
+        connection->is_last_chunk_prepared = 0;
+        if (connection->chunk == NULL) return start_error_response(connection);
+    }
+
+    // Ranges are sent one by one after the head, each with its part head.
+    connection->range_index = 0;
+    if (response->ranges != NULL) connection->file_remaining = 0;
+
+    LOG_INFO("Response created");
+    set_output(connection, output_count, parse_status_code(response->status));
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode start_method_get(struct Connection* connection) {
+    // The loop thread serves every connection and mustn't wait for a fill of another loop.
+    connection->content = find_cached_response(&connection->request, 0);
+    if (connection->content != NULL) {
+        int output_count = prepare_cached_response(connection->content, connection->keep_alive,
+                                                   connection->response.date, connection->output);
+        set_output(connection, output_count, HTTP_STATUS_CODE_OK);
+        return RET_SUCCESS;
+    }
+    return start_response(connection);
+}
+
+static size_t get_output_size(const struct Connection* connection) {
+    size_t output_size = 0;
+    for (int i = 0; i < connection->output_count; ++i) {
+        output_size += connection->output[i].iov_len;
+    }
+    return output_size;
+}
+
+static enum ReturnCode start_body(struct Connection* connection, enum ConnectionState body_state) {
+    if (!connection->request.expect_continue) {
+        connection->state = body_state;
+        return RET_SUCCESS;
+    }
+
+    // 100 Continue goes through the output like any response head, so a
+    // short send is finished when the socket becomes writable.
+    connection->output[0].iov_base = (void*)RAW_RESPONSE_100_CONTINUE;
+    connection->output[0].iov_len = strlen(RAW_RESPONSE_100_CONTINUE);
+    connection->output_count = 1;
+    connection->body_state = body_state;
+    connection->state = STATE_SENDING_CONTINUE;
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode send_continue(struct Connection* connection) {
+    while (get_output_size(connection) > 0) {
+        ssize_t sent_bytes = socket_writev(connection->socket, connection->output, connection->output_count);
+        if (sent_bytes < 0) {
+            if (is_would_block_error()) return RET_WOULD_BLOCK;
+            LOG_ERROR("Failed to send 100 Continue response");
+            return RET_ERROR;
+        }
+    }
+
+    LOG_INFO("100 Continue response sent successfully");
+    connection->output_count = 0;
+    connection->state = connection->body_state;
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode finish_upload(struct Connection* connection) {
+    connection->file_fd = -1;
+    connection->file_remaining = 0;
+    if (close_file_for_writing(connection->request.path.data, &connection->upload) != RET_SUCCESS) {
+        return start_error_response(connection);
+    }
+    LOG_INFO("File was successfully received");
+    return start_response(connection);
+}
+
+static enum ReturnCode start_method_post(struct Connection* connection) {
+    struct Request* request = &connection->request;
+    size_t content_len = (size_t)request->content_length;
+
+    if (open_file_for_writing(request->path.data, &connection->upload) != RET_SUCCESS) {
+        LOG_ERROR("Failed to receive file");
+        return start_error_response(connection);
+    }
+    connection->file_fd = connection->upload.fd;
+
+    if (request->is_chunked) {
+        initialize_chunked_decoder(&connection->decoder);
+        return start_body(connection, STATE_READING_CHUNKED_BODY);
+    }
+
+    size_t buffered_size = MIN(request->body.length, content_len);
+    if (buffered_size > 0) {
+        if (write_to_file(connection->file_fd, request->body.data, buffered_size) != RET_SUCCESS) {
+            return start_error_response(connection);
+        }
+    }
+
+    connection->file_remaining = content_len - buffered_size;
+    if (connection->file_remaining == 0) {
+        return finish_upload(connection);
+    }
+
+    return start_body(connection, STATE_READING_BODY);
+}
+
+static enum ReturnCode dispatch_request(struct Connection* connection) {
+    struct Request* request = &connection->request;
+    connection->keep_alive = request->keep_alive;
+
+    switch (request->method) {
+        case GET: return start_method_get(connection);
+        case POST: return start_method_post(connection);
+        case DELETE:
+        case UNKNOWN:
+        default: return start_response(connection);
+    }
+}
+
+static void update_connection_cork(struct Connection* connection) {
+    struct Request* request = &connection->request;
+
+    // Responses to pipelined requests are corked into full segments. The
+    // socket is flushed before waiting for a body, the client may wait for
+    // earlier responses or 100 Continue before sending it.
+    connection->is_next_request_received = !request->is_chunked && has_next_request(&connection->input, request->size);
+    if (connection->is_next_request_received) {
+        socket_set_cork(connection->socket, &connection->is_corked, 1);
+    } else if (is_body_pending(request)) {
+        socket_set_cork(connection->socket, &connection->is_corked, 0);
+    }
+}
+
+static enum ReturnCode read_request_headers(struct Connection* connection) {
+    struct InputBuffer* input = &connection->input;
+    while (find_input_headers_end(input) == 0) {
+        if (input->size == input->capacity && grow_input_buffer(input) != RET_SUCCESS) {
+            return RET_ERROR;
+        }
+
+        ssize_t received_bytes = recv(connection->socket, input->data + input->size,
+                                      input->capacity - input->size, 0);
+        if (received_bytes == 0) {
+            LOG_WARN("Client closed connection");
+            return RET_ERROR;
+        }
+        if (received_bytes < 0) {
+            if (is_would_block_error()) return RET_WOULD_BLOCK;
+            if (errno == EINTR) continue;
+            LOG_ERROR("recv() error while reading headers");
+            return RET_ERROR;
+        }
+        input->size += (size_t)received_bytes;
+    }
+    LOG_INFO("Received HTTP headers");
+
+    if (parse_request(input->data, input->size, &connection->request) != RET_SUCCESS) {
+        LOG_ERROR("Request wasn't parsed correctly");
+        return RET_ERROR;
+    }
+    connection->has_request = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &connection->request.received_time);
+    update_connection_cork(connection);
+    return dispatch_request(connection);
+}
+
+static enum ReturnCode read_request_body(struct Connection* connection) {
+    while (connection->file_remaining > 0) {
+        ssize_t received_bytes = socket_splice_to_file(connection->socket, connection->file_fd,
+                                                       connection->file_remaining);
+        if (received_bytes == 0) {
+            LOG_ERROR("Client disconnected during receiving data chunk");
+            return RET_ERROR;
+        }
+        if (received_bytes < 0) {
+            if (is_would_block_error()) return RET_WOULD_BLOCK;
+            LOG_ERROR("Failed during receiving data chunk");
+            return start_error_response(connection);
+        }
+        connection->file_remaining -= (size_t)received_bytes;
+    }
+
+    return finish_upload(connection);
+}
+
+static enum ReturnCode read_chunked_body(struct Connection* connection) {
+    struct InputBuffer* input = &connection->input;
+    size_t body_offset = connection->request.size;
+
+    // The body is decoded in the input buffer after the headers, bytes
+    // of the next request stay there.
+    while (1) {
+        size_t body_size = input->size - body_offset;
+        if (write_chunked_to_file(connection->file_fd, &connection->decoder, input->data + body_offset,
+                                  &body_size) != RET_SUCCESS) {
+            LOG_ERROR("Failed during receiving data chunk");
+            return start_error_response(connection);
+        }
+        input->size = body_offset + body_size;
+        if (is_chunked_body_complete(&connection->decoder)) break;
+
+        if (input->size == input->capacity) {
+            LOG_ERROR("No space left in receive buffer for chunked body");
+            return start_error_response(connection);
+        }
+
+        ssize_t received_bytes = recv(connection->socket, input->data + input->size,
+                                      input->capacity - input->size, 0);
+        if (received_bytes == 0) {
+            LOG_ERROR("Client disconnected during receiving data chunk");
+            return RET_ERROR;
+        }
+        if (received_bytes < 0) {
+            if (is_would_block_error()) return RET_WOULD_BLOCK;
+            if (errno == EINTR) continue;
+            LOG_ERROR("Failed during receiving data chunk");
+            return RET_ERROR;
+        }
+        input->size += (size_t)received_bytes;
+    }
+
+    return finish_upload(connection);
+}
+
+static enum ReturnCode finish_response(struct Connection* connection) {
+    close_connection_file(connection);
+    release_connection_content(connection);
+    write_access_log(connection->socket, &connection->request);
+    connection->has_request = 0;
+    consume_input(&connection->input, connection->request.size);
+    reset_arena(&connection->arena);
+    // Ranges point into the arena and mustn't be seen by a cached response.
+    connection->response.ranges = NULL;
+    if (!connection->is_next_request_received) socket_set_cork(connection->socket, &connection->is_corked, 0);
+
+    if (!connection->keep_alive || !is_server_running) {
+        LOG_INFO("Connection: close - closing client socket");
+        return RET_ERROR;
+    }
+
+    LOG_INFO("Keep-Alive: waiting for next request on same connection");
+    connection->state = STATE_READING_HEADERS;
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode start_next_range(struct Connection* connection) {
+    const struct ByteRanges* ranges = connection->response.ranges;
+    if (ranges == NULL || connection->range_index > ranges->count) return finish_response(connection);
+
+    const char* delimiter = NULL;
+    size_t delimiter_size = 0;
+    if (connection->range_index < ranges->count) {
+        const struct ByteRange* range = &ranges->items[connection->range_index];
+        connection->file_offset = (size_t)range->offset;
+        connection->file_remaining = (size_t)range->length;
+        delimiter = range->part_head;
+        delimiter_size = range->part_head_size;
+    } else {
+        if (ranges->tail_size == 0) return finish_response(connection);
+        delimiter = ranges->tail;
+        delimiter_size = ranges->tail_size;
+    }
+    connection->range_index++;
+
+    connection->output[0].iov_base = (void*)delimiter;
+    connection->output[0].iov_len = delimiter_size;
+    connection->output_count = 1;
+    connection->state = STATE_SENDING_HEADERS;
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode send_response_headers(struct Connection* connection) {
+    while (get_output_size(connection) > 0) {
+        ssize_t sent_bytes = socket_writev(connection->socket, connection->output, connection->output_count);
+        if (sent_bytes < 0) {
+            if (is_would_block_error()) return RET_WOULD_BLOCK;
+            LOG_ERROR("Response was not sent");
+            return RET_ERROR;
+        }
+        connection->request.bytes_sent += (unsigned long long)sent_bytes;
+    }
+
+    connection->request.status_code = connection->output_status_code;
+    connection->output_count = 0;
+    LOG_INFO("Response sent successfully");
+
+    if (connection->is_chunked_output) {
+        connection->state = STATE_SENDING_CHUNKS;
+        return RET_SUCCESS;
+    }
+    if (connection->file_fd != -1 && connection->file_remaining > 0) {
+        connection->state = STATE_SENDING_FILE;
+        return RET_SUCCESS;
+    }
+    return start_next_range(connection);
+}
+
+static enum ReturnCode send_response_file(struct Connection* connection) {
+    while (connection->file_remaining > 0) {
+        off_t offset = (off_t)connection->file_offset;
+        ssize_t bytes_sent = socket_sendfile(connection->socket, connection->file_fd, &offset,
+                                             connection->file_remaining);
+        if (bytes_sent <= 0) {
+            if (bytes_sent < 0 && is_would_block_error()) return RET_WOULD_BLOCK;
+            LOG_ERROR("Failed to send file");
+            return RET_ERROR;
+        }
+
+        connection->file_offset += (size_t)bytes_sent;
+        connection->file_remaining -= (size_t)bytes_sent;
+        connection->request.bytes_sent += (unsigned long long)bytes_sent;
+    }
+
+    LOG_INFO("File was successfully sent");
+    return start_next_range(connection);
+}
+
+static enum ReturnCode send_response_chunks(struct Connection* connection) {
+    while (1) {
+        if (get_output_size(connection) == 0) {
+            if (connection->is_last_chunk_prepared) break;
+
+            ssize_t bytes_read = read(connection->file_fd, connection->chunk, BUFSIZ);
+            if (bytes_read < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("Couldn't read file for chunked response");
+                return RET_ERROR;
+            }
+            if (connection->is_close_delimited) {
+                connection->output[0].iov_base = connection->chunk;
+                connection->output[0].iov_len = (size_t)bytes_read;
+                connection->output_count = 1;
+            } else {
+                connection->output_count = prepare_chunk(connection->chunk_size_line, connection->chunk,
+                                                         (size_t)bytes_read, connection->output);
+            }
+            connection->is_last_chunk_prepared = bytes_read == 0;
+            continue;
+        }
+
+        ssize_t sent_bytes = socket_writev(connection->socket, connection->output, connection->output_count);
+        if (sent_bytes < 0) {
+            if (is_would_block_error()) return RET_WOULD_BLOCK;
+            LOG_ERROR("Failed to send chunk");
+            return RET_ERROR;
+        }
+        connection->request.bytes_sent += (unsigned long long)sent_bytes;
+    }
+
+    connection->is_chunked_output = 0;
+    LOG_INFO("File was successfully sent");
+    return finish_response(connection);
+}
+
+static void process_connection(struct EventLoop* loop, struct Connection* connection) {
+    connection->last_activity = time(NULL);
+
+    enum ReturnCode return_code = RET_SUCCESS;
+    while (return_code == RET_SUCCESS) {
+        switch (connection->state) {
+            case STATE_READING_HEADERS: return_code = read_request_headers(connection); break;
+            case STATE_READING_BODY: return_code = read_request_body(connection); break;
+            case STATE_READING_CHUNKED_BODY: return_code = read_chunked_body(connection); break;
+            case STATE_SENDING_CONTINUE: return_code = send_continue(connection); break;
+            case STATE_SENDING_HEADERS: return_code = send_response_headers(connection); break;
+            case STATE_SENDING_FILE: return_code = send_response_file(connection); break;
+            case STATE_SENDING_CHUNKS: return_code = send_response_chunks(connection); break;
+        }
+    }
+
+    if (return_code == RET_WOULD_BLOCK) {
+        update_connection_events(loop, connection);
+        return;
+    }
+    close_connection(loop, connection);
+}
+
+static void add_connection(struct EventLoop* loop, int client_socket) {
+    struct Connection* connection = calloc(1, sizeof(*connection));
+    if (connection == NULL || initialize_input_buffer(&connection->input) != RET_SUCCESS) {
+        LOG_ERROR("Memory not allocated for new connection");
+        free(connection);
+        close(client_socket);
+        atomic_fetch_sub(&active_connections, 1);
+        return;
+    }
+
+    connection->socket = client_socket;
+    connection->state = STATE_READING_HEADERS;
+    connection->events = EPOLLIN;
+    initialize_arena(&connection->arena);
+    connection->request.arena = &connection->arena;
+    connection->file_fd = -1;
+    connection->last_activity = time(NULL);
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = connection->events;
+    event.data.ptr = connection;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, client_socket, &event) == RET_ERROR) {
+        LOG_ERROR("Couldn't register connection in epoll");
+        free_input_buffer(&connection->input);
+        free(connection);
+        close(client_socket);
+        atomic_fetch_sub(&active_connections, 1);
+        return;
+    }
+
+    connection->next = loop->connections;
+    if (loop->connections != NULL) loop->connections->prev = connection;
+    loop->connections = connection;
+}
+
+static void accept_connections(struct EventLoop* loop) {
+    const struct Config* config = get_config();
+
+    while (1) {
+        int client_socket = accept4(loop->server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket == RET_ERROR) {
+            if (errno == EINTR) continue;
+            if (!is_would_block_error()) LOG_ERROR("Couldn't accept connection");
+            return;
+        }
+        LOG_INFO("Connection successfully accepted");
+
+        if (atomic_fetch_add(&active_connections, 1) >= config->max_clients) {
+            atomic_fetch_sub(&active_connections, 1);
+            LOG_WARN("Reached max clients count, connection rejected");
+            close(client_socket);
+            continue;
+        }
+
+        add_connection(loop, client_socket);
+    }
+}
+
+static void close_timed_out_connections(struct EventLoop* loop) {
+    time_t now = time(NULL);
+    if (now == loop->last_timeout_check) return;
+    loop->last_timeout_check = now;
+
+    struct Connection* connection = loop->connections;
+    while (connection != NULL) {
+        struct Connection* next = connection->next;
+        if (now - connection->last_activity >= CLIENT_TIMEOUT_SEC) {
+            LOG_WARN("Client timed out, closing connection");
+            close_connection(loop, connection);
+        }
+        connection = next;
+    }
+}
+
+void run_event_loop(int server_fd) {
+    struct EventLoop loop;
+    memset(&loop, 0, sizeof(loop));
+    loop.server_fd = server_fd;
+
+    loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop.epoll_fd == RET_ERROR) {
+        LOG_FATAL("Couldn't create epoll instance");
+        return;
+    }
+
+    struct epoll_event server_event;
+    memset(&server_event, 0, sizeof(server_event));
+    server_event.events = EPOLLIN;
+    server_event.data.ptr = NULL;
+    if (set_non_blocking(server_fd) != RET_SUCCESS ||
+        epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, server_fd, &server_event) == RET_ERROR) {
+        LOG_FATAL("Couldn't register server socket in epoll");
+        close(loop.epoll_fd);
+        return;
+    }
+    LOG_INFO("Event loop started");
+
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    while (is_server_running) {
+        int events_count = epoll_wait(loop.epoll_fd, events, EVENT_LOOP_MAX_EVENTS, EVENT_LOOP_TIMEOUT_MS);
+        if (events_count == RET_ERROR) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait() failed");
+            break;
+        }
+
+        for (int i = 0; i < events_count; ++i) {
+            if (events[i].data.ptr == NULL) {
+                accept_connections(&loop);
+            } else {
+                process_connection(&loop, events[i].data.ptr);
+            }
+        }
+
+        close_timed_out_connections(&loop);
+    }
+
+    while (loop.connections != NULL) {
+        close_connection(&loop, loop.connections);
+    }
+    close(loop.epoll_fd);
+    LOG_INFO("Event loop stopped");
+}
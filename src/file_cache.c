@@ -0,0 +1,224 @@
+/**
+    * @file: file_cache.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the cache of open file
+    * descriptors and their fstat() results.
+    *
+    * The table is a chained hash map guarded by one mutex, which is
+    * never held during open() or fstat(). Entries are kept in LRU
+    * order and the least recently used unreferenced entry is evicted
+    * when the table is full. Every invalidation bumps a generation
+    * counter, so a file opened concurrently with a modification is
+    * served once but not inserted into the table with stale stat.
+*/
+
+#include "../include/file_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../include/logger.h"
+#include "../include/config.h"
+
+#define MIN_BUCKETS_COUNT 16
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct CachedFile** buckets = NULL;
+static size_t buckets_count = 0;
+static size_t entries_count = 0;
+static size_t capacity = 0;
+static int is_initialized = 0;
+static unsigned long long generation = 0;
+static struct CachedFile* lru_head = NULL;
+static struct CachedFile* lru_tail = NULL;
+
+uint32_t hash_path(const char* path) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* symbol = (const unsigned char*)path; *symbol != '\0'; ++symbol) {
+        hash ^= *symbol;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void initialize_cache() {
+    const struct Config* config = get_config();
+    capacity = config->file_cache_entries;
+    is_initialized = 1;
+    if (capacity == 0) return;
+
+    size_t count = MIN_BUCKETS_COUNT;
+    while (count < capacity * 2) count *= 2;
+
+    buckets = calloc(count, sizeof(struct CachedFile*));
+    if (buckets == NULL) {
+        LOG_ERROR("Memory not allocated for file cache, caching disabled");
+        capacity = 0;
+        return;
+    }
+    buckets_count = count;
+}
+
+static struct CachedFile** find_slot(const char* path) {
+    struct CachedFile** slot = &buckets[hash_path(path) & (buckets_count - 1)];
+    while (*slot != NULL && strcmp((*slot)->path, path) != 0) {
+        slot = &(*slot)->bucket_next;
+    }
+    return slot;
+}
+
+static void unlink_lru(struct CachedFile* file) {
+    if (file->lru_prev != NULL) file->lru_prev->lru_next = file->lru_next;
+    else lru_head = file->lru_next;
+    if (file->lru_next != NULL) file->lru_next->lru_prev = file->lru_prev;
+    else lru_tail = file->lru_prev;
+    file->lru_prev = NULL;
+    file->lru_next = NULL;
+}
+
+static void push_lru(struct CachedFile* file) {
+    file->lru_next = lru_head;
+    if (lru_head != NULL) lru_head->lru_prev = file;
+    lru_head = file;
+    if (lru_tail == NULL) lru_tail = file;
+}
+
+static void remove_entry(struct CachedFile* file) {
+    struct CachedFile** slot = find_slot(file->path);
+    *slot = file->bucket_next;
+    file->bucket_next = NULL;
+    unlink_lru(file);
+    file->is_cached = 0;
+    entries_count--;
+}
+
+static void destroy_entry(struct CachedFile* file) {
+    close(file->fd);
+    free(file);
+}
+
+static int make_room() {
+    if (entries_count < capacity) return 1;
+
+    for (struct CachedFile* file = lru_tail; file != NULL; file = file->lru_prev) {
+        if (file->references > 0) continue;
+        remove_entry(file);
+        destroy_entry(file);
+        return 1;
+    }
+    return 0;
+}
+
+static struct CachedFile* open_entry(const char* path) {
+    struct CachedFile* file = calloc(1, sizeof(struct CachedFile));
+    if (file == NULL) {
+        LOG_ERROR("Memory not allocated for file cache entry");
+        return NULL;
+    }
+
+    strncpy(file->path, path, sizeof(file->path) - 1);
+    file->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (file->fd == RET_ERROR) {
+        free(file);
+        return NULL;
+    }
+
+    if (fstat(file->fd, &file->stat) == RET_ERROR) {
+        destroy_entry(file);
+        return NULL;
+    }
+
+    file->references = 1;
+    return file;
+}
+
+struct CachedFile* acquire_file(const char* path) {
+    if (path == NULL) return NULL;
+
+    pthread_mutex_lock(&cache_mutex);
+    if (!is_initialized) initialize_cache();
+
+    if (capacity > 0) {
+        struct CachedFile* file = *find_slot(path);
+        if (file != NULL) {
+            file->references++;
+            unlink_lru(file);
+            push_lru(file);
+            pthread_mutex_unlock(&cache_mutex);
+            return file;
+        }
+    }
+    unsigned long long opened_generation = generation;
+    pthread_mutex_unlock(&cache_mutex);
+
+    struct CachedFile* file = open_entry(path);
+    if (file == NULL || capacity == 0 || !S_ISREG(file->stat.st_mode)) return file;
+
+    pthread_mutex_lock(&cache_mutex);
+    struct CachedFile** slot = find_slot(path);
+    if (*slot != NULL) {
+        struct CachedFile* existing = *slot;
+        existing->references++;
+        pthread_mutex_unlock(&cache_mutex);
+        destroy_entry(file);
+        return existing;
+    }
+
+    if (opened_generation == generation && make_room()) {
+        file->is_cached = 1;
+        *slot = file;
+        push_lru(file);
+        entries_count++;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    return file;
+}
+
+void release_file(struct CachedFile* file) {
+    if (file == NULL) return;
+
+    pthread_mutex_lock(&cache_mutex);
+    file->references--;
+    int is_unused = !file->is_cached && file->references == 0;
+    pthread_mutex_unlock(&cache_mutex);
+
+    if (is_unused) destroy_entry(file);
+}
+
+void invalidate_file(const char* path) {
+    if (path == NULL) return;
+
+    pthread_mutex_lock(&cache_mutex);
+    generation++;
+
+    struct CachedFile* file = capacity > 0 ? *find_slot(path) : NULL;
+    int is_unused = 0;
+    if (file != NULL) {
+        remove_entry(file);
+        is_unused = file->references == 0;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+    if (is_unused) destroy_entry(file);
+}
+
+void clear_file_cache() {
+    pthread_mutex_lock(&cache_mutex);
+    struct CachedFile* file = lru_head;
+    while (file != NULL) {
+        struct CachedFile* next = file->lru_next;
+        remove_entry(file);
+        if (file->references == 0) destroy_entry(file);
+        file = next;
+    }
+
+    free(buckets);
+    buckets = NULL;
+    buckets_count = 0;
+    capacity = 0;
+    is_initialized = 0;
+    pthread_mutex_unlock(&cache_mutex);
+}
@@ -9,22 +9,67 @@
     * and verifying the existence of files. Additionally, it handles
     * file path resolution based on the server’s configured root
     * directory.
+    *
+    * Existence checks and sizes are answered by the metadata index.
+    * An upload is written into a temporary file in the same directory
+    * and renamed over the target only when the whole body is received,
+    * so readers see either the old or the new content, never a partial
+    * one, and a failed upload leaves the old file in place.
+    *
+    * A striped table of reader/writer locks keyed by a hash of the
+    * resolved path orders opening a file against replacing or deleting
+    * it, so the descriptor cache and the metadata index never keep a
+    * stale entry. The locks are held only around these short steps and
+    * never during a transfer, paths hashed to one stripe share its lock.
 */
 
 #include "../include/file_storage.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
 #include <pthread.h>
 #include <sys/param.h>
+#include "../include/io_uring_backend.h"
+#include "../include/file_cache.h"
+#include "../include/content_cache.h"
+#include "../include/metadata_index.h"
+#include "../include/coroutine.h"
+#include "../include/socket_io.h"
 #include "../include/logger.h"
 #include "../include/config.h"
 #include "../include/common.h"
 
-static pthread_mutex_t file_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define FILE_LOCK_STRIPES 64
+#define UPLOAD_FILE_FORMAT "%.*s.%s.upload-%d-%u"
+
+static pthread_rwlock_t file_locks[FILE_LOCK_STRIPES];
+static pthread_once_t file_locks_once = PTHREAD_ONCE_INIT;
+static atomic_uint uploads_count = 0;
+
+static void initialize_file_locks() {
+    for (size_t i = 0; i < FILE_LOCK_STRIPES; ++i) {
+        pthread_rwlock_init(&file_locks[i], NULL);
+    }
+}
+
+static pthread_rwlock_t* get_file_lock(const char* path) {
+    pthread_once(&file_locks_once, initialize_file_locks);
+    return &file_locks[hash_path(path) % FILE_LOCK_STRIPES];
+}
+
+static void invalidate_cached_path(const char* path) {
+    invalidate_file(path);
+    invalidate_content(path);
+    invalidate_metadata(path);
+}
 
-static enum ReturnCode set_file_location(char* output, const char* filename) {
+enum ReturnCode set_file_location(char* output, const char* filename) {
     if (filename == NULL) {
         LOG_ERROR("Filename is NULL");
         output = NULL;
@@ -47,7 +92,225 @@ static enum ReturnCode set_file_location(char* output, const char* filename) {
     return RET_SUCCESS;
 }
 
-enum ReturnCode send_file(int client_socket, const char* filename) {
+static int is_io_uring_used() {
+    const struct Config* config = get_config();
+    // A blocking io_uring wait would stall every coroutine of the scheduler.
+    return config->io_backend == IO_BACKEND_IO_URING && is_io_uring_available() && !is_in_coroutine();
+}
+
+static enum ReturnCode set_upload_location(char* output, const char* path) {
+    const char* name = strrchr(path, '/');
+    int directory_len = name == NULL ? 0 : (int)(name - path + 1);
+    name = name == NULL ? path : name + 1;
+
+    // Hidden name in the target's directory, so rename() never crosses file systems.
+    int written_bytes = snprintf(output, MAX_PATH_LEN, UPLOAD_FILE_FORMAT, directory_len, path, name,
+                                 (int)getpid(), atomic_fetch_add(&uploads_count, 1));
+    if (written_bytes < 0 || written_bytes >= MAX_PATH_LEN) {
+        LOG_ERROR("Temporary upload path is bigger than buffer size");
+        return RET_ERROR;
+    }
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode create_upload_file(const char* path, struct UploadFile* file, int is_io_uring) {
+    int flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+
+    file->fd = -1;
+    if (set_upload_location(file->temp_path, path) != RET_SUCCESS) return RET_ERROR;
+
+    file->fd = is_io_uring ? io_uring_open_file(file->temp_path, flags, 0666) : open(file->temp_path, flags, 0666);
+    if (file->fd == RET_ERROR) {
+        LOG_ERROR("Couldn't create file");
+        return RET_FILE_NOT_OPENED;
+    }
+    return RET_SUCCESS;
+}
+
+static void close_upload_file(struct UploadFile* file, int is_io_uring) {
+    if (is_io_uring) io_uring_close_file(file->fd);
+    else close(file->fd);
+    file->fd = -1;
+}
+
+static void discard_upload_file(struct UploadFile* file, int is_io_uring) {
+    close_upload_file(file, is_io_uring);
+    unlink(file->temp_path);
+}
+
+static enum ReturnCode commit_upload_file(const char* path, struct UploadFile* file, int is_io_uring) {
+    struct stat stat_result;
+    int is_stat_taken = fstat(file->fd, &stat_result) == RET_SUCCESS;
+    close_upload_file(file, is_io_uring);
+
+    // Readers opening the old file are ordered before the swap, so none
+    // of them caches its descriptor or metadata after the invalidation.
+    pthread_rwlock_t* lock = get_file_lock(path);
+    pthread_rwlock_wrlock(lock);
+    int result = rename(file->temp_path, path);
+    invalidate_cached_path(path);
+    if (result == RET_SUCCESS && is_stat_taken) update_metadata(path, &stat_result);
+    pthread_rwlock_unlock(lock);
+
+    if (result == RET_ERROR) {
+        LOG_ERROR("Couldn't move received file into place");
+        unlink(file->temp_path);
+        return RET_ERROR;
+    }
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode send_chunked_file(int client_socket, const struct CachedFile* file,
+                                         unsigned long long* bytes_sent) {
+    char buffer[BUFSIZ];
+    char size_line[CHUNK_SIZE_LINE_SIZE];
+    struct iovec iov[CHUNK_IOV_COUNT];
+
+    while (1) {
+        ssize_t bytes_read = read(file->fd, buffer, sizeof(buffer));
+        if (bytes_read < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Couldn't read file for chunked response");
+            return RET_ERROR;
+        }
+
+        int iov_count = prepare_chunk(size_line, buffer, (size_t)bytes_read, iov);
+        size_t remaining_bytes = 0;
+        for (int i = 0; i < iov_count; ++i) remaining_bytes += iov[i].iov_len;
+
+        while (remaining_bytes > 0) {
+            ssize_t sent_bytes = socket_writev(client_socket, iov, iov_count);
+            if (sent_bytes <= 0) {
+                LOG_ERROR("Failed to send chunk");
+                return RET_ERROR;
+            }
+            remaining_bytes -= (size_t)sent_bytes;
+            *bytes_sent += (unsigned long long)sent_bytes;
+        }
+
+        if (bytes_read == 0) return RET_SUCCESS;
+    }
+}
+
+static enum ReturnCode send_file_range(int client_socket, const struct CachedFile* file, off_t offset, size_t size,
+                                       unsigned long long* bytes_sent) {
+    if (is_io_uring_used()) {
+        enum ReturnCode return_code = io_uring_send_file(client_socket, file->fd, offset, size);
+        if (return_code == RET_SUCCESS) *bytes_sent += (unsigned long long)size;
+        return return_code;
+    }
+
+    off_t end = offset + (off_t)size;
+    while (offset < end) {
+        ssize_t sent_bytes = socket_sendfile(client_socket, file->fd, &offset, (size_t)(end - offset));
+        if (sent_bytes <= 0) {
+            LOG_ERROR("Failed to send file");
+            return RET_ERROR;
+        }
+        *bytes_sent += (unsigned long long)sent_bytes;
+    }
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode send_buffer(int client_socket, const char* buffer, size_t size,
+                                   unsigned long long* bytes_sent) {
+    while (size > 0) {
+        ssize_t sent_bytes = socket_send(client_socket, buffer, size, MSG_NOSIGNAL);
+        if (sent_bytes <= 0) {
+            LOG_ERROR("Failed to send buffer");
+            return RET_ERROR;
+        }
+        buffer += sent_bytes;
+        size -= (size_t)sent_bytes;
+        *bytes_sent += (unsigned long long)sent_bytes;
+    }
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode send_file_until_end(int client_socket, const struct CachedFile* file,
+                                           unsigned long long* bytes_sent) {
+    char buffer[BUFSIZ];
+    while (1) {
+        ssize_t bytes_read = read(file->fd, buffer, sizeof(buffer));
+        if (bytes_read < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Couldn't read file for close-delimited response");
+            return RET_ERROR;
+        }
+        if (bytes_read == 0) return RET_SUCCESS;
+        if (send_buffer(client_socket, buffer, (size_t)bytes_read, bytes_sent) != RET_SUCCESS) return RET_ERROR;
+    }
+}
+
+static enum ReturnCode send_file_ranges(int client_socket, const struct CachedFile* file,
+                                        const struct ByteRanges* ranges, unsigned long long* bytes_sent) {
+    for (size_t i = 0; i < ranges->count; ++i) {
+        const struct ByteRange* range = &ranges->items[i];
+        if (send_buffer(client_socket, range->part_head, range->part_head_size, bytes_sent) != RET_SUCCESS ||
+            send_file_range(client_socket, file, (off_t)range->offset, (size_t)range->length,
+                            bytes_sent) != RET_SUCCESS) {
+            return RET_ERROR;
+        }
+    }
+    return send_buffer(client_socket, ranges->tail, ranges->tail_size, bytes_sent);
+}
+
+enum ReturnCode send_opened_file(int client_socket, const struct CachedFile* file, const struct ByteRanges* ranges,
+                                 int is_close_delimited, unsigned long long* bytes_sent) {
+    if (file == NULL) {
+        LOG_ERROR("File is NULL");
+        return RET_ARGUMENT_IS_NULL;
+    }
+
+    if (!S_ISREG(file->stat.st_mode)) {
+        return is_close_delimited ? send_file_until_end(client_socket, file, bytes_sent)
+                                  : send_chunked_file(client_socket, file, bytes_sent);
+    }
+    if (ranges != NULL) {
+        return send_file_ranges(client_socket, file, ranges, bytes_sent);
+    }
+    return send_file_range(client_socket, file, 0, (size_t)file->stat.st_size, bytes_sent);
+}
+
+static enum ReturnCode receive_into_opened_file(int client_socket, int fd, size_t file_size,
+                                                const void* received_body, size_t received_body_size) {
+    if (is_io_uring_used()) {
+        return io_uring_receive_file(client_socket, fd, file_size, received_body, received_body_size);
+    }
+
+    size_t remaining_bytes = file_size;
+
+    if (received_body && received_body_size > 0) {
+        size_t buffered_size = MIN(received_body_size, file_size);
+        if (write_to_file(fd, received_body, buffered_size) != RET_SUCCESS) {
+            return RET_ERROR;
+        }
+        remaining_bytes -= buffered_size;
+    }
+
+    while (remaining_bytes > 0) {
+        ssize_t received_bytes = socket_splice_to_file(client_socket, fd, remaining_bytes);
+        if (received_bytes <= 0) {
+            LOG_ERROR("Failed during receiving data chunk");
+            return RET_ERROR;
+        }
+        remaining_bytes -= (size_t)received_bytes;
+    }
+    return RET_SUCCESS;
+}
+
+static struct CachedFile* acquire_file_locked(const char* path) {
+    // Only opening is ordered against replacement, an opened descriptor
+    // keeps the content it was opened with.
+    pthread_rwlock_t* lock = get_file_lock(path);
+    pthread_rwlock_rdlock(lock);
+    struct CachedFile* file = acquire_file(path);
+    pthread_rwlock_unlock(lock);
+    return file;
+}
+
+enum ReturnCode send_file(int client_socket, const char* filename, const struct ByteRanges* ranges,
+                          unsigned long long* bytes_sent) {
     if (filename == NULL) {
         LOG_ERROR("Filename is NULL");
         return RET_ARGUMENT_IS_NULL;
@@ -58,35 +321,19 @@ enum ReturnCode send_file(int client_socket, const char* filename) {
         return RET_ERROR;
     }
 
-    pthread_mutex_lock(&file_mutex);
-    FILE* file = fopen(path, "rb");
+    struct CachedFile* file = acquire_file_locked(path);
     if (file == NULL) {
-        pthread_mutex_unlock(&file_mutex);
+        // The file was removed behind the server's back.
+        invalidate_metadata(path);
         LOG_ERROR("Couldn't open file");
         return RET_FILE_NOT_OPENED;
     }
-    pthread_mutex_unlock(&file_mutex);
 
-    char buffer[BUFSIZ];
-    memset(buffer, 0, sizeof(buffer));
-
-    size_t bytes_read;
-    while((bytes_read = fread(buffer, 1, BUFSIZ, file)) > 0) {
-        size_t total_sent = 0;
-        while (total_sent < bytes_read) {
-            ssize_t bytes_sent = send(client_socket, buffer + total_sent, bytes_read - total_sent, 0);
-            if (bytes_sent <= 0) {
-                LOG_ERROR("Failed to send file");
-                fclose(file);
-                return RET_ERROR;
-            }
-            total_sent += bytes_sent;
-        }
-    }
+    enum ReturnCode return_code = send_opened_file(client_socket, file, ranges, 0, bytes_sent);
+    release_file(file);
 
-    LOG_INFO("File was successfully sent");
-    fclose(file);
-    return RET_SUCCESS;
+    if (return_code == RET_SUCCESS) LOG_INFO("File was successfully sent");
+    return return_code;
 }
 
 enum ReturnCode receive_file(int client_socket, const char* filename, size_t file_size,
@@ -101,52 +348,154 @@ enum ReturnCode receive_file(int client_socket, const char* filename, size_t fil
         return RET_ERROR;
     }
 
-    pthread_mutex_lock(&file_mutex);
-    FILE* file = fopen(path, "wb");
-    if (file == NULL) {
-        pthread_mutex_unlock(&file_mutex);
-        LOG_ERROR("Couldn't create file");
+    int is_io_uring = is_io_uring_used();
+    struct UploadFile file;
+    if (create_upload_file(path, &file, is_io_uring) != RET_SUCCESS) {
         return RET_FILE_NOT_OPENED;
     }
 
-    size_t remaining_bytes = file_size;
+    enum ReturnCode return_code = receive_into_opened_file(client_socket, file.fd, file_size,
+                                                           received_body, received_body_size);
+    if (return_code == RET_SUCCESS) return_code = commit_upload_file(path, &file, is_io_uring);
+    else discard_upload_file(&file, is_io_uring);
 
-    if (received_body && received_body_size > 0) {
-        if (fwrite(received_body, 1, received_body_size, file) != received_body_size) {
-            LOG_ERROR("Couldn't write received body into file");
-            fclose(file);
-            pthread_mutex_unlock(&file_mutex);
-            return RET_ERROR;
-        }
-        remaining_bytes -= received_body_size;
+    if (return_code == RET_SUCCESS) LOG_INFO("File was successfully received");
+    return return_code;
+}
+
+enum ReturnCode receive_chunked_file(int client_socket, const char* filename, char* buffer,
+                                     size_t buffer_capacity, size_t* buffered_size) {
+    if (filename == NULL) {
+        LOG_ERROR("Filename is NULL");
+        return RET_ARGUMENT_IS_NULL;
     }
 
-    char buffer[BUFSIZ];
-    memset(buffer, 0, sizeof(buffer));
+    char path[MAX_PATH_LEN];
+    if (set_file_location(path, filename) != RET_SUCCESS) {
+        return RET_ERROR;
+    }
 
-    while (remaining_bytes > 0) {
-        size_t data_chunk = MIN(remaining_bytes, sizeof(buffer));
+    int is_io_uring = is_io_uring_used();
+    struct UploadFile file;
+    if (create_upload_file(path, &file, is_io_uring) != RET_SUCCESS) {
+        return RET_FILE_NOT_OPENED;
+    }
+
+    struct ChunkedDecoder decoder;
+    initialize_chunked_decoder(&decoder);
 
-        ssize_t received_bytes = recv(client_socket, buffer, data_chunk, 0);
+    enum ReturnCode return_code = RET_SUCCESS;
+    size_t size = *buffered_size;
+    while (1) {
+        if (write_chunked_to_file(file.fd, &decoder, buffer, &size) != RET_SUCCESS) {
+            return_code = RET_ERROR;
+            break;
+        }
+        if (is_chunked_body_complete(&decoder)) break;
+
+        ssize_t received_bytes = buffer_capacity > 0 ? socket_recv(client_socket, buffer, buffer_capacity, 0) : -1;
         if (received_bytes <= 0) {
             LOG_ERROR("Failed during receiving data chunk");
-            fclose(file);
-            pthread_mutex_unlock(&file_mutex);
-            return RET_ERROR;
+            return_code = RET_ERROR;
+            break;
         }
+        size = (size_t)received_bytes;
+    }
+    if (return_code == RET_SUCCESS) return_code = commit_upload_file(path, &file, is_io_uring);
+    else discard_upload_file(&file, is_io_uring);
+
+    *buffered_size = size;
+    if (return_code == RET_SUCCESS) LOG_INFO("File was successfully received");
+    return return_code;
+}
+
+enum ReturnCode open_file_for_reading(const char* filename, struct CachedFile** file) {
+    if (filename == NULL || file == NULL) {
+        LOG_ERROR("Filename or output argument is NULL");
+        return RET_ARGUMENT_IS_NULL;
+    }
 
-        if (fwrite(buffer, 1, (size_t)received_bytes, file) != (size_t)received_bytes) {
-            LOG_ERROR("Couldn't write received data chunk into file");
-            fclose(file);
-            pthread_mutex_unlock(&file_mutex);
+    char path[MAX_PATH_LEN];
+    if (set_file_location(path, filename) != RET_SUCCESS) {
+        return RET_ERROR;
+    }
+
+    if (lookup_metadata(path, NULL) != RET_SUCCESS) {
+        *file = NULL;
+        LOG_WARN("File not found");
+        return RET_FILE_NOT_OPENED;
+    }
+
+    *file = acquire_file_locked(path);
+    if (*file == NULL) {
+        // The file was removed behind the server's back.
+        invalidate_metadata(path);
+        LOG_ERROR("Couldn't open file");
+        return RET_FILE_NOT_OPENED;
+    }
+
+    return RET_SUCCESS;
+}
+
+void close_file_for_reading(struct CachedFile* file) {
+    release_file(file);
+}
+
+enum ReturnCode open_file_for_writing(const char* filename, struct UploadFile* file) {
+    if (filename == NULL || file == NULL) {
+        LOG_ERROR("Filename or output argument is NULL");
+        return RET_ARGUMENT_IS_NULL;
+    }
+
+    char path[MAX_PATH_LEN];
+    if (set_file_location(path, filename) != RET_SUCCESS) {
+        file->fd = -1;
+        return RET_ERROR;
+    }
+
+    return create_upload_file(path, file, 0);
+}
+
+enum ReturnCode close_file_for_writing(const char* filename, struct UploadFile* file) {
+    char path[MAX_PATH_LEN];
+    if (set_file_location(path, filename) != RET_SUCCESS) {
+        discard_upload_file(file, 0);
+        return RET_ERROR;
+    }
+
+    return commit_upload_file(path, file, 0);
+}
+
+void discard_file_for_writing(struct UploadFile* file) {
+    discard_upload_file(file, 0);
+}
+
+enum ReturnCode write_to_file(int fd, const void* data, size_t size) {
+    size_t total_written = 0;
+    while (total_written < size) {
+        ssize_t written_bytes = write(fd, (const char*)data + total_written, size - total_written);
+        if (written_bytes <= 0) {
+            if (written_bytes == RET_ERROR && errno == EINTR) continue;
+            LOG_ERROR("Couldn't write received data into file");
             return RET_ERROR;
         }
-        remaining_bytes -= (size_t)received_bytes;
+        total_written += (size_t)written_bytes;
     }
+    return RET_SUCCESS;
+}
 
-    LOG_INFO("File was successfully received");
-    fclose(file);
-    pthread_mutex_unlock(&file_mutex);
+enum ReturnCode write_chunked_to_file(int fd, struct ChunkedDecoder* decoder, char* data, size_t* size) {
+    size_t decoded_size = 0;
+    size_t consumed_size = 0;
+    if (decode_chunked(decoder, data, *size, &decoded_size, &consumed_size) != RET_SUCCESS) {
+        return RET_ERROR;
+    }
+    if (decoded_size > 0 && write_to_file(fd, data, decoded_size) != RET_SUCCESS) {
+        return RET_ERROR;
+    }
+
+    *size -= consumed_size;
+    if (*size > 0) memmove(data, data + consumed_size, *size);
     return RET_SUCCESS;
 }
 
@@ -161,9 +510,11 @@ int delete_file(const char* filename) {
         return RET_ERROR;
     }
 
-    pthread_mutex_lock(&file_mutex);
+    pthread_rwlock_t* lock = get_file_lock(path);
+    pthread_rwlock_wrlock(lock);
     int result = remove(path);
-    pthread_mutex_unlock(&file_mutex);
+    invalidate_cached_path(path);
+    pthread_rwlock_unlock(lock);
 
     return result;
 }
@@ -179,13 +530,21 @@ enum ReturnCode check_file_exists(const char* filename) {
         return RET_ERROR;
     }
 
-    FILE* file = fopen(path, "r");
-    if (file != NULL) {
-        fclose(file);
-        return RET_SUCCESS;
+    return lookup_metadata(path, NULL) == RET_SUCCESS ? RET_SUCCESS : RET_ERROR;
+}
+
+enum ReturnCode get_file_metadata(const char* filename, struct FileMetadata* metadata) {
+    if (filename == NULL || metadata == NULL) {
+        LOG_ERROR("Filename or output argument is NULL");
+        return RET_ARGUMENT_IS_NULL;
     }
 
-    return RET_ERROR;
+    char path[MAX_PATH_LEN];
+    if (set_file_location(path, filename) != RET_SUCCESS) {
+        return RET_ERROR;
+    }
+
+    return lookup_metadata(path, metadata) == RET_SUCCESS ? RET_SUCCESS : RET_ERROR;
 }
 
 size_t get_file_size(const char* filename) {
@@ -199,13 +558,7 @@ size_t get_file_size(const char* filename) {
         return 0;
     }
 
-    FILE* file = fopen(path, "rb");
-    if (file == NULL) return 0;
-
-    fseek(file, 0, SEEK_END);
-    size_t size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    fclose(file);
-    return size;
+    struct FileMetadata metadata;
+    if (lookup_metadata(path, &metadata) != RET_SUCCESS) return 0;
+    return (size_t)metadata.size;
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+/**
+    * @file: header_scanner.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the incremental search
+    * of the request headers terminator and of the receive buffer growth.
+    *
+    * The terminator "\r\n\r\n" ends with LF, so only LF bytes are
+    * candidates, and every byte is examined once: a terminator split
+    * between two recv() calls is found when its last LF arrives. The
+    * vector versions compare 16 or 32 bytes at a time with LF, and
+    * with LF two bytes before them, so the candidates left to check
+    * byte by byte are only the "\n?\n" patterns.
+    *
+    * Bytes following an answered request are moved to the start of
+    * the receive buffer, so a pipelined request is parsed without
+    * waiting for another recv().
+*/
+
+#include "../include/header_scanner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/logger.h"
+#include "../include/config.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEADER_SCANNER_X86
+#endif
+
+#define TERMINATOR_LAST_INDEX 3     /**< Index of the last LF in "\r\n\r\n". */
+#define MIN_BODY_BUFFER_SIZE 1024   /**< Space kept after headers for receiving a chunked body. */
+
+static int is_terminator_end(const char* buffer, size_t position) {
+    return buffer[position - 3] == '\r' && buffer[position - 2] == '\n' && buffer[position - 1] == '\r';
+}
+
+static size_t scan_scalar(const char* buffer, size_t position, size_t size) {
+    while (position < size) {
+        const char* newline = memchr(buffer + position, '\n', size - position);
+        if (newline == NULL) return size;
+
+        position = (size_t)(newline - buffer);
+        if (is_terminator_end(buffer, position)) return position;
+        position++;
+    }
+    return size;
+}
+
+#ifdef HEADER_SCANNER_X86
+static size_t check_candidates(const char* buffer, size_t position, unsigned int mask) {
+    while (mask != 0) {
+        size_t candidate = position + (size_t)__builtin_ctz(mask);
+        if (is_terminator_end(buffer, candidate)) return candidate;
+        mask &= mask - 1;
+    }
+    return 0;
+}
+
+static size_t scan_sse2(const char* buffer, size_t position, size_t size) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; position + sizeof(__m128i) <= size; position += sizeof(__m128i)) {
+        __m128i current = _mm_loadu_si128((const __m128i*)(buffer + position));
+        __m128i previous = _mm_loadu_si128((const __m128i*)(buffer + position - 2));
+        __m128i matches = _mm_and_si128(_mm_cmpeq_epi8(current, newline), _mm_cmpeq_epi8(previous, newline));
+
+        size_t found = check_candidates(buffer, position, (unsigned int)_mm_movemask_epi8(matches));
+        if (found != 0) return found;
+    }
+    return scan_scalar(buffer, position, size);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_avx2(const char* buffer, size_t position, size_t size) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; position + sizeof(__m256i) <= size; position += sizeof(__m256i)) {
+        __m256i current = _mm256_loadu_si256((const __m256i*)(buffer + position));
+        __m256i previous = _mm256_loadu_si256((const __m256i*)(buffer + position - 2));
+        __m256i matches = _mm256_and_si256(_mm256_cmpeq_epi8(current, newline),
+                                           _mm256_cmpeq_epi8(previous, newline));
+
+        size_t found = check_candidates(buffer, position, (unsigned int)_mm256_movemask_epi8(matches));
+        if (found != 0) return found;
+    }
+    return scan_sse2(buffer, position, size);
+}
+#endif
+
+size_t find_headers_end(const char* buffer, size_t size, size_t* scanned_size) {
+    size_t position = *scanned_size > TERMINATOR_LAST_INDEX ? *scanned_size : TERMINATOR_LAST_INDEX;
+    if (position >= size) return 0;
+
+#ifdef HEADER_SCANNER_X86
+    size_t found = __builtin_cpu_supports("avx2") ? scan_avx2(buffer, position, size)
+                                                  : scan_sse2(buffer, position, size);
+#else
+    size_t found = scan_scalar(buffer, position, size);
+#endif
+
+    if (found == size) {
+        *scanned_size = size;
+        return 0;
+    }
+    *scanned_size = found + 1;
+    return found + 1;
+}
+
+enum ReturnCode initialize_input_buffer(struct InputBuffer* input) {
+    size_t max_header_size = get_config()->max_header_size;
+    input->capacity = BUFSIZ < max_header_size ? BUFSIZ : max_header_size;
+    input->size = 0;
+    input->scanned = 0;
+    input->data = malloc(input->capacity);
+    if (input->data == NULL) {
+        LOG_ERROR("Memory not allocated for receive buffer");
+        return RET_ERROR;
+    }
+    return RET_SUCCESS;
+}
+
+void free_input_buffer(struct InputBuffer* input) {
+    free(input->data);
+    input->data = NULL;
+    input->size = 0;
+    input->capacity = 0;
+    input->scanned = 0;
+}
+
+size_t find_input_headers_end(struct InputBuffer* input) {
+    size_t headers_size = find_headers_end(input->data, input->size, &input->scanned);
+
+    // Growing is possible only before the request is parsed into views of the buffer.
+    if (headers_size != 0 && input->capacity - headers_size < MIN_BODY_BUFFER_SIZE &&
+        input->capacity < get_config()->max_header_size) {
+        grow_input_buffer(input);
+    }
+    return headers_size;
+}
+
+int has_next_request(const struct InputBuffer* input, size_t request_size) {
+    if (request_size >= input->size) return 0;
+
+    size_t scanned_size = 0;
+    return find_headers_end(input->data + request_size, input->size - request_size, &scanned_size) != 0;
+}
+
+void consume_input(struct InputBuffer* input, size_t request_size) {
+    if (request_size > input->size) request_size = input->size;
+
+    input->size -= request_size;
+    if (input->size > 0) memmove(input->data, input->data + request_size, input->size);
+    input->scanned = 0;
+}
+
+enum ReturnCode grow_input_buffer(struct InputBuffer* input) {
+    size_t max_header_size = get_config()->max_header_size;
+    if (input->capacity >= max_header_size) {
+        LOG_ERRORF("Request headers exceed %zu bytes", max_header_size);
+        return RET_ERROR;
+    }
+
+    size_t new_capacity = input->capacity * 2 < max_header_size ? input->capacity * 2 : max_header_size;
+    char* new_data = realloc(input->data, new_capacity);
+    if (new_data == NULL) {
+        LOG_ERROR("Memory not allocated for request headers");
+        return RET_ERROR;
+    }
+
+    input->data = new_data;
+    input->capacity = new_capacity;
+    return RET_SUCCESS;
+}
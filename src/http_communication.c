@@ -10,10 +10,18 @@
     * methods such as GET, POST, and DELETE. Unsupported
     * methods result in an HTTP 405 response.
     *
-    * Additionally, this file includes functionality for
-    * converting response structures into raw HTTP strings,
-    * extracting header information such as Content-Length,
-    * and determining whether connections should be kept alive.
+    * Responses are sent with a single writev() over the serialized
+    * head, the Date header, the connection headers and the body, so
+    * nothing is copied into one contiguous buffer. Heads of responses
+    * that never change (404, 405, 201, 500, ...) are serialized once
+    * at startup.
+    *
+    * GET with a satisfiable Range is answered with 206 and only the
+    * requested bytes of the file. Files are validated by an entity tag
+    * made of inode, size and modification time in nanoseconds, and by
+    * the modification date. A conditional GET of an unchanged file is
+    * answered with 304 from the metadata index, without opening it.
+    * Partial and conditional responses bypass the content cache.
 */
 
 #include "../include/http_communication.h"
@@ -21,239 +29,574 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
 #include "../include/http_header.h"
+#include "../include/byte_range.h"
 #include "../include/file_storage.h"
+#include "../include/socket_io.h"
+#include "../include/coroutine.h"
 #include "../include/logger.h"
 #include "../include/common.h"
 
 #define METHOD_GET "GET"
 #define METHOD_POST "POST"
 #define METHOD_DELETE "DELETE"
+#define HTTP_VERSION_PREFIX "HTTP/"
+#define HTTP_VERSION_PREFIX_LEN 5
+#define HTTP_VERSION_1_1 "HTTP/1.1"
+#define CONSTANT_RESPONSE_HEAD_SIZE 128
+
+static int is_token_char(unsigned char c) {
+    if (isalnum(c)) return 1;
+    return c != '\0' && strchr("!#$%&'*+-.^_`|~", c) != NULL;
+}
+
+static int is_target_char(unsigned char c) {
+    return c > ' ' && c != 0x7f;
+}
 
-static void initialize_request(struct Request* request) {
-    memset(request, 0, sizeof(*request));
+static int is_field_value_char(unsigned char c) {
+    return c == '\t' || (c >= ' ' && c != 0x7f);
 }
 
-static struct HeaderList parse_headers(const char* raw_headers) {
-    struct HeaderList list = {NULL, 0};
-    if (raw_headers == NULL) return list;
+static int is_whitespace(char c) {
+    return c == ' ' || c == '\t';
+}
 
-    const char* line_start = raw_headers;
-    const char* line_end;
+static enum Method get_method(const char* name, size_t length) {
+    if (length == sizeof(METHOD_GET) - 1 && memcmp(name, METHOD_GET, length) == 0) return GET;
+    if (length == sizeof(METHOD_POST) - 1 && memcmp(name, METHOD_POST, length) == 0) return POST;
+    if (length == sizeof(METHOD_DELETE) - 1 && memcmp(name, METHOD_DELETE, length) == 0) return DELETE;
+    return UNKNOWN;
+}
 
-    while ((line_end = strstr(line_start, "\r\n")) != NULL) {
-        if (line_end == line_start) break;
+static int is_line_end(const char* position, const char* end) {
+    return end - position >= 2 && position[0] == '\r' && position[1] == '\n';
+}
+
+static char* parse_request_line(char* position, const char* end, struct Request* request) {
+    const char* method_start = position;
+    while (position < end && is_token_char((unsigned char)*position)) position++;
+    if (position == method_start || position == end || *position != ' ') return NULL;
+    request->method = get_method(method_start, (size_t)(position - method_start));
+    position++;
+
+    char* path_start = position;
+    while (position < end && is_target_char((unsigned char)*position)) position++;
+    if (position == path_start || position == end || *position != ' ') return NULL;
+    if ((size_t)(position - path_start) >= MAX_PATH_LEN) return NULL;
+    request->path.data = path_start;
+    request->path.length = (size_t)(position - path_start);
+    // The separator is replaced in place, so the path can be passed to file storage as is.
+    *position++ = '\0';
+
+    const char* version_start = position;
+    while (position < end && is_target_char((unsigned char)*position)) position++;
+    if (position - version_start < HTTP_VERSION_PREFIX_LEN ||
+        memcmp(version_start, HTTP_VERSION_PREFIX, HTTP_VERSION_PREFIX_LEN) != 0) {
+        return NULL;
+    }
+    if (!is_line_end(position, end)) return NULL;
+    request->version.data = version_start;
+    request->version.length = (size_t)(position - version_start);
+    return position + 2;
+}
 
-        const char* colon = strchr(line_start, ':');
-        if (colon && colon < line_end) {
-            size_t key_len = colon - line_start;
-            size_t value_len = line_end - (colon + 1);
-            while (value_len > 0 && ((colon[1 + value_len - 1] == ' ') || (colon[1 + value_len - 1] == '\t'))) {
-                value_len--;
-            }
+static char* parse_header_line(char* position, const char* end, struct Request* request) {
+    const char* key_start = position;
+    while (position < end && is_token_char((unsigned char)*position)) position++;
+    if (position == key_start || position == end || *position != ':') return NULL;
+    size_t key_length = (size_t)(position - key_start);
+    position++;
 
-            list.items = realloc(list.items, sizeof(struct Header) * (list.size + 1));
-            list.items[list.size].key = strndup(line_start, key_len);
-            list.items[list.size].value = strndup(colon + 1, value_len);
-            list.size++;
+    while (position < end && is_whitespace(*position)) position++;
+    const char* value_start = position;
+    while (position < end && is_field_value_char((unsigned char)*position)) position++;
+    if (!is_line_end(position, end)) return NULL;
+
+    size_t value_length = (size_t)(position - value_start);
+    while (value_length > 0 && is_whitespace(value_start[value_length - 1])) value_length--;
+
+    if (request->headers_count == MAX_REQUEST_HEADERS) {
+        LOG_ERROR("Request has too many headers");
+        return NULL;
+    }
+    struct RequestHeader* header = &request->headers[request->headers_count++];
+    header->key.data = key_start;
+    header->key.length = key_length;
+    header->value.data = value_start;
+    header->value.length = value_length;
+
+    enum KnownHeader known_header = classify_header(header->key);
+    if (known_header != HEADER_UNKNOWN) {
+        struct StringView* known_value = &request->known_headers[known_header];
+        if (known_value->data == NULL) {
+            *known_value = header->value;
+        } else if (known_header == HEADER_CONTENT_LENGTH && (known_value->length != value_length ||
+                   memcmp(known_value->data, value_start, value_length) != 0)) {
+            LOG_ERROR("Request has conflicting Content-Length headers");
+            return NULL;
         }
+    }
+    return position + 2;
+}
+
+static enum ReturnCode parse_content_length(struct StringView value, uint64_t* content_length) {
+    if (value.length == 0) return RET_ERROR;
+
+    uint64_t result = 0;
+    for (size_t i = 0; i < value.length; ++i) {
+        unsigned char c = (unsigned char)value.data[i];
+        if (!isdigit(c)) return RET_ERROR;
 
-        line_start = line_end + 2;
+        uint64_t digit = (uint64_t)(c - '0');
+        if (result > (UINT64_MAX - digit) / 10) return RET_ERROR;
+        result = result * 10 + digit;
     }
 
-    return list;
+    *content_length = result;
+    return RET_SUCCESS;
 }
 
-struct Request parse_request(const char* raw_request) {
-    struct Request request;
-    initialize_request(&request);
+static int has_connection_option(struct StringView value, const char* option) {
+    const char* position = value.data;
+    const char* end = value.data + value.length;
 
-    if (raw_request == NULL) {
-        LOG_WARN("Raw request is NULL");
-        return request;
+    while (position < end) {
+        const char* option_end = memchr(position, ',', (size_t)(end - position));
+        if (option_end == NULL) option_end = end;
+
+        struct StringView token = {position, (size_t)(option_end - position)};
+        while (token.length > 0 && is_whitespace(token.data[0])) {
+            token.data++;
+            token.length--;
+        }
+        while (token.length > 0 && is_whitespace(token.data[token.length - 1])) token.length--;
+        if (is_view_equal(token, option)) return 1;
+
+        position = option_end + 1;
     }
+    return 0;
+}
 
-    char method[METHOD_STR_LEN];
-    int parsed = sscanf(raw_request, "%15s %511s %31s", method, request.path, request.version);
-    if (parsed != 3) {
-        LOG_ERROR("Couldn't parse raw request");
-        return request;
+static int is_http_1_1(const struct Request* request) {
+    return request->version.length == sizeof(HTTP_VERSION_1_1) - 1 &&
+           memcmp(request->version.data, HTTP_VERSION_1_1, request->version.length) == 0;
+}
+
+static enum ReturnCode interpret_known_headers(struct Request* request) {
+    struct StringView content_length = request->known_headers[HEADER_CONTENT_LENGTH];
+    if (content_length.data != NULL && parse_content_length(content_length, &request->content_length) != RET_SUCCESS) {
+        LOG_ERROR("Request has invalid Content-Length");
+        return RET_ERROR;
     }
 
-    if (strcmp(method, METHOD_GET) == RET_SUCCESS) {
-        request.method = GET;
-    } else if (strcmp(method, METHOD_POST) == RET_SUCCESS) {
-        request.method = POST;
-    } else if (strcmp(method, METHOD_DELETE) == RET_SUCCESS) {
-        request.method = DELETE;
-    } else {
-        request.method = UNKNOWN;
+    struct StringView transfer_encoding = request->known_headers[HEADER_TRANSFER_ENCODING];
+    request->is_chunked = transfer_encoding.data != NULL;
+    if (request->is_chunked && (!is_view_equal(transfer_encoding, "chunked") || content_length.data != NULL)) {
+        LOG_ERROR("Request has unsupported Transfer-Encoding");
+        return RET_ERROR;
     }
 
-    const char* header_end = strstr(raw_request, "\r\n\r\n");
-    if (header_end != NULL) {
-        size_t header_size = header_end - raw_request;
-        char* header_buf = strndup(raw_request, header_size);
-        request.headers = parse_headers(header_buf);
-        free(header_buf);
+    // HTTP/1.1 connections are persistent unless closed, older clients have to ask for it.
+    struct StringView connection = request->known_headers[HEADER_CONNECTION];
+    request->keep_alive = (is_http_1_1(request) || has_connection_option(connection, "keep-alive")) &&
+                          !has_connection_option(connection, "close");
+    request->expect_continue = is_view_equal(request->known_headers[HEADER_EXPECT], "100-continue");
+    return RET_SUCCESS;
+}
 
-        const char* after_header = header_end + 4;
-        if (*after_header) {
-            request.body_size = strlen(after_header);
-            request.body = strndup(after_header, request.body_size);
-        }
+enum ReturnCode parse_request(char* raw_request, size_t raw_request_size, struct Request* request) {
+    if (raw_request == NULL || request == NULL) {
+        LOG_WARN("Raw request is NULL");
+        return RET_ARGUMENT_IS_NULL;
+    }
+
+    request->method = UNKNOWN;
+    request->headers_count = 0;
+    memset(request->known_headers, 0, sizeof(request->known_headers));
+    request->content_length = 0;
+    request->status_code = 0;
+    request->bytes_sent = 0;
+
+    const char* end = raw_request + raw_request_size;
+    char* position = parse_request_line(raw_request, end, request);
+    while (position != NULL && !is_line_end(position, end)) {
+        position = parse_header_line(position, end, request);
+    }
+
+    if (position == NULL || interpret_known_headers(request) != RET_SUCCESS) {
+        LOG_ERROR("Couldn't parse raw request");
+        return RET_ERROR;
     }
 
+    // Bytes after Content-Length belong to the next pipelined request.
+    request->body.data = position + 2;
+    request->body.length = (size_t)(end - request->body.data);
+    if (request->body.length > request->content_length) request->body.length = (size_t)request->content_length;
+    request->size = (size_t)(request->body.data + request->body.length - raw_request);
+
+    // Only POST receives the rest of the body, after other methods it would be taken for the next request.
+    if (request->method != POST && is_body_pending(request)) request->keep_alive = 0;
     LOG_INFO("Raw request parsed successfully");
-    return request;
+    return RET_SUCCESS;
 }
 
-static void initialize_response(struct Response* response) {
-    memset(response, 0, sizeof(*response));
+enum ConstantResponseType {
+    RESPONSE_CREATED,
+    RESPONSE_DELETED,
+    RESPONSE_NOT_FOUND,
+    RESPONSE_METHOD_NOT_ALLOWED,
+    RESPONSE_INTERNAL_ERROR,
+    CONSTANT_RESPONSES_COUNT
+};
+
+struct ConstantResponse {
+    const char* status;
+    const char* body;
+    char head[CONSTANT_RESPONSE_HEAD_SIZE];
+    size_t head_size;
+};
+
+static struct ConstantResponse constant_responses[CONSTANT_RESPONSES_COUNT] = {
+    [RESPONSE_CREATED] = {STATUS_201_CREATED, "File created.\n", "", 0},
+    [RESPONSE_DELETED] = {STATUS_200_OK, "File deleted.\n", "", 0},
+    [RESPONSE_NOT_FOUND] = {STATUS_404_NOT_FOUND, "Not Found", "", 0},
+    [RESPONSE_METHOD_NOT_ALLOWED] = {STATUS_405_METHOD_NOT_ALLOWED, "Method not allowed", "", 0},
+    [RESPONSE_INTERNAL_ERROR] = {STATUS_500_INTERNAL_SERVER_ERROR, "", "", 0},
+};
+
+void initialize_responses() {
+    for (int i = 0; i < CONSTANT_RESPONSES_COUNT; ++i) {
+        struct ConstantResponse* response = &constant_responses[i];
+        size_t body_size = strlen(response->body);
+        int head_size = body_size > 0
+            ? snprintf(response->head, sizeof(response->head), "%s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n",
+                       response->status, body_size)
+            : snprintf(response->head, sizeof(response->head), "%s\r\nContent-Length: 0\r\n", response->status);
+        response->head_size = (size_t)head_size;
+    }
+    LOG_INFO("Constant responses serialized");
 }
 
-static char* response_to_string(const struct Response* response) {
-    if (response == NULL) {
-        LOG_ERROR("Response is NULL");
-        return NULL;
-    }
+static void initialize_response(struct Response* response, struct Arena* arena) {
+    memset(response->status, 0, sizeof(response->status));
+    initialize_headers(&response->headers, arena);
+    response->head = NULL;
+    response->head_size = 0;
+    response->body = NULL;
+    response->body_size = 0;
+    response->ranges = NULL;
+    response->file = NULL;
+    response->is_close_delimited = 0;
+}
+
+void close_response_file(struct Response* response) {
+    if (response->file == NULL) return;
+
+    close_file_for_reading(response->file);
+    response->file = NULL;
+}
 
-    size_t total_estimated = HTTP_VERSION_SIZE + response->body_size + RESPONSE_EXTRA_BYTES;
+static void set_constant_response(struct Response* response, enum ConstantResponseType type) {
+    const struct ConstantResponse* constant_response = &constant_responses[type];
+    strncpy(response->status, constant_response->status, sizeof(response->status) - 1);
+    response->head = constant_response->head;
+    response->head_size = constant_response->head_size;
+    response->body = constant_response->body;
+    response->body_size = strlen(constant_response->body);
+}
+
+static enum ReturnCode serialize_response_head(struct Response* response) {
+    size_t head_size = strlen(response->status) + 2;
     for (size_t i = 0; i < response->headers.size; ++i) {
-        total_estimated += strlen(response->headers.items[i].key) + strlen(response->headers.items[i].value) + 4;
+        head_size += strlen(response->headers.items[i].key) + strlen(response->headers.items[i].value) + 4;
     }
 
-    char* response_str = malloc(total_estimated);
-    if (response_str == NULL) {
-        LOG_ERROR("Failed to allocate response response_str");
-        return NULL;
+    char* head = arena_allocate(response->headers.arena, head_size + 1);
+    if (head == NULL) {
+        LOG_ERROR("Memory not allocated for response head");
+        return RET_ERROR;
     }
 
-    size_t offset = snprintf(response_str, total_estimated, "%s\r\n", response->status);
+    size_t offset = (size_t)snprintf(head, head_size + 1, "%s\r\n", response->status);
     for (size_t i = 0; i < response->headers.size; ++i) {
-        offset += snprintf(response_str + offset, total_estimated - offset,
-                           "%s: %s\r\n",
-                           response->headers.items[i].key,
-                           response->headers.items[i].value);
+        offset += (size_t)snprintf(head + offset, head_size + 1 - offset, "%s: %s\r\n",
+                                   response->headers.items[i].key, response->headers.items[i].value);
     }
-    offset += snprintf(response_str + offset, total_estimated - offset, "\r\n");
 
-    if (response->body && response->body_size > 0) {
-        memcpy(response_str + offset, response->body, response->body_size);
-        offset += response->body_size;
-    }
-    response_str[offset] = '\0';
+    response->head = head;
+    response->head_size = offset;
+    return RET_SUCCESS;
+}
 
-    return response_str;
+static void fill_response_iov(struct iovec* iov, const char* head, size_t head_size, const char* date_header,
+                              int keep_alive, const char* body, size_t body_size) {
+    const char* connection_headers = keep_alive ? RAW_HEADERS_KEEP_ALIVE : RAW_HEADERS_CLOSE;
+
+    iov[0].iov_base = (void*)head;
+    iov[0].iov_len = head_size;
+    iov[1].iov_base = (void*)date_header;
+    iov[1].iov_len = strlen(date_header);
+    iov[2].iov_base = (void*)connection_headers;
+    iov[2].iov_len = strlen(connection_headers);
+    iov[3].iov_base = (void*)body;
+    iov[3].iov_len = body_size;
 }
 
-static enum ReturnCode send_raw_response(int client_socket, struct Response* response) {
-    if (response == NULL) {
+int prepare_response(struct Response* response, int keep_alive, struct iovec* iov) {
+    if (response == NULL || iov == NULL) {
         LOG_ERROR("Response is NULL");
         return RET_ARGUMENT_IS_NULL;
     }
+    if (response->head == NULL && serialize_response_head(response) != RET_SUCCESS) return RET_ERROR;
 
-    char* raw_response = response_to_string(response);
-    free_response(response);
+    get_date_header(response->date);
+    fill_response_iov(iov, response->head, response->head_size, response->date, keep_alive,
+                      response->body, response->body_size);
+    return RESPONSE_IOV_COUNT;
+}
 
-    if (raw_response == NULL) {
-        return RET_ERROR;
+static enum ReturnCode send_iov(int client_socket, struct iovec* iov, int iov_count, unsigned long long* bytes_sent) {
+    size_t remaining_bytes = 0;
+    for (int i = 0; i < iov_count; ++i) remaining_bytes += iov[i].iov_len;
+
+    while (remaining_bytes > 0) {
+        ssize_t sent_bytes = socket_writev(client_socket, iov, iov_count);
+        if (sent_bytes <= 0) return RET_RESPONSE_NOT_SENT;
+
+        remaining_bytes -= (size_t)sent_bytes;
+        *bytes_sent += (unsigned long long)sent_bytes;
     }
-    
-    if (send(client_socket, raw_response, strlen(raw_response), 0) == RET_ERROR) {
+    return RET_SUCCESS;
+}
+
+enum ReturnCode send_prepared_response(int client_socket, struct Request* request, struct Response* response,
+                                       int keep_alive) {
+    struct iovec iov[RESPONSE_IOV_COUNT];
+    int iov_count = prepare_response(response, keep_alive, iov);
+    if (iov_count < 0) return RET_ERROR;
+
+    if (send_iov(client_socket, iov, iov_count, &request->bytes_sent) != RET_SUCCESS) {
         LOG_ERROR("Response was not sent");
-        free(raw_response);
         return RET_RESPONSE_NOT_SENT;
     }
 
+    request->status_code = parse_status_code(response->status);
     LOG_INFO("Response sent successfully");
-    free(raw_response);
     return RET_SUCCESS;
 }
 
-static struct Response create_method_get_response(const struct Request* request) {
-    struct Response response;
-    initialize_response(&response);
+struct Validators {
+    char entity_tag[ENTITY_TAG_SIZE];
+    char last_modified[HTTP_DATE_SIZE];
+};
+
+static void set_validators(struct Validators* validators, const struct FileMetadata* metadata) {
+    unsigned long long mtime_ns = (unsigned long long)metadata->mtime.tv_sec * 1000000000ULL +
+                                  (unsigned long long)metadata->mtime.tv_nsec;
+    snprintf(validators->entity_tag, sizeof(validators->entity_tag), "\"%llx-%llx-%llx\"",
+             (unsigned long long)metadata->inode, (unsigned long long)metadata->size, mtime_ns);
+    format_http_date(metadata->mtime.tv_sec, validators->last_modified);
+}
 
-    if (request == NULL) {
-        LOG_ERROR("Request is NULL");
-        return response;
-    }
+static void set_file_validators(struct Validators* validators, const struct stat* file_stat) {
+    struct FileMetadata metadata = {
+        .size = file_stat->st_size,
+        .mtime = file_stat->st_mtim,
+        .inode = file_stat->st_ino,
+        .is_regular = S_ISREG(file_stat->st_mode)
+    };
+    set_validators(validators, &metadata);
+}
 
-    if (check_file_exists(request->path) != RET_SUCCESS) {
-        LOG_WARN("GET: file not found");
-        strncpy(response.status, STATUS_404_NOT_FOUND, sizeof(response.status));
-        response.body = strdup("Not Found");
-        response.body_size = strlen(response.body);
-        add_header(&response.headers, "Content-Type", "text/plain");
-        add_header_formatted(&response.headers, "Content-Length", "%zu", response.body_size);
-        return response;
-    }
+static void add_validator_headers(struct Response* response, const struct Validators* validators) {
+    add_header(&response->headers, "ETag", validators->entity_tag);
+    add_header(&response->headers, "Last-Modified", validators->last_modified);
+}
 
-    LOG_INFO("GET: file found");
-    strncpy(response.status, STATUS_200_OK, sizeof(response.status));
-    add_header(&response.headers, "Content-Type", "application/octet-stream");
-    add_header_formatted(&response.headers, "Content-Length", "%zu", get_file_size(request->path));
-    return response;
+static int is_entity_tag_listed(struct StringView list, const char* entity_tag) {
+    size_t entity_tag_length = strlen(entity_tag);
+    const char* position = list.data;
+    const char* end = list.data + list.length;
+
+    while (position < end) {
+        if (is_whitespace(*position) || *position == ',') {
+            position++;
+            continue;
+        }
+        if (*position == '*') return 1;
+
+        // If-None-Match uses weak comparison, so the W/ prefix is ignored.
+        if (end - position >= 2 && position[0] == 'W' && position[1] == '/') position += 2;
+        if (position == end || *position != '"') return 0;
+
+        const char* tag_end = memchr(position + 1, '"', (size_t)(end - position - 1));
+        if (tag_end == NULL) return 0;
+        size_t tag_length = (size_t)(tag_end + 1 - position);
+        if (tag_length == entity_tag_length && memcmp(position, entity_tag, tag_length) == 0) return 1;
+        position = tag_end + 1;
+    }
+    return 0;
 }
 
-static struct Response create_method_post_response() {
-    struct Response response;
-    initialize_response(&response);
+static int is_not_modified(const struct Request* request, const struct FileMetadata* metadata,
+                           const struct Validators* validators) {
+    // If-Modified-Since is ignored when If-None-Match is present.
+    struct StringView if_none_match = request->known_headers[HEADER_IF_NONE_MATCH];
+    if (if_none_match.data != NULL) return is_entity_tag_listed(if_none_match, validators->entity_tag);
 
-    strncpy(response.status, STATUS_201_CREATED, sizeof(response.status));
-    response.body = strdup("File created.\n");
-    response.body_size = strlen(response.body);
-    add_header(&response.headers, "Content-Type", "text/plain");
-    add_header_formatted(&response.headers, "Content-Length", "%zu", response.body_size);
+    time_t if_modified_since = 0;
+    return parse_http_date(request->known_headers[HEADER_IF_MODIFIED_SINCE], &if_modified_since) == RET_SUCCESS &&
+           metadata->mtime.tv_sec <= if_modified_since;
+}
 
-    LOG_INFO("POST: file created response");
-    return response;
+static int is_if_range_matching(struct StringView if_range, const struct Validators* validators) {
+    if (if_range.data == NULL) return 1;
+
+    // If-Range uses strong comparison, so a weak entity tag never matches.
+    const char* validator = if_range.length > 0 && if_range.data[0] == '"' ? validators->entity_tag
+                                                                           : validators->last_modified;
+    return if_range.length == strlen(validator) && memcmp(if_range.data, validator, if_range.length) == 0;
 }
 
-static struct Response create_method_delete_response(const struct Request* request) {
-    struct Response response;
-    initialize_response(&response);
+static enum RangeStatus find_requested_ranges(const struct Request* request, uint64_t file_size,
+                                              const struct Validators* validators, struct Response* response) {
+    struct StringView range = request->known_headers[HEADER_RANGE];
+    if (range.data == NULL || !is_if_range_matching(request->known_headers[HEADER_IF_RANGE], validators)) {
+        return RANGES_IGNORED;
+    }
 
-    if (request == NULL) {
-        LOG_ERROR("Request is NULL");
-        return response;
+    struct ByteRanges* ranges = arena_allocate(response->headers.arena, sizeof(struct ByteRanges));
+    if (ranges == NULL) {
+        LOG_ERROR("Memory not allocated for byte ranges");
+        return RANGES_IGNORED;
     }
 
-    if (delete_file(request->path) == RET_SUCCESS) {
-        strncpy(response.status, STATUS_200_OK, sizeof(response.status));
-        response.body = strdup("File deleted.\n");
+    enum RangeStatus range_status = parse_byte_ranges(range, file_size, ranges);
+    if (range_status == RANGES_SATISFIABLE && ranges->count > 1 &&
+        prepare_multipart_ranges(ranges, file_size, FILE_CONTENT_TYPE, response->headers.arena) != RET_SUCCESS) {
+        return RANGES_IGNORED;
+    }
+
+    if (range_status == RANGES_SATISFIABLE) response->ranges = ranges;
+    return range_status;
+}
+
+static void create_partial_response(const struct ByteRanges* ranges, uint64_t file_size,
+                                    const struct Validators* validators, struct Response* response) {
+    strncpy(response->status, STATUS_206_PARTIAL_CONTENT, sizeof(response->status) - 1);
+    add_validator_headers(response, validators);
+    if (ranges->count == 1) {
+        const struct ByteRange* range = &ranges->items[0];
+        add_header(&response->headers, "Content-Type", FILE_CONTENT_TYPE);
+        add_header_formatted(&response->headers, "Content-Range", "bytes %llu-%llu/%llu",
+                             (unsigned long long)range->offset,
+                             (unsigned long long)(range->offset + range->length - 1),
+                             (unsigned long long)file_size);
     } else {
-        strncpy(response.status, STATUS_404_NOT_FOUND, sizeof(response.status));
-        response.body = strdup("Not Found");
+        add_header_formatted(&response->headers, "Content-Type", "multipart/byteranges; boundary=%s",
+                             ranges->boundary);
     }
+    add_header_formatted(&response->headers, "Content-Length", "%llu",
+                         (unsigned long long)get_ranges_body_size(ranges));
+}
 
-    response.body_size = strlen(response.body);
-    add_header(&response.headers, "Content-Type", "text/plain");
-    add_header_formatted(&response.headers, "Content-Length", "%zu", response.body_size);
+static void create_method_get_response(const struct Request* request, struct Response* response) {
+    struct FileMetadata metadata;
+    if (get_file_metadata(request->path.data, &metadata) != RET_SUCCESS) {
+        LOG_WARN("GET: file not found");
+        set_constant_response(response, RESPONSE_NOT_FOUND);
+        return;
+    }
 
-    LOG_INFO("DELETE method response created");
-    return response;
+    LOG_INFO("GET: file found");
+    struct Validators validators;
+    set_validators(&validators, &metadata);
+    if (metadata.is_regular && is_not_modified(request, &metadata, &validators)) {
+        LOG_INFO("GET: file not modified");
+        strncpy(response->status, STATUS_304_NOT_MODIFIED, sizeof(response->status) - 1);
+        add_validator_headers(response, &validators);
+        return;
+    }
+
+    // The body is sent from this descriptor, so its length must come
+    // from the same file even if the path was replaced meanwhile.
+    if (open_file_for_reading(request->path.data, &response->file) != RET_SUCCESS) {
+        LOG_WARN("GET: file disappeared after it was found");
+        response->file = NULL;
+        set_constant_response(response, RESPONSE_NOT_FOUND);
+        return;
+    }
+
+    const struct stat* file_stat = &response->file->stat;
+    if (S_ISDIR(file_stat->st_mode)) {
+        // The path became a directory after it was looked up.
+        LOG_WARN("GET: path is a directory");
+        close_response_file(response);
+        set_constant_response(response, RESPONSE_NOT_FOUND);
+        return;
+    }
+    if (!S_ISREG(file_stat->st_mode)) {
+        // Size of a pipe or a device is not the length of its content. HTTP/1.0
+        // has no chunked coding, its client reads the body until the connection is closed.
+        strncpy(response->status, STATUS_200_OK, sizeof(response->status) - 1);
+        add_header(&response->headers, "Content-Type", FILE_CONTENT_TYPE);
+        if (is_http_1_1(request)) add_header(&response->headers, "Transfer-Encoding", "chunked");
+        else response->is_close_delimited = 1;
+        return;
+    }
+
+    // Validators of the index only answer 304, the sent ones describe the sent body.
+    set_file_validators(&validators, file_stat);
+    uint64_t file_size = (uint64_t)file_stat->st_size;
+    switch (find_requested_ranges(request, file_size, &validators, response)) {
+        case RANGES_SATISFIABLE:
+            create_partial_response(response->ranges, file_size, &validators, response);
+            break;
+        case RANGES_NOT_SATISFIABLE:
+            LOG_WARN("GET: requested range not satisfiable");
+            strncpy(response->status, STATUS_416_RANGE_NOT_SATISFIABLE, sizeof(response->status) - 1);
+            add_header_formatted(&response->headers, "Content-Range", "bytes */%llu", (unsigned long long)file_size);
+            add_header(&response->headers, "Content-Length", "0");
+            break;
+        case RANGES_IGNORED:
+        default:
+            strncpy(response->status, STATUS_200_OK, sizeof(response->status) - 1);
+            add_header(&response->headers, "Content-Type", FILE_CONTENT_TYPE);
+            add_header(&response->headers, "Accept-Ranges", "bytes");
+            add_validator_headers(response, &validators);
+            add_header_formatted(&response->headers, "Content-Length", "%llu", (unsigned long long)file_size);
+    }
 }
 
-static struct Response create_method_other_response() {
-    struct Response response;
-    initialize_response(&response);
+static void create_method_post_response(struct Response* response) {
+    set_constant_response(response, RESPONSE_CREATED);
+    LOG_INFO("POST: file created response");
+}
+
+static void create_method_delete_response(const struct Request* request, struct Response* response) {
+    if (delete_file(request->path.data) == RET_SUCCESS) {
+        set_constant_response(response, RESPONSE_DELETED);
+    } else {
+        set_constant_response(response, RESPONSE_NOT_FOUND);
+    }
 
-    strncpy(response.status, STATUS_405_METHOD_NOT_ALLOWED, sizeof(response.status));
-    response.body = strdup("Method not allowed");
-    response.body_size = strlen(response.body);
-    add_header(&response.headers, "Content-Type", "text/plain");
-    add_header_formatted(&response.headers, "Content-Length", "%zu", response.body_size);
+    LOG_INFO("DELETE method response created");
+}
 
+static void create_method_other_response(struct Response* response) {
+    set_constant_response(response, RESPONSE_METHOD_NOT_ALLOWED);
     LOG_WARN("Other/unsupported method handled");
-    return response;
 }
 
-static struct Response create_response(const struct Request* request) {
+struct Response create_response(const struct Request* request) {
     struct Response response;
-    initialize_response(&response);
+    initialize_response(&response, request != NULL ? request->arena : NULL);
 
     if (request == NULL) {
         LOG_ERROR("Request is NULL");
@@ -261,24 +604,124 @@ static struct Response create_response(const struct Request* request) {
     }
 
     switch (request->method) {
-        case GET: response = create_method_get_response(request); break;
-        case POST: response = create_method_post_response(); break;
-        case DELETE: response = create_method_delete_response(request); break;
+        case GET: create_method_get_response(request, &response); break;
+        case POST: create_method_post_response(&response); break;
+        case DELETE: create_method_delete_response(request, &response); break;
         case UNKNOWN: 
-        default: response = create_method_other_response();
-    }
-
-    if (is_keep_alive(request->headers)) {
-        add_header(&response.headers, "Connection", "keep-alive");
-        add_header(&response.headers, "Keep-Alive", "timeout=5, max=100");
-    } else {
-        add_header(&response.headers, "Connection", "close");
+        default: create_method_other_response(&response);
     }
 
     LOG_INFO("Response created");
     return response;
 }
 
+struct Response create_error_response(struct Arena* arena) {
+    struct Response response;
+    initialize_response(&response, arena);
+    set_constant_response(&response, RESPONSE_INTERNAL_ERROR);
+    return response;
+}
+
+static struct CachedContent* load_cached_response(const char* path, const char* filename,
+                                                  const struct ContentFill* fill) {
+    unsigned long long generation = get_content_generation();
+
+    struct CachedFile* file = NULL;
+    if (open_file_for_reading(filename, &file) != RET_SUCCESS) return NULL;
+
+    size_t body_size = (size_t)file->stat.st_size;
+    struct Validators validators;
+    set_file_validators(&validators, &file->stat);
+
+    char headers[CACHED_HEADERS_SIZE];
+    int headers_size = snprintf(headers, sizeof(headers),
+                                "%s\r\nContent-Type: %s\r\nAccept-Ranges: bytes\r\nETag: %s\r\n"
+                                "Last-Modified: %s\r\nContent-Length: %zu\r\n",
+                                STATUS_200_OK, FILE_CONTENT_TYPE, validators.entity_tag,
+                                validators.last_modified, body_size);
+    if (!S_ISREG(file->stat.st_mode) || !should_load_content(fill, (size_t)headers_size + body_size)) {
+        close_file_for_reading(file);
+        return NULL;
+    }
+
+    char* data = malloc((size_t)headers_size + body_size);
+    if (data == NULL) {
+        LOG_ERROR("Memory not allocated for cached response");
+        close_file_for_reading(file);
+        return NULL;
+    }
+    memcpy(data, headers, (size_t)headers_size);
+
+    size_t total_read = 0;
+    while (total_read < body_size) {
+        ssize_t bytes_read = pread(file->fd, data + headers_size + total_read, body_size - total_read,
+                                   (off_t)total_read);
+        if (bytes_read <= 0) {
+            LOG_ERROR("Couldn't read file into content cache");
+            free(data);
+            close_file_for_reading(file);
+            return NULL;
+        }
+        total_read += (size_t)bytes_read;
+    }
+    close_file_for_reading(file);
+
+    LOG_INFO("File loaded into content cache");
+    return insert_content(path, data, (size_t)headers_size, body_size, generation);
+}
+
+struct CachedContent* find_cached_response(const struct Request* request, int may_wait) {
+    if (request == NULL || request->method != GET) return NULL;
+    // Partial and conditional responses are created from the metadata index.
+    if (request->known_headers[HEADER_RANGE].data != NULL || request->known_headers[HEADER_IF_NONE_MATCH].data != NULL ||
+        request->known_headers[HEADER_IF_MODIFIED_SINCE].data != NULL) {
+        return NULL;
+    }
+
+    // Content of a pipe or a device can be read only once, so it is never loaded here.
+    struct FileMetadata metadata;
+    if (get_file_metadata(request->path.data, &metadata) != RET_SUCCESS || !metadata.is_regular) return NULL;
+
+    char path[MAX_PATH_LEN];
+    if (set_file_location(path, request->path.data) != RET_SUCCESS) return NULL;
+
+    struct ContentFill* fill = NULL;
+    struct CachedContent* content = acquire_content(path, may_wait, &fill);
+    if (content != NULL || fill == NULL) return content;
+
+    content = load_cached_response(path, request->path.data, fill);
+    complete_content_fill(fill, content);
+    return content;
+}
+
+int prepare_cached_response(const struct CachedContent* content, int keep_alive, char* date_header,
+                            struct iovec* iov) {
+    get_date_header(date_header);
+    fill_response_iov(iov, content->data, content->headers_size, date_header, keep_alive,
+                      content->data + content->headers_size, content->body_size);
+    return RESPONSE_IOV_COUNT;
+}
+
+enum ReturnCode send_cached_response(int client_socket, struct Request* request) {
+    // A coroutine shares its thread with other connections and mustn't wait for a fill.
+    struct CachedContent* content = find_cached_response(request, !is_in_coroutine());
+    if (content == NULL) return RET_CACHE_MISS;
+
+    char date_header[DATE_HEADER_SIZE];
+    struct iovec iov[RESPONSE_IOV_COUNT];
+    int iov_count = prepare_cached_response(content, request->keep_alive, date_header, iov);
+    if (send_iov(client_socket, iov, iov_count, &request->bytes_sent) != RET_SUCCESS) {
+        LOG_ERROR("Cached response was not sent");
+        release_content(content);
+        return RET_RESPONSE_NOT_SENT;
+    }
+
+    request->status_code = HTTP_STATUS_CODE_OK;
+    release_content(content);
+    LOG_INFO("Response sent from content cache");
+    return RET_SUCCESS;
+}
+
 enum ReturnCode handle_request(int client_socket, struct Request* request) {
     if (request == NULL) {
         LOG_ERROR("Request is NULL");
@@ -286,24 +729,35 @@ enum ReturnCode handle_request(int client_socket, struct Request* request) {
     }
     LOG_INFO("Sending response");
     struct Response response = create_response(request);
-    return send_raw_response(client_socket, &response);
+    if (response.is_close_delimited) request->keep_alive = 0;
+    enum ReturnCode return_code = send_prepared_response(client_socket, request, &response, request->keep_alive);
+    close_response_file(&response);
+    return return_code;
 }
 
-int is_keep_alive(const struct HeaderList headers) {
-    const char* connection_header = get_header_value(&headers, "Connection");
-    return connection_header != NULL && strcasecmp(connection_header, "keep-alive") == 0;
+enum ReturnCode send_error_response(int client_socket, struct Request* request) {
+    if (request == NULL) {
+        LOG_ERROR("Request is NULL");
+        return RET_ARGUMENT_IS_NULL;
+    }
+    struct Response response = create_error_response(request->arena);
+    return send_prepared_response(client_socket, request, &response, 0);
+}
+
+int is_file_response(const struct Request* request, const struct Response* response) {
+    if (request->method != GET || response->file == NULL) return 0;
+
+    int status_code = parse_status_code(response->status);
+    return status_code == HTTP_STATUS_CODE_OK || status_code == HTTP_STATUS_CODE_PARTIAL_CONTENT;
 }
 
-void free_request(struct Request* request) {
-    if (request == NULL) return;
-    free_headers(&request->headers);
-    free(request->body);
-    request->body = NULL;
+int is_body_pending(const struct Request* request) {
+    return request->is_chunked || request->body.length < request->content_length;
 }
 
-void free_response(struct Response* response) {
-    if (response == NULL) return;
-    free_headers(&response->headers);
-    free(response->body);
-    response->body = NULL;
-}
\ No newline at end of file
+int parse_status_code(const char* status_line) {
+    if (status_line == NULL) return 0;
+
+    const char* code = strchr(status_line, ' ');
+    return code != NULL ? atoi(code + 1) : 0;
+}
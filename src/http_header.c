@@ -5,21 +5,76 @@
     * This file contains implementations of functions for managing HTTP headers.
     *
     * It provides functionality to add headers, add formatted headers,
-    * retrieve header values, check for header existence, and free
-    * allocated memory associated with header lists.
+    * retrieve header values and check for header existence. Header
+    * lists are allocated from the arena of the connection, so they
+    * are released together with it.
 */
 
+#define _GNU_SOURCE
+
 #include "../include/http_header.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include "../include/logger.h"
+
+#define HEADER_LIST_INITIAL_CAPACITY 8
+#define KNOWN_HEADERS_TABLE_SIZE 16
+#define DATE_HEADER_FORMAT "Date: %a, %d %b %Y %H:%M:%S GMT\r\n"
+#define HTTP_DATE_FORMAT "%a, %d %b %Y %H:%M:%S GMT"
+
+struct KnownHeaderName {
+    const char* name;
+    enum KnownHeader header;
+};
+
+/**
+    * Slots are (2 * length + lowercase first character) % 16 of the
+    * name, which is collision-free for these names. Adding a name
+    * requires checking the slot is still unique.
+*/
+static const struct KnownHeaderName known_headers_table[KNOWN_HEADERS_TABLE_SIZE] = {
+    [0]  = {"host", HEADER_HOST},
+    [1]  = {"expect", HEADER_EXPECT},
+    [3]  = {"if-none-match", HEADER_IF_NONE_MATCH},
+    [6]  = {"transfer-encoding", HEADER_TRANSFER_ENCODING},
+    [7]  = {"connection", HEADER_CONNECTION},
+    [9]  = {"if-range", HEADER_IF_RANGE},
+    [11] = {"if-modified-since", HEADER_IF_MODIFIED_SINCE},
+    [12] = {"range", HEADER_RANGE},
+    [15] = {"content-length", HEADER_CONTENT_LENGTH},
+};
+
+static _Thread_local time_t date_header_time = 0;
+static _Thread_local char date_header[DATE_HEADER_SIZE];
 
 void add_header(struct HeaderList* list, const char* key, const char* value) {
-    list->items = realloc(list->items, sizeof(struct Header) * (list->size + 1));
-    list->items[list->size].key = strdup(key);
-    list->items[list->size].value = strdup(value);
+    if (list->size == list->capacity) {
+        size_t capacity = list->capacity > 0 ? list->capacity * 2 : HEADER_LIST_INITIAL_CAPACITY;
+        struct Header* items = arena_allocate(list->arena, sizeof(struct Header) * capacity);
+        if (items == NULL) {
+            LOG_ERROR("Memory not allocated for header");
+            return;
+        }
+        if (list->size > 0) memcpy(items, list->items, sizeof(struct Header) * list->size);
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    char* key_copy = arena_strdup(list->arena, key);
+    char* value_copy = arena_strdup(list->arena, value);
+    if (key_copy == NULL || value_copy == NULL) {
+        LOG_ERROR("Memory not allocated for header");
+        return;
+    }
+
+    list->items[list->size].key = key_copy;
+    list->items[list->size].value = value_copy;
     list->size++;
 }
 
@@ -43,12 +98,68 @@ const char* get_header_value(const struct HeaderList* list, const char* key) {
     return NULL;
 }
 
-void free_headers(struct HeaderList* list) {
-    for (size_t i = 0; i < list->size; ++i) {
-        free(list->items[i].key);
-        free(list->items[i].value);
+enum KnownHeader classify_header(struct StringView key) {
+    if (key.length == 0) return HEADER_UNKNOWN;
+
+    size_t slot = (key.length * 2 + (size_t)tolower((unsigned char)key.data[0])) % KNOWN_HEADERS_TABLE_SIZE;
+    const struct KnownHeaderName* entry = &known_headers_table[slot];
+    if (entry->name == NULL || !is_view_equal(key, entry->name)) return HEADER_UNKNOWN;
+    return entry->header;
+}
+
+int is_view_equal(struct StringView view, const char* string) {
+    size_t length = strlen(string);
+    return view.data != NULL && view.length == length && strncasecmp(view.data, string, length) == 0;
+}
+
+struct StringView get_request_header(const struct Request* request, const char* key) {
+    struct StringView not_found = {NULL, 0};
+    if (request == NULL || key == NULL) return not_found;
+
+    for (size_t i = 0; i < request->headers_count; ++i) {
+        if (is_view_equal(request->headers[i].key, key)) {
+            return request->headers[i].value;
+        }
     }
-    free(list->items);
+    return not_found;
+}
+
+void initialize_headers(struct HeaderList* list, struct Arena* arena) {
     list->items = NULL;
     list->size = 0;
-}
\ No newline at end of file
+    list->capacity = 0;
+    list->arena = arena;
+}
+
+void get_date_header(char* buffer) {
+    time_t now = time(NULL);
+    if (now != date_header_time) {
+        struct tm now_tm;
+        gmtime_r(&now, &now_tm);
+        strftime(date_header, sizeof(date_header), DATE_HEADER_FORMAT, &now_tm);
+        date_header_time = now;
+    }
+    memcpy(buffer, date_header, sizeof(date_header));
+}
+
+void format_http_date(time_t time, char* buffer) {
+    struct tm time_tm;
+    gmtime_r(&time, &time_tm);
+    strftime(buffer, HTTP_DATE_SIZE, HTTP_DATE_FORMAT, &time_tm);
+}
+
+enum ReturnCode parse_http_date(struct StringView value, time_t* time) {
+    if (value.data == NULL || value.length != HTTP_DATE_SIZE - 1) return RET_ERROR;
+
+    char date[HTTP_DATE_SIZE];
+    memcpy(date, value.data, value.length);
+    date[value.length] = '\0';
+
+    struct tm time_tm;
+    memset(&time_tm, 0, sizeof(time_tm));
+    const char* end = strptime(date, HTTP_DATE_FORMAT, &time_tm);
+    if (end == NULL || *end != '\0') return RET_ERROR;
+
+    *time = timegm(&time_tm);
+    return RET_SUCCESS;
+}
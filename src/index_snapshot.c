@@ -0,0 +1,340 @@
+/**
+    * @file: index_snapshot.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of metadata index snapshots.
+    *
+    * A snapshot is a fixed header followed by variable-length records
+    * aligned to 8 bytes, each one holding metadata of an entry and its
+    * path. The header keeps the root directory, the number and size of
+    * records and their FNV-1a checksum, and a snapshot is used only if
+    * all of them match. Records are in native byte order, a snapshot
+    * is meant to be read by the host which wrote it.
+    *
+    * Restored entries are confirmed by the background thread which
+    * then writes a new snapshot every index_snapshot_interval seconds.
+*/
+
+#include "../include/index_snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/metadata_index.h"
+#include "../include/file_storage.h"
+#include "../include/logger.h"
+#include "../include/config.h"
+
+#define SNAPSHOT_MAGIC "HTTPIDX"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ALIGNMENT 8
+#define SNAPSHOT_TEMPORARY_SUFFIX ".tmp"
+#define SNAPSHOT_INITIAL_BUFFER_SIZE (1024 * 1024)
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t records_count;
+    uint64_t records_size;
+    uint64_t checksum;
+    char root_directory[MAX_PATH_LEN];
+};
+
+struct SnapshotRecord {
+    uint64_t size;
+    int64_t mtime_sec;
+    uint64_t inode;
+    uint32_t mtime_nsec;
+    uint16_t path_length;
+    uint8_t is_directory;
+    uint8_t reserved;
+};
+
+struct SnapshotBuffer {
+    char* data;
+    size_t size;
+    size_t capacity;
+    uint64_t records_count;
+    int is_failed;
+};
+
+static pthread_t snapshot_thread;
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t snapshot_stop;
+static int is_snapshot_thread_running = 0;
+static int is_rescan_needed = 0;
+
+static size_t align_record_size(size_t size) {
+    return (size + SNAPSHOT_ALIGNMENT - 1) & ~(size_t)(SNAPSHOT_ALIGNMENT - 1);
+}
+
+static uint64_t compute_checksum(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static void append_record(const char* path, const struct FileMetadata* metadata,
+                          int is_directory, void* context) {
+    struct SnapshotBuffer* buffer = context;
+    if (buffer->is_failed) return;
+
+    size_t path_length = strlen(path);
+    size_t record_size = align_record_size(sizeof(struct SnapshotRecord) + path_length);
+    if (buffer->size + record_size > buffer->capacity) {
+        size_t capacity = buffer->capacity == 0 ? SNAPSHOT_INITIAL_BUFFER_SIZE : buffer->capacity * 2;
+        char* data = realloc(buffer->data, capacity);
+        if (data == NULL) {
+            buffer->is_failed = 1;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+
+    char* position = buffer->data + buffer->size;
+    memset(position, 0, record_size);
+
+    struct SnapshotRecord* record = (struct SnapshotRecord*)position;
+    record->size = (uint64_t)metadata->size;
+    record->mtime_sec = (int64_t)metadata->mtime.tv_sec;
+    record->mtime_nsec = (uint32_t)metadata->mtime.tv_nsec;
+    record->inode = (uint64_t)metadata->inode;
+    record->path_length = (uint16_t)path_length;
+    record->is_directory = (uint8_t)is_directory;
+    memcpy(position + sizeof(struct SnapshotRecord), path, path_length);
+
+    buffer->size += record_size;
+    buffer->records_count++;
+}
+
+enum ReturnCode save_index_snapshot(const char* snapshot_file, const char* root_directory) {
+    if (snapshot_file == NULL || root_directory == NULL) {
+        LOG_ERROR("Snapshot file or root directory is NULL");
+        return RET_ARGUMENT_IS_NULL;
+    }
+
+    char temporary_file[MAX_PATH_LEN + sizeof(SNAPSHOT_TEMPORARY_SUFFIX)];
+    snprintf(temporary_file, sizeof(temporary_file), "%s%s", snapshot_file, SNAPSHOT_TEMPORARY_SUFFIX);
+
+    struct SnapshotBuffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    for_each_metadata(append_record, &buffer);
+    if (buffer.is_failed) {
+        LOG_ERROR("Memory not allocated for index snapshot");
+        free(buffer.data);
+        return RET_ERROR;
+    }
+
+    struct SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(header);
+    header.records_count = buffer.records_count;
+    header.records_size = buffer.size;
+    header.checksum = compute_checksum(buffer.data, buffer.size);
+    strncpy(header.root_directory, root_directory, sizeof(header.root_directory) - 1);
+
+    int fd = open(temporary_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == RET_ERROR) {
+        LOG_ERROR("Couldn't create index snapshot");
+        free(buffer.data);
+        return RET_FILE_NOT_OPENED;
+    }
+
+    int is_written = write_to_file(fd, &header, sizeof(header)) == RET_SUCCESS &&
+                     write_to_file(fd, buffer.data, buffer.size) == RET_SUCCESS &&
+                     fsync(fd) == RET_SUCCESS;
+    close(fd);
+    free(buffer.data);
+
+    if (!is_written || rename(temporary_file, snapshot_file) == RET_ERROR) {
+        LOG_ERROR("Couldn't write index snapshot");
+        unlink(temporary_file);
+        return RET_ERROR;
+    }
+
+    LOG_INFOF("Index snapshot saved with %llu entries", (unsigned long long)header.records_count);
+    return RET_SUCCESS;
+}
+
+static int is_header_valid(const struct SnapshotHeader* header, size_t file_size, const char* root_directory) {
+    return memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+           header->version == SNAPSHOT_VERSION &&
+           header->header_size == sizeof(struct SnapshotHeader) &&
+           header->records_size == file_size - sizeof(struct SnapshotHeader) &&
+           strncmp(header->root_directory, root_directory, sizeof(header->root_directory)) == 0;
+}
+
+static enum ReturnCode restore_records(const char* records, size_t records_size, uint64_t records_count) {
+    const char* position = records;
+    const char* end = records + records_size;
+    uint64_t restored_count = 0;
+
+    while (position < end) {
+        if ((size_t)(end - position) < sizeof(struct SnapshotRecord)) return RET_ERROR;
+
+        const struct SnapshotRecord* record = (const struct SnapshotRecord*)position;
+        size_t record_size = align_record_size(sizeof(struct SnapshotRecord) + record->path_length);
+        if (record->path_length == 0 || record->path_length >= MAX_PATH_LEN ||
+            record_size > (size_t)(end - position)) {
+            return RET_ERROR;
+        }
+
+        char path[MAX_PATH_LEN];
+        memcpy(path, position + sizeof(struct SnapshotRecord), record->path_length);
+        path[record->path_length] = '\0';
+        if (strlen(path) != record->path_length) return RET_ERROR;
+
+        struct FileMetadata metadata;
+        metadata.size = (off_t)record->size;
+        metadata.mtime.tv_sec = (time_t)record->mtime_sec;
+        metadata.mtime.tv_nsec = (long)record->mtime_nsec;
+        metadata.inode = (ino_t)record->inode;
+        metadata.is_regular = !record->is_directory;
+        restore_metadata(path, &metadata, record->is_directory);
+
+        position += record_size;
+        restored_count++;
+    }
+
+    return restored_count == records_count ? RET_SUCCESS : RET_ERROR;
+}
+
+enum ReturnCode load_index_snapshot(const char* snapshot_file, const char* root_directory) {
+    if (snapshot_file == NULL || root_directory == NULL) {
+        LOG_ERROR("Snapshot file or root directory is NULL");
+        return RET_ARGUMENT_IS_NULL;
+    }
+
+    int fd = open(snapshot_file, O_RDONLY | O_CLOEXEC);
+    if (fd == RET_ERROR) return RET_FILE_NOT_OPENED;
+
+    struct stat stat_result;
+    if (fstat(fd, &stat_result) == RET_ERROR || (size_t)stat_result.st_size < sizeof(struct SnapshotHeader)) {
+        close(fd);
+        LOG_WARN("Index snapshot is too short");
+        return RET_ERROR;
+    }
+
+    size_t file_size = (size_t)stat_result.st_size;
+    char* mapping = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Couldn't map index snapshot");
+        return RET_ERROR;
+    }
+    madvise(mapping, file_size, MADV_SEQUENTIAL);
+
+    const struct SnapshotHeader* header = (const struct SnapshotHeader*)mapping;
+    const char* records = mapping + sizeof(struct SnapshotHeader);
+    enum ReturnCode return_code = RET_ERROR;
+    if (is_header_valid(header, file_size, root_directory) &&
+        compute_checksum(records, header->records_size) == header->checksum) {
+        return_code = restore_records(records, header->records_size, header->records_count);
+    }
+
+    uint64_t records_count = header->records_count;
+    munmap(mapping, file_size);
+
+    if (return_code != RET_SUCCESS) {
+        LOG_WARN("Index snapshot is invalid");
+        clear_metadata_index();
+        return return_code;
+    }
+
+    LOG_INFOF("Metadata index restored with %llu entries", (unsigned long long)records_count);
+    return RET_SUCCESS;
+}
+
+static void wait_for_interval(unsigned int interval) {
+    if (interval == 0) {
+        pthread_cond_wait(&snapshot_stop, &snapshot_mutex);
+        return;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += interval;
+    pthread_cond_timedwait(&snapshot_stop, &snapshot_mutex, &deadline);
+}
+
+static void* run_snapshot_thread(void* argument) {
+    (void)argument;
+    const struct Config* config = get_config();
+    if (is_rescan_needed) rescan_metadata_index();
+
+    pthread_mutex_lock(&snapshot_mutex);
+    while (is_snapshot_thread_running) {
+        wait_for_interval(config->index_snapshot_interval);
+        if (!is_snapshot_thread_running) break;
+
+        pthread_mutex_unlock(&snapshot_mutex);
+        save_index_snapshot(config->index_snapshot_file, config->root_directory);
+        pthread_mutex_lock(&snapshot_mutex);
+    }
+    pthread_mutex_unlock(&snapshot_mutex);
+    return NULL;
+}
+
+static enum ReturnCode start_snapshot_thread() {
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&snapshot_stop, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    is_snapshot_thread_running = 1;
+    if (pthread_create(&snapshot_thread, NULL, run_snapshot_thread, NULL) != RET_SUCCESS) {
+        LOG_ERROR("Couldn't start index snapshot thread");
+        is_snapshot_thread_running = 0;
+        pthread_cond_destroy(&snapshot_stop);
+        return RET_ERROR;
+    }
+    return RET_SUCCESS;
+}
+
+enum ReturnCode start_metadata_index() {
+    const struct Config* config = get_config();
+    int is_snapshot_enabled = config->index_snapshot_file[0] != '\0';
+
+    is_rescan_needed = is_snapshot_enabled &&
+                       load_index_snapshot(config->index_snapshot_file, config->root_directory) == RET_SUCCESS;
+    if (!is_rescan_needed) {
+        enum ReturnCode return_code = build_metadata_index(config->root_directory);
+        if (return_code != RET_SUCCESS) return return_code;
+    }
+
+    if (!is_snapshot_enabled) return RET_SUCCESS;
+    return start_snapshot_thread();
+}
+
+void stop_metadata_index() {
+    const struct Config* config = get_config();
+    stop_metadata_rescan();
+
+    pthread_mutex_lock(&snapshot_mutex);
+    int is_thread_started = is_snapshot_thread_running;
+    is_snapshot_thread_running = 0;
+    if (is_thread_started) pthread_cond_signal(&snapshot_stop);
+    pthread_mutex_unlock(&snapshot_mutex);
+
+    if (is_thread_started) {
+        pthread_join(snapshot_thread, NULL);
+        pthread_cond_destroy(&snapshot_stop);
+        save_index_snapshot(config->index_snapshot_file, config->root_directory);
+    }
+    clear_metadata_index();
+}
@@ -0,0 +1,441 @@
+/**
+    * @file: io_uring_backend.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the io_uring based
+    * I/O backend.
+    *
+    * The ring is driven directly through io_uring_setup(2) and
+    * io_uring_enter(2), so no additional library is required. Every
+    * thread gets its own ring on first use, which keeps submission
+    * lock-free. When the kernel lacks io_uring or any operation the
+    * backend relies on, the ring is not created and callers fall
+    * back to regular POSIX I/O.
+*/
+
+#define _GNU_SOURCE
+
+#include "../include/io_uring_backend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "../include/logger.h"
+
+#define RING_ENTRIES 8
+#define RING_BUFFERS_COUNT 2
+#define PROBE_OPERATIONS_COUNT 256
+
+enum RingOperation {
+    OPERATION_OPEN,
+    OPERATION_CLOSE,
+    OPERATION_ACCEPT,
+    OPERATION_READ,
+    OPERATION_WRITE,
+    OPERATION_SEND,
+    OPERATION_RECV,
+    OPERATION_TIMEOUT,
+    OPERATIONS_COUNT
+};
+
+static const unsigned char required_opcodes[] = {
+    IORING_OP_OPENAT, IORING_OP_CLOSE, IORING_OP_ACCEPT, IORING_OP_READ,
+    IORING_OP_WRITE, IORING_OP_SEND, IORING_OP_RECV, IORING_OP_LINK_TIMEOUT
+};
+
+struct Ring {
+    int ring_fd;
+    unsigned int entries;
+
+    void* sq_ring;
+    size_t sq_ring_size;
+    unsigned int* sq_head;
+    unsigned int* sq_tail;
+    unsigned int* sq_array;
+    unsigned int sq_mask;
+    unsigned int sq_local_tail;
+    unsigned int to_submit;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+
+    void* cq_ring;
+    size_t cq_ring_size;
+    unsigned int* cq_head;
+    unsigned int* cq_tail;
+    unsigned int cq_mask;
+    struct io_uring_cqe* cqes;
+
+    long long results[OPERATIONS_COUNT];    /**< Result of the last completion of every operation. */
+    struct __kernel_timespec timeout;
+    char buffers[RING_BUFFERS_COUNT][BUFSIZ];
+};
+
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static _Thread_local struct Ring* thread_ring = NULL;
+static _Thread_local int is_ring_unavailable = 0;
+
+static void destroy_ring(void* arg) {
+    struct Ring* ring = arg;
+    if (ring == NULL) return;
+
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED) munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->ring_fd >= 0) close(ring->ring_fd);
+    free(ring);
+}
+
+static void create_ring_key() {
+    pthread_key_create(&ring_key, destroy_ring);
+}
+
+static int has_required_operations(int ring_fd) {
+    size_t probe_size = sizeof(struct io_uring_probe) + PROBE_OPERATIONS_COUNT * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = calloc(1, probe_size);
+    if (probe == NULL) return 0;
+
+    int is_supported = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE,
+                               probe, PROBE_OPERATIONS_COUNT) == RET_SUCCESS;
+    for (size_t i = 0; is_supported && i < sizeof(required_opcodes); ++i) {
+        unsigned char opcode = required_opcodes[i];
+        is_supported = opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    free(probe);
+    return is_supported;
+}
+
+static struct Ring* create_ring() {
+    struct Ring* ring = calloc(1, sizeof(struct Ring));
+    if (ring == NULL) return NULL;
+    ring->ring_fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->ring_fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (ring->ring_fd < 0 || !has_required_operations(ring->ring_fd)) {
+        destroy_ring(ring);
+        return NULL;
+    }
+    ring->entries = params.sq_entries;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->sq_ring_size = MAX(ring->sq_ring_size, ring->cq_ring_size);
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        destroy_ring(ring);
+        return NULL;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            destroy_ring(ring);
+            return NULL;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        destroy_ring(ring);
+        return NULL;
+    }
+
+    char* sq_ring = ring->sq_ring;
+    ring->sq_head = (unsigned int*)(sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned int*)(sq_ring + params.sq_off.tail);
+    ring->sq_mask = *(unsigned int*)(sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int*)(sq_ring + params.sq_off.array);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    char* cq_ring = ring->cq_ring;
+    ring->cq_head = (unsigned int*)(cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned int*)(cq_ring + params.cq_off.tail);
+    ring->cq_mask = *(unsigned int*)(cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq_ring + params.cq_off.cqes);
+
+    return ring;
+}
+
+static struct Ring* get_ring() {
+    if (thread_ring != NULL) return thread_ring;
+    if (is_ring_unavailable) return NULL;
+
+    pthread_once(&ring_key_once, create_ring_key);
+    thread_ring = create_ring();
+    if (thread_ring == NULL) {
+        is_ring_unavailable = 1;
+        LOG_WARN("io_uring is not available, falling back to POSIX I/O");
+        return NULL;
+    }
+
+    pthread_setspecific(ring_key, thread_ring);
+    LOG_INFO("io_uring ring created for thread");
+    return thread_ring;
+}
+
+static struct io_uring_sqe* get_sqe(struct Ring* ring, enum RingOperation operation) {
+    unsigned int index = ring->sq_local_tail & ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = operation;
+
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+    ring->to_submit++;
+    return sqe;
+}
+
+static unsigned int reap_completions(struct Ring* ring) {
+    unsigned int head = *ring->cq_head;
+    unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned int reaped_count = 0;
+
+    while (head != tail) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+        if (cqe->user_data < OPERATIONS_COUNT) {
+            ring->results[cqe->user_data] = cqe->res;
+        }
+        head++;
+        reaped_count++;
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return reaped_count;
+}
+
+static enum ReturnCode submit_and_wait(struct Ring* ring, unsigned int wait_count, int is_interruptible) {
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+    unsigned int completed_count = 0;
+    while (1) {
+        completed_count += reap_completions(ring);
+        if (completed_count >= wait_count && ring->to_submit == 0) break;
+
+        unsigned int min_complete = completed_count < wait_count ? wait_count - completed_count : 0;
+        long submitted = syscall(__NR_io_uring_enter, ring->ring_fd, ring->to_submit, min_complete,
+                                 IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR && !is_interruptible) continue;
+            if (errno != EINTR) LOG_ERROR("io_uring_enter() failed");
+            return RET_ERROR;
+        }
+        ring->to_submit -= MIN((unsigned int)submitted, ring->to_submit);
+    }
+
+    return RET_SUCCESS;
+}
+
+static void prepare_rw(struct Ring* ring, enum RingOperation operation, int opcode,
+                       int fd, const void* buffer, size_t size, off_t offset) {
+    struct io_uring_sqe* sqe = get_sqe(ring, operation);
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)buffer;
+    sqe->len = (unsigned int)size;
+    sqe->off = (unsigned long long)offset;
+}
+
+static void prepare_send(struct Ring* ring, int client_socket, const void* buffer, size_t size) {
+    prepare_rw(ring, OPERATION_SEND, IORING_OP_SEND, client_socket, buffer, size, 0);
+    ring->sqes[(ring->sq_local_tail - 1) & ring->sq_mask].msg_flags = MSG_NOSIGNAL;
+}
+
+static void prepare_recv_with_timeout(struct Ring* ring, int client_socket, void* buffer, size_t size) {
+    prepare_rw(ring, OPERATION_RECV, IORING_OP_RECV, client_socket, buffer, size, 0);
+    ring->sqes[(ring->sq_local_tail - 1) & ring->sq_mask].flags |= IOSQE_IO_LINK;
+
+    ring->timeout.tv_sec = CLIENT_TIMEOUT_SEC;
+    ring->timeout.tv_nsec = 0;
+    prepare_rw(ring, OPERATION_TIMEOUT, IORING_OP_LINK_TIMEOUT, -1, &ring->timeout, 1, 0);
+}
+
+static enum ReturnCode complete_transfer(struct Ring* ring, enum RingOperation operation, int opcode,
+                                         int fd, const char* data, size_t size, off_t offset) {
+    size_t total_transferred = 0;
+    while (1) {
+        long long transferred = ring->results[operation];
+        if (transferred <= 0) return RET_ERROR;
+
+        total_transferred += (size_t)transferred;
+        if (total_transferred >= size) return RET_SUCCESS;
+
+        if (operation == OPERATION_SEND) {
+            prepare_send(ring, fd, data + total_transferred, size - total_transferred);
+        } else {
+            prepare_rw(ring, operation, opcode, fd, data + total_transferred,
+                       size - total_transferred, offset + (off_t)total_transferred);
+        }
+        if (submit_and_wait(ring, 1, 0) != RET_SUCCESS) return RET_ERROR;
+    }
+}
+
+int is_io_uring_available() {
+    return get_ring() != NULL;
+}
+
+int io_uring_open_file(const char* path, int flags, mode_t mode) {
+    struct Ring* ring = get_ring();
+    if (ring == NULL || path == NULL) return RET_ERROR;
+
+    struct io_uring_sqe* sqe = get_sqe(ring, OPERATION_OPEN);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (unsigned long)path;
+    sqe->len = mode;
+    sqe->open_flags = flags;
+
+    if (submit_and_wait(ring, 1, 0) != RET_SUCCESS) return RET_ERROR;
+    if (ring->results[OPERATION_OPEN] < 0) {
+        errno = (int)-ring->results[OPERATION_OPEN];
+        return RET_ERROR;
+    }
+    return (int)ring->results[OPERATION_OPEN];
+}
+
+void io_uring_close_file(int fd) {
+    struct Ring* ring = get_ring();
+    if (ring == NULL) {
+        close(fd);
+        return;
+    }
+
+    struct io_uring_sqe* sqe = get_sqe(ring, OPERATION_CLOSE);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    if (submit_and_wait(ring, 1, 0) != RET_SUCCESS || ring->results[OPERATION_CLOSE] < 0) {
+        LOG_WARN("Couldn't close file with io_uring");
+    }
+}
+
+int io_uring_accept_connection(int server_fd) {
+    struct Ring* ring = get_ring();
+    if (ring == NULL) return RET_ERROR;
+
+    struct io_uring_sqe* sqe = get_sqe(ring, OPERATION_ACCEPT);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server_fd;
+
+    if (submit_and_wait(ring, 1, 1) != RET_SUCCESS) return RET_ERROR;
+    if (ring->results[OPERATION_ACCEPT] < 0) {
+        errno = (int)-ring->results[OPERATION_ACCEPT];
+        return RET_ERROR;
+    }
+    return (int)ring->results[OPERATION_ACCEPT];
+}
+
+enum ReturnCode io_uring_send_file(int client_socket, int fd, off_t offset, size_t size) {
+    struct Ring* ring = get_ring();
+    if (ring == NULL) return RET_ERROR;
+    if (size == 0) return RET_SUCCESS;
+
+    unsigned int current = 0;
+    prepare_rw(ring, OPERATION_READ, IORING_OP_READ, fd, ring->buffers[current], MIN(size, BUFSIZ), offset);
+    if (submit_and_wait(ring, 1, 0) != RET_SUCCESS) return RET_ERROR;
+
+    long long bytes_read = ring->results[OPERATION_READ];
+    while (bytes_read > 0) {
+        unsigned int next = (current + 1) % RING_BUFFERS_COUNT;
+        offset += (off_t)bytes_read;
+        size -= (size_t)bytes_read;
+
+        prepare_send(ring, client_socket, ring->buffers[current], (size_t)bytes_read);
+        unsigned int wait_count = 1;
+        if (size > 0) {
+            prepare_rw(ring, OPERATION_READ, IORING_OP_READ, fd, ring->buffers[next], MIN(size, BUFSIZ), offset);
+            wait_count++;
+        }
+        if (submit_and_wait(ring, wait_count, 0) != RET_SUCCESS) return RET_ERROR;
+
+        long long next_bytes_read = size > 0 ? ring->results[OPERATION_READ] : 0;
+        if (complete_transfer(ring, OPERATION_SEND, IORING_OP_SEND, client_socket,
+                              ring->buffers[current], (size_t)bytes_read, 0) != RET_SUCCESS) {
+            LOG_ERROR("Failed to send file");
+            return RET_ERROR;
+        }
+
+        bytes_read = next_bytes_read;
+        current = next;
+    }
+
+    if (bytes_read < 0 || size > 0) {
+        LOG_ERROR("Failed to read file");
+        return RET_ERROR;
+    }
+    return RET_SUCCESS;
+}
+
+enum ReturnCode io_uring_receive_file(int client_socket, int fd, size_t file_size,
+                                      const void* received_body, size_t received_body_size) {
+    struct Ring* ring = get_ring();
+    if (ring == NULL) return RET_ERROR;
+
+    const char* pending_data = received_body;
+    size_t pending_size = received_body != NULL ? MIN(received_body_size, file_size) : 0;
+    size_t remaining_bytes = file_size - pending_size;
+    unsigned int current = 0;
+    off_t offset = 0;
+
+    while (pending_size > 0 || remaining_bytes > 0) {
+        unsigned int wait_count = 0;
+        if (pending_size > 0) {
+            prepare_rw(ring, OPERATION_WRITE, IORING_OP_WRITE, fd, pending_data, pending_size, offset);
+            wait_count++;
+        }
+
+        size_t data_chunk = MIN(remaining_bytes, (size_t)BUFSIZ);
+        if (data_chunk > 0) {
+            prepare_recv_with_timeout(ring, client_socket, ring->buffers[current], data_chunk);
+            wait_count += 2;
+        }
+
+        if (submit_and_wait(ring, wait_count, 0) != RET_SUCCESS) return RET_ERROR;
+
+        if (pending_size > 0) {
+            if (complete_transfer(ring, OPERATION_WRITE, IORING_OP_WRITE, fd,
+                                  pending_data, pending_size, offset) != RET_SUCCESS) {
+                LOG_ERROR("Couldn't write received data chunk into file");
+                return RET_ERROR;
+            }
+            offset += (off_t)pending_size;
+            pending_size = 0;
+        }
+
+        if (data_chunk > 0) {
+            long long received_bytes = ring->results[OPERATION_RECV];
+            if (received_bytes <= 0) {
+                LOG_ERROR("Failed during receiving data chunk");
+                return RET_ERROR;
+            }
+
+            pending_data = ring->buffers[current];
+            pending_size = (size_t)received_bytes;
+            remaining_bytes -= (size_t)received_bytes;
+            current = (current + 1) % RING_BUFFERS_COUNT;
+        }
+    }
+
+    return RET_SUCCESS;
+}
@@ -8,63 +8,361 @@
     * It provides a unified interface for writing log messages
     * to the configured log file, including timestamps and severity
     * levels such as DEBUG, INFO, WARN, ERROR, and FATAL.
+    *
+    * Once initialized, logging threads only copy records into a
+    * bounded lock-free ring (Vyukov's queue with a sequence number
+    * per slot), and a dedicated flush thread formats them, writes
+    * them in batches and flushes the file on a timer. When the ring is
+    * full, records are dropped or the logging thread sleeps on a
+    * condition variable until the flush thread frees slots, depending
+    * on log_overflow_policy. Before initialization and after it
+    * messages are written synchronously.
+    *
+    * A record holds at most LOG_MESSAGE_SIZE - 1 bytes of a message,
+    * longer messages are cut and end with LOG_TRUNCATION_MARK.
 */
 
 #include "../include/logger.h"
 
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include <time.h>
 #include <string.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include "../include/config.h"
 #include "../include/common.h"
 
+#define LOG_MESSAGE_SIZE 512        /**< Longer messages are truncated and marked. */
+#define LOG_TRUNCATION_MARK "..."
+#define LOG_TIME_SIZE 32
+#define LOG_BATCH_SIZE (64 * 1024)
+#define LOG_FLUSH_INTERVAL_MS 100
+
+struct LogRecord {
+    atomic_size_t sequence;
+    enum Level level;
+    time_t time;
+    char message[LOG_MESSAGE_SIZE];
+};
+
+atomic_int g_log_level = DEFAULT_LOG_LEVEL;
+
 static FILE* log_file;
 static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+static struct LogRecord* records = NULL;
+static size_t records_mask = 0;
+static atomic_size_t enqueue_position = 0;
+static atomic_size_t dequeue_position = 0;
+static atomic_ullong dropped_count = 0;
+static atomic_int is_async = 0;
+static enum LogOverflowPolicy overflow_policy;
+
+static pthread_t flush_thread;
+static pthread_cond_t flush_wakeup;
+static pthread_cond_t space_available = PTHREAD_COND_INITIALIZER;
+static unsigned int blocked_count = 0;
+static int is_flush_thread_stopping = 0;
+
+static char batch[LOG_BATCH_SIZE];
+static size_t batch_size = 0;
+static time_t batch_time = 0;
+static char batch_time_str[LOG_TIME_SIZE];
+
+static const char* get_level_string(enum Level level) {
+    switch (level) {
+        case DEBUG: return "DEBUG";
+        case INFO:  return "INFO";
+        case WARN:  return "WARN";
+        case ERROR: return "ERROR";
+        case FATAL: return "FATAL";
+        default:    return "UNKNOWN";
+    }
+}
+
+static void format_time(time_t time, char* output, size_t size) {
+    struct tm local_time;
+    localtime_r(&time, &local_time);
+    // The same layout ctime() produces, without its static buffer.
+    strftime(output, size, "%a %b %e %H:%M:%S %Y", &local_time);
+}
+
+static void write_synchronously(enum Level level, const char* message) {
+    char time_str[LOG_TIME_SIZE];
+    format_time(time(NULL), time_str, sizeof(time_str));
+
+    pthread_mutex_lock(&log_mutex);
+    if (log_file != NULL) {
+        fprintf(log_file, "[%s] [%s] %s\n", time_str, get_level_string(level), message);
+        fflush(log_file);
+    } else {
+        fprintf(stderr, "[%s] [%s] %s\n", time_str, get_level_string(level), message);
+    }
+    pthread_mutex_unlock(&log_mutex);
+}
+
+static void wake_flush_thread() {
+    pthread_mutex_lock(&log_mutex);
+    pthread_cond_signal(&flush_wakeup);
+    pthread_mutex_unlock(&log_mutex);
+}
+
+static void mark_truncated(char* message, size_t size) {
+    memcpy(message + size - sizeof(LOG_TRUNCATION_MARK), LOG_TRUNCATION_MARK, sizeof(LOG_TRUNCATION_MARK));
+}
+
+static int enqueue_record(enum Level level, const char* message) {
+    size_t position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+    struct LogRecord* record;
+
+    for (;;) {
+        record = &records[position & records_mask];
+        size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return 0;
+        } else {
+            position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+        }
+    }
+
+    record->level = level;
+    record->time = time(NULL);
+    strncpy(record->message, message, sizeof(record->message) - 1);
+    record->message[sizeof(record->message) - 1] = '\0';
+    if (strnlen(message, sizeof(record->message)) == sizeof(record->message)) {
+        mark_truncated(record->message, sizeof(record->message));
+    }
+    atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+
+    // Half full ring wakes the flush thread early instead of waiting for its timer.
+    size_t used = position + 1 - atomic_load_explicit(&dequeue_position, memory_order_relaxed);
+    if (used == (records_mask + 1) / 2) wake_flush_thread();
+    return 1;
+}
+
+static void write_batch() {
+    if (batch_size == 0) return;
+    fwrite(batch, 1, batch_size, log_file != NULL ? log_file : stderr);
+    batch_size = 0;
+}
+
+static void append_to_batch(time_t time, enum Level level, const char* message) {
+    if (time != batch_time) {
+        format_time(time, batch_time_str, sizeof(batch_time_str));
+        batch_time = time;
+    }
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        size_t available = sizeof(batch) - batch_size;
+        int written_bytes = snprintf(batch + batch_size, available, "[%s] [%s] %s\n",
+                                     batch_time_str, get_level_string(level), message);
+        if (written_bytes >= 0 && (size_t)written_bytes < available) {
+            batch_size += (size_t)written_bytes;
+            return;
+        }
+        write_batch();
+    }
+}
+
+static size_t drain_records() {
+    size_t drained_count = 0;
+    size_t position = atomic_load_explicit(&dequeue_position, memory_order_relaxed);
+
+    for (;;) {
+        struct LogRecord* record = &records[position & records_mask];
+        size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+        if (sequence != position + 1) break;
+
+        append_to_batch(record->time, record->level, record->message);
+        atomic_store_explicit(&record->sequence, position + records_mask + 1, memory_order_release);
+        position++;
+        atomic_store_explicit(&dequeue_position, position, memory_order_relaxed);
+        drained_count++;
+    }
+
+    if (drained_count > 0) {
+        pthread_mutex_lock(&log_mutex);
+        if (blocked_count > 0) pthread_cond_broadcast(&space_available);
+        pthread_mutex_unlock(&log_mutex);
+    }
+
+    unsigned long long dropped = atomic_exchange(&dropped_count, 0);
+    if (dropped > 0) {
+        char message[LOG_STATISTICS_SIZE];
+        snprintf(message, sizeof(message), "%llu log records were dropped, log buffer is full", dropped);
+        append_to_batch(time(NULL), WARN, message);
+    }
+    return drained_count;
+}
+
+static void wait_for_records() {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += LOG_FLUSH_INTERVAL_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&log_mutex);
+    if (!is_flush_thread_stopping) {
+        pthread_cond_timedwait(&flush_wakeup, &log_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&log_mutex);
+}
+
+static void* run_flush_thread(void* argument) {
+    (void)argument;
+
+    for (;;) {
+        pthread_mutex_lock(&log_mutex);
+        int is_stopping = is_flush_thread_stopping;
+        pthread_mutex_unlock(&log_mutex);
+
+        size_t drained_count = drain_records();
+        if (batch_size > 0) {
+            write_batch();
+            fflush(log_file);
+        }
+
+        if (is_stopping && drained_count == 0) break;
+        if (drained_count == 0) wait_for_records();
+    }
+    return NULL;
+}
+
+static size_t round_up_to_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+static void start_async_logging(const struct Config* config) {
+    size_t capacity = round_up_to_power_of_two(config->log_buffer_records);
+    records = calloc(capacity, sizeof(struct LogRecord));
+    if (records == NULL) return;
+
+    for (size_t i = 0; i < capacity; ++i) {
+        atomic_init(&records[i].sequence, i);
+    }
+    records_mask = capacity - 1;
+    atomic_store(&enqueue_position, 0);
+    atomic_store(&dequeue_position, 0);
+    overflow_policy = config->log_overflow_policy;
+
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&flush_wakeup, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    is_flush_thread_stopping = 0;
+    if (pthread_create(&flush_thread, NULL, run_flush_thread, NULL) != RET_SUCCESS) {
+        pthread_cond_destroy(&flush_wakeup);
+        free(records);
+        records = NULL;
+        return;
+    }
+    atomic_store(&is_async, 1);
+}
+
 enum ReturnCode initialize_logger() {
     const struct Config* config = get_config();
     log_file = fopen(config->log_file, "a");
     if (log_file == NULL) {
         return RET_ERROR;
     }
+
+    set_log_level(config->log_level);
+    start_async_logging(config);
     return RET_SUCCESS;
 }
 
+static int is_ring_full() {
+    size_t used = atomic_load_explicit(&enqueue_position, memory_order_relaxed) -
+                  atomic_load_explicit(&dequeue_position, memory_order_relaxed);
+    return used > records_mask;
+}
+
+static void wait_for_space() {
+    // Fullness is checked under the mutex the flush thread takes after
+    // draining, so its broadcast can't be missed.
+    pthread_mutex_lock(&log_mutex);
+    blocked_count++;
+    while (is_ring_full() && !is_flush_thread_stopping) {
+        pthread_cond_signal(&flush_wakeup);
+        pthread_cond_wait(&space_available, &log_mutex);
+    }
+    blocked_count--;
+    pthread_mutex_unlock(&log_mutex);
+}
+
 void log_message(enum Level level, const char* message) {
     if (message == NULL) return;
 
-    time_t curr_time;
-    time(&curr_time);
-    char* curr_time_str = ctime(&curr_time);
-    curr_time_str[strcspn(curr_time_str, "\n")] = 0;
-
-    char* level_str;
-    switch (level) {
-        case DEBUG: level_str = "DEBUG";    break;
-        case INFO:  level_str = "INFO";     break;
-        case WARN:  level_str = "WARN";     break;
-        case ERROR: level_str = "ERROR";    break;
-        case FATAL: level_str = "FATAL";    break;
-        default:    level_str = "UNKNOWN";
+    if (!atomic_load_explicit(&is_async, memory_order_acquire)) {
+        write_synchronously(level, message);
+        return;
     }
 
-    pthread_mutex_lock(&log_mutex);
-    if (log_file != NULL) {
-        fprintf(log_file, "[%s] [%s] %s\n", curr_time_str, level_str, message);
-        fflush(log_file);
-    } else {
-        fprintf(stderr, "[%s] [%s] %s\n", curr_time_str, level_str, message);
+    while (!enqueue_record(level, message)) {
+        if (overflow_policy == LOG_OVERFLOW_DROP) {
+            atomic_fetch_add(&dropped_count, 1);
+            return;
+        }
+        wait_for_space();
+        if (!atomic_load_explicit(&is_async, memory_order_acquire)) {
+            write_synchronously(level, message);
+            return;
+        }
     }
-    pthread_mutex_unlock(&log_mutex);
+}
+
+void log_formatted(enum Level level, const char* format, ...) {
+    if (format == NULL) return;
+
+    char message[LOG_MESSAGE_SIZE];
+    va_list args;
+    va_start(args, format);
+    int message_length = vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (message_length >= (int)sizeof(message)) mark_truncated(message, sizeof(message));
+
+    log_message(level, message);
+}
+
+void set_log_level(enum Level level) {
+    atomic_store_explicit(&g_log_level, level, memory_order_relaxed);
 }
 
 void deinitialize_logger() {
+    if (atomic_exchange(&is_async, 0)) {
+        pthread_mutex_lock(&log_mutex);
+        is_flush_thread_stopping = 1;
+        pthread_cond_signal(&flush_wakeup);
+        pthread_cond_broadcast(&space_available);
+        pthread_mutex_unlock(&log_mutex);
+
+        pthread_join(flush_thread, NULL);
+        pthread_cond_destroy(&flush_wakeup);
+        free(records);
+        records = NULL;
+    }
+
     pthread_mutex_lock(&log_mutex);
     if (log_file != NULL) {
         fclose(log_file);
         log_file = NULL;
     }
     pthread_mutex_unlock(&log_mutex);
-    pthread_mutex_destroy(&log_mutex);
-}
\ No newline at end of file
+}
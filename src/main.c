@@ -4,10 +4,13 @@
     *
     * This file serves as the entry point for the server application.
     *
-    * It sets custom function to handle SIGINT, initializes the
-    * server by calling the server_start() function which handles
-    * configuration loading, socket setup, and request processing,
-    * and then stops the server using server_stop().
+    * It blocks SIGINT and SIGHUP before any thread is started, so
+    * only the signal thread receives them, and ignores SIGPIPE, so a
+    * client closing connection during sendfile() doesn't kill the
+    * process. Then it initializes the server by calling the
+    * server_start() function which handles configuration loading,
+    * socket setup, and request processing, and then stops the
+    * server using server_stop().
 */
 
 #include <signal.h>
@@ -15,7 +18,8 @@
 #include "../include/utils.h"
 
 int main(void) {
-    signal(SIGINT, handle_sigint);
+    block_server_signals();
+    signal(SIGPIPE, SIG_IGN);
     server_start();
     server_stop();
     return RET_SUCCESS;
@@ -0,0 +1,475 @@
+/**
+    * @file: metadata_index.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the in-memory index of
+    * file metadata.
+    *
+    * Indexed files live in a chained hash map which doubles when it
+    * gets full, recent misses live in a small direct-mapped table
+    * where a new miss simply replaces an older one in its slot. Both
+    * are guarded by one reader/writer lock which is never held during
+    * stat(). Every change made by the server bumps a generation
+    * counter, so a stat() racing with an upload or deletion doesn't
+    * overwrite the fresher state.
+    *
+    * Directories are indexed too, with their mtime, so a restored
+    * index can tell which of them changed since it was saved. Restored
+    * entries start unverified and are answered with stat() until the
+    * rescan confirms them: files of unchanged directories are trusted,
+    * changed directories are listed again and their entries which
+    * weren't seen are dropped.
+*/
+
+#define _GNU_SOURCE
+#include "../include/metadata_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../include/file_cache.h"
+#include "../include/logger.h"
+
+#define MIN_BUCKETS_COUNT 1024
+#define MISSING_ENTRIES_COUNT 1024
+#define MISSING_ENTRY_TTL_SEC 1     /**< Files created behind the server's back show up after this. */
+
+struct IndexEntry {
+    char path[MAX_PATH_LEN];
+    struct FileMetadata metadata;
+    unsigned char is_directory;
+    unsigned char is_verified;  /**< Whether metadata matches the filesystem. */
+    unsigned char is_listed;    /**< Whether directory was listed by this process. */
+    struct IndexEntry* next;
+};
+
+struct MissingEntry {
+    char path[MAX_PATH_LEN];
+    time_t expires;
+};
+
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+static struct IndexEntry** buckets = NULL;
+static size_t buckets_count = 0;
+static size_t entries_count = 0;
+static struct MissingEntry missing_entries[MISSING_ENTRIES_COUNT];
+static unsigned long long generation = 0;
+static atomic_int is_rescan_stopped = 0;
+static int is_reconciled = 1;
+
+static time_t get_current_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return now.tv_sec;
+}
+
+static void set_metadata(struct FileMetadata* metadata, const struct stat* stat) {
+    metadata->size = stat->st_size;
+    metadata->mtime = stat->st_mtim;
+    metadata->inode = stat->st_ino;
+    metadata->is_regular = S_ISREG(stat->st_mode);
+}
+
+static struct IndexEntry** find_slot(const char* path) {
+    if (buckets_count == 0) return NULL;
+
+    struct IndexEntry** slot = &buckets[hash_path(path) & (buckets_count - 1)];
+    while (*slot != NULL && strcmp((*slot)->path, path) != 0) {
+        slot = &(*slot)->next;
+    }
+    return slot;
+}
+
+static struct MissingEntry* get_missing_entry(const char* path) {
+    return &missing_entries[hash_path(path) % MISSING_ENTRIES_COUNT];
+}
+
+static int is_recently_missed(const char* path) {
+    const struct MissingEntry* entry = get_missing_entry(path);
+    return entry->expires > get_current_time() && strcmp(entry->path, path) == 0;
+}
+
+static void forget_missing(const char* path) {
+    struct MissingEntry* entry = get_missing_entry(path);
+    if (strcmp(entry->path, path) == 0) entry->expires = 0;
+}
+
+static void remember_missing(const char* path) {
+    struct MissingEntry* entry = get_missing_entry(path);
+    strncpy(entry->path, path, sizeof(entry->path) - 1);
+    entry->path[sizeof(entry->path) - 1] = '\0';
+    entry->expires = get_current_time() + MISSING_ENTRY_TTL_SEC;
+}
+
+static int grow_buckets() {
+    size_t count = buckets_count == 0 ? MIN_BUCKETS_COUNT : buckets_count * 2;
+    struct IndexEntry** new_buckets = calloc(count, sizeof(struct IndexEntry*));
+    if (new_buckets == NULL) return 0;
+
+    for (size_t i = 0; i < buckets_count; ++i) {
+        struct IndexEntry* entry = buckets[i];
+        while (entry != NULL) {
+            struct IndexEntry* next = entry->next;
+            struct IndexEntry** bucket = &new_buckets[hash_path(entry->path) & (count - 1)];
+            entry->next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+
+    free(buckets);
+    buckets = new_buckets;
+    buckets_count = count;
+    return 1;
+}
+
+static struct IndexEntry* find_entry(const char* path) {
+    struct IndexEntry** slot = find_slot(path);
+    return slot != NULL ? *slot : NULL;
+}
+
+static struct IndexEntry* get_or_create_entry(const char* path) {
+    struct IndexEntry* entry = find_entry(path);
+    if (entry != NULL) return entry;
+
+    if (entries_count >= buckets_count && !grow_buckets() && buckets_count == 0) return NULL;
+
+    entry = calloc(1, sizeof(struct IndexEntry));
+    if (entry == NULL) {
+        LOG_ERROR("Memory not allocated for metadata index entry");
+        return NULL;
+    }
+
+    strncpy(entry->path, path, sizeof(entry->path) - 1);
+    *find_slot(path) = entry;
+    entries_count++;
+    return entry;
+}
+
+static struct IndexEntry* store_entry(const char* path, const struct stat* stat) {
+    forget_missing(path);
+
+    struct IndexEntry* entry = get_or_create_entry(path);
+    if (entry == NULL) return NULL;
+
+    set_metadata(&entry->metadata, stat);
+    entry->is_directory = S_ISDIR(stat->st_mode);
+    entry->is_verified = 1;
+    return entry;
+}
+
+static void remove_entry(const char* path) {
+    struct IndexEntry** slot = find_slot(path);
+    if (slot == NULL || *slot == NULL) return;
+
+    struct IndexEntry* entry = *slot;
+    *slot = entry->next;
+    free(entry);
+    entries_count--;
+}
+
+static unsigned long long get_generation() {
+    pthread_rwlock_rdlock(&index_lock);
+    unsigned long long current_generation = generation;
+    pthread_rwlock_unlock(&index_lock);
+    return current_generation;
+}
+
+static int store_scanned_directory(const char* path, const struct stat* stat) {
+    pthread_rwlock_wrlock(&index_lock);
+    struct IndexEntry* entry = find_entry(path);
+    // Known directories are checked by the rescan on their own.
+    int is_new = entry == NULL || !entry->is_directory;
+    if (is_new) {
+        entry = store_entry(path, stat);
+        if (entry != NULL) entry->is_listed = 1;
+    }
+    pthread_rwlock_unlock(&index_lock);
+    return is_new;
+}
+
+static void store_scanned_file(const char* path, const struct stat* stat, unsigned long long scan_generation) {
+    pthread_rwlock_wrlock(&index_lock);
+    struct IndexEntry* entry = find_entry(path);
+    if (scan_generation == generation && (entry == NULL || !entry->is_verified)) {
+        store_entry(path, stat);
+    }
+    pthread_rwlock_unlock(&index_lock);
+}
+
+static void scan_directory(const char* directory) {
+    DIR* stream = opendir(directory);
+    if (stream == NULL) return;
+
+    struct dirent* dirent;
+    while (!atomic_load(&is_rescan_stopped) && (dirent = readdir(stream)) != NULL) {
+        if (strcmp(dirent->d_name, ".") == 0 || strcmp(dirent->d_name, "..") == 0) continue;
+
+        // Same concatenation as set_file_location(), so keys match request paths.
+        char path[MAX_PATH_LEN];
+        int written_bytes = snprintf(path, sizeof(path), "%s/%s", directory, dirent->d_name);
+        if (written_bytes < 0 || written_bytes >= MAX_PATH_LEN) continue;
+
+        unsigned long long scan_generation = get_generation();
+        struct stat stat_result;
+        if (stat(path, &stat_result) == RET_ERROR) continue;
+
+        if (S_ISDIR(stat_result.st_mode)) {
+            if (store_scanned_directory(path, &stat_result)) scan_directory(path);
+        } else if (S_ISREG(stat_result.st_mode)) {
+            store_scanned_file(path, &stat_result, scan_generation);
+        }
+    }
+    closedir(stream);
+}
+
+static size_t get_entries_count() {
+    pthread_rwlock_rdlock(&index_lock);
+    size_t count = entries_count;
+    pthread_rwlock_unlock(&index_lock);
+    return count;
+}
+
+enum ReturnCode build_metadata_index(const char* root_directory) {
+    if (root_directory == NULL) {
+        LOG_ERROR("Root directory is NULL");
+        return RET_ARGUMENT_IS_NULL;
+    }
+
+    struct stat stat_result;
+    if (stat(root_directory, &stat_result) == RET_ERROR || !S_ISDIR(stat_result.st_mode)) {
+        LOG_ERROR("Root directory couldn't be indexed");
+        return RET_ERROR;
+    }
+
+    if (store_scanned_directory(root_directory, &stat_result)) scan_directory(root_directory);
+    size_t indexed_count = get_entries_count();
+
+    LOG_INFOF("Metadata index built with %zu entries", indexed_count);
+    return RET_SUCCESS;
+}
+
+enum ReturnCode lookup_metadata(const char* path, struct FileMetadata* metadata) {
+    if (path == NULL) {
+        LOG_ERROR("Path is NULL");
+        return RET_ARGUMENT_IS_NULL;
+    }
+
+    pthread_rwlock_rdlock(&index_lock);
+    struct IndexEntry* entry = find_entry(path);
+    if (entry != NULL && entry->is_verified && !entry->is_directory) {
+        if (metadata != NULL) *metadata = entry->metadata;
+        pthread_rwlock_unlock(&index_lock);
+        return RET_SUCCESS;
+    }
+
+    int is_missing = is_recently_missed(path);
+    unsigned long long looked_up_generation = generation;
+    pthread_rwlock_unlock(&index_lock);
+    if (is_missing) return RET_ERROR;
+
+    struct stat stat_result;
+    int is_found = stat(path, &stat_result) == RET_SUCCESS;
+    // A directory is not a file which could be sent or replaced.
+    if (is_found && S_ISDIR(stat_result.st_mode)) return RET_ERROR;
+    if (is_found && !S_ISREG(stat_result.st_mode)) {
+        // Only regular files are indexed, anything else is reported as is.
+        if (metadata != NULL) set_metadata(metadata, &stat_result);
+        return RET_SUCCESS;
+    }
+
+    pthread_rwlock_wrlock(&index_lock);
+    if (looked_up_generation == generation) {
+        if (is_found) {
+            store_entry(path, &stat_result);
+        } else {
+            remove_entry(path);
+            remember_missing(path);
+        }
+    }
+    pthread_rwlock_unlock(&index_lock);
+
+    if (!is_found) return RET_ERROR;
+    if (metadata != NULL) set_metadata(metadata, &stat_result);
+    return RET_SUCCESS;
+}
+
+void update_metadata(const char* path, const struct stat* stat) {
+    if (path == NULL || stat == NULL) return;
+
+    pthread_rwlock_wrlock(&index_lock);
+    generation++;
+    store_entry(path, stat);
+    pthread_rwlock_unlock(&index_lock);
+}
+
+void invalidate_metadata(const char* path) {
+    if (path == NULL) return;
+
+    pthread_rwlock_wrlock(&index_lock);
+    generation++;
+    remove_entry(path);
+    forget_missing(path);
+    pthread_rwlock_unlock(&index_lock);
+}
+
+void restore_metadata(const char* path, const struct FileMetadata* metadata, int is_directory) {
+    if (path == NULL || metadata == NULL) return;
+
+    pthread_rwlock_wrlock(&index_lock);
+    struct IndexEntry* entry = get_or_create_entry(path);
+    if (entry != NULL) {
+        entry->metadata = *metadata;
+        entry->is_directory = is_directory != 0;
+        entry->is_verified = 0;
+        entry->is_listed = 0;
+    }
+    is_reconciled = 0;
+    pthread_rwlock_unlock(&index_lock);
+}
+
+static char (*collect_unverified_directories(size_t* count))[MAX_PATH_LEN] {
+    pthread_rwlock_rdlock(&index_lock);
+    size_t directories_count = 0;
+    for (size_t i = 0; i < buckets_count; ++i) {
+        for (const struct IndexEntry* entry = buckets[i]; entry != NULL; entry = entry->next) {
+            if (entry->is_directory && !entry->is_verified) directories_count++;
+        }
+    }
+
+    char (*directories)[MAX_PATH_LEN] = malloc((directories_count + 1) * MAX_PATH_LEN);
+    *count = 0;
+    for (size_t i = 0; directories != NULL && i < buckets_count; ++i) {
+        for (const struct IndexEntry* entry = buckets[i]; entry != NULL; entry = entry->next) {
+            if (!entry->is_directory || entry->is_verified) continue;
+            memcpy(directories[*count], entry->path, MAX_PATH_LEN);
+            (*count)++;
+        }
+    }
+    pthread_rwlock_unlock(&index_lock);
+    return directories;
+}
+
+static int is_same_time(const struct timespec* first, const struct timespec* second) {
+    return first->tv_sec == second->tv_sec && first->tv_nsec == second->tv_nsec;
+}
+
+static void rescan_directory(const char* directory) {
+    struct stat stat_result;
+    int is_found = stat(directory, &stat_result) == RET_SUCCESS && S_ISDIR(stat_result.st_mode);
+
+    pthread_rwlock_wrlock(&index_lock);
+    struct IndexEntry* entry = find_entry(directory);
+    if (entry == NULL || !is_found) {
+        remove_entry(directory);
+        pthread_rwlock_unlock(&index_lock);
+        return;
+    }
+
+    // Creating, removing or renaming an entry updates mtime of its directory.
+    int is_changed = !is_same_time(&entry->metadata.mtime, &stat_result.st_mtim) ||
+                     entry->metadata.inode != stat_result.st_ino;
+    set_metadata(&entry->metadata, &stat_result);
+    entry->is_verified = 1;
+    entry->is_listed = is_changed;
+    pthread_rwlock_unlock(&index_lock);
+
+    if (is_changed) scan_directory(directory);
+}
+
+static const struct IndexEntry* find_parent_entry(const char* path) {
+    char parent[MAX_PATH_LEN];
+    strncpy(parent, path, sizeof(parent) - 1);
+    parent[sizeof(parent) - 1] = '\0';
+
+    char* separator = strrchr(parent, '/');
+    if (separator == NULL) return NULL;
+    *separator = '\0';
+    return find_entry(parent);
+}
+
+static void reconcile_restored_entries() {
+    pthread_rwlock_wrlock(&index_lock);
+    for (size_t i = 0; i < buckets_count; ++i) {
+        struct IndexEntry** slot = &buckets[i];
+        while (*slot != NULL) {
+            struct IndexEntry* entry = *slot;
+            const struct IndexEntry* parent = entry->is_verified ? NULL : find_parent_entry(entry->path);
+
+            if (!entry->is_verified && (parent == NULL || parent->is_verified)) {
+                // Unchanged directory still has the file, a listed one would have verified it.
+                if (parent != NULL && parent->is_directory && !parent->is_listed) {
+                    entry->is_verified = 1;
+                } else {
+                    *slot = entry->next;
+                    free(entry);
+                    entries_count--;
+                    continue;
+                }
+            }
+            slot = &entry->next;
+        }
+    }
+    is_reconciled = 1;
+    pthread_rwlock_unlock(&index_lock);
+}
+
+void rescan_metadata_index() {
+    size_t count = 0;
+    char (*directories)[MAX_PATH_LEN] = collect_unverified_directories(&count);
+    if (directories == NULL) {
+        LOG_ERROR("Memory not allocated for metadata index rescan");
+        return;
+    }
+
+    for (size_t i = 0; i < count && !atomic_load(&is_rescan_stopped); ++i) {
+        rescan_directory(directories[i]);
+    }
+    free(directories);
+
+    if (atomic_load(&is_rescan_stopped)) return;
+    reconcile_restored_entries();
+
+    LOG_INFOF("Metadata index rescanned %zu directories, %zu entries", count, get_entries_count());
+}
+
+void stop_metadata_rescan() {
+    atomic_store(&is_rescan_stopped, 1);
+}
+
+void for_each_metadata(MetadataVisitor visitor, void* context) {
+    if (visitor == NULL) return;
+
+    pthread_rwlock_rdlock(&index_lock);
+    for (size_t i = 0; i < buckets_count; ++i) {
+        for (const struct IndexEntry* entry = buckets[i]; entry != NULL; entry = entry->next) {
+            struct FileMetadata metadata = entry->metadata;
+            // Entries which vanished from a listed directory are dropped only by reconciliation.
+            if (!is_reconciled && entry->is_listed) memset(&metadata.mtime, 0, sizeof(metadata.mtime));
+            visitor(entry->path, &metadata, entry->is_directory, context);
+        }
+    }
+    pthread_rwlock_unlock(&index_lock);
+}
+
+void clear_metadata_index() {
+    pthread_rwlock_wrlock(&index_lock);
+    for (size_t i = 0; i < buckets_count; ++i) {
+        struct IndexEntry* entry = buckets[i];
+        while (entry != NULL) {
+            struct IndexEntry* next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+
+    free(buckets);
+    buckets = NULL;
+    buckets_count = 0;
+    entries_count = 0;
+    memset(missing_entries, 0, sizeof(missing_entries));
+    pthread_rwlock_unlock(&index_lock);
+}
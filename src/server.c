@@ -6,15 +6,28 @@
     * responsible for managing socket creation, configuration, and
     * lifecycle control of client connections.
     *
-    * It implements multithreaded request handling using POSIX threads
-    * and integrates with HTTP parsing, logging, and file storage modules
-    * to process and respond to HTTP client requests.
+    * It implements multithreaded request handling using a pool of
+    * POSIX threads, or serves every connection in a coroutine with
+    * a small stack, and integrates with HTTP parsing, logging, and
+    * file storage modules to process and respond to HTTP client
+    * requests.
+    *
+    * With the pool, connections wait for data in epoll and headers
+    * are read without blocking by the listener thread, so a worker
+    * only gets a parsed request. An upload body is read by the worker
+    * while it arrives, and the connection goes back to epoll whenever
+    * the socket has nothing to read, so idle and slow clients never
+    * hold a worker. Responses are sent by the worker with blocking
+    * calls, which fail once the socket makes no progress for the
+    * client timeout, so a client that stops reading frees its worker.
     *
     * The server supports handling of HTTP GET, POST, and DELETE methods,
     * connection timeouts, Keep-Alive sessions, and safe shutdown
     * on termination signals.
 */
 
+#define _GNU_SOURCE
+
 #include "../include/server.h"
 
 #include <stdio.h>
@@ -23,26 +36,52 @@
 #include <unistd.h>
 #include <signal.h>
 #include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/param.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "../include/http_header.h"
+#include "../include/header_scanner.h"
+#include "../include/event_loop.h"
+#include "../include/thread_pool.h"
+#include "../include/coroutine.h"
+#include "../include/socket_io.h"
 #include "../include/utils.h"
 #include "../include/file_storage.h"
+#include "../include/file_cache.h"
+#include "../include/content_cache.h"
+#include "../include/index_snapshot.h"
+#include "../include/access_log.h"
+#include "../include/io_uring_backend.h"
 #include "../include/logger.h"
 #include "../include/config.h"
 
 volatile sig_atomic_t is_server_running = 1;
 int g_server_fd = -1;
 
+struct ListenerShard {
+    pthread_t thread_id;
+    int server_fd;
+    unsigned int cpu;
+};
+
+static struct ListenerShard* listener_shards = NULL;
+static unsigned int listener_shards_count = 0;
+static pthread_mutex_t listeners_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 volatile unsigned int active_clients = 0;
 pthread_mutex_t client_count_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static enum ReturnCode send_method_continue(int client_socket) {
-    const char* continue_response = "HTTP/1.1 100 Continue\r\n\r\n";
+    const char* continue_response = RAW_RESPONSE_100_CONTINUE;
     size_t response_len = strlen(continue_response);
-    ssize_t bytes_sent = send(client_socket, continue_response, response_len, 0);
+    ssize_t bytes_sent = socket_send(client_socket, continue_response, response_len, 0);
 
     if (bytes_sent < 0) {
         LOG_ERROR("Failed to send 100 Continue response");
@@ -58,24 +97,35 @@ static enum ReturnCode send_method_continue(int client_socket) {
     return RET_SUCCESS;
 }
 
-static enum ReturnCode send_method_post(int client_socket, struct Request* request) {
+static enum ReturnCode receive_request_body(int client_socket, struct Request* request, struct InputBuffer* input) {
+    if (!request->is_chunked) {
+        return receive_file(client_socket, request->path.data, (size_t)request->content_length,
+                            request->body.data, request->body.length);
+    }
+
+    // The chunked body is decoded in the input buffer after the headers,
+    // bytes of the next request stay there.
+    size_t body_size = input->size - request->size;
+    enum ReturnCode return_code = receive_chunked_file(client_socket, request->path.data, input->data + request->size,
+                                                       input->capacity - request->size, &body_size);
+    input->size = request->size + body_size;
+    return return_code;
+}
+
+static enum ReturnCode send_method_post(int client_socket, struct Request* request, struct InputBuffer* input) {
     if (request == NULL) {
         LOG_ERROR("Request is NULL");
         return RET_ARGUMENT_IS_NULL;
     }
 
-    const char* expect_header = get_header_value(&request->headers, "Expect");
-    if (expect_header && strcmp(expect_header, "100-continue") == 0) {
+    if (request->expect_continue) {
         if (send_method_continue(client_socket) != RET_SUCCESS) {
             return RET_RESPONSE_NOT_SENT;
         }
     }
 
-    const char* content_len_str = get_header_value(&request->headers, "Content-Length");
-    size_t content_len = content_len_str ? atoi(content_len_str) : 0;
-    if (receive_file(client_socket, request->path, content_len, request->body, request->body_size) != RET_SUCCESS) {
-        const char* error = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
-        send(client_socket, error, strlen(error), 0);
+    if (receive_request_body(client_socket, request, input) != RET_SUCCESS) {
+        send_error_response(client_socket, request);
         LOG_ERROR("Failed to receive file");
         return RET_ERROR;
     }
@@ -94,17 +144,30 @@ static enum ReturnCode send_method_get(int client_socket, struct Request* reques
         return RET_ARGUMENT_IS_NULL;
     }
 
-    if (handle_request(client_socket, request) == RET_RESPONSE_NOT_SENT) {
+    enum ReturnCode cache_return_code = send_cached_response(client_socket, request);
+    if (cache_return_code != RET_CACHE_MISS) {
+        if (cache_return_code == RET_SUCCESS) LOG_INFO("GET method response sent from cache");
+        return cache_return_code;
+    }
+
+    struct Response response = create_response(request);
+    if (response.is_close_delimited) request->keep_alive = 0;
+    if (send_prepared_response(client_socket, request, &response, request->keep_alive) == RET_RESPONSE_NOT_SENT) {
+        close_response_file(&response);
         return RET_RESPONSE_NOT_SENT;
     }
     
     LOG_INFO("GET method response sent");
-    if (send_file(client_socket, request->path) != RET_SUCCESS) {
+    enum ReturnCode return_code = RET_SUCCESS;
+    if (request->status_code != 0 && is_file_response(request, &response) &&
+        send_opened_file(client_socket, response.file, response.ranges, response.is_close_delimited,
+                         &request->bytes_sent) != RET_SUCCESS) {
         LOG_ERROR("Failed to send file");
-        return RET_ERROR;
+        return_code = RET_ERROR;
     }
 
-    return RET_SUCCESS;
+    close_response_file(&response);
+    return return_code;
 }
 
 static enum ReturnCode send_method_delete(int client_socket, struct Request* request) {
@@ -120,13 +183,15 @@ static enum ReturnCode send_method_delete(int client_socket, struct Request* req
     return RET_SUCCESS;
 }
 
-static void send_method_other(int client_socket) {
-    const char* raw_response = "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n";
-    send(client_socket, raw_response, strlen(raw_response), 0);
+static enum ReturnCode send_method_other(int client_socket, struct Request* request) {
+    if (handle_request(client_socket, request) == RET_RESPONSE_NOT_SENT) {
+        return RET_RESPONSE_NOT_SENT;
+    }
     LOG_WARN("Other method response sent");
+    return RET_SUCCESS;
 }
 
-static enum ReturnCode send_response(int client_socket, struct Request* request) {
+static enum ReturnCode send_response(int client_socket, struct Request* request, struct InputBuffer* input) {
     if (request == NULL) {
         LOG_ERROR("Request is NULL");
         return RET_ARGUMENT_IS_NULL;
@@ -135,10 +200,10 @@ static enum ReturnCode send_response(int client_socket, struct Request* request)
     enum ReturnCode return_code = RET_SUCCESS;
     switch (request->method) {
         case GET: return_code = send_method_get(client_socket, request); break;
-        case POST: return_code = send_method_post(client_socket, request); break;
+        case POST: return_code = send_method_post(client_socket, request, input); break;
         case DELETE: return_code = send_method_delete(client_socket, request); break;
         case UNKNOWN: 
-        default: send_method_other(client_socket);
+        default: return_code = send_method_other(client_socket, request);
     }
     return return_code;
 }
@@ -153,6 +218,16 @@ static void make_port_reusable(int server_fd) {
     LOG_INFO("Made possible for server to reuse port");
 }
 
+static void make_port_shareable(int server_fd) {
+    int opt = 1;
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == RET_ERROR) {
+        LOG_FATAL("Couldn't make server share port between listeners");
+        close(server_fd);
+        exit(EXIT_FAILURE);
+    }
+    LOG_INFO("Made possible for listeners to share port");
+}
+
 static int create_file_descriptor() {
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
 
@@ -186,22 +261,9 @@ static void bind_addr_to_socket(int server_fd, struct sockaddr_in server_addr) {
     LOG_INFO("Bound server address to file descriptor");
 }
 
-static int set_client_timeout(int client_socket) {
-    struct timeval timeout = {5, 0};
-
-    if (setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == RET_ERROR) {
-        LOG_ERROR("Couldn't set timeout time for client");
-        close(client_socket);
-        return RET_ERROR;
-    }
-
-    LOG_INFO("Successfully set timeout time for client");
-    return 0;
-}
-
 static void start_listening(int server_fd) {
     const struct Config* config = get_config();
-    if (listen(server_fd, config->max_clients) == RET_ERROR) {
+    if (listen(server_fd, config->listen_backlog) == RET_ERROR) {
         LOG_FATAL("Couldn't listen on socket");
         exit(EXIT_FAILURE);
     }
@@ -209,6 +271,17 @@ static void start_listening(int server_fd) {
 }
 
 static int accept_connection(int server_fd) {
+    const struct Config* config = get_config();
+    if (config->io_backend == IO_BACKEND_IO_URING && is_io_uring_available()) {
+        int client_socket = io_uring_accept_connection(server_fd);
+        if (client_socket == RET_ERROR) {
+            LOG_ERROR("Couldn't accept connection");
+            return RET_ERROR;
+        }
+        LOG_INFO("Connection successfully accepted");
+        return client_socket;
+    }
+
     struct sockaddr_in client_addr;
     socklen_t client_addr_len = sizeof(client_addr);
     int client_socket = accept(server_fd, (struct sockaddr*)&client_addr, &client_addr_len);
@@ -221,148 +294,744 @@ static int accept_connection(int server_fd) {
     return client_socket;
 }
 
-static char* receive_request(int client_socket) {
-    size_t buffer_size = BUFSIZ;
-    char* buffer = malloc(buffer_size + 1);
-    if (buffer == NULL) {
-        LOG_ERROR("Memory not allocated for raw request buffer");
-        return NULL;
+enum ClientState {
+    CLIENT_READING_HEADERS,
+    CLIENT_READING_BODY,
+    CLIENT_READING_CHUNKED_BODY
+};
+
+struct ClientPoller;
+
+struct ClientTask {
+    int client_socket;
+    struct InputBuffer input;       /**< Received bytes kept between pipelined requests. */
+    struct Request request;
+    struct Arena arena;
+    int is_corked;
+    int is_next_request_received;   /**< Whether input holds the next request after the current one. */
+    struct ClientPoller* poller;    /**< Poller waiting for the connection in worker pool mode. */
+    enum ClientState state;
+    int is_served;                  /**< Whether a worker owns the connection, the poller mustn't touch it. */
+    struct UploadFile upload;       /**< File receiving the body of POST. */
+    size_t upload_remaining;
+    struct ChunkedDecoder decoder;  /**< Decoder of a chunked upload. */
+    time_t last_activity;
+    struct ClientTask* prev;
+    struct ClientTask* next;
+};
+
+struct ClientPoller {
+    int epoll_fd;
+    int server_fd;
+    struct ClientTask* clients;     /**< Connections of the listener, waiting or served. */
+    unsigned int served_count;      /**< Connections owned by workers. */
+    pthread_mutex_t mutex;
+    pthread_cond_t served_done;
+    time_t last_timeout_check;
+};
+
+static int is_would_block_error() {
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+static enum ReturnCode set_socket_blocking(int client_socket, int is_blocking) {
+    int flags = fcntl(client_socket, F_GETFL, 0);
+    if (flags == RET_ERROR) return RET_ERROR;
+
+    flags = is_blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+    if (fcntl(client_socket, F_SETFL, flags) == RET_ERROR) {
+        LOG_ERROR("Couldn't switch client socket mode");
+        return RET_ERROR;
     }
+    return RET_SUCCESS;
+}
 
-    size_t total_received_bytes = 0;
-    ssize_t received_bytes;
-    while (1) {
-        received_bytes = recv(client_socket, buffer + total_received_bytes, buffer_size - total_received_bytes, 0);
+static enum ReturnCode receive_request(int client_socket, struct InputBuffer* input, int flags) {
+    while (find_input_headers_end(input) == 0) {
+        if (input->size == input->capacity && grow_input_buffer(input) != RET_SUCCESS) {
+            return RET_ERROR;
+        }
+
+        ssize_t received_bytes = socket_recv(client_socket, input->data + input->size,
+                                             input->capacity - input->size, flags);
+        if (received_bytes < 0 && is_would_block_error()) return RET_WOULD_BLOCK;
+        if (received_bytes < 0 && errno == EINTR) continue;
         if (received_bytes <= 0) {
             LOG_ERROR("Client disconnected or recv() error while reading headers");
-            free(buffer);
-            return NULL;
+            return RET_ERROR;
         }
+        input->size += (size_t)received_bytes;
+    }
 
-        total_received_bytes += (size_t)received_bytes;
-        buffer[total_received_bytes] = '\0';
+    LOG_INFO("Received HTTP headers");
+    return RET_SUCCESS;
+}
 
-        char* header_end = strstr(buffer, "\r\n\r\n");
-        if (header_end != NULL) break;
+static enum ReturnCode parse_client_request(struct ClientTask* task) {
+    if (parse_request(task->input.data, task->input.size, &task->request) != RET_SUCCESS) {
+        LOG_ERROR("Request wasn't parsed correctly");
+        return RET_ERROR;
+    }
 
-        if (total_received_bytes >= buffer_size) {
-            LOG_ERROR("Received bytes exceed buffer size while reading headers");
-            free(buffer);
-            return NULL;
-        }
+    clock_gettime(CLOCK_MONOTONIC, &task->request.received_time);
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode read_client_request(struct ClientTask* task) {
+    if (receive_request(task->client_socket, &task->input, 0) != RET_SUCCESS) {
+        LOG_WARN("Client closed connection or invalid request");
+        return RET_ERROR;
     }
+    return parse_client_request(task);
+}
 
-    LOG_INFO("Received HTTP headers");
-    return buffer;
+static void cork_client_response(struct ClientTask* task) {
+    struct Request* request = &task->request;
+
+    // Responses to pipelined requests are corked into full segments. The
+    // socket is flushed before waiting for a body, the client may wait for
+    // earlier responses or 100 Continue before sending it.
+    task->is_next_request_received = !request->is_chunked && has_next_request(&task->input, request->size);
+    if (task->is_next_request_received) {
+        socket_set_cork(task->client_socket, &task->is_corked, 1);
+    } else if (is_body_pending(request)) {
+        socket_set_cork(task->client_socket, &task->is_corked, 0);
+    }
 }
 
-static void* handle_client(void* arg) {
-    int client_socket = *(int*)arg;
-    free(arg);
+static enum ReturnCode finish_client_request(struct ClientTask* task, enum ReturnCode return_code) {
+    struct Request* request = &task->request;
 
-    while (is_server_running) {
-        char* raw_request = receive_request(client_socket);
-        if (raw_request == NULL) {
-            LOG_WARN("Client closed connection or invalid request");
-            break;
+    write_access_log(task->client_socket, request);
+    int keep_alive = request->keep_alive;
+    consume_input(&task->input, request->size);
+    reset_arena(request->arena);
+    if (!task->is_next_request_received) socket_set_cork(task->client_socket, &task->is_corked, 0);
+
+    if (return_code != RET_SUCCESS) {
+        LOG_ERROR("Couln't send response, closing connection with client");
+        return RET_ERROR;
+    }
+
+    if (!keep_alive) {
+        LOG_INFO("Connection: close - closing client socket");
+        return RET_ERROR;
+    }
+
+    LOG_INFO("Keep-Alive: waiting for next request on same connection");
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode answer_client_request(struct ClientTask* task) {
+    cork_client_response(task);
+    enum ReturnCode return_code = send_response(task->client_socket, &task->request, &task->input);
+    return finish_client_request(task, return_code);
+}
+
+static enum ReturnCode initialize_client_task(struct ClientTask* task, int client_socket) {
+    task->client_socket = client_socket;
+    task->is_corked = 0;
+    task->upload.fd = -1;
+    initialize_arena(&task->arena);
+    task->request.arena = &task->arena;
+    return initialize_input_buffer(&task->input);
+}
+
+static void unlink_client_locked(struct ClientTask* task) {
+    struct ClientPoller* poller = task->poller;
+    if (task->prev != NULL) task->prev->next = task->next;
+    else poller->clients = task->next;
+    if (task->next != NULL) task->next->prev = task->prev;
+
+    if (task->is_served && --poller->served_count == 0) {
+        pthread_cond_broadcast(&poller->served_done);
+    }
+}
+
+static void close_client_locked(struct ClientTask* task) {
+    epoll_ctl(task->poller->epoll_fd, EPOLL_CTL_DEL, task->client_socket, NULL);
+    unlink_client_locked(task);
+
+    if (task->upload.fd != -1) discard_file_for_writing(&task->upload);
+    close(task->client_socket);
+    LOG_INFO("Client socket closed");
+    free_input_buffer(&task->input);
+    free_arena(&task->arena);
+    free(task);
+
+    pthread_mutex_lock(&client_count_mutex);
+    active_clients--;
+    pthread_mutex_unlock(&client_count_mutex);
+}
+
+static void close_client(struct ClientTask* task) {
+    struct ClientPoller* poller = task->poller;
+    pthread_mutex_lock(&poller->mutex);
+    close_client_locked(task);
+    pthread_mutex_unlock(&poller->mutex);
+}
+
+static void wait_for_client(struct ClientTask* task) {
+    struct ClientPoller* poller = task->poller;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = task;
+
+    // Once armed, the poller may take the connection at once, so it is
+    // given back under the mutex and never touched by the worker again.
+    pthread_mutex_lock(&poller->mutex);
+    if (!is_server_running) {
+        close_client_locked(task);
+        pthread_mutex_unlock(&poller->mutex);
+        return;
+    }
+
+    task->last_activity = time(NULL);
+    if (epoll_ctl(poller->epoll_fd, EPOLL_CTL_MOD, task->client_socket, &event) == RET_ERROR) {
+        LOG_ERROR("Couldn't rearm client socket in epoll");
+        close_client_locked(task);
+        pthread_mutex_unlock(&poller->mutex);
+        return;
+    }
+
+    task->is_served = 0;
+    if (--poller->served_count == 0) pthread_cond_broadcast(&poller->served_done);
+    pthread_mutex_unlock(&poller->mutex);
+}
+
+static void serve_client(struct ClientTask* task, TaskFunction function) {
+    struct ClientPoller* poller = task->poller;
+    pthread_mutex_lock(&poller->mutex);
+    task->is_served = 1;
+    poller->served_count++;
+    pthread_mutex_unlock(&poller->mutex);
+
+    if (submit_task(function, task) != RET_SUCCESS) {
+        LOG_ERROR("Couldn't submit request to worker pool");
+        close_client(task);
+    }
+}
+
+static void respond_to_client(void* arg);
+
+static void continue_with_client(struct ClientTask* task, enum ReturnCode return_code) {
+    if (finish_client_request(task, return_code) != RET_SUCCESS || !is_server_running) {
+        close_client(task);
+        return;
+    }
+
+    task->state = CLIENT_READING_HEADERS;
+    if (find_input_headers_end(&task->input) == 0) {
+        wait_for_client(task);
+        return;
+    }
+
+    // A pipelined request is already received, it is answered as a new task.
+    if (parse_client_request(task) != RET_SUCCESS) {
+        close_client(task);
+        return;
+    }
+    if (submit_task(respond_to_client, task) != RET_SUCCESS) {
+        LOG_ERROR("Couldn't submit request to worker pool");
+        close_client(task);
+    }
+}
+
+static enum ReturnCode receive_client_body(struct ClientTask* task) {
+    while (task->upload_remaining > 0) {
+        ssize_t received_bytes = socket_splice_to_file(task->client_socket, task->upload.fd, task->upload_remaining);
+        if (received_bytes < 0 && is_would_block_error()) return RET_WOULD_BLOCK;
+        if (received_bytes <= 0) {
+            LOG_ERROR("Failed during receiving data chunk");
+            return RET_ERROR;
         }
+        task->upload_remaining -= (size_t)received_bytes;
+    }
+    return RET_SUCCESS;
+}
 
-        struct Request request = parse_request(raw_request);
-        struct Request zeroed;
-        memset(&zeroed, 0, sizeof(zeroed));
-        if (memcmp(&request, &zeroed, sizeof(request)) == RET_SUCCESS) {
-            LOG_ERROR("Request wasn't parsed correctly");
-            free(raw_request);
-            break;
+static enum ReturnCode receive_client_chunked_body(struct ClientTask* task) {
+    struct InputBuffer* input = &task->input;
+    size_t body_offset = task->request.size;
+
+    // The body is decoded in the input buffer after the headers, bytes
+    // of the next request stay there.
+    while (1) {
+        size_t body_size = input->size - body_offset;
+        if (write_chunked_to_file(task->upload.fd, &task->decoder, input->data + body_offset,
+                                  &body_size) != RET_SUCCESS) {
+            LOG_ERROR("Failed during receiving data chunk");
+            return RET_ERROR;
         }
+        input->size = body_offset + body_size;
+        if (is_chunked_body_complete(&task->decoder)) return RET_SUCCESS;
 
-        if (send_response(client_socket, &request) != RET_SUCCESS) {
-            LOG_ERROR("Couln't send response, closing connection with client");
-            free(raw_request);
-            break;
+        if (input->size == input->capacity) {
+            LOG_ERROR("No space left in receive buffer for chunked body");
+            return RET_ERROR;
         }
-        free(raw_request);
 
-        if (!is_keep_alive(request.headers)) {
-            LOG_INFO("Connection: close - closing client socket");
-            break;
+        ssize_t received_bytes = recv(task->client_socket, input->data + input->size,
+                                      input->capacity - input->size, 0);
+        if (received_bytes < 0 && is_would_block_error()) return RET_WOULD_BLOCK;
+        if (received_bytes < 0 && errno == EINTR) continue;
+        if (received_bytes <= 0) {
+            LOG_ERROR("Failed during receiving data chunk");
+            return RET_ERROR;
         }
+        input->size += (size_t)received_bytes;
+    }
+}
+
+static void finish_client_upload(struct ClientTask* task, enum ReturnCode return_code) {
+    if (return_code == RET_SUCCESS) {
+        return_code = close_file_for_writing(task->request.path.data, &task->upload);
+    } else {
+        discard_file_for_writing(&task->upload);
+    }
+
+    // Responses are sent by blocking calls, the body was the only part read without them.
+    if (set_socket_blocking(task->client_socket, 1) != RET_SUCCESS) {
+        close_client(task);
+        return;
+    }
 
-        LOG_INFO("Keep-Alive: waiting for next request on same connection");
-        free_request(&request);
+    if (return_code != RET_SUCCESS) {
+        send_error_response(task->client_socket, &task->request);
+        LOG_ERROR("Failed to receive file");
+        continue_with_client(task, RET_ERROR);
+        return;
     }
 
+    LOG_INFO("File was successfully received");
+    return_code = handle_request(task->client_socket, &task->request);
+    if (return_code == RET_SUCCESS) LOG_INFO("POST method response sent");
+    continue_with_client(task, return_code);
+}
+
+static void receive_client_upload(void* arg) {
+    struct ClientTask* task = arg;
+    if (!is_server_running) {
+        close_client(task);
+        return;
+    }
+
+    enum ReturnCode return_code = task->state == CLIENT_READING_CHUNKED_BODY
+                                ? receive_client_chunked_body(task)
+                                : receive_client_body(task);
+    if (return_code == RET_WOULD_BLOCK) {
+        wait_for_client(task);
+        return;
+    }
+    finish_client_upload(task, return_code);
+}
+
+static void start_client_upload(struct ClientTask* task) {
+    struct Request* request = &task->request;
+
+    if (request->expect_continue && send_method_continue(task->client_socket) != RET_SUCCESS) {
+        continue_with_client(task, RET_RESPONSE_NOT_SENT);
+        return;
+    }
+
+    if (open_file_for_writing(request->path.data, &task->upload) != RET_SUCCESS) {
+        send_error_response(task->client_socket, request);
+        LOG_ERROR("Failed to receive file");
+        continue_with_client(task, RET_ERROR);
+        return;
+    }
+
+    if (request->is_chunked) {
+        initialize_chunked_decoder(&task->decoder);
+        task->state = CLIENT_READING_CHUNKED_BODY;
+    } else {
+        size_t content_len = (size_t)request->content_length;
+        size_t buffered_size = MIN(request->body.length, content_len);
+        if (buffered_size > 0 && write_to_file(task->upload.fd, request->body.data, buffered_size) != RET_SUCCESS) {
+            finish_client_upload(task, RET_ERROR);
+            return;
+        }
+        task->upload_remaining = content_len - buffered_size;
+        task->state = CLIENT_READING_BODY;
+    }
+
+    // The rest of the body is read while it arrives, the worker is given
+    // back to the pool whenever the socket has nothing to read.
+    if (set_socket_blocking(task->client_socket, 0) != RET_SUCCESS) {
+        finish_client_upload(task, RET_ERROR);
+        return;
+    }
+    receive_client_upload(task);
+}
+
+static void respond_to_client(void* arg) {
+    struct ClientTask* task = arg;
+    if (!is_server_running) {
+        close_client(task);
+        return;
+    }
+
+    cork_client_response(task);
+    if (task->request.method == POST) {
+        start_client_upload(task);
+        return;
+    }
+    continue_with_client(task, send_response(task->client_socket, &task->request, &task->input));
+}
+
+static void serve_client_in_coroutine(int client_socket) {
+    struct ClientTask task;
+    memset(&task, 0, sizeof(task));
+    if (initialize_client_task(&task, client_socket) == RET_SUCCESS) {
+        while (is_server_running) {
+            if (read_client_request(&task) != RET_SUCCESS) break;
+            if (answer_client_request(&task) != RET_SUCCESS) break;
+        }
+    }
+
+    free_input_buffer(&task.input);
+    free_arena(&task.arena);
     close(client_socket);
     LOG_INFO("Client socket closed");
+}
+
+static void set_send_timeout(int client_socket) {
+    struct timeval timeout = {.tv_sec = CLIENT_TIMEOUT_SEC, .tv_usec = 0};
+    if (setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == RET_ERROR) {
+        LOG_WARN("Couldn't set send timeout of client socket");
+    }
+}
+
+static void add_client(struct ClientPoller* poller, int client_socket) {
+    struct ClientTask* task = calloc(1, sizeof(*task));
+    if (task == NULL || initialize_client_task(task, client_socket) != RET_SUCCESS) {
+        LOG_ERROR("Couldn't allocate memory for client task");
+        if (task != NULL) free_arena(&task->arena);
+        free(task);
+        close(client_socket);
+
+        pthread_mutex_lock(&client_count_mutex);
+        active_clients--;
+        pthread_mutex_unlock(&client_count_mutex);
+        return;
+    }
+
+    set_send_timeout(client_socket);
+    task->poller = poller;
+    task->state = CLIENT_READING_HEADERS;
+    task->last_activity = time(NULL);
+
+    pthread_mutex_lock(&poller->mutex);
+    task->next = poller->clients;
+    if (poller->clients != NULL) poller->clients->prev = task;
+    poller->clients = task;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = task;
+    if (epoll_ctl(poller->epoll_fd, EPOLL_CTL_ADD, client_socket, &event) == RET_ERROR) {
+        LOG_ERROR("Couldn't register client socket in epoll");
+        close_client_locked(task);
+    }
+    pthread_mutex_unlock(&poller->mutex);
+}
+
+static void accept_client(struct ClientPoller* poller) {
+    const struct Config* config = get_config();
+
+    int client_socket = accept_connection(poller->server_fd);
+    if (client_socket == RET_ERROR) return;
 
     pthread_mutex_lock(&client_count_mutex);
-    active_clients--;
+    if (active_clients >= config->max_clients) {
+        pthread_mutex_unlock(&client_count_mutex);
+        LOG_WARN("Reached max clients count, connection rejected");
+        close(client_socket);
+        return;
+    }
+    active_clients++;
     pthread_mutex_unlock(&client_count_mutex);
 
-    return NULL;
+    add_client(poller, client_socket);
 }
 
-static void handle_requests(int server_fd) {
-    start_listening(server_fd);
+static void poll_client(struct ClientPoller* poller, struct ClientTask* task) {
+    task->last_activity = time(NULL);
+    if (task->state != CLIENT_READING_HEADERS) {
+        serve_client(task, receive_client_upload);
+        return;
+    }
 
-    while (is_server_running) {
-        int client_socket = accept_connection(server_fd);
-        if (client_socket == RET_ERROR) break;
-        if (set_client_timeout(client_socket) == RET_ERROR) break;
+    // Headers are read without blocking here, a worker gets only a parsed request.
+    enum ReturnCode return_code = receive_request(task->client_socket, &task->input, MSG_DONTWAIT);
+    if (return_code == RET_WOULD_BLOCK) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.ptr = task;
+        if (epoll_ctl(poller->epoll_fd, EPOLL_CTL_MOD, task->client_socket, &event) == RET_SUCCESS) return;
+        LOG_ERROR("Couldn't rearm client socket in epoll");
+    }
 
-        const struct Config* config = get_config();
-        pthread_mutex_lock(&client_count_mutex);
-        if (active_clients >= config->max_clients) {
-            pthread_mutex_unlock(&client_count_mutex);
-            LOG_WARN("Reached max clients count, connection rejected");
-            close(client_socket);
-            continue;
+    if (return_code != RET_SUCCESS || parse_client_request(task) != RET_SUCCESS) {
+        close_client(task);
+        return;
+    }
+    serve_client(task, respond_to_client);
+}
+
+static void close_idle_clients(struct ClientPoller* poller, int is_stopping) {
+    time_t now = time(NULL);
+    if (!is_stopping && now == poller->last_timeout_check) return;
+    poller->last_timeout_check = now;
+
+    pthread_mutex_lock(&poller->mutex);
+    struct ClientTask* task = poller->clients;
+    while (task != NULL) {
+        struct ClientTask* next = task->next;
+        if (!task->is_served && (is_stopping || now - task->last_activity >= CLIENT_TIMEOUT_SEC)) {
+            if (!is_stopping) LOG_WARN("Client timed out, closing connection");
+            close_client_locked(task);
         }
-        active_clients++;
-        pthread_mutex_unlock(&client_count_mutex);
+        task = next;
+    }
+    pthread_mutex_unlock(&poller->mutex);
+}
+
+static void stop_client_poller(struct ClientPoller* poller) {
+    // Workers close their connections instead of giving them back once the server stops.
+    pthread_mutex_lock(&poller->mutex);
+    while (poller->served_count > 0) {
+        pthread_cond_wait(&poller->served_done, &poller->mutex);
+    }
+    pthread_mutex_unlock(&poller->mutex);
+
+    close_idle_clients(poller, 1);
+    close(poller->epoll_fd);
+    pthread_mutex_destroy(&poller->mutex);
+    pthread_cond_destroy(&poller->served_done);
+}
+
+static void handle_requests_in_threads(int server_fd) {
+    struct ClientPoller poller;
+    memset(&poller, 0, sizeof(poller));
+    poller.server_fd = server_fd;
+    pthread_mutex_init(&poller.mutex, NULL);
+    pthread_cond_init(&poller.served_done, NULL);
 
-        int* client_socket_ptr = malloc(sizeof(int));
-        if (client_socket_ptr == NULL) {
-            LOG_ERROR("Couldn't allocate memory for client socket");
-            close(client_socket);
-            continue;
+    poller.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event server_event;
+    memset(&server_event, 0, sizeof(server_event));
+    server_event.events = EPOLLIN;
+    server_event.data.ptr = NULL;
+    if (poller.epoll_fd == RET_ERROR ||
+        epoll_ctl(poller.epoll_fd, EPOLL_CTL_ADD, server_fd, &server_event) == RET_ERROR) {
+        LOG_FATAL("Couldn't register server socket in epoll");
+        if (poller.epoll_fd != RET_ERROR) close(poller.epoll_fd);
+        pthread_mutex_destroy(&poller.mutex);
+        pthread_cond_destroy(&poller.served_done);
+        return;
+    }
+
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    while (is_server_running) {
+        int events_count = epoll_wait(poller.epoll_fd, events, EVENT_LOOP_MAX_EVENTS, EVENT_LOOP_TIMEOUT_MS);
+        if (events_count == RET_ERROR) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait() failed");
+            break;
+        }
+
+        for (int i = 0; i < events_count && is_server_running; ++i) {
+            if (events[i].data.ptr == NULL) {
+                accept_client(&poller);
+            } else {
+                poll_client(&poller, events[i].data.ptr);
+            }
         }
-        *client_socket_ptr = client_socket;
-
-        pthread_t thread_id;
-        if (pthread_create(&thread_id, NULL, handle_client, client_socket_ptr) != RET_SUCCESS) {
-            LOG_ERROR("Couldn't create thread for new connection");
-            close(client_socket);
-            free(client_socket_ptr);
-
-            pthread_mutex_lock(&client_count_mutex);
-            active_clients--;
-            pthread_mutex_unlock(&client_count_mutex);
-        } else {
-            pthread_detach(thread_id);
+
+        close_idle_clients(&poller, 0);
+    }
+
+    stop_client_poller(&poller);
+}
+
+static int create_listener(int is_shared) {
+    int server_fd = create_file_descriptor();
+    if (is_shared) make_port_shareable(server_fd);
+
+    struct sockaddr_in server_addr = create_server_addr();
+    bind_addr_to_socket(server_fd, server_addr);
+    start_listening(server_fd);
+    return server_fd;
+}
+
+static void serve_listener(int server_fd) {
+    const struct Config* config = get_config();
+    switch (config->connection_mode) {
+        case CONNECTION_MODE_EPOLL:
+            LOG_INFO("Serving connections with epoll event loop");
+            run_event_loop(server_fd);
+            break;
+        case CONNECTION_MODE_COROUTINES:
+            LOG_INFO("Serving connections with coroutines");
+            run_coroutine_scheduler(server_fd, serve_client_in_coroutine);
+            break;
+        case CONNECTION_MODE_THREADS:
+        default:
+            LOG_INFO("Serving connections with worker pool");
+            handle_requests_in_threads(server_fd);
+    }
+}
+
+static void shutdown_listeners() {
+    // Descriptors stay open, so a thread blocked on one never finds it reused by another socket.
+    pthread_mutex_lock(&listeners_mutex);
+    if (g_server_fd != -1) shutdown(g_server_fd, SHUT_RDWR);
+    for (unsigned int i = 0; i < listener_shards_count; ++i) {
+        if (listener_shards[i].server_fd != -1) shutdown(listener_shards[i].server_fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&listeners_mutex);
+}
+
+static void close_listeners() {
+    pthread_mutex_lock(&listeners_mutex);
+    if (g_server_fd != -1) {
+        close(g_server_fd);
+        g_server_fd = -1;
+    }
+
+    for (unsigned int i = 0; i < listener_shards_count; ++i) {
+        if (listener_shards[i].server_fd == -1) continue;
+        close(listener_shards[i].server_fd);
+        listener_shards[i].server_fd = -1;
+    }
+    pthread_mutex_unlock(&listeners_mutex);
+}
+
+static void* run_listener_shard(void* arg) {
+    struct ListenerShard* shard = arg;
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(shard->cpu, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != RET_SUCCESS) {
+        LOG_WARN("Couldn't pin listener shard to CPU core");
+    }
+
+    serve_listener(shard->server_fd);
+    return NULL;
+}
+
+static void handle_requests_in_shards() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int shards_count = cores > 0 ? (unsigned int)cores : 1;
+
+    listener_shards = calloc(shards_count, sizeof(struct ListenerShard));
+    if (listener_shards == NULL) {
+        LOG_FATAL("Couldn't allocate memory for listener shards");
+        return;
+    }
+
+    for (unsigned int i = 0; i < shards_count; ++i) {
+        listener_shards[i].server_fd = create_listener(1);
+        listener_shards[i].cpu = i;
+    }
+    pthread_mutex_lock(&listeners_mutex);
+    listener_shards_count = shards_count;
+    pthread_mutex_unlock(&listeners_mutex);
+    LOG_INFO("Created listener shard for every CPU core");
+
+    unsigned int started_count = 0;
+    for (; started_count < shards_count; ++started_count) {
+        struct ListenerShard* shard = &listener_shards[started_count];
+        if (pthread_create(&shard->thread_id, NULL, run_listener_shard, shard) != RET_SUCCESS) {
+            LOG_ERROR("Couldn't create thread for listener shard");
+            request_server_stop();
+            break;
         }
     }
+
+    for (unsigned int i = 0; i < started_count; ++i) {
+        pthread_join(listener_shards[i].thread_id, NULL);
+    }
+
+    close_listeners();
+    pthread_mutex_lock(&listeners_mutex);
+    listener_shards_count = 0;
+    free(listener_shards);
+    listener_shards = NULL;
+    pthread_mutex_unlock(&listeners_mutex);
+}
+
+static void handle_requests() {
+    const struct Config* config = get_config();
+    int is_pool_used = config->connection_mode == CONNECTION_MODE_THREADS;
+    if (is_pool_used && initialize_thread_pool(config->worker_threads) != RET_SUCCESS) {
+        LOG_FATAL("Couldn't start worker pool");
+        return;
+    }
+
+    if (config->reuse_port) {
+        handle_requests_in_shards();
+    } else {
+        serve_listener(g_server_fd);
+    }
+
+    if (is_pool_used) deinitialize_thread_pool();
+    clear_file_cache();
+
+    LOG_INFOF("Bytes sent with zero-copy: %llu", get_zero_copy_bytes_count());
+
+    if (is_content_cache_enabled()) {
+        struct ContentCacheStatistics cache_statistics;
+        get_content_cache_statistics(&cache_statistics);
+        LOG_INFOF("Content cache hits: %llu, misses: %llu, coalesced: %llu, evictions: %llu",
+                  cache_statistics.hits, cache_statistics.misses, cache_statistics.coalesced,
+                  cache_statistics.evictions);
+    } else {
+        struct ContentCacheStatistics cache_statistics;
+        get_content_cache_statistics(&cache_statistics);
+        LOG_INFOF("Responses shared by concurrent requests: %llu", cache_statistics.coalesced);
+    }
+    clear_content_cache();
 }
 
 void server_start() {
-    if (load_config("config.json") != RET_SUCCESS) {
+    if (load_config(CONFIG_FILE) != RET_SUCCESS) {
         puts("Failed to load config");
     }
 
     if (initialize_logger() != RET_SUCCESS) return;
 
-    g_server_fd = create_file_descriptor();
-    struct sockaddr_in server_addr = create_server_addr();
-    bind_addr_to_socket(g_server_fd, server_addr);
+    const struct Config* config = get_config();
+    initialize_responses();
+    start_metadata_index();
+    open_access_log();
+    if (!config->reuse_port) {
+        g_server_fd = create_listener(0);
+    }
     
+    if (start_signal_thread() != RET_SUCCESS) return;
+
     puts("Server is started. Press Ctrl+C to stop it...");
     LOG_INFO("Server is started");
-    handle_requests(g_server_fd);
+    handle_requests();
+}
+
+void request_server_stop() {
+    is_server_running = 0;
+    stop_coroutine_schedulers();
+    shutdown_listeners();
 }
 
 void server_stop() {
-    close(g_server_fd);
-    g_server_fd = -1;
+    stop_signal_thread();
+    close_listeners();
+    stop_metadata_index();
+    close_access_log();
     LOG_INFO("Server is stopped!");
     deinitialize_logger();
 }
\ No newline at end of file
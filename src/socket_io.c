@@ -0,0 +1,271 @@
+/**
+    * @file: socket_io.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of socket I/O functions
+    * shared by all connection modes.
+    *
+    * Inside a coroutine every operation is attempted without
+    * blocking, and when the socket is not ready the coroutine waits
+    * for it in the scheduler for at most the client timeout.
+    *
+    * File bodies are sent with sendfile(), and the number of bytes
+    * which took this zero-copy path is counted for statistics.
+    * Uploads are moved socket->pipe->file with splice() through a
+    * pipe owned by the calling thread, which is always drained
+    * before return, so it can be reused by the next upload.
+*/
+
+#define _GNU_SOURCE
+
+#include "../include/socket_io.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/param.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../include/coroutine.h"
+
+#define SPLICE_PIPE_SIZE (1024 * 1024)
+
+struct SplicePipe {
+    int read_fd;
+    int write_fd;
+    size_t capacity;
+};
+
+static atomic_ullong zero_copy_bytes = 0;
+
+static pthread_key_t splice_pipe_key;
+static pthread_once_t splice_pipe_key_once = PTHREAD_ONCE_INIT;
+static _Thread_local struct SplicePipe* splice_pipe = NULL;
+
+ssize_t socket_recv(int socket, void* buffer, size_t length, int flags) {
+    if (!is_in_coroutine()) {
+        return recv(socket, buffer, length, flags);
+    }
+
+    while (1) {
+        ssize_t received_bytes = recv(socket, buffer, length, flags | MSG_DONTWAIT);
+        if (received_bytes >= 0) return received_bytes;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return RET_ERROR;
+
+        if (wait_in_coroutine(socket, EPOLLIN, CLIENT_TIMEOUT_SEC) != RET_SUCCESS) {
+            errno = ETIMEDOUT;
+            return RET_ERROR;
+        }
+    }
+}
+
+ssize_t socket_send(int socket, const void* buffer, size_t length, int flags) {
+    if (!is_in_coroutine()) {
+        return send(socket, buffer, length, flags);
+    }
+
+    size_t total_sent = 0;
+    while (total_sent < length) {
+        ssize_t sent_bytes = send(socket, (const char*)buffer + total_sent, length - total_sent,
+                                  flags | MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent_bytes >= 0) {
+            total_sent += (size_t)sent_bytes;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return RET_ERROR;
+
+        if (wait_in_coroutine(socket, EPOLLOUT, CLIENT_TIMEOUT_SEC) != RET_SUCCESS) {
+            errno = ETIMEDOUT;
+            return RET_ERROR;
+        }
+    }
+    return (ssize_t)total_sent;
+}
+
+static void advance_iov(struct iovec* iov, int iov_count, size_t sent_bytes) {
+    for (int i = 0; i < iov_count && sent_bytes > 0; ++i) {
+        size_t consumed = MIN(sent_bytes, iov[i].iov_len);
+        iov[i].iov_base = (char*)iov[i].iov_base + consumed;
+        iov[i].iov_len -= consumed;
+        sent_bytes -= consumed;
+    }
+}
+
+static size_t get_iov_size(const struct iovec* iov, int iov_count) {
+    size_t size = 0;
+    for (int i = 0; i < iov_count; ++i) size += iov[i].iov_len;
+    return size;
+}
+
+ssize_t socket_writev(int socket, struct iovec* iov, int iov_count) {
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = (size_t)iov_count;
+
+    int flags = MSG_NOSIGNAL | (is_in_coroutine() ? MSG_DONTWAIT : 0);
+    size_t total_sent = 0;
+    while (get_iov_size(iov, iov_count) > 0) {
+        ssize_t sent_bytes = sendmsg(socket, &message, flags);
+        if (sent_bytes >= 0) {
+            advance_iov(iov, iov_count, (size_t)sent_bytes);
+            total_sent += (size_t)sent_bytes;
+            if (!is_in_coroutine()) break;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return RET_ERROR;
+        if (!is_in_coroutine()) return RET_ERROR;
+
+        if (wait_in_coroutine(socket, EPOLLOUT, CLIENT_TIMEOUT_SEC) != RET_SUCCESS) {
+            errno = ETIMEDOUT;
+            return RET_ERROR;
+        }
+    }
+    return (ssize_t)total_sent;
+}
+
+static ssize_t copy_file_to_socket(int socket, int fd, off_t* offset, size_t count) {
+    char buffer[BUFSIZ];
+    ssize_t bytes_read = pread(fd, buffer, MIN(count, sizeof(buffer)), *offset);
+    if (bytes_read <= 0) return bytes_read;
+
+    ssize_t bytes_sent = socket_send(socket, buffer, (size_t)bytes_read, MSG_NOSIGNAL);
+    if (bytes_sent > 0) *offset += bytes_sent;
+    return bytes_sent;
+}
+
+ssize_t socket_sendfile(int socket, int fd, off_t* offset, size_t count) {
+    while (1) {
+        ssize_t sent_bytes = sendfile(socket, fd, offset, count);
+        if (sent_bytes >= 0) {
+            atomic_fetch_add(&zero_copy_bytes, (unsigned long long)sent_bytes);
+            return sent_bytes;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EINVAL || errno == ENOSYS) return copy_file_to_socket(socket, fd, offset, count);
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return RET_ERROR;
+        if (!is_in_coroutine()) return RET_ERROR;
+
+        if (wait_in_coroutine(socket, EPOLLOUT, CLIENT_TIMEOUT_SEC) != RET_SUCCESS) {
+            errno = ETIMEDOUT;
+            return RET_ERROR;
+        }
+    }
+}
+
+static void destroy_splice_pipe(void* arg) {
+    struct SplicePipe* pipe = arg;
+    if (pipe == NULL) return;
+
+    close(pipe->read_fd);
+    close(pipe->write_fd);
+    free(pipe);
+}
+
+static void create_splice_pipe_key() {
+    pthread_key_create(&splice_pipe_key, destroy_splice_pipe);
+}
+
+static struct SplicePipe* get_splice_pipe() {
+    if (splice_pipe != NULL) return splice_pipe;
+
+    struct SplicePipe* pipe = malloc(sizeof(struct SplicePipe));
+    if (pipe == NULL) return NULL;
+
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) == RET_ERROR) {
+        free(pipe);
+        return NULL;
+    }
+    pipe->read_fd = pipe_fds[0];
+    pipe->write_fd = pipe_fds[1];
+
+    // Bigger pipe means fewer splice() calls, default size is kept if not permitted.
+    fcntl(pipe->write_fd, F_SETPIPE_SZ, SPLICE_PIPE_SIZE);
+    int capacity = fcntl(pipe->write_fd, F_GETPIPE_SZ);
+    pipe->capacity = capacity > 0 ? (size_t)capacity : BUFSIZ;
+
+    pthread_once(&splice_pipe_key_once, create_splice_pipe_key);
+    pthread_setspecific(splice_pipe_key, pipe);
+    splice_pipe = pipe;
+    return pipe;
+}
+
+static void discard_splice_pipe() {
+    destroy_splice_pipe(splice_pipe);
+    pthread_setspecific(splice_pipe_key, NULL);
+    splice_pipe = NULL;
+}
+
+static ssize_t copy_socket_to_file(int socket, int fd, size_t count) {
+    char buffer[BUFSIZ];
+    ssize_t received_bytes = socket_recv(socket, buffer, MIN(count, sizeof(buffer)), 0);
+    if (received_bytes <= 0) return received_bytes;
+
+    ssize_t total_written = 0;
+    while (total_written < received_bytes) {
+        ssize_t written_bytes = write(fd, buffer + total_written, (size_t)(received_bytes - total_written));
+        if (written_bytes <= 0) {
+            if (written_bytes == RET_ERROR && errno == EINTR) continue;
+            return RET_ERROR;
+        }
+        total_written += written_bytes;
+    }
+    return received_bytes;
+}
+
+ssize_t socket_splice_to_file(int socket, int fd, size_t count) {
+    struct SplicePipe* pipe = get_splice_pipe();
+    if (pipe == NULL) return copy_socket_to_file(socket, fd, count);
+
+    ssize_t received_bytes;
+    while (1) {
+        received_bytes = splice(socket, NULL, pipe->write_fd, NULL, MIN(count, pipe->capacity),
+                                SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (received_bytes >= 0) break;
+        if (errno == EINTR) continue;
+        if (errno == EINVAL) return copy_socket_to_file(socket, fd, count);
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return RET_ERROR;
+        if (!is_in_coroutine()) return RET_ERROR;
+
+        if (wait_in_coroutine(socket, EPOLLIN, CLIENT_TIMEOUT_SEC) != RET_SUCCESS) {
+            errno = ETIMEDOUT;
+            return RET_ERROR;
+        }
+    }
+
+    size_t remaining_bytes = (size_t)received_bytes;
+    while (remaining_bytes > 0) {
+        ssize_t written_bytes = splice(pipe->read_fd, NULL, fd, NULL, remaining_bytes, SPLICE_F_MOVE);
+        if (written_bytes <= 0) {
+            if (written_bytes == RET_ERROR && errno == EINTR) continue;
+            // Data left in the pipe would end up in the next upload.
+            discard_splice_pipe();
+            return RET_ERROR;
+        }
+        remaining_bytes -= (size_t)written_bytes;
+    }
+
+    return received_bytes;
+}
+
+void socket_set_cork(int socket, int* is_corked, int should_cork) {
+    if (*is_corked == should_cork) return;
+    if (setsockopt(socket, IPPROTO_TCP, TCP_CORK, &should_cork, sizeof(should_cork)) == RET_ERROR) return;
+    *is_corked = should_cork;
+}
+
+unsigned long long get_zero_copy_bytes_count() {
+    return atomic_load(&zero_copy_bytes);
+}
@@ -0,0 +1,219 @@
+/**
+    * @file: thread_pool.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the implementation of the work-stealing
+    * worker pool.
+    *
+    * Each worker has its own deque protected by its own mutex, so
+    * workers only contend when one of them steals. The owner pushes
+    * and pops tasks at the bottom (LIFO, good cache locality), while
+    * thieves take the oldest task from the top. Idle workers sleep on
+    * a condition variable until a new task is submitted.
+*/
+
+#include "../include/thread_pool.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../include/logger.h"
+
+#define INITIAL_DEQUE_CAPACITY 64
+
+struct Task {
+    TaskFunction function;
+    void* arg;
+};
+
+struct TaskDeque {
+    pthread_mutex_t mutex;
+    struct Task* tasks;
+    size_t capacity;
+    size_t head;            /**< Index of the top (oldest) task. */
+    size_t size;
+};
+
+struct Worker {
+    pthread_t thread_id;
+    unsigned int index;
+    struct TaskDeque deque;
+};
+
+static struct Worker* workers = NULL;
+static unsigned int workers_count = 0;
+static unsigned int started_workers_count = 0;
+static atomic_uint next_worker = 0;
+static atomic_size_t pending_tasks = 0;
+static int is_pool_running = 0;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t task_available = PTHREAD_COND_INITIALIZER;
+
+static _Thread_local int current_worker = -1;
+
+static enum ReturnCode grow_deque(struct TaskDeque* deque) {
+    size_t new_capacity = deque->capacity ? deque->capacity * 2 : INITIAL_DEQUE_CAPACITY;
+    struct Task* new_tasks = malloc(new_capacity * sizeof(struct Task));
+    if (new_tasks == NULL) return RET_ERROR;
+
+    for (size_t i = 0; i < deque->size; ++i) {
+        new_tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+    }
+    free(deque->tasks);
+    deque->tasks = new_tasks;
+    deque->capacity = new_capacity;
+    deque->head = 0;
+    return RET_SUCCESS;
+}
+
+static enum ReturnCode push_bottom(struct TaskDeque* deque, struct Task task) {
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->size == deque->capacity && grow_deque(deque) != RET_SUCCESS) {
+        pthread_mutex_unlock(&deque->mutex);
+        return RET_ERROR;
+    }
+    deque->tasks[(deque->head + deque->size) % deque->capacity] = task;
+    deque->size++;
+    pthread_mutex_unlock(&deque->mutex);
+    return RET_SUCCESS;
+}
+
+static int pop_bottom(struct TaskDeque* deque, struct Task* task) {
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->size == 0) {
+        pthread_mutex_unlock(&deque->mutex);
+        return 0;
+    }
+    deque->size--;
+    *task = deque->tasks[(deque->head + deque->size) % deque->capacity];
+    pthread_mutex_unlock(&deque->mutex);
+    return 1;
+}
+
+static int steal_top(struct TaskDeque* deque, struct Task* task) {
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->size == 0) {
+        pthread_mutex_unlock(&deque->mutex);
+        return 0;
+    }
+    *task = deque->tasks[deque->head];
+    deque->head = (deque->head + 1) % deque->capacity;
+    deque->size--;
+    pthread_mutex_unlock(&deque->mutex);
+    return 1;
+}
+
+static int take_task(struct Worker* worker, struct Task* task) {
+    if (pop_bottom(&worker->deque, task)) return 1;
+
+    for (unsigned int i = 1; i < workers_count; ++i) {
+        struct Worker* victim = &workers[(worker->index + i) % workers_count];
+        if (steal_top(&victim->deque, task)) return 1;
+    }
+    return 0;
+}
+
+static void* run_worker(void* arg) {
+    struct Worker* worker = arg;
+    current_worker = (int)worker->index;
+
+    while (1) {
+        struct Task task;
+        if (take_task(worker, &task)) {
+            atomic_fetch_sub(&pending_tasks, 1);
+            task.function(task.arg);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool_mutex);
+        while (atomic_load(&pending_tasks) == 0 && is_pool_running) {
+            pthread_cond_wait(&task_available, &pool_mutex);
+        }
+        int should_exit = atomic_load(&pending_tasks) == 0 && !is_pool_running;
+        pthread_mutex_unlock(&pool_mutex);
+
+        if (should_exit) break;
+    }
+
+    return NULL;
+}
+
+enum ReturnCode initialize_thread_pool(unsigned int count) {
+    if (count == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        count = cores > 0 ? (unsigned int)cores : 1;
+    }
+
+    workers = calloc(count, sizeof(struct Worker));
+    if (workers == NULL) {
+        LOG_ERROR("Memory not allocated for worker pool");
+        return RET_ERROR;
+    }
+
+    for (unsigned int i = 0; i < count; ++i) {
+        workers[i].index = i;
+        pthread_mutex_init(&workers[i].deque.mutex, NULL);
+    }
+    workers_count = count;
+    is_pool_running = 1;
+
+    for (unsigned int i = 0; i < count; ++i) {
+        if (pthread_create(&workers[i].thread_id, NULL, run_worker, &workers[i]) != RET_SUCCESS) {
+            LOG_ERROR("Couldn't create worker thread");
+            deinitialize_thread_pool();
+            return RET_ERROR;
+        }
+        started_workers_count++;
+    }
+
+    LOG_INFO("Worker pool started");
+    return RET_SUCCESS;
+}
+
+enum ReturnCode submit_task(TaskFunction function, void* arg) {
+    if (function == NULL) return RET_ARGUMENT_IS_NULL;
+    if (workers_count == 0) return RET_ERROR;
+
+    unsigned int index = current_worker >= 0
+                       ? (unsigned int)current_worker
+                       : atomic_fetch_add(&next_worker, 1) % workers_count;
+
+    // Counted before it is visible, so a worker taking it right away never drops the counter below zero.
+    atomic_fetch_add(&pending_tasks, 1);
+    struct Task task = {function, arg};
+    if (push_bottom(&workers[index].deque, task) != RET_SUCCESS) {
+        atomic_fetch_sub(&pending_tasks, 1);
+        LOG_ERROR("Memory not allocated for new task");
+        return RET_ERROR;
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    pthread_cond_signal(&task_available);
+    pthread_mutex_unlock(&pool_mutex);
+    return RET_SUCCESS;
+}
+
+void deinitialize_thread_pool() {
+    if (workers == NULL) return;
+
+    pthread_mutex_lock(&pool_mutex);
+    is_pool_running = 0;
+    pthread_cond_broadcast(&task_available);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (unsigned int i = 0; i < started_workers_count; ++i) {
+        pthread_join(workers[i].thread_id, NULL);
+    }
+    for (unsigned int i = 0; i < workers_count; ++i) {
+        free(workers[i].deque.tasks);
+        pthread_mutex_destroy(&workers[i].deque.mutex);
+    }
+
+    free(workers);
+    workers = NULL;
+    workers_count = 0;
+    started_workers_count = 0;
+    LOG_INFO("Worker pool stopped");
+}
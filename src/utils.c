@@ -8,21 +8,88 @@
     * It provides functionality for handling system signals,
     * such as SIGINT, to ensure a graceful server shutdown by
     * properly terminating active connections and releasing
-    * resources.
+    * resources. SIGHUP makes the server re-read log_level from the
+    * configuration file, so verbosity can be changed without restart.
+    *
+    * The signal thread only asks the server to stop. Workers, the
+    * log flush thread and the snapshot thread are joined and
+    * resources are released once, by main() after server_start()
+    * returns, so nothing is torn down while it is still in use.
 */
 
 #include "../include/utils.h"
 
 #include <signal.h>
-#include <sys/socket.h>
+#include <pthread.h>
 #include "../include/server.h"
 #include "../include/logger.h"
+#include "../include/config.h"
+
+static pthread_t signal_thread;
+static int is_signal_thread_started = 0;
+
+static void get_server_signals(sigset_t* signals) {
+    sigemptyset(signals);
+    sigaddset(signals, SIGINT);
+    sigaddset(signals, SIGHUP);
+}
+
+void block_server_signals() {
+    sigset_t signals;
+    get_server_signals(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+}
+
+static void reload_log_level() {
+    enum Level level;
+    if (load_log_level(CONFIG_FILE, &level) != RET_SUCCESS) {
+        LOG_WARN("SIGHUP received, but log_level couldn't be read from config");
+        return;
+    }
+
+    set_log_level(level);
+    // Logged as WARN, so the change is visible under every level but FATAL.
+    LOG_WARN("SIGHUP received, log level reloaded from config");
+}
+
+static void* run_signal_thread(void* argument) {
+    (void)argument;
+
+    sigset_t signals;
+    get_server_signals(&signals);
+
+    for (;;) {
+        int signal_number = 0;
+        if (sigwait(&signals, &signal_number) != RET_SUCCESS) continue;
+
+        if (signal_number == SIGHUP) {
+            reload_log_level();
+            continue;
+        }
+        if (signal_number == SIGINT) {
+            LOG_INFO("SIGINT received, stopping server");
+            request_server_stop();
+            break;
+        }
+    }
+    return NULL;
+}
+
+enum ReturnCode start_signal_thread() {
+    if (pthread_create(&signal_thread, NULL, run_signal_thread, NULL) != RET_SUCCESS) {
+        LOG_FATAL("Couldn't create signal thread");
+        return RET_ERROR;
+    }
+
+    is_signal_thread_started = 1;
+    return RET_SUCCESS;
+}
 
-extern volatile sig_atomic_t is_server_running;
-extern int g_server_fd;
+void stop_signal_thread() {
+    if (!is_signal_thread_started) return;
 
-void handle_sigint(int sig) {
-    (void)sig;
-    is_server_running = 0;
-    server_stop();
-}
\ No newline at end of file
+    // The thread either already returned after SIGINT or is woken by this one.
+    pthread_kill(signal_thread, SIGINT);
+    pthread_join(signal_thread, NULL);
+    is_signal_thread_started = 0;
+}
@@ -4,10 +4,23 @@ cd "$(dirname "$0")/.."
 rm -rf build/*.so
 
 gcc -fPIC -shared -Iinclude -o build/test_logger.so src/logger.c src/config.c
-gcc -fPIC -shared -Iinclude -o build/test_file_storage.so src/file_storage.c src/logger.c src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_file_storage.so src/file_storage.c src/file_cache.c src/content_cache.c src/metadata_index.c src/io_uring_backend.c src/socket_io.c src/coroutine.c src/logger.c src/config.c src/chunked.c src/arena.c src/byte_range.c
 gcc -fPIC -shared -Iinclude -o build/test_server.so src/*.c
-gcc -fPIC -shared -Iinclude -o build/test_http_communication.so src/http_communication.c src/logger.c src/file_storage.c src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_http_communication.so src/http_communication.c src/logger.c src/file_storage.c src/file_cache.c src/content_cache.c src/metadata_index.c src/io_uring_backend.c src/socket_io.c src/coroutine.c src/config.c src/chunked.c src/arena.c src/byte_range.c src/http_header.c src/header_scanner.c
 gcc -fPIC -shared -Iinclude -o build/test_config.so src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_chunked.so src/chunked.c src/logger.c src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_byte_range.so src/byte_range.c src/arena.c src/logger.c src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_header_scanner.so src/header_scanner.c src/logger.c src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_arena.so src/arena.c
+gcc -fPIC -shared -Iinclude -o build/test_http_header.so src/http_header.c src/arena.c src/logger.c src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_file_cache.so src/file_storage.c src/file_cache.c src/content_cache.c src/metadata_index.c src/io_uring_backend.c src/socket_io.c src/coroutine.c src/logger.c src/config.c src/chunked.c src/arena.c src/byte_range.c
+gcc -fPIC -shared -Iinclude -o build/test_content_cache.so src/content_cache.c src/file_cache.c src/logger.c src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_index_snapshot.so src/index_snapshot.c src/file_storage.c src/file_cache.c src/content_cache.c src/metadata_index.c src/io_uring_backend.c src/socket_io.c src/coroutine.c src/logger.c src/config.c src/chunked.c src/arena.c src/byte_range.c
+gcc -fPIC -shared -Iinclude -o build/test_socket_io.so src/socket_io.c src/coroutine.c src/logger.c src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_thread_pool.so src/thread_pool.c src/logger.c src/config.c
+gcc -fPIC -shared -Iinclude -o build/test_access_log.so src/access_log.c src/logger.c src/config.c
+gcc -Iinclude -o build/access_log_decoder tools/access_log_decoder.c
+gcc -fPIC -shared -Iinclude -Wl,--wrap=stat -o build/test_metadata_index.so src/metadata_index.c src/file_cache.c src/logger.c src/config.c tests/stat_hook.c
 
 pytest --rootdir=.
 
@@ -0,0 +1,28 @@
+/**
+    * @file: stat_hook.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file is linked only into test libraries with -Wl,--wrap=stat.
+    * It lets a test run a callback right after a stat() made by the
+    * server returned, so changes racing with the lookup are made at
+    * a known point instead of by chance.
+*/
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+typedef void (*StatHook)(const char* path);
+
+static StatHook stat_hook = NULL;
+
+int __real_stat(const char* path, struct stat* buffer);
+
+void set_stat_hook(StatHook hook) {
+    stat_hook = hook;
+}
+
+int __wrap_stat(const char* path, struct stat* buffer) {
+    int result = __real_stat(path, buffer);
+    if (stat_hook != NULL) stat_hook(path);
+    return result;
+}
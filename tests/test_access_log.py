@@ -0,0 +1,187 @@
+import ctypes
+import struct
+import subprocess
+import threading
+import pytest
+
+
+ACCESS_LOG_HEADER = struct.Struct("=8sII")
+ACCESS_LOG_RECORD = struct.Struct("=QQIIHHBBH")
+MAX_REQUEST_HEADERS = 64
+KNOWN_HEADERS_COUNT = 9
+GET = 1
+
+
+class StringView(ctypes.Structure):
+    _fields_ = [
+        ("data", ctypes.c_void_p),
+        ("length", ctypes.c_size_t),
+    ]
+
+
+class RequestHeader(ctypes.Structure):
+    _fields_ = [
+        ("key", StringView),
+        ("value", StringView),
+    ]
+
+
+class Timespec(ctypes.Structure):
+    _fields_ = [
+        ("tv_sec", ctypes.c_long),
+        ("tv_nsec", ctypes.c_long),
+    ]
+
+
+class Request(ctypes.Structure):
+    _fields_ = [
+        ("method", ctypes.c_int),
+        ("path", StringView),
+        ("version", StringView),
+        ("headers", RequestHeader * MAX_REQUEST_HEADERS),
+        ("headers_count", ctypes.c_size_t),
+        ("known_headers", StringView * KNOWN_HEADERS_COUNT),
+        ("content_length", ctypes.c_uint64),
+        ("is_chunked", ctypes.c_int),
+        ("keep_alive", ctypes.c_int),
+        ("expect_continue", ctypes.c_int),
+        ("body", StringView),
+        ("size", ctypes.c_size_t),
+        ("arena", ctypes.c_void_p),
+        ("received_time", Timespec),
+        ("status_code", ctypes.c_int),
+        ("bytes_sent", ctypes.c_ulonglong),
+    ]
+
+
+@pytest.fixture
+def access_log_lib():
+    lib = ctypes.CDLL("build/test_access_log.so")
+
+    lib.load_config.argtypes = [ctypes.c_char_p]
+    lib.load_config.restype = None
+
+    lib.open_access_log.argtypes = []
+    lib.open_access_log.restype = ctypes.c_int
+
+    lib.write_access_log.argtypes = [ctypes.c_int, ctypes.POINTER(Request)]
+    lib.write_access_log.restype = None
+
+    lib.close_access_log.argtypes = []
+    lib.close_access_log.restype = None
+
+    return lib
+
+
+@pytest.fixture
+def access_log_file(access_log_lib, tmp_path):
+    log_file = tmp_path / "access.bin"
+    config = tmp_path / "config.json"
+    config.write_bytes(b'{ "access_log_file": "%s", "access_log_sample_rate": 1, "access_log_slow_ms": 0 }\0'
+                       % str(log_file).encode())
+    access_log_lib.load_config(str(config).encode())
+    assert access_log_lib.open_access_log() == 0
+    yield log_file
+    access_log_lib.close_access_log()
+
+
+def make_request(path, status_code, bytes_sent):
+    request = Request()
+    request.method = GET
+    request.path.data = ctypes.cast(ctypes.c_char_p(path), ctypes.c_void_p)
+    request.path.length = len(path)
+    request.status_code = status_code
+    request.bytes_sent = bytes_sent
+    libc = ctypes.CDLL(None)
+    libc.clock_gettime(1, ctypes.byref(request.received_time))
+    return request
+
+
+def read_records(log_file):
+    data = log_file.read_bytes()
+    magic, version, record_size = ACCESS_LOG_HEADER.unpack_from(data)
+    assert magic == b"HTTPACC\0"
+    assert version == 1
+    assert record_size == ACCESS_LOG_RECORD.size
+
+    records = []
+    offset = ACCESS_LOG_HEADER.size
+    while offset < len(data):
+        fields = ACCESS_LOG_RECORD.unpack_from(data, offset)
+        offset += ACCESS_LOG_RECORD.size
+        path_length = fields[-1]
+        records.append((fields, data[offset:offset + path_length]))
+        offset += path_length
+    assert offset == len(data)
+    return records
+
+
+def test_records_are_written_on_close(access_log_lib, access_log_file):
+    paths = [b"/index.html", b"/missing"]
+    for path, status_code in zip(paths, [200, 404]):
+        request = make_request(path, status_code, 1234)
+        access_log_lib.write_access_log(-1, ctypes.byref(request))
+    access_log_lib.close_access_log()
+
+    records = read_records(access_log_file)
+    assert [path for _, path in records] == paths
+    assert [fields[5] for fields, _ in records] == [200, 404]
+    assert all(fields[1] == 1234 and fields[6] == GET for fields, _ in records)
+
+
+def test_records_are_flushed_in_background(access_log_lib, access_log_file):
+    request = make_request(b"/slowly", 200, 1)
+    access_log_lib.write_access_log(-1, ctypes.byref(request))
+
+    # The flush thread takes a partially filled buffer once per second.
+    deadline = 30
+    while len(read_records(access_log_file)) == 0 and deadline > 0:
+        threading.Event().wait(0.1)
+        deadline -= 1
+    assert [path for _, path in read_records(access_log_file)] == [b"/slowly"]
+
+
+def test_concurrent_writers_fill_many_buffers(access_log_lib, access_log_file):
+    paths = [b"/thread_%d/%s" % (i, b"x" * 200) for i in range(4)]
+
+    def write(path):
+        request = make_request(path, 200, 1)
+        for _ in range(2000):
+            access_log_lib.write_access_log(-1, ctypes.byref(request))
+
+    threads = [threading.Thread(target=write, args=(path,)) for path in paths]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join(30)
+    access_log_lib.close_access_log()
+
+    # Records that found every buffer waiting for the disk are dropped, the rest stay whole.
+    records = read_records(access_log_file)
+    assert 0 < len(records) <= 8000
+    assert all(path in paths for _, path in records)
+
+
+def test_decoder_prints_records(access_log_lib, access_log_file):
+    request = make_request(b'/a "quoted" path', 500, 42)
+    access_log_lib.write_access_log(-1, ctypes.byref(request))
+    access_log_lib.close_access_log()
+
+    text = subprocess.run(["build/access_log_decoder", str(access_log_file)],
+                          capture_output=True, text=True, check=True).stdout.splitlines()
+    assert len(text) == 1
+    assert ' - GET /a "quoted" path 500 42 bytes ' in text[0]
+
+    csv = subprocess.run(["build/access_log_decoder", "--csv", str(access_log_file)],
+                         capture_output=True, text=True, check=True).stdout.splitlines()
+    assert csv[0] == "timestamp,client,method,path,status,bytes,latency_us"
+    assert ',-,GET,"/a ""quoted"" path",500,42,' in csv[1]
+
+
+def test_decoder_rejects_other_files(tmp_path):
+    other_file = tmp_path / "other.bin"
+    other_file.write_bytes(b"not an access log")
+
+    result = subprocess.run(["build/access_log_decoder", str(other_file)], capture_output=True, text=True)
+    assert result.returncode == 1
+    assert "not an access log" in result.stderr
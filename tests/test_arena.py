@@ -0,0 +1,174 @@
+import ctypes
+import pytest
+
+
+ARENA_BLOCK_SIZE = 4096
+ARENA_ALIGNMENT = 16
+SIZE_MAX = ctypes.c_size_t(-1).value
+
+
+class ArenaBlock(ctypes.Structure):
+    pass
+
+
+ArenaBlock._fields_ = [
+    ("next", ctypes.POINTER(ArenaBlock)),
+    ("capacity", ctypes.c_size_t),
+    ("used", ctypes.c_size_t),
+]
+
+
+class Arena(ctypes.Structure):
+    _fields_ = [
+        ("first", ctypes.POINTER(ArenaBlock)),
+        ("current", ctypes.POINTER(ArenaBlock)),
+    ]
+
+
+@pytest.fixture
+def arena_lib():
+    lib = ctypes.CDLL("build/test_arena.so")
+
+    lib.initialize_arena.argtypes = [ctypes.POINTER(Arena)]
+    lib.initialize_arena.restype = None
+
+    lib.arena_allocate.argtypes = [ctypes.POINTER(Arena), ctypes.c_size_t]
+    lib.arena_allocate.restype = ctypes.c_void_p
+
+    lib.arena_strdup.argtypes = [ctypes.POINTER(Arena), ctypes.c_char_p]
+    lib.arena_strdup.restype = ctypes.c_void_p
+
+    lib.reset_arena.argtypes = [ctypes.POINTER(Arena)]
+    lib.reset_arena.restype = None
+
+    lib.free_arena.argtypes = [ctypes.POINTER(Arena)]
+    lib.free_arena.restype = None
+
+    return lib
+
+
+@pytest.fixture
+def arena(arena_lib):
+    arena = Arena()
+    arena_lib.initialize_arena(ctypes.byref(arena))
+    yield arena
+    arena_lib.free_arena(ctypes.byref(arena))
+
+
+def address(pointer):
+    return ctypes.cast(pointer, ctypes.c_void_p).value
+
+
+def blocks(arena):
+    result = []
+    block = arena.first
+    while block:
+        result.append(block.contents)
+        block = block.contents.next
+    return result
+
+
+def test_first_block_is_allocated_lazily(arena):
+    assert not arena.first
+    assert not arena.current
+
+
+@pytest.mark.parametrize("size", [0, 1, 7, 15, 16, 17, 100])
+def test_allocations_are_aligned(arena_lib, arena, size):
+    for _ in range(8):
+        memory = arena_lib.arena_allocate(ctypes.byref(arena), size)
+        assert memory is not None
+        assert memory % ARENA_ALIGNMENT == 0
+
+
+def test_allocations_do_not_overlap(arena_lib, arena):
+    allocations = []
+    for i in range(200):
+        size = 1 + i % 50
+        memory = arena_lib.arena_allocate(ctypes.byref(arena), size)
+        ctypes.memset(memory, i % 256, size)
+        allocations.append((memory, size, i % 256))
+
+    # Chaining new blocks never moves or overwrites earlier allocations.
+    for memory, size, value in allocations:
+        assert ctypes.string_at(memory, size) == bytes([value]) * size
+    assert len(blocks(arena)) > 1
+
+
+def test_full_block_chains_new_one(arena_lib, arena):
+    first = arena_lib.arena_allocate(ctypes.byref(arena), ARENA_BLOCK_SIZE)
+    assert len(blocks(arena)) == 1
+    assert arena.first.contents.used == ARENA_BLOCK_SIZE
+
+    second = arena_lib.arena_allocate(ctypes.byref(arena), 1)
+    assert len(blocks(arena)) == 2
+    assert address(arena.current) == address(arena.first.contents.next)
+    assert second != first
+
+
+def test_large_allocation_gets_own_block(arena_lib, arena):
+    size = ARENA_BLOCK_SIZE * 3 + 5
+    memory = arena_lib.arena_allocate(ctypes.byref(arena), size)
+    assert memory is not None
+    ctypes.memset(memory, 0xAB, size)
+    assert arena.current.contents.capacity >= size
+
+
+@pytest.mark.parametrize("size", [SIZE_MAX, SIZE_MAX - 8, SIZE_MAX - 64, 1 << 62])
+def test_unsatisfiable_allocation_fails(arena_lib, arena, size):
+    before = arena_lib.arena_allocate(ctypes.byref(arena), 32)
+    current = address(arena.current)
+
+    assert arena_lib.arena_allocate(ctypes.byref(arena), size) is None
+
+    # The arena is still usable after a failed allocation.
+    assert address(arena.current) == current
+    after = arena_lib.arena_allocate(ctypes.byref(arena), 32)
+    assert after == before + 32
+
+
+def test_reset_keeps_first_block(arena_lib, arena):
+    first_memory = arena_lib.arena_allocate(ctypes.byref(arena), 64)
+    first_block = address(arena.first)
+    for _ in range(10):
+        arena_lib.arena_allocate(ctypes.byref(arena), ARENA_BLOCK_SIZE)
+    assert len(blocks(arena)) > 1
+
+    arena_lib.reset_arena(ctypes.byref(arena))
+
+    assert address(arena.first) == first_block
+    assert address(arena.current) == first_block
+    assert len(blocks(arena)) == 1
+    assert arena.first.contents.used == 0
+    # The next request reuses the same memory.
+    assert arena_lib.arena_allocate(ctypes.byref(arena), 64) == first_memory
+
+
+def test_reset_of_empty_arena(arena_lib, arena):
+    arena_lib.reset_arena(ctypes.byref(arena))
+    assert not arena.first
+    assert arena_lib.arena_allocate(ctypes.byref(arena), 1) is not None
+
+
+def test_repeated_resets_do_not_grow(arena_lib, arena):
+    for _ in range(100):
+        for _ in range(3):
+            arena_lib.arena_allocate(ctypes.byref(arena), ARENA_BLOCK_SIZE // 2)
+        arena_lib.reset_arena(ctypes.byref(arena))
+        assert len(blocks(arena)) == 1
+
+
+def test_strdup(arena_lib, arena):
+    copy = arena_lib.arena_strdup(ctypes.byref(arena), b"Content-Type")
+    assert ctypes.string_at(copy) == b"Content-Type"
+    empty = arena_lib.arena_strdup(ctypes.byref(arena), b"")
+    assert ctypes.string_at(empty) == b""
+    assert ctypes.string_at(copy) == b"Content-Type"
+
+
+def test_free_makes_arena_empty(arena_lib, arena):
+    arena_lib.arena_allocate(ctypes.byref(arena), ARENA_BLOCK_SIZE * 2)
+    arena_lib.free_arena(ctypes.byref(arena))
+    assert not arena.first
+    assert not arena.current
+    assert arena_lib.arena_allocate(ctypes.byref(arena), 8) is not None
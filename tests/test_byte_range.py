@@ -0,0 +1,203 @@
+import ctypes
+import re
+import pytest
+
+
+RANGES_IGNORED = 0
+RANGES_SATISFIABLE = 1
+RANGES_NOT_SATISFIABLE = 2
+
+MAX_BYTE_RANGES = 16
+MULTIPART_BOUNDARY_SIZE = 17
+
+
+class StringView(ctypes.Structure):
+    _fields_ = [
+        ("data", ctypes.c_char_p),
+        ("length", ctypes.c_size_t),
+    ]
+
+
+class ByteRange(ctypes.Structure):
+    _fields_ = [
+        ("offset", ctypes.c_uint64),
+        ("length", ctypes.c_uint64),
+        ("part_head", ctypes.c_void_p),
+        ("part_head_size", ctypes.c_size_t),
+    ]
+
+
+class ByteRanges(ctypes.Structure):
+    _fields_ = [
+        ("items", ByteRange * MAX_BYTE_RANGES),
+        ("count", ctypes.c_size_t),
+        ("tail", ctypes.c_void_p),
+        ("tail_size", ctypes.c_size_t),
+        ("boundary", ctypes.c_char * MULTIPART_BOUNDARY_SIZE),
+    ]
+
+
+class Arena(ctypes.Structure):
+    _fields_ = [
+        ("first", ctypes.c_void_p),
+        ("current", ctypes.c_void_p),
+    ]
+
+
+@pytest.fixture
+def byte_range_lib():
+    lib = ctypes.CDLL("build/test_byte_range.so")
+
+    lib.parse_byte_ranges.argtypes = [StringView, ctypes.c_uint64, ctypes.POINTER(ByteRanges)]
+    lib.parse_byte_ranges.restype = ctypes.c_int
+
+    lib.prepare_multipart_ranges.argtypes = [ctypes.POINTER(ByteRanges), ctypes.c_uint64, ctypes.c_char_p,
+                                             ctypes.POINTER(Arena)]
+    lib.prepare_multipart_ranges.restype = ctypes.c_int
+
+    lib.get_ranges_body_size.argtypes = [ctypes.POINTER(ByteRanges)]
+    lib.get_ranges_body_size.restype = ctypes.c_uint64
+
+    lib.initialize_arena.argtypes = [ctypes.POINTER(Arena)]
+    lib.initialize_arena.restype = None
+
+    lib.free_arena.argtypes = [ctypes.POINTER(Arena)]
+    lib.free_arena.restype = None
+
+    return lib
+
+
+@pytest.fixture
+def arena(byte_range_lib):
+    arena = Arena()
+    byte_range_lib.initialize_arena(ctypes.byref(arena))
+    yield arena
+    byte_range_lib.free_arena(ctypes.byref(arena))
+
+
+def parse(lib, value, file_size):
+    ranges = ByteRanges()
+    status = lib.parse_byte_ranges(StringView(value, len(value)), file_size, ctypes.byref(ranges))
+    return status, [(ranges.items[i].offset, ranges.items[i].length) for i in range(ranges.count)]
+
+
+@pytest.mark.parametrize(
+    "value,expected",
+    [
+        (b"bytes=0-0", [(0, 1)]),
+        (b"bytes=0-99", [(0, 100)]),
+        (b"bytes=10-19", [(10, 10)]),
+        (b"bytes=90-", [(90, 10)]),                     # open-ended
+        (b"bytes=0-", [(0, 100)]),
+        (b"bytes=-10", [(90, 10)]),                     # suffix
+        (b"bytes=-1000", [(0, 100)]),                   # suffix longer than file
+        (b"bytes=50-1000", [(50, 50)]),                 # clipped to the end
+        (b"bytes=0-1,5-6", [(0, 2), (5, 2)]),
+        (b"bytes= 0-1 , ,5-6", [(0, 2), (5, 2)]),       # whitespace and empty elements
+        (b"BYTES=0-1", [(0, 2)]),
+        (b"bytes=200-300,0-1", [(0, 2)]),               # unsatisfiable part is skipped
+    ]
+)
+def test_satisfiable_ranges(byte_range_lib, value, expected):
+    status, ranges = parse(byte_range_lib, value, 100)
+    assert status == RANGES_SATISFIABLE
+    assert ranges == expected
+
+
+@pytest.mark.parametrize(
+    "value,file_size",
+    [
+        (b"bytes=100-", 100),
+        (b"bytes=100-200", 100),
+        (b"bytes=-0", 100),
+        (b"bytes=0-", 0),
+        (b"bytes=-5", 0),
+        (b"bytes=200-300,400-", 100),
+    ]
+)
+def test_unsatisfiable_ranges(byte_range_lib, value, file_size):
+    status, ranges = parse(byte_range_lib, value, file_size)
+    assert status == RANGES_NOT_SATISFIABLE
+    assert ranges == []
+
+
+@pytest.mark.parametrize(
+    "value",
+    [
+        b"",
+        b"bytes=",
+        b"bytes=,",
+        b"items=0-1",
+        b"bytes=1",
+        b"bytes=-",
+        b"bytes=5-4",
+        b"bytes=a-b",
+        b"bytes=0-1;2-3",
+        b"bytes=99999999999999999999-",
+    ]
+)
+def test_ignored_ranges(byte_range_lib, value):
+    status, _ = parse(byte_range_lib, value, 100)
+    assert status == RANGES_IGNORED
+
+
+def test_range_count_limit(byte_range_lib):
+    allowed = b"bytes=" + b",".join(b"%d-%d" % (i, i) for i in range(MAX_BYTE_RANGES))
+    status, ranges = parse(byte_range_lib, allowed, 100)
+    assert status == RANGES_SATISFIABLE
+    assert len(ranges) == MAX_BYTE_RANGES
+
+    too_many = b"bytes=" + b",".join(b"%d-%d" % (i, i) for i in range(MAX_BYTE_RANGES + 1))
+    status, _ = parse(byte_range_lib, too_many, 100)
+    assert status == RANGES_IGNORED
+
+
+def build_multipart_body(ranges, content):
+    body = b""
+    for i in range(ranges.count):
+        item = ranges.items[i]
+        body += ctypes.string_at(item.part_head, item.part_head_size)
+        body += content[item.offset:item.offset + item.length]
+    return body + ctypes.string_at(ranges.tail, ranges.tail_size)
+
+
+def test_multipart_layout(byte_range_lib, arena):
+    content = bytes(range(256)) * 4
+    ranges = ByteRanges()
+    value = b"bytes=0-9,-5,500-"
+    assert byte_range_lib.parse_byte_ranges(StringView(value, len(value)), len(content),
+                                            ctypes.byref(ranges)) == RANGES_SATISFIABLE
+    assert byte_range_lib.prepare_multipart_ranges(ctypes.byref(ranges), len(content), b"text/plain",
+                                                   ctypes.byref(arena)) == 0
+
+    boundary = ranges.boundary
+    assert re.fullmatch(rb"[0-9a-f]{16}", boundary)
+
+    body = build_multipart_body(ranges, content)
+    assert byte_range_lib.get_ranges_body_size(ctypes.byref(ranges)) == len(body)
+
+    expected = b""
+    for first, last in [(0, 9), (1019, 1023), (500, 1023)]:
+        expected += (b"\r\n--" + boundary + b"\r\nContent-Type: text/plain\r\n" +
+                     b"Content-Range: bytes %d-%d/%d\r\n\r\n" % (first, last, len(content)) +
+                     content[first:last + 1])
+    expected += b"\r\n--" + boundary + b"--\r\n"
+    assert body == expected
+
+
+def test_multipart_boundaries_differ(byte_range_lib, arena):
+    value = b"bytes=0-1,3-4"
+    boundaries = set()
+    for _ in range(4):
+        ranges = ByteRanges()
+        byte_range_lib.parse_byte_ranges(StringView(value, len(value)), 10, ctypes.byref(ranges))
+        byte_range_lib.prepare_multipart_ranges(ctypes.byref(ranges), 10, b"text/plain", ctypes.byref(arena))
+        boundaries.add(ranges.boundary)
+    assert len(boundaries) == 4
+
+
+def test_single_range_body_size(byte_range_lib):
+    ranges = ByteRanges()
+    value = b"bytes=10-29"
+    byte_range_lib.parse_byte_ranges(StringView(value, len(value)), 100, ctypes.byref(ranges))
+    assert byte_range_lib.get_ranges_body_size(ctypes.byref(ranges)) == 20
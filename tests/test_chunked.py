@@ -0,0 +1,174 @@
+import ctypes
+import pytest
+
+
+CHUNKED_DONE = 10
+
+
+class ChunkedDecoder(ctypes.Structure):
+    _fields_ = [
+        ("state", ctypes.c_int),
+        ("chunk_size", ctypes.c_uint64),
+        ("has_size_digits", ctypes.c_int),
+    ]
+
+
+class IoVec(ctypes.Structure):
+    _fields_ = [
+        ("iov_base", ctypes.c_void_p),
+        ("iov_len", ctypes.c_size_t),
+    ]
+
+
+@pytest.fixture
+def chunked_lib():
+    lib = ctypes.CDLL("build/test_chunked.so")
+
+    lib.initialize_chunked_decoder.argtypes = [ctypes.POINTER(ChunkedDecoder)]
+    lib.initialize_chunked_decoder.restype = None
+
+    lib.decode_chunked.argtypes = [ctypes.POINTER(ChunkedDecoder), ctypes.c_char_p, ctypes.c_size_t,
+                                   ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ctypes.c_size_t)]
+    lib.decode_chunked.restype = ctypes.c_int
+
+    lib.is_chunked_body_complete.argtypes = [ctypes.POINTER(ChunkedDecoder)]
+    lib.is_chunked_body_complete.restype = ctypes.c_int
+
+    lib.prepare_chunk.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_size_t, ctypes.POINTER(IoVec)]
+    lib.prepare_chunk.restype = ctypes.c_int
+
+    return lib
+
+
+def decode(lib, pieces):
+    """Feeds pieces to one decoder, returns (status, decoded data, bytes left after the body)."""
+    decoder = ChunkedDecoder()
+    lib.initialize_chunked_decoder(ctypes.byref(decoder))
+
+    decoded = b""
+    left = b""
+    for piece in pieces:
+        buffer = ctypes.create_string_buffer(piece, len(piece))
+        decoded_size = ctypes.c_size_t(0)
+        consumed_size = ctypes.c_size_t(0)
+        result = lib.decode_chunked(ctypes.byref(decoder), buffer, len(piece),
+                                    ctypes.byref(decoded_size), ctypes.byref(consumed_size))
+        if result != 0:
+            return result, decoded, left
+        decoded += buffer.raw[:decoded_size.value]
+        left += piece[consumed_size.value:]
+
+    return lib.is_chunked_body_complete(ctypes.byref(decoder)), decoded, left
+
+
+def test_decode_whole_body(chunked_lib):
+    complete, decoded, left = decode(chunked_lib, [b"5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n"])
+    assert complete == 1
+    assert decoded == b"hello world"
+    assert left == b""
+
+
+def test_decode_byte_by_byte(chunked_lib):
+    body = b"a\r\n0123456789\r\n3\r\nabc\r\n0\r\n\r\n"
+    complete, decoded, left = decode(chunked_lib, [body[i:i + 1] for i in range(len(body))])
+    assert complete == 1
+    assert decoded == b"0123456789abc"
+
+
+@pytest.mark.parametrize("split", [1, 2, 3, 4])
+def test_decode_split_size_line(chunked_lib, split):
+    body = b"1A;name=value\r\n" + b"x" * 26 + b"\r\n0\r\n\r\n"
+    complete, decoded, _ = decode(chunked_lib, [body[:split], body[split:]])
+    assert complete == 1
+    assert decoded == b"x" * 26
+
+
+def test_decode_uppercase_and_lowercase_hex(chunked_lib):
+    complete, decoded, _ = decode(chunked_lib, [b"B\r\n0123456789a\r\nb\r\n0123456789b\r\n0\r\n\r\n"])
+    assert complete == 1
+    assert decoded == b"0123456789a0123456789b"
+
+
+def test_decode_extensions_are_skipped(chunked_lib):
+    body = b"4;ext\r\nWiki\r\n5 ; a=1;b=\"q\"\r\npedia\r\n0;last\r\n\r\n"
+    complete, decoded, _ = decode(chunked_lib, [body])
+    assert complete == 1
+    assert decoded == b"Wikipedia"
+
+
+def test_decode_trailers_are_skipped(chunked_lib):
+    body = b"4\r\ndata\r\n0\r\nExpires: never\r\nX-Checksum: 1\r\n\r\n"
+    complete, decoded, left = decode(chunked_lib, [body])
+    assert complete == 1
+    assert decoded == b"data"
+    assert left == b""
+
+
+def test_decode_trailers_split(chunked_lib):
+    body = b"4\r\ndata\r\n0\r\nExpires: never\r\n\r\n"
+    complete, decoded, _ = decode(chunked_lib, [body[:17], body[17:25], body[25:]])
+    assert complete == 1
+    assert decoded == b"data"
+
+
+def test_decode_zero_chunk_terminates_body(chunked_lib):
+    next_request = b"GET / HTTP/1.1\r\n\r\n"
+    complete, decoded, left = decode(chunked_lib, [b"0\r\n\r\n" + next_request])
+    assert complete == 1
+    assert decoded == b""
+    assert left == next_request
+
+
+def test_decode_incomplete_body(chunked_lib):
+    complete, decoded, _ = decode(chunked_lib, [b"5\r\nhel"])
+    assert complete == 0
+    assert decoded == b"hel"
+
+    complete, _, _ = decode(chunked_lib, [b"0\r\n"])
+    assert complete == 0
+
+
+@pytest.mark.parametrize(
+    "body",
+    [
+        b"g\r\n",                               # not a hex digit
+        b"\r\n",                                # no size digits
+        b";ext\r\n",                            # extension without size
+        b"-1\r\n",                              # sign
+        b"5\nhello\r\n",                        # bare LF after size
+        b"5\r\nhelloX\r\n",                     # data longer than size
+        b"5\r\nhello\n",                        # bare LF after data
+        b"0\r\nExpires: never\n\r\n",           # bare LF in trailer
+        b"0\r\n\n",                             # bare LF instead of final CRLF
+        b"10000000000000000\r\n",               # size overflows 64 bits
+        b"FFFFFFFFFFFFFFFFF\r\n",               # size overflows 64 bits
+    ]
+)
+def test_decode_malformed_body(chunked_lib, body):
+    result, _, _ = decode(chunked_lib, [body])
+    assert result == -1
+
+
+def test_decode_largest_size(chunked_lib):
+    decoder = ChunkedDecoder()
+    chunked_lib.initialize_chunked_decoder(ctypes.byref(decoder))
+    body = b"FFFFFFFFFFFFFFFF\r\n"
+    decoded_size = ctypes.c_size_t(0)
+    consumed_size = ctypes.c_size_t(0)
+    result = chunked_lib.decode_chunked(ctypes.byref(decoder), body, len(body),
+                                        ctypes.byref(decoded_size), ctypes.byref(consumed_size))
+    assert result == 0
+    assert decoder.chunk_size == 0xFFFFFFFFFFFFFFFF
+    assert consumed_size.value == len(body)
+
+
+@pytest.mark.parametrize("size,size_line", [(0, b"0\r\n"), (5, b"5\r\n"), (255, b"ff\r\n"), (4096, b"1000\r\n")])
+def test_prepare_chunk(chunked_lib, size, size_line):
+    data = b"x" * size
+    line = ctypes.create_string_buffer(32)
+    iov = (IoVec * 3)()
+
+    assert chunked_lib.prepare_chunk(line, data, size, iov) == 3
+
+    chunk = b"".join(ctypes.string_at(v.iov_base, v.iov_len) if v.iov_len else b"" for v in iov)
+    assert chunk == size_line + data + b"\r\n"
@@ -10,6 +10,23 @@ class Config(ctypes.Structure):
         ("max_clients", ctypes.c_uint),
         ("root_directory", ctypes.c_char * 256),
         ("log_file", ctypes.c_char * 256),
+        ("connection_mode", ctypes.c_int),
+        ("worker_threads", ctypes.c_uint),
+        ("listen_backlog", ctypes.c_uint),
+        ("reuse_port", ctypes.c_int),
+        ("io_backend", ctypes.c_int),
+        ("coroutine_stack_size", ctypes.c_uint),
+        ("file_cache_entries", ctypes.c_uint),
+        ("content_cache_size", ctypes.c_size_t),
+        ("index_snapshot_file", ctypes.c_char * 256),
+        ("index_snapshot_interval", ctypes.c_uint),
+        ("log_buffer_records", ctypes.c_uint),
+        ("log_overflow_policy", ctypes.c_int),
+        ("log_level", ctypes.c_int),
+        ("access_log_file", ctypes.c_char * 256),
+        ("access_log_sample_rate", ctypes.c_uint),
+        ("access_log_slow_ms", ctypes.c_uint),
+        ("max_header_size", ctypes.c_size_t),
     ]
 
 
@@ -71,4 +88,187 @@ def test_invalid_ip_and_port(config_lib, tmp_path):
     cfg = config_lib.get_config().contents
 
     assert cfg.ip == 2130706433 # 127.0.0.1
-    assert cfg.port == 8080
\ No newline at end of file
+    assert cfg.port == 8080
+
+
+def test_connection_mode(config_lib, tmp_path):
+    config_path = tmp_path / "epoll.json"
+    config_path.write_bytes(b'{ "connection_mode": "epoll" }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    assert config_lib.get_config().contents.connection_mode == 1
+
+    config_path.write_bytes(b'{ "connection_mode": "fibers" }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    assert config_lib.get_config().contents.connection_mode == 0
+
+
+def test_worker_threads(config_lib, tmp_path):
+    config_path = tmp_path / "workers.json"
+    config_path.write_bytes(b'{ "worker_threads": 4 }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    assert config_lib.get_config().contents.worker_threads == 4
+
+    config_path.write_bytes(b'{ "port": 8080 }\0')
+    config_lib.load_config(str(config_path).encode())
+    assert config_lib.get_config().contents.worker_threads == 0
+
+
+def test_listener_settings(config_lib, tmp_path):
+    config_path = tmp_path / "listeners.json"
+    config_path.write_bytes(b'{ "max_clients": 3, "listen_backlog": 512, "reuse_port": true }\0')
+
+    config_lib.load_config(str(config_path).encode())
+
+    cfg = config_lib.get_config().contents
+    assert cfg.max_clients == 3
+    assert cfg.listen_backlog == 512
+    assert cfg.reuse_port == 1
+
+
+def test_io_backend(config_lib, tmp_path):
+    config_path = tmp_path / "io_uring.json"
+    config_path.write_bytes(b'{ "io_backend": "io_uring" }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    assert config_lib.get_config().contents.io_backend == 1
+
+    config_path.write_bytes(b'{ "io_backend": "aio" }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    assert config_lib.get_config().contents.io_backend == 0
+
+
+def test_coroutine_mode(config_lib, tmp_path):
+    config_path = tmp_path / "coroutines.json"
+    config_path.write_bytes(b'{ "connection_mode": "coroutines", "coroutine_stack_size": 131072 }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    config = config_lib.get_config().contents
+    assert config.connection_mode == 2
+    assert config.coroutine_stack_size == 131072
+
+    config_path.write_bytes(b'{ "coroutine_stack_size": 4096 }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    assert config_lib.get_config().contents.coroutine_stack_size == 65536
+
+
+def test_file_cache_entries(config_lib, tmp_path):
+    config_path = tmp_path / "file_cache.json"
+    config_path.write_bytes(b'{ "file_cache_entries": 0 }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    assert config_lib.get_config().contents.file_cache_entries == 0
+
+    config_path.write_bytes(b'{ "file_cache_entries": -1 }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    assert config_lib.get_config().contents.file_cache_entries == 256
+
+
+def test_content_cache_size(config_lib, tmp_path):
+    config_path = tmp_path / "content_cache.json"
+    config_path.write_bytes(b'{ "content_cache_size": 8589934592 }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    assert config_lib.get_config().contents.content_cache_size == 8589934592
+
+    config_path.write_bytes(b'{ "content_cache_size": -5 }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    assert config_lib.get_config().contents.content_cache_size == 0
+
+
+def test_index_snapshot(config_lib, tmp_path):
+    config_path = tmp_path / "index_snapshot.json"
+    config_path.write_bytes(b'{ "index_snapshot_file": "index.snapshot", "index_snapshot_interval": 0 }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    config = config_lib.get_config().contents
+    assert config.index_snapshot_file.decode() == "index.snapshot"
+    assert config.index_snapshot_interval == 0
+
+    config_path.write_bytes(b'{ "index_snapshot_interval": -1 }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    config = config_lib.get_config().contents
+    assert config.index_snapshot_file.decode() == ""
+    assert config.index_snapshot_interval == 300
+
+
+def test_log_buffer(config_lib, tmp_path):
+    config_path = tmp_path / "log_buffer.json"
+    config_path.write_bytes(b'{ "log_buffer_records": 65536, "log_overflow_policy": "drop" }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    config = config_lib.get_config().contents
+    assert config.log_buffer_records == 65536
+    assert config.log_overflow_policy == 1
+
+    config_path.write_bytes(b'{ "log_overflow_policy": "wait" }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    config = config_lib.get_config().contents
+    assert config.log_buffer_records == 4096
+    assert config.log_overflow_policy == 0
+
+
+def test_log_level(config_lib, tmp_path):
+    config_path = tmp_path / "log_level.json"
+    config_path.write_bytes(b'{ "log_level": "warn" }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    assert config_lib.get_config().contents.log_level == 2
+
+    config_path.write_bytes(b'{ "log_level": "verbose" }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    assert config_lib.get_config().contents.log_level == 0
+
+
+def test_access_log(config_lib, tmp_path):
+    config_path = tmp_path / "access_log.json"
+    config_path.write_bytes(b'{ "access_log_file": "access.bin", "access_log_sample_rate": 100, "access_log_slow_ms": 0 }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    config = config_lib.get_config().contents
+    assert config.access_log_file.decode() == "access.bin"
+    assert config.access_log_sample_rate == 100
+    assert config.access_log_slow_ms == 0
+
+    config_path.write_bytes(b'{ "access_log_sample_rate": -1 }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    config = config_lib.get_config().contents
+    assert config.access_log_file.decode() == ""
+    assert config.access_log_sample_rate == 1
+    assert config.access_log_slow_ms == 1000
+
+
+def test_max_header_size(config_lib, tmp_path):
+    config_path = tmp_path / "max_header_size.json"
+    config_path.write_bytes(b'{ "max_header_size": 1048576 }\0')
+
+    config_lib.load_config(str(config_path).encode())
+    assert config_lib.get_config().contents.max_header_size == 1048576
+
+    config_path.write_bytes(b'{ "max_header_size": 100 }\0')
+    assert config_lib.load_config(str(config_path).encode()) != 0
+    assert config_lib.get_config().contents.max_header_size == 65536
+
+
+def test_load_log_level(config_lib, tmp_path):
+    config_path = tmp_path / "log_level.json"
+    config_path.write_bytes(b'{ "port": 9090, "log_level": "info" }\0')
+    config_lib.load_config(str(config_path).encode())
+
+    # Only the level is read again, the loaded configuration is kept.
+    level = ctypes.c_int(-1)
+    config_path.write_bytes(b'{ "port": 7070, "log_level": "error" }\0')
+    assert config_lib.load_log_level(str(config_path).encode(), ctypes.byref(level)) == 0
+    assert level.value == 3
+    config = config_lib.get_config().contents
+    assert config.log_level == 1
+    assert config.port == 9090
+
+    for invalid_config in [b'{ "log_level": "verbose" }\0', b'{ "port": 7070 }\0']:
+        level.value = -1
+        config_path.write_bytes(invalid_config)
+        assert config_lib.load_log_level(str(config_path).encode(), ctypes.byref(level)) != 0
+        assert level.value == -1
+
+    assert config_lib.load_log_level(str(tmp_path / "missing.json").encode(), ctypes.byref(level)) != 0
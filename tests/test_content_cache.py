@@ -0,0 +1,384 @@
+import ctypes
+import json
+import threading
+import time
+import pytest
+
+
+MAX_PATH_LEN = 256
+CACHE_SIZE = 8000                   # budget of the tests
+ENTRY_SIZE = CACHE_SIZE // 8        # largest cacheable entry
+PROTECTED_SIZE = CACHE_SIZE // 100 * 80
+
+
+class CachedContent(ctypes.Structure):
+    _fields_ = [
+        ("path", ctypes.c_char * MAX_PATH_LEN),
+        ("data", ctypes.c_void_p),
+        ("headers_size", ctypes.c_size_t),
+        ("body_size", ctypes.c_size_t),
+        ("references", ctypes.c_uint),
+        ("is_cached", ctypes.c_int),
+        ("is_protected", ctypes.c_int),
+    ]
+
+
+class ContentCacheStatistics(ctypes.Structure):
+    _fields_ = [
+        ("hits", ctypes.c_ulonglong),
+        ("misses", ctypes.c_ulonglong),
+        ("coalesced", ctypes.c_ulonglong),
+        ("evictions", ctypes.c_ulonglong),
+        ("used_bytes", ctypes.c_size_t),
+        ("waiting", ctypes.c_uint),
+    ]
+
+
+libc = ctypes.CDLL(None)
+libc.malloc.argtypes = [ctypes.c_size_t]
+libc.malloc.restype = ctypes.c_void_p
+
+
+@pytest.fixture
+def content_cache_lib(tmp_path):
+    lib = ctypes.CDLL("build/test_content_cache.so")
+
+    lib.load_config.argtypes = [ctypes.c_char_p]
+    lib.load_config.restype = ctypes.c_int
+
+    lib.is_content_cacheable.argtypes = [ctypes.c_size_t]
+    lib.is_content_cacheable.restype = ctypes.c_int
+
+    lib.acquire_content.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.POINTER(ctypes.c_void_p)]
+    lib.acquire_content.restype = ctypes.POINTER(CachedContent)
+
+    lib.should_load_content.argtypes = [ctypes.c_void_p, ctypes.c_size_t]
+    lib.should_load_content.restype = ctypes.c_int
+
+    lib.complete_content_fill.argtypes = [ctypes.c_void_p, ctypes.POINTER(CachedContent)]
+    lib.complete_content_fill.restype = None
+
+    lib.get_content_generation.argtypes = []
+    lib.get_content_generation.restype = ctypes.c_ulonglong
+
+    lib.insert_content.argtypes = [ctypes.c_char_p, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_size_t,
+                                   ctypes.c_ulonglong]
+    lib.insert_content.restype = ctypes.POINTER(CachedContent)
+
+    lib.release_content.argtypes = [ctypes.POINTER(CachedContent)]
+    lib.release_content.restype = None
+
+    lib.invalidate_content.argtypes = [ctypes.c_char_p]
+    lib.invalidate_content.restype = None
+
+    lib.get_content_cache_statistics.argtypes = [ctypes.POINTER(ContentCacheStatistics)]
+    lib.get_content_cache_statistics.restype = None
+
+    lib.clear_content_cache.argtypes = []
+    lib.clear_content_cache.restype = None
+
+    config = tmp_path / "config.json"
+    config.write_text(json.dumps({"content_cache_size": CACHE_SIZE}))
+    assert lib.load_config(str(config).encode()) == 0
+
+    lib.clear_content_cache()
+    yield lib
+    lib.clear_content_cache()
+
+
+def path(name):
+    return ("./storage/content_cache_%s" % name).encode()
+
+
+def insert(lib, name, size=ENTRY_SIZE, generation=None, keep=False):
+    if generation is None:
+        generation = lib.get_content_generation()
+    content = lib.insert_content(path(name), libc.malloc(size), 0, size, generation)
+    assert content
+    if keep:
+        return content
+    is_cached = content.contents.is_cached
+    lib.release_content(content)
+    return is_cached
+
+
+def lookup(lib, name):
+    """Acquires and releases an entry, returns its is_protected flag or None on miss."""
+    fill = ctypes.c_void_p()
+    content = lib.acquire_content(path(name), 1, ctypes.byref(fill))
+    if not content:
+        lib.complete_content_fill(fill, None)
+        return None
+    is_protected = content.contents.is_protected
+    lib.release_content(content)
+    return is_protected
+
+
+def statistics(lib):
+    result = ContentCacheStatistics()
+    lib.get_content_cache_statistics(ctypes.byref(result))
+    return result
+
+
+def test_entry_size_limit(content_cache_lib):
+    assert content_cache_lib.is_content_cacheable(ENTRY_SIZE) == 1
+    assert content_cache_lib.is_content_cacheable(ENTRY_SIZE + 1) == 0
+
+
+def test_second_hit_promotes_entry(content_cache_lib):
+    assert insert(content_cache_lib, "a")
+    assert lookup(content_cache_lib, "a") == 1
+    assert lookup(content_cache_lib, "a") == 1
+
+    assert insert(content_cache_lib, "b")
+    before = statistics(content_cache_lib)
+    assert lookup(content_cache_lib, "b") == 1
+    assert lookup(content_cache_lib, "missing") is None
+    after = statistics(content_cache_lib)
+    assert after.hits == before.hits + 1
+    assert after.misses == before.misses + 1
+
+
+def test_probation_is_evicted_in_lru_order(content_cache_lib):
+    for i in range(8):
+        assert insert(content_cache_lib, "p%d" % i)
+    assert statistics(content_cache_lib).used_bytes == CACHE_SIZE
+
+    before = statistics(content_cache_lib)
+    assert insert(content_cache_lib, "p8")
+    assert statistics(content_cache_lib).evictions == before.evictions + 1
+
+    assert lookup(content_cache_lib, "p0") is None
+    for i in range(1, 9):
+        assert lookup(content_cache_lib, "p%d" % i) is not None
+
+
+def test_scan_does_not_flush_protected_entries(content_cache_lib):
+    for name in ["hot0", "hot1", "hot2"]:
+        insert(content_cache_lib, name)
+        lookup(content_cache_lib, name)
+
+    # One pass over many cold files, each seen once.
+    for i in range(50):
+        assert insert(content_cache_lib, "cold%d" % i)
+
+    for name in ["hot0", "hot1", "hot2"]:
+        assert lookup(content_cache_lib, name) == 1
+    assert lookup(content_cache_lib, "cold0") is None
+    assert lookup(content_cache_lib, "cold49") is not None
+    assert statistics(content_cache_lib).used_bytes <= CACHE_SIZE
+
+
+def test_protected_overflow_is_demoted(content_cache_lib):
+    protected_count = PROTECTED_SIZE // ENTRY_SIZE
+    first = insert(content_cache_lib, "h0", keep=True)
+    lookup(content_cache_lib, "h0")
+    assert first.contents.is_protected == 1
+
+    for i in range(1, protected_count + 1):
+        insert(content_cache_lib, "h%d" % i)
+        lookup(content_cache_lib, "h%d" % i)
+
+    # The least recently used protected entry gets another chance in probation.
+    assert first.contents.is_protected == 0
+    assert first.contents.is_cached == 1
+    content_cache_lib.release_content(first)
+    for i in range(1, protected_count + 1):
+        assert lookup(content_cache_lib, "h%d" % i) == 1
+
+
+def test_demoted_entry_is_evicted_before_protected(content_cache_lib):
+    protected_count = PROTECTED_SIZE // ENTRY_SIZE
+    for i in range(protected_count + 1):
+        insert(content_cache_lib, "h%d" % i)
+        lookup(content_cache_lib, "h%d" % i)
+    insert(content_cache_lib, "new")
+
+    # The budget is full; probation holds "new" and demoted "h0".
+    assert insert(content_cache_lib, "newer")
+    assert lookup(content_cache_lib, "h0") is None
+    for i in range(1, protected_count + 1):
+        assert lookup(content_cache_lib, "h%d" % i) == 1
+
+
+def test_referenced_entries_are_not_evicted(content_cache_lib):
+    held = [insert(content_cache_lib, "r%d" % i, keep=True) for i in range(8)]
+
+    # Nothing can be evicted, the new entry is served but not cached.
+    overflow = insert(content_cache_lib, "overflow", keep=True)
+    assert overflow.contents.is_cached == 0
+    content_cache_lib.release_content(overflow)
+
+    content_cache_lib.release_content(held[3])
+    assert insert(content_cache_lib, "after")
+    assert lookup(content_cache_lib, "r3") is None
+    for i in [0, 1, 2, 4, 5, 6, 7]:
+        assert held[i].contents.is_cached == 1
+        content_cache_lib.release_content(held[i])
+
+
+def test_invalidate_removes_entry(content_cache_lib):
+    insert(content_cache_lib, "x")
+    used = statistics(content_cache_lib).used_bytes
+
+    content_cache_lib.invalidate_content(path("x"))
+    assert statistics(content_cache_lib).used_bytes == used - ENTRY_SIZE
+    assert lookup(content_cache_lib, "x") is None
+
+
+def test_stale_generation_is_not_cached(content_cache_lib):
+    generation = content_cache_lib.get_content_generation()
+    content_cache_lib.invalidate_content(path("y"))
+
+    # The file was read before it was modified, the copy is served once.
+    assert not insert(content_cache_lib, "y", generation=generation)
+    assert lookup(content_cache_lib, "y") is None
+
+
+def start_followers(lib, name, count):
+    """Starts threads looking up name, returns them with the list their results are appended to."""
+    results = []
+
+    def follow():
+        fill = ctypes.c_void_p()
+        content = lib.acquire_content(path(name), 1, ctypes.byref(fill))
+        results.append((ctypes.addressof(content.contents) if content else None, fill.value))
+        if content:
+            lib.release_content(content)
+
+    threads = [threading.Thread(target=follow) for _ in range(count)]
+    for thread in threads:
+        thread.start()
+    return threads, results
+
+
+def wait_for_followers(lib, count):
+    deadline = time.monotonic() + 5
+    while statistics(lib).waiting < count:
+        assert time.monotonic() < deadline, "followers didn't wait for the fill"
+        time.sleep(0.001)
+
+
+def test_concurrent_misses_are_coalesced(content_cache_lib):
+    before = statistics(content_cache_lib)
+    fill = ctypes.c_void_p()
+    assert not content_cache_lib.acquire_content(path("shared"), 1, ctypes.byref(fill))
+    assert fill.value is not None
+
+    threads, results = start_followers(content_cache_lib, "shared", 8)
+    wait_for_followers(content_cache_lib, 8)
+    # Followers sleep until the leader completes the fill.
+    assert results == []
+
+    content = insert(content_cache_lib, "shared", keep=True)
+    content_cache_lib.complete_content_fill(fill, content)
+    for thread in threads:
+        thread.join(5)
+
+    assert results == [(ctypes.addressof(content.contents), None)] * 8
+    after = statistics(content_cache_lib)
+    assert after.misses == before.misses + 1
+    assert after.coalesced == before.coalesced + 8
+
+    assert content.contents.references == 1
+    content_cache_lib.release_content(content)
+    assert lookup(content_cache_lib, "shared") is not None
+
+
+def test_failed_fill_is_handed_to_followers(content_cache_lib):
+    before = statistics(content_cache_lib)
+    fill = ctypes.c_void_p()
+    content_cache_lib.acquire_content(path("failed"), 1, ctypes.byref(fill))
+
+    threads, results = start_followers(content_cache_lib, "failed", 4)
+    wait_for_followers(content_cache_lib, 4)
+    content_cache_lib.complete_content_fill(fill, None)
+    for thread in threads:
+        thread.join(5)
+
+    # Followers get the miss without becoming leaders themselves, and they aren't counted as coalesced.
+    assert results == [(None, None)] * 4
+    assert statistics(content_cache_lib).coalesced == before.coalesced
+
+    # The next lookup starts a new fill.
+    next_fill = ctypes.c_void_p()
+    assert not content_cache_lib.acquire_content(path("failed"), 1, ctypes.byref(next_fill))
+    assert next_fill.value is not None
+    content_cache_lib.complete_content_fill(next_fill, None)
+    assert statistics(content_cache_lib).misses == before.misses + 2
+
+
+def test_uncached_fill_result_is_shared(content_cache_lib):
+    before = statistics(content_cache_lib)
+    generation = content_cache_lib.get_content_generation()
+    fill = ctypes.c_void_p()
+    content_cache_lib.acquire_content(path("stale"), 1, ctypes.byref(fill))
+
+    threads, results = start_followers(content_cache_lib, "stale", 4)
+    wait_for_followers(content_cache_lib, 4)
+
+    # The file changed while it was read, the copy isn't cached but still answers the waiters.
+    content_cache_lib.invalidate_content(path("stale"))
+    content = insert(content_cache_lib, "stale", generation=generation, keep=True)
+    assert content.contents.is_cached == 0
+    content_cache_lib.complete_content_fill(fill, content)
+    for thread in threads:
+        thread.join(5)
+
+    assert results == [(ctypes.addressof(content.contents), None)] * 4
+    content_cache_lib.release_content(content)
+    assert lookup(content_cache_lib, "stale") is None
+
+
+def test_lookup_which_may_not_wait_gets_miss(content_cache_lib):
+    before = statistics(content_cache_lib)
+    fill = ctypes.c_void_p()
+    content_cache_lib.acquire_content(path("busy"), 1, ctypes.byref(fill))
+
+    # An event loop thread reads the file itself instead of sleeping.
+    follower_fill = ctypes.c_void_p()
+    assert not content_cache_lib.acquire_content(path("busy"), 0, ctypes.byref(follower_fill))
+    assert follower_fill.value is None
+
+    content_cache_lib.complete_content_fill(fill, None)
+    after = statistics(content_cache_lib)
+    assert after.misses == before.misses + 2
+    assert after.coalesced == before.coalesced
+
+
+def test_uncacheable_response_is_loaded_for_followers(content_cache_lib):
+    fill = ctypes.c_void_p()
+    content_cache_lib.acquire_content(path("large"), 1, ctypes.byref(fill))
+    assert content_cache_lib.should_load_content(fill, ENTRY_SIZE) == 1
+    # Nobody waits for a response which doesn't fit the cache, it is sent from the file.
+    assert content_cache_lib.should_load_content(fill, ENTRY_SIZE + 1) == 0
+
+    threads, results = start_followers(content_cache_lib, "large", 2)
+    wait_for_followers(content_cache_lib, 2)
+    assert content_cache_lib.should_load_content(fill, ENTRY_SIZE + 1) == 1
+
+    before = statistics(content_cache_lib)
+    content = insert(content_cache_lib, "large", size=ENTRY_SIZE + 1, keep=True)
+    assert content.contents.is_cached == 0
+    assert statistics(content_cache_lib).used_bytes == before.used_bytes
+    content_cache_lib.complete_content_fill(fill, content)
+    for thread in threads:
+        thread.join(5)
+
+    assert results == [(ctypes.addressof(content.contents), None)] * 2
+    assert statistics(content_cache_lib).coalesced == before.coalesced + 2
+    content_cache_lib.release_content(content)
+
+
+def test_fills_of_different_paths_are_independent(content_cache_lib):
+    first_fill = ctypes.c_void_p()
+    second_fill = ctypes.c_void_p()
+    content_cache_lib.acquire_content(path("first"), 1, ctypes.byref(first_fill))
+
+    # A pending fill of another path doesn't make the lookup wait.
+    assert not content_cache_lib.acquire_content(path("second"), 1, ctypes.byref(second_fill))
+    assert second_fill.value is not None
+    assert second_fill.value != first_fill.value
+
+    content_cache_lib.complete_content_fill(second_fill, None)
+    content_cache_lib.complete_content_fill(first_fill, None)
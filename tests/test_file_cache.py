@@ -0,0 +1,200 @@
+import ctypes
+import os
+import socket
+import uuid
+import pytest
+
+
+RET_FILE_NOT_OPENED = -4
+MAX_PATH_LEN = 256
+dir = "./storage"
+
+
+class CachedFile(ctypes.Structure):
+    _fields_ = [
+        ("path", ctypes.c_char * MAX_PATH_LEN),
+        ("fd", ctypes.c_int),
+    ]
+
+
+class UploadFile(ctypes.Structure):
+    _fields_ = [
+        ("fd", ctypes.c_int),
+        ("temp_path", ctypes.c_char * MAX_PATH_LEN),
+    ]
+
+
+@pytest.fixture
+def file_cache_lib():
+    lib = ctypes.CDLL("build/test_file_cache.so")
+
+    lib.load_config.argtypes = [ctypes.c_char_p]
+    lib.load_config.restype = ctypes.c_int
+
+    lib.acquire_file.argtypes = [ctypes.c_char_p]
+    lib.acquire_file.restype = ctypes.POINTER(CachedFile)
+
+    lib.release_file.argtypes = [ctypes.POINTER(CachedFile)]
+    lib.release_file.restype = None
+
+    lib.invalidate_file.argtypes = [ctypes.c_char_p]
+    lib.invalidate_file.restype = None
+
+    lib.clear_file_cache.argtypes = []
+    lib.clear_file_cache.restype = None
+
+    lib.open_file_for_reading.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.POINTER(CachedFile))]
+    lib.open_file_for_reading.restype = ctypes.c_int
+
+    lib.close_file_for_reading.argtypes = [ctypes.POINTER(CachedFile)]
+    lib.close_file_for_reading.restype = None
+
+    lib.open_file_for_writing.argtypes = [ctypes.c_char_p, ctypes.POINTER(UploadFile)]
+    lib.open_file_for_writing.restype = ctypes.c_int
+
+    lib.close_file_for_writing.argtypes = [ctypes.c_char_p, ctypes.POINTER(UploadFile)]
+    lib.close_file_for_writing.restype = ctypes.c_int
+
+    lib.discard_file_for_writing.argtypes = [ctypes.POINTER(UploadFile)]
+    lib.discard_file_for_writing.restype = None
+
+    lib.write_to_file.argtypes = [ctypes.c_int, ctypes.c_char_p, ctypes.c_size_t]
+    lib.write_to_file.restype = ctypes.c_int
+
+    lib.receive_file.argtypes = [ctypes.c_int, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_size_t]
+    lib.receive_file.restype = ctypes.c_int
+
+    lib.delete_file.argtypes = [ctypes.c_char_p]
+    lib.delete_file.restype = ctypes.c_int
+
+    lib.load_config(b"../config.json")
+    yield lib
+    lib.clear_file_cache()
+
+
+@pytest.fixture
+def stored_file():
+    os.makedirs(dir, exist_ok=True)
+    name = "/file_cache_%s.txt" % uuid.uuid4().hex
+    with open(dir + name, "wb") as file:
+        file.write(b"old content")
+    yield name.encode()
+    if os.path.exists(dir + name):
+        os.remove(dir + name)
+
+
+def open_cached(lib, name):
+    entry = ctypes.POINTER(CachedFile)()
+    assert lib.open_file_for_reading(name, ctypes.byref(entry)) == 0
+    return entry
+
+
+def address(entry):
+    return ctypes.addressof(entry.contents)
+
+
+def read_entry(entry):
+    return os.pread(entry.contents.fd, 1024, 0)
+
+
+def test_repeated_reads_share_entry(file_cache_lib, stored_file):
+    first = open_cached(file_cache_lib, stored_file)
+    second = open_cached(file_cache_lib, stored_file)
+    assert address(first) == address(second)
+    assert read_entry(second) == b"old content"
+    file_cache_lib.close_file_for_reading(first)
+    file_cache_lib.close_file_for_reading(second)
+
+    # Released entry stays cached for the next request.
+    third = open_cached(file_cache_lib, stored_file)
+    assert address(third) == address(first)
+    file_cache_lib.close_file_for_reading(third)
+
+
+def test_upload_invalidates_entry(file_cache_lib, stored_file):
+    old = open_cached(file_cache_lib, stored_file)
+    old_fd = old.contents.fd
+
+    server, client = socket.socketpair()
+    new_content = b"new content after upload"
+    client.sendall(new_content)
+    assert file_cache_lib.receive_file(server.fileno(), stored_file, len(new_content), None, 0) == 0
+    server.close()
+    client.close()
+
+    new = open_cached(file_cache_lib, stored_file)
+    assert new.contents.fd != old_fd
+    assert read_entry(new) == new_content
+    assert os.fstat(new.contents.fd).st_size == len(new_content)
+
+    # A response still sending from the old descriptor keeps the old content.
+    assert read_entry(old) == b"old content"
+    file_cache_lib.close_file_for_reading(old)
+    file_cache_lib.close_file_for_reading(new)
+
+
+def test_streamed_upload_invalidates_entry(file_cache_lib, stored_file):
+    old = open_cached(file_cache_lib, stored_file)
+    file_cache_lib.close_file_for_reading(old)
+
+    upload = UploadFile()
+    assert file_cache_lib.open_file_for_writing(stored_file, ctypes.byref(upload)) == 0
+    assert file_cache_lib.write_to_file(upload.fd, b"streamed", 8) == 0
+
+    # Until the upload completes readers keep getting the cached old file.
+    during = open_cached(file_cache_lib, stored_file)
+    assert read_entry(during) == b"old content"
+    file_cache_lib.close_file_for_reading(during)
+
+    assert file_cache_lib.close_file_for_writing(stored_file, ctypes.byref(upload)) == 0
+
+    new = open_cached(file_cache_lib, stored_file)
+    assert read_entry(new) == b"streamed"
+    file_cache_lib.close_file_for_reading(new)
+
+
+def test_discarded_upload_keeps_entry(file_cache_lib, stored_file):
+    old = open_cached(file_cache_lib, stored_file)
+    file_cache_lib.close_file_for_reading(old)
+
+    upload = UploadFile()
+    assert file_cache_lib.open_file_for_writing(stored_file, ctypes.byref(upload)) == 0
+    file_cache_lib.write_to_file(upload.fd, b"partial", 7)
+    file_cache_lib.discard_file_for_writing(ctypes.byref(upload))
+
+    same = open_cached(file_cache_lib, stored_file)
+    assert address(same) == address(old)
+    assert read_entry(same) == b"old content"
+    file_cache_lib.close_file_for_reading(same)
+
+
+def test_delete_invalidates_entry(file_cache_lib, stored_file):
+    entry = open_cached(file_cache_lib, stored_file)
+    file_cache_lib.close_file_for_reading(entry)
+
+    assert file_cache_lib.delete_file(stored_file) == 0
+
+    missing = ctypes.POINTER(CachedFile)()
+    assert file_cache_lib.open_file_for_reading(stored_file, ctypes.byref(missing)) == RET_FILE_NOT_OPENED
+
+
+def test_delete_while_sending(file_cache_lib, stored_file):
+    entry = open_cached(file_cache_lib, stored_file)
+    assert file_cache_lib.delete_file(stored_file) == 0
+
+    # The descriptor of a response in progress stays open until it is released.
+    assert read_entry(entry) == b"old content"
+    file_cache_lib.close_file_for_reading(entry)
+
+
+def test_invalidate_referenced_entry(file_cache_lib, stored_file):
+    path = (dir + stored_file.decode()).encode()
+    held = file_cache_lib.acquire_file(path)
+    file_cache_lib.invalidate_file(path)
+
+    fresh = file_cache_lib.acquire_file(path)
+    assert address(fresh) != address(held)
+    assert read_entry(held) == b"old content"
+
+    file_cache_lib.release_file(held)
+    file_cache_lib.release_file(fresh)
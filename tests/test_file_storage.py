@@ -14,7 +14,7 @@ def file_storage_lib():
     lib.load_config.argtypes = [ctypes.c_char_p]
     lib.load_config.restype = None
     
-    lib.send_file.argtypes = [ctypes.c_int, ctypes.c_char_p]
+    lib.send_file.argtypes = [ctypes.c_int, ctypes.c_char_p, ctypes.c_void_p, ctypes.POINTER(ctypes.c_ulonglong)]
     lib.send_file.restype = ctypes.c_int
     
     lib.receive_file.argtypes = [ctypes.c_int, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_size_t]
@@ -58,8 +58,10 @@ def test_send_file_success(file_storage_lib, socket_pair):
     with open(full_path, "wb") as f:
         f.write(sent_data)
 
-    result = file_storage_lib.send_file(client.fileno(), b"/test.txt")
+    bytes_sent = ctypes.c_ulonglong(0)
+    result = file_storage_lib.send_file(client.fileno(), b"/test.txt", None, ctypes.byref(bytes_sent))
     assert result == 0
+    assert bytes_sent.value == len(sent_data)
 
     received_data = server.recv(len(sent_data))
     assert received_data == sent_data
@@ -87,7 +89,8 @@ def test_receive_file_success(file_storage_lib, socket_pair):
 
 def test_send_file_missing(file_storage_lib, socket_pair):
     server, client = socket_pair
-    result = file_storage_lib.send_file(client.fileno(), b"fail")
+    bytes_sent = ctypes.c_ulonglong(0)
+    result = file_storage_lib.send_file(client.fileno(), b"fail", None, ctypes.byref(bytes_sent))
     assert result == -4
 
 
@@ -100,7 +103,8 @@ def test_send_file_closed_socket(file_storage_lib, socket_pair):
     server, client = socket.socketpair()
     client.close()
 
-    result = file_storage_lib.send_file(client.fileno(), filename.encode())
+    bytes_sent = ctypes.c_ulonglong(0)
+    result = file_storage_lib.send_file(client.fileno(), filename.encode(), None, ctypes.byref(bytes_sent))
     assert result == -4
 
     os.remove(filename)
@@ -116,6 +120,49 @@ def test_receive_file_closed_socket(file_storage_lib, socket_pair):
     result = file_storage_lib.receive_file(server.fileno(), filename.encode("utf-8"), 256, None, 0)
     assert result == -1
 
+    assert not os.path.exists(dir + filename)
+    assert not [name for name in os.listdir(dir) if ".upload-" in name]
+
+
+def test_receive_file_partial_keeps_old_file(file_storage_lib, socket_pair):
+    server, client = socket_pair
+
+    os.makedirs(dir, exist_ok=True)
+    with open(dir + filename, "wb") as file:
+        file.write(b"old content")
+
+    client.sendall(b"new")
+    client.close()
+
+    result = file_storage_lib.receive_file(server.fileno(), filename.encode("utf-8"), 256, None, 0)
+    assert result == -1
+
+    with open(dir + filename, "rb") as file:
+        assert file.read() == b"old content"
+    assert not [name for name in os.listdir(dir) if ".upload-" in name]
+
+    os.remove(dir + filename)
+
+
+def test_receive_file_replaces_opened_file(file_storage_lib, socket_pair):
+    server, client = socket_pair
+
+    os.makedirs(dir, exist_ok=True)
+    with open(dir + filename, "wb") as file:
+        file.write(b"old content")
+
+    with open(dir + filename, "rb") as reader:
+        sent_data = b"new content, longer than old"
+        client.sendall(sent_data)
+        result = file_storage_lib.receive_file(server.fileno(), filename.encode("utf-8"), len(sent_data), None, 0)
+        assert result == 0
+
+        # A reader which opened the file before keeps reading the old content.
+        assert reader.read() == b"old content"
+
+    with open(dir + filename, "rb") as file:
+        assert file.read() == sent_data
+
     os.remove(dir + filename)
 
 
@@ -0,0 +1,103 @@
+import ctypes
+import random
+import pytest
+
+
+@pytest.fixture
+def header_scanner_lib():
+    lib = ctypes.CDLL("build/test_header_scanner.so")
+
+    lib.find_headers_end.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_size_t)]
+    lib.find_headers_end.restype = ctypes.c_size_t
+
+    return lib
+
+
+def reference_headers_end(data, scanned_size):
+    """Scalar reference: size of headers ending after scanned_size - 3, or 0."""
+    index = data.find(b"\r\n\r\n", max(scanned_size - 3, 0))
+    return 0 if index == -1 else index + 4
+
+
+def find(lib, data, scanned_size=0):
+    scanned = ctypes.c_size_t(scanned_size)
+    return lib.find_headers_end(data, len(data), ctypes.byref(scanned)), scanned.value
+
+
+def find_incrementally(lib, data, piece_sizes):
+    """Feeds growing prefixes of data like successive recv() calls, returns the first found end."""
+    scanned = ctypes.c_size_t(0)
+    size = 0
+    for piece_size in piece_sizes:
+        size = min(size + piece_size, len(data))
+        found = lib.find_headers_end(data, size, ctypes.byref(scanned))
+        if found != 0:
+            return found
+        # Fewer bytes than a terminator are not scanned at all.
+        assert scanned.value == (size if size > 3 else 0)
+    return 0
+
+
+# Filler full of near-misses: LF pairs, CRLFCR without the last LF, bare LFs.
+FILLER = b"a\n\nb\r\n\rc\n\r\nd\r\r\n\ne\n"
+
+
+def make_request(terminator_offset, tail_size):
+    prefix = (FILLER * (terminator_offset // len(FILLER) + 1))[:terminator_offset]
+    if prefix.endswith(b"\r") or prefix.endswith(b"\r\n") or prefix.endswith(b"\r\n\r"):
+        prefix = prefix[:-1] + b"x"
+    return prefix + b"\r\n\r\n" + b"x" * tail_size
+
+
+@pytest.mark.parametrize("tail_size", [0, 1, 15, 16, 17, 31, 32, 33])
+def test_terminator_at_every_offset(header_scanner_lib, tail_size):
+    for offset in range(0, 100):
+        data = make_request(offset, tail_size)
+        found, scanned = find(header_scanner_lib, data)
+        assert found == reference_headers_end(data, 0) == offset + 4
+        assert scanned == found
+
+
+@pytest.mark.parametrize("size", list(range(0, 70)))
+def test_no_terminator(header_scanner_lib, size):
+    data = (FILLER * 8)[:size]
+    found, scanned = find(header_scanner_lib, data)
+    assert found == 0
+    assert scanned == (size if size > 3 else 0)
+
+
+@pytest.mark.parametrize("boundary", [16, 32, 64])
+def test_terminator_split_across_boundary(header_scanner_lib, boundary):
+    for shift in range(-4, 5):
+        offset = boundary + shift
+        if offset < 0:
+            continue
+        data = make_request(offset, 40)
+        # Every split of the terminator between two receives.
+        for first_size in range(offset, offset + 5):
+            found = find_incrementally(header_scanner_lib, data, [first_size, len(data)])
+            assert found == offset + 4
+
+
+def test_first_of_several_terminators(header_scanner_lib):
+    data = b"GET / HTTP/1.1\r\nHost: a\r\n\r\nGET /b HTTP/1.1\r\n\r\n"
+    assert find(header_scanner_lib, data)[0] == data.index(b"\r\n\r\n") + 4
+
+
+def test_scan_resumes_after_scanned_size(header_scanner_lib):
+    data = b"GET / HTTP/1.1\r\n\r\n" + b"x" * 40 + b"\r\n\r\n"
+    # A terminator before scanned_size - 3 was already seen by an earlier call.
+    assert find(header_scanner_lib, data, 30)[0] == len(data)
+
+
+def test_random_input_matches_reference(header_scanner_lib):
+    generator = random.Random(1234)
+    for _ in range(3000):
+        size = generator.randrange(0, 140)
+        data = bytes(generator.choice(b"\r\n\r\nab") for _ in range(size))
+
+        found, _ = find(header_scanner_lib, data)
+        assert found == reference_headers_end(data, 0), data
+
+        pieces = [generator.randrange(1, 40) for _ in range(size // 2 + 2)]
+        assert find_incrementally(header_scanner_lib, data, pieces) == reference_headers_end(data, 0), data
@@ -1,5 +1,11 @@
 import ctypes
+import os
+import re
+import socket
+import time
+import uuid
 import pytest
+from email.utils import formatdate
 from enum import IntEnum
 
 
@@ -10,23 +16,70 @@ class Method(IntEnum):
     DELETE = 3
 
 
+class KnownHeader(IntEnum):
+    CONNECTION = 0
+    CONTENT_LENGTH = 1
+    EXPECT = 2
+    HOST = 3
+    TRANSFER_ENCODING = 4
+    RANGE = 5
+    IF_RANGE = 6
+    IF_NONE_MATCH = 7
+    IF_MODIFIED_SINCE = 8
+    COUNT = 9
+
+
+MAX_REQUEST_HEADERS = 64
+
+
+class StringView(ctypes.Structure):
+    _fields_ = [
+        ("data", ctypes.c_void_p),
+        ("length", ctypes.c_size_t),
+    ]
+
+
+class RequestHeader(ctypes.Structure):
+    _fields_ = [
+        ("key", StringView),
+        ("value", StringView),
+    ]
+
+
+class Timespec(ctypes.Structure):
+    _fields_ = [
+        ("tv_sec", ctypes.c_long),
+        ("tv_nsec", ctypes.c_long),
+    ]
+
+
 class Request(ctypes.Structure):
     _fields_ = [
         ("method", ctypes.c_int),
-        ("path", ctypes.c_char * 256),
-        ("version", ctypes.c_char * 32),
-        ("headers", ctypes.c_char * 8192),
-        ("body", ctypes.c_char_p),
-        ("body_size", ctypes.c_ulong),
+        ("path", StringView),
+        ("version", StringView),
+        ("headers", RequestHeader * MAX_REQUEST_HEADERS),
+        ("headers_count", ctypes.c_size_t),
+        ("known_headers", StringView * KnownHeader.COUNT),
+        ("content_length", ctypes.c_uint64),
+        ("is_chunked", ctypes.c_int),
+        ("keep_alive", ctypes.c_int),
+        ("expect_continue", ctypes.c_int),
+        ("body", StringView),
+        ("size", ctypes.c_size_t),
+        ("arena", ctypes.c_void_p),
+        ("received_time", Timespec),
+        ("status_code", ctypes.c_int),
+        ("bytes_sent", ctypes.c_ulonglong),
     ]
 
 
-class Response(ctypes.Structure):
+class InputBuffer(ctypes.Structure):
     _fields_ = [
-        ("status", ctypes.c_char * 64),
-        ("headers", ctypes.c_char * 256),
-        ("body", ctypes.c_char_p),
-        ("body_size", ctypes.c_ulong),
+        ("data", ctypes.c_void_p),
+        ("size", ctypes.c_size_t),
+        ("capacity", ctypes.c_size_t),
+        ("scanned", ctypes.c_size_t),
     ]
 
 
@@ -37,17 +90,47 @@ def http_communication_lib():
     lib.load_config.argtypes = [ctypes.c_char_p]
     lib.load_config.restype = None
 
-    lib.parse_request.argtypes = [ctypes.c_char_p]
-    lib.parse_request.restype = Request
+    lib.parse_request.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.POINTER(Request)]
+    lib.parse_request.restype = ctypes.c_int
+
+    lib.is_body_pending.argtypes = [ctypes.POINTER(Request)]
+    lib.is_body_pending.restype = ctypes.c_int
+
+    lib.parse_status_code.argtypes = [ctypes.c_char_p]
+    lib.parse_status_code.restype = ctypes.c_int
 
-    lib.create_response.argtypes = [Request]
-    lib.create_response.restype = ctypes.c_char_p
+    lib.handle_request.argtypes = [ctypes.c_int, ctypes.POINTER(Request)]
+    lib.handle_request.restype = ctypes.c_int
 
-    lib.parse_content_length.argtypes = [ctypes.c_char_p]
-    lib.parse_content_length.restype = ctypes.c_size_t
+    lib.initialize_responses.argtypes = []
+    lib.initialize_responses.restype = None
 
-    lib.is_keep_alive.argtypes = [ctypes.c_char_p]
-    lib.is_keep_alive.restype = ctypes.c_int
+    lib.initialize_arena.argtypes = [ctypes.c_void_p]
+    lib.initialize_arena.restype = None
+
+    lib.free_arena.argtypes = [ctypes.c_void_p]
+    lib.free_arena.restype = None
+
+    lib.invalidate_metadata.argtypes = [ctypes.c_char_p]
+    lib.invalidate_metadata.restype = None
+
+    lib.invalidate_file.argtypes = [ctypes.c_char_p]
+    lib.invalidate_file.restype = None
+
+    lib.initialize_input_buffer.argtypes = [ctypes.POINTER(InputBuffer)]
+    lib.initialize_input_buffer.restype = ctypes.c_int
+
+    lib.free_input_buffer.argtypes = [ctypes.POINTER(InputBuffer)]
+    lib.free_input_buffer.restype = None
+
+    lib.find_input_headers_end.argtypes = [ctypes.POINTER(InputBuffer)]
+    lib.find_input_headers_end.restype = ctypes.c_size_t
+
+    lib.has_next_request.argtypes = [ctypes.POINTER(InputBuffer), ctypes.c_size_t]
+    lib.has_next_request.restype = ctypes.c_int
+
+    lib.consume_input.argtypes = [ctypes.POINTER(InputBuffer), ctypes.c_size_t]
+    lib.consume_input.restype = None
 
     return lib
 
@@ -57,31 +140,545 @@ def auto_load_config(http_communication_lib):
     http_communication_lib.load_config("../config.json".encode())
 
 
+@pytest.fixture
+def storage_file():
+    # Every test uses its own name, the metadata index of the library outlives the test.
+    filename = "/http_test_%s.bin" % uuid.uuid4().hex
+    os.makedirs("./storage", exist_ok=True)
+    content = bytes(range(256)) * 4
+    with open("./storage" + filename, "wb") as file:
+        file.write(content)
+    yield filename, content
+    os.remove("./storage" + filename)
+
+
+def parse(lib, raw):
+    """Parses raw bytes, returns (result, request, buffer), the buffer must outlive the views."""
+    buffer = ctypes.create_string_buffer(raw, len(raw))
+    request = Request()
+    result = lib.parse_request(buffer, len(raw), ctypes.byref(request))
+    return result, request, buffer
+
+
+def view_offset(view, buffer):
+    return view.data - ctypes.addressof(buffer)
+
+
+def view_bytes(view):
+    return ctypes.string_at(view.data, view.length) if view.data else None
+
+
 def test_parse_request(http_communication_lib):
-    raw = b"GET /test.txt HTTP/1.1\r\nConnection: keep-alive\r\n\r\n"
-    req = http_communication_lib.parse_request(raw)
-    assert req.method == Method.GET
-    assert req.path.decode() == "/test.txt"
-    assert req.version.decode() == "HTTP/1.1"
-    assert b"Connection: keep-alive" in req.headers
+    raw = b"GET /test.txt HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n"
+    result, request, _ = parse(http_communication_lib, raw)
+    assert result == 0
+    assert request.method == Method.GET
+    assert view_bytes(request.path) == b"/test.txt"
+    assert view_bytes(request.version) == b"HTTP/1.1"
+    assert request.headers_count == 2
+    assert view_bytes(request.headers[1].key) == b"Connection"
+    assert view_bytes(request.headers[1].value) == b"keep-alive"
+    assert view_bytes(request.known_headers[KnownHeader.HOST]) == b"localhost"
+    assert request.keep_alive == 1
+    assert request.size == len(raw)
+
+
+@pytest.mark.parametrize("method,expected", [(b"GET", Method.GET), (b"POST", Method.POST),
+                                             (b"DELETE", Method.DELETE), (b"PUT", Method.UNKNOWN),
+                                             (b"get", Method.UNKNOWN)])
+def test_parse_method(http_communication_lib, method, expected):
+    result, request, _ = parse(http_communication_lib, method + b" / HTTP/1.1\r\n\r\n")
+    assert result == 0
+    assert request.method == expected
+
+
+def test_views_point_into_buffer(http_communication_lib):
+    raw = b"POST /upload HTTP/1.1\r\nX-Name:   padded value  \r\nContent-Length: 4\r\n\r\nbody"
+    result, request, buffer = parse(http_communication_lib, raw)
+    assert result == 0
+
+    # Views are bounded by length, nothing is copied out of the receive buffer.
+    assert view_offset(request.path, buffer) == raw.index(b"/upload")
+    assert view_offset(request.version, buffer) == raw.index(b"HTTP/1.1")
+    assert view_offset(request.headers[0].key, buffer) == raw.index(b"X-Name")
+    assert request.headers[0].key.length == len(b"X-Name")
+    assert view_offset(request.headers[0].value, buffer) == raw.index(b"padded")
+    assert request.headers[0].value.length == len(b"padded value")
+    assert view_offset(request.body, buffer) == raw.index(b"body")
+    assert request.body.length == 4
+    assert request.content_length == 4
+
+    # Only the separator after the path is terminated in place.
+    assert buffer.raw[raw.index(b" HTTP/1.1")] == 0
+    assert buffer.raw[raw.index(b"X-Name"):] == raw[raw.index(b"X-Name"):]
+
+
+def test_body_stops_at_content_length(http_communication_lib):
+    raw = b"POST /a HTTP/1.1\r\nContent-Length: 3\r\n\r\nabcGET /b HTTP/1.1\r\n\r\n"
+    result, request, _ = parse(http_communication_lib, raw)
+    assert result == 0
+    assert view_bytes(request.body) == b"abc"
+    assert request.size == raw.index(b"GET")
+    assert http_communication_lib.is_body_pending(ctypes.byref(request)) == 0
+
+
+def test_body_pending(http_communication_lib):
+    raw = b"POST /a HTTP/1.1\r\nContent-Length: 10\r\n\r\nabc"
+    result, request, _ = parse(http_communication_lib, raw)
+    assert result == 0
+    assert request.content_length == 10
+    assert view_bytes(request.body) == b"abc"
+    assert http_communication_lib.is_body_pending(ctypes.byref(request)) == 1
+
+
+def test_body_keeps_nul_bytes(http_communication_lib):
+    raw = b"POST /a HTTP/1.1\r\nContent-Length: 5\r\n\r\na\x00b\x00c"
+    result, request, _ = parse(http_communication_lib, raw)
+    assert result == 0
+    assert view_bytes(request.body) == b"a\x00b\x00c"
+
+
+def test_duplicate_equal_content_length(http_communication_lib):
+    raw = b"POST /a HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\nhello"
+    result, request, _ = parse(http_communication_lib, raw)
+    assert result == 0
+    assert request.content_length == 5
+
+
+@pytest.mark.parametrize(
+    "headers",
+    [
+        b"Content-Length: 5\r\nContent-Length: 6\r\n",
+        b"Content-Length: 5\r\ncontent-length: 05\r\n",
+        b"Content-Length: -1\r\n",
+        b"Content-Length: 1e3\r\n",
+        b"Content-Length: \r\n",
+        b"Content-Length: 99999999999999999999999\r\n",
+    ]
+)
+def test_invalid_content_length(http_communication_lib, headers):
+    result, _, _ = parse(http_communication_lib, b"POST /a HTTP/1.1\r\n" + headers + b"\r\n")
+    assert result != 0
+
+
+def test_chunked_transfer_encoding(http_communication_lib):
+    raw = b"POST /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n"
+    result, request, _ = parse(http_communication_lib, raw)
+    assert result == 0
+    assert request.is_chunked == 1
+    assert http_communication_lib.is_body_pending(ctypes.byref(request)) == 1
+
+
+@pytest.mark.parametrize(
+    "headers",
+    [
+        b"Transfer-Encoding: chunked\r\nContent-Length: 5\r\n",
+        b"Content-Length: 5\r\nTransfer-Encoding: chunked\r\n",
+        b"Transfer-Encoding: gzip, chunked\r\n",
+        b"Transfer-Encoding: identity\r\n",
+    ]
+)
+def test_rejected_transfer_encoding(http_communication_lib, headers):
+    result, _, _ = parse(http_communication_lib, b"POST /a HTTP/1.1\r\n" + headers + b"\r\n")
+    assert result != 0
+
+
+@pytest.mark.parametrize(
+    "raw",
+    [
+        b"GET /a HTTP/1.1\r\n",                         # no empty line
+        b"GET /a HTTP/1.1\r\nHost: x\r\n",              # no empty line after headers
+        b"GET  /a HTTP/1.1\r\n\r\n",                    # empty path
+        b"GET /a FTP/1.1\r\n\r\n",                      # unknown protocol
+        b"GET /a HTTP/1.1\n\r\n",                       # bare LF
+        b"GET /a HTTP/1.1\r\nHost x\r\n\r\n",           # no colon
+        b"GET /a HTTP/1.1\r\nBad Name: x\r\n\r\n",      # space in name
+        b"GET /a HTTP/1.1\r\n: x\r\n\r\n",              # empty name
+        b"GET /a HTTP/1.1\r\nHost: a\x00b\r\n\r\n",     # control byte in value
+        b"GET /" + b"a" * 256 + b" HTTP/1.1\r\n\r\n",   # path too long
+    ]
+)
+def test_malformed_request(http_communication_lib, raw):
+    result, _, _ = parse(http_communication_lib, raw)
+    assert result != 0
+
+
+def test_too_many_headers(http_communication_lib):
+    headers = b"".join(b"X-%d: v\r\n" % i for i in range(MAX_REQUEST_HEADERS + 1))
+    result, _, _ = parse(http_communication_lib, b"GET /a HTTP/1.1\r\n" + headers + b"\r\n")
+    assert result != 0
+
+
+@pytest.mark.parametrize(
+    "version,connection,expected",
+    [
+        (b"HTTP/1.1", b"", 1),
+        (b"HTTP/1.1", b"Connection: keep-alive\r\n", 1),
+        (b"HTTP/1.1", b"Connection: close\r\n", 0),
+        (b"HTTP/1.1", b"Connection: Upgrade, CLOSE\r\n", 0),
+        (b"HTTP/1.1", b"Connection: keep-alive, close\r\n", 0),
+        (b"HTTP/1.0", b"", 0),
+        (b"HTTP/1.0", b"Connection: keep-alive\r\n", 1),
+        (b"HTTP/1.0", b"Connection: Keep-Alive\r\n", 1),
+        (b"HTTP/1.0", b"Connection: close\r\n", 0),
+    ]
+)
+def test_keep_alive(http_communication_lib, version, connection, expected):
+    result, request, _ = parse(http_communication_lib, b"GET /a " + version + b"\r\n" + connection + b"\r\n")
+    assert result == 0
+    assert request.keep_alive == expected
+
+
+def test_keep_alive_with_unread_body(http_communication_lib):
+    # A body the method doesn't read would be taken for the next request.
+    result, request, _ = parse(http_communication_lib, b"GET /a HTTP/1.1\r\nContent-Length: 10\r\n\r\nabc")
+    assert result == 0
+    assert request.keep_alive == 0
+
+
+def receive(input_buffer, data):
+    """Appends data to the input buffer like recv() into its free space."""
+    assert input_buffer.size + len(data) <= input_buffer.capacity
+    ctypes.memmove(input_buffer.data + input_buffer.size, data, len(data))
+    input_buffer.size += len(data)
+
+
+def parse_pipelined(lib, input_buffer):
+    """Parses and consumes every complete request of the buffer like a connection does."""
+    parsed = []
+    while lib.find_input_headers_end(ctypes.byref(input_buffer)) != 0:
+        request = Request()
+        assert lib.parse_request(ctypes.cast(input_buffer.data, ctypes.c_char_p), input_buffer.size,
+                                 ctypes.byref(request)) == 0
+        is_next_buffered = lib.has_next_request(ctypes.byref(input_buffer), request.size)
+        parsed.append((Method(request.method), ctypes.string_at(request.path.data),
+                       view_bytes(request.body), request.keep_alive, is_next_buffered))
+        lib.consume_input(ctypes.byref(input_buffer), request.size)
+    return parsed
+
+
+PIPELINED_REQUESTS = [
+    (b"GET /first HTTP/1.1\r\nHost: a\r\n\r\n", (Method.GET, b"/first", b"", 1, 1)),
+    (b"POST /upload HTTP/1.1\r\nContent-Length: 20\r\n\r\nGET /not-a-request\r\n",
+     (Method.POST, b"/upload", b"GET /not-a-request\r\n", 1, 1)),
+    (b"DELETE /old HTTP/1.1\r\nContent-Length: 0\r\n\r\n", (Method.DELETE, b"/old", b"", 1, 1)),
+    (b"GET /last HTTP/1.1\r\nConnection: close\r\n\r\n", (Method.GET, b"/last", b"", 0, 0)),
+]
+
+
+def test_pipelined_requests(http_communication_lib):
+    input_buffer = InputBuffer()
+    assert http_communication_lib.initialize_input_buffer(ctypes.byref(input_buffer)) == 0
+    receive(input_buffer, b"".join(raw for raw, _ in PIPELINED_REQUESTS))
+
+    parsed = parse_pipelined(http_communication_lib, input_buffer)
+    assert parsed == [expected for _, expected in PIPELINED_REQUESTS]
+    assert input_buffer.size == 0
+    http_communication_lib.free_input_buffer(ctypes.byref(input_buffer))
+
+
+def test_pipelined_request_split_across_receives(http_communication_lib):
+    raw = b"GET /a HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\n\r\nGET /c HTTP/1.1\r\n\r\n"
+    for split in range(1, len(raw)):
+        input_buffer = InputBuffer()
+        assert http_communication_lib.initialize_input_buffer(ctypes.byref(input_buffer)) == 0
+
+        receive(input_buffer, raw[:split])
+        parsed = parse_pipelined(http_communication_lib, input_buffer)
+        receive(input_buffer, raw[split:])
+        parsed += parse_pipelined(http_communication_lib, input_buffer)
+
+        assert [entry[1] for entry in parsed] == [b"/a", b"/b", b"/c"]
+        assert input_buffer.size == 0
+        http_communication_lib.free_input_buffer(ctypes.byref(input_buffer))
+
+
+def test_partial_next_request_stays_buffered(http_communication_lib):
+    input_buffer = InputBuffer()
+    assert http_communication_lib.initialize_input_buffer(ctypes.byref(input_buffer)) == 0
+    receive(input_buffer, b"GET /a HTTP/1.1\r\n\r\nGET /b HTT")
+
+    parsed = parse_pipelined(http_communication_lib, input_buffer)
+    assert [entry[1] for entry in parsed] == [b"/a"]
+    assert ctypes.string_at(input_buffer.data, input_buffer.size) == b"GET /b HTT"
+    http_communication_lib.free_input_buffer(ctypes.byref(input_buffer))
+
+
+def test_parse_status_code(http_communication_lib):
+    assert http_communication_lib.parse_status_code(b"HTTP/1.1 206 Partial Content") == 206
+    assert http_communication_lib.parse_status_code(None) == 0
+
+
+def respond(lib, raw):
+    """Parses and answers a request, returns (status code, headers) of the sent head."""
+    result, request, _ = parse(lib, raw)
+    assert result == 0
+
+    lib.initialize_responses()
+    arena = (ctypes.c_void_p * 2)()
+    lib.initialize_arena(arena)
+    request.arena = ctypes.addressof(arena)
+
+    server, client = socket.socketpair()
+    try:
+        assert lib.handle_request(server.fileno(), ctypes.byref(request)) == 0
+        server.shutdown(socket.SHUT_WR)
+        response = b""
+        while chunk := client.recv(65536):
+            response += chunk
+    finally:
+        server.close()
+        client.close()
+        lib.free_arena(arena)
+
+    head, _, _ = response.partition(b"\r\n\r\n")
+    lines = head.split(b"\r\n")
+    headers = dict(line.split(b": ", 1) for line in lines[1:])
+    return lib.parse_status_code(lines[0]), headers
+
+
+def test_directory_is_not_found(http_communication_lib):
+    path = "/http_test_%s" % uuid.uuid4().hex
+    os.makedirs("./storage" + path)
+    try:
+        status, _ = respond(http_communication_lib, get_request(path))
+    finally:
+        os.rmdir("./storage" + path)
+    assert status == 404
+
+
+@pytest.mark.parametrize(
+    "version, transfer_encoding, connection",
+    [
+        (b"HTTP/1.1", b"chunked", b"keep-alive"),
+        (b"HTTP/1.0", None, b"close"),
+    ]
+)
+def test_device_body_framing(http_communication_lib, version, transfer_encoding, connection):
+    path = "/http_test_%s" % uuid.uuid4().hex
+    os.symlink("/dev/null", "./storage" + path)
+    try:
+        status, headers = respond(http_communication_lib, b"GET " + path.encode() + b" " + version +
+                                  b"\r\nConnection: keep-alive\r\n\r\n")
+    finally:
+        os.remove("./storage" + path)
+
+    # Length of a device is unknown, HTTP/1.0 gets a body ended by closing the connection.
+    assert status == 200
+    assert headers.get(b"Transfer-Encoding") == transfer_encoding
+    assert b"Content-Length" not in headers
+    assert headers[b"Connection"] == connection
+
+
+def test_single_range_response(http_communication_lib, storage_file):
+    path, content = storage_file
+    status, headers = respond(http_communication_lib, b"GET " + path.encode() + b" HTTP/1.1\r\nRange: bytes=-24\r\n\r\n")
+    assert status == 206
+    assert headers[b"Content-Range"] == b"bytes %d-%d/%d" % (len(content) - 24, len(content) - 1, len(content))
+    assert headers[b"Content-Length"] == b"24"
+    assert b"ETag" in headers
+
+
+def test_multipart_range_response(http_communication_lib, storage_file):
+    path, content = storage_file
+    status, headers = respond(http_communication_lib,
+                              b"GET " + path.encode() + b" HTTP/1.1\r\nRange: bytes=0-9,100-\r\n\r\n")
+    assert status == 206
+    match = re.fullmatch(rb"multipart/byteranges; boundary=([0-9a-f]{16})", headers[b"Content-Type"])
+    assert match
+    boundary = match.group(1)
+
+    body_size = 0
+    for first, last in [(0, 9), (100, len(content) - 1)]:
+        body_size += len(b"\r\n--" + boundary + b"\r\nContent-Type: application/octet-stream\r\n" +
+                         b"Content-Range: bytes %d-%d/%d\r\n\r\n" % (first, last, len(content)))
+        body_size += last - first + 1
+    body_size += len(b"\r\n--" + boundary + b"--\r\n")
+    assert int(headers[b"Content-Length"]) == body_size
+
+
+def test_unsatisfiable_range_response(http_communication_lib, storage_file):
+    path, content = storage_file
+    status, headers = respond(http_communication_lib,
+                              b"GET " + path.encode() + b" HTTP/1.1\r\nRange: bytes=5000-\r\n\r\n")
+    assert status == 416
+    assert headers[b"Content-Range"] == b"bytes */%d" % len(content)
+    assert headers[b"Content-Length"] == b"0"
+
+
+def test_invalid_range_is_ignored(http_communication_lib, storage_file):
+    path, content = storage_file
+    status, headers = respond(http_communication_lib, b"GET " + path.encode() + b" HTTP/1.1\r\nRange: lines=1-2\r\n\r\n")
+    assert status == 200
+    assert headers[b"Content-Length"] == b"%d" % len(content)
+    assert headers[b"Accept-Ranges"] == b"bytes"
+
+
+def get_request(path, headers=b""):
+    return b"GET " + path.encode() + b" HTTP/1.1\r\n" + headers + b"\r\n"
+
+
+def get_validators(path):
+    stat = os.stat("./storage" + path)
+    entity_tag = b'"%x-%x-%x"' % (stat.st_ino, stat.st_size, stat.st_mtime_ns)
+    return entity_tag, formatdate(stat.st_mtime, usegmt=True).encode()
+
+
+def test_validators(http_communication_lib, storage_file):
+    path, _ = storage_file
+    entity_tag, last_modified = get_validators(path)
+    status, headers = respond(http_communication_lib, get_request(path))
+    assert status == 200
+    assert headers[b"ETag"] == entity_tag
+    assert headers[b"Last-Modified"] == last_modified
+
+
+def test_entity_tag_changes_with_content(http_communication_lib, storage_file):
+    path, content = storage_file
+    _, headers = respond(http_communication_lib, get_request(path))
+    old_entity_tag = headers[b"ETag"]
+
+    with open("./storage" + path, "ab") as file:
+        file.write(b"more")
+    # Changes made behind the server's back are seen once the index and descriptor entries are dropped.
+    http_communication_lib.invalidate_metadata(("./storage" + path).encode())
+    http_communication_lib.invalidate_file(("./storage" + path).encode())
+
+    _, headers = respond(http_communication_lib, get_request(path))
+    assert headers[b"ETag"] != old_entity_tag
+    assert headers[b"ETag"] == get_validators(path)[0]
+    assert headers[b"Content-Length"] == b"%d" % (len(content) + 4)
+
+
+def test_length_comes_from_opened_file(http_communication_lib, storage_file):
+    path, _ = storage_file
+    respond(http_communication_lib, get_request(path))
+
+    # The index still has the old size, the descriptor opened for the body has the new one.
+    with open("./storage" + path + ".new", "wb") as file:
+        file.write(b"x" * 100)
+    os.replace("./storage" + path + ".new", "./storage" + path)
+    http_communication_lib.invalidate_file(("./storage" + path).encode())
+
+    status, headers = respond(http_communication_lib, get_request(path))
+    assert status == 200
+    assert headers[b"Content-Length"] == b"100"
+
+    status, headers = respond(http_communication_lib, get_request(path, b"Range: bytes=50-\r\n"))
+    assert status == 206
+    assert headers[b"Content-Range"] == b"bytes 50-99/100"
+
+
+def test_validators_come_from_opened_file(http_communication_lib, storage_file):
+    path, _ = storage_file
+    old_entity_tag, _ = get_validators(path)
+    respond(http_communication_lib, get_request(path))
+
+    time.sleep(0.01)
+    with open("./storage" + path + ".new", "wb") as file:
+        file.write(b"x" * 100)
+    os.replace("./storage" + path + ".new", "./storage" + path)
+    http_communication_lib.invalidate_file(("./storage" + path).encode())
+    entity_tag, last_modified = get_validators(path)
+    assert entity_tag != old_entity_tag
+
+    status, headers = respond(http_communication_lib, get_request(path))
+    assert status == 200
+    assert headers[b"ETag"] == entity_tag
+    assert headers[b"Last-Modified"] == last_modified
+
+    # If-Range is compared with the body which is going to be sent.
+    status, _ = respond(http_communication_lib, get_request(path, b"Range: bytes=0-9\r\nIf-Range: " + entity_tag + b"\r\n"))
+    assert status == 206
+
+
+@pytest.mark.parametrize(
+    "if_none_match",
+    [
+        b"{tag}",
+        b"W/{tag}",
+        b"\"other\", {tag}",
+        b"\"other\",{tag} ",
+        b"*",
+    ]
+)
+def test_if_none_match_not_modified(http_communication_lib, storage_file, if_none_match):
+    path, _ = storage_file
+    entity_tag, last_modified = get_validators(path)
+    value = if_none_match.replace(b"{tag}", entity_tag)
+    status, headers = respond(http_communication_lib, get_request(path, b"If-None-Match: " + value + b"\r\n"))
+    assert status == 304
+    assert headers[b"ETag"] == entity_tag
+    assert headers[b"Last-Modified"] == last_modified
+    assert b"Content-Length" not in headers
+
+
+@pytest.mark.parametrize("if_none_match", [b'"other"', b'"other", W/"another"', b"", b"invalid"])
+def test_if_none_match_modified(http_communication_lib, storage_file, if_none_match):
+    path, content = storage_file
+    status, headers = respond(http_communication_lib, get_request(path, b"If-None-Match: " + if_none_match + b"\r\n"))
+    assert status == 200
+    assert headers[b"Content-Length"] == b"%d" % len(content)
+
+
+def test_if_modified_since(http_communication_lib, storage_file):
+    path, _ = storage_file
+    _, last_modified = get_validators(path)
+    mtime = os.stat("./storage" + path).st_mtime
+
+    status, _ = respond(http_communication_lib, get_request(path, b"If-Modified-Since: " + last_modified + b"\r\n"))
+    assert status == 304
+
+    later = formatdate(mtime + 3600, usegmt=True).encode()
+    status, _ = respond(http_communication_lib, get_request(path, b"If-Modified-Since: " + later + b"\r\n"))
+    assert status == 304
+
+    earlier = formatdate(mtime - 3600, usegmt=True).encode()
+    status, _ = respond(http_communication_lib, get_request(path, b"If-Modified-Since: " + earlier + b"\r\n"))
+    assert status == 200
+
+    status, _ = respond(http_communication_lib, get_request(path, b"If-Modified-Since: yesterday\r\n"))
+    assert status == 200
+
+
+def test_if_none_match_takes_precedence(http_communication_lib, storage_file):
+    path, _ = storage_file
+    entity_tag, _ = get_validators(path)
+    mtime = os.stat("./storage" + path).st_mtime
+    later = formatdate(mtime + 3600, usegmt=True).encode()
+    earlier = formatdate(mtime - 3600, usegmt=True).encode()
+
+    # A changed entity tag wins over a date the file wasn't modified after.
+    status, _ = respond(http_communication_lib, get_request(
+        path, b"If-None-Match: \"other\"\r\nIf-Modified-Since: " + later + b"\r\n"))
+    assert status == 200
+
+    # A matching entity tag wins over a date the file was modified after.
+    status, _ = respond(http_communication_lib, get_request(
+        path, b"If-Modified-Since: " + earlier + b"\r\nIf-None-Match: " + entity_tag + b"\r\n"))
+    assert status == 304
 
 
-def test_create_response_get(http_communication_lib):
-    raw = b"GET /file.txt HTTP/1.1\r\nConnection: close\r\n\r\n"
-    req = http_communication_lib.parse_request(raw)
-    resp_str = http_communication_lib.create_response(req)
-    resp_py = ctypes.string_at(resp_str)
-    assert b"HTTP/1.1 200 OK" in resp_py or b"HTTP/1.1 404 Not Found" in resp_py
+def test_not_modified_takes_precedence_over_range(http_communication_lib, storage_file):
+    path, _ = storage_file
+    entity_tag, _ = get_validators(path)
+    status, _ = respond(http_communication_lib, get_request(
+        path, b"Range: bytes=0-9\r\nIf-None-Match: " + entity_tag + b"\r\n"))
+    assert status == 304
 
 
-def test_content_length(http_communication_lib):
-    headers = b"Content-Length: 123\r\nConnection: keep-alive\r\n\r\n"
-    cl = http_communication_lib.parse_content_length(headers)
-    assert cl == 123
+def test_if_range(http_communication_lib, storage_file):
+    path, content = storage_file
+    entity_tag, last_modified = get_validators(path)
 
+    for validator in [entity_tag, last_modified]:
+        status, _ = respond(http_communication_lib, get_request(
+            path, b"Range: bytes=0-9\r\nIf-Range: " + validator + b"\r\n"))
+        assert status == 206
 
-def test_keep_alive(http_communication_lib):
-    headers = b"Connection: keep-alive\r\n\r\n"
-    assert http_communication_lib.is_keep_alive(headers) == 1
-    headers = b"Connection: close\r\n\r\n"
-    assert http_communication_lib.is_keep_alive(headers) == 0
+    # If-Range uses strong comparison, a stale or weak validator sends the whole file.
+    for validator in [b'"other"', b"W/" + entity_tag, formatdate(0, usegmt=True).encode()]:
+        status, headers = respond(http_communication_lib, get_request(
+            path, b"Range: bytes=0-9\r\nIf-Range: " + validator + b"\r\n"))
+        assert status == 200
+        assert headers[b"Content-Length"] == b"%d" % len(content)
@@ -0,0 +1,125 @@
+import ctypes
+import random
+import pytest
+
+
+KNOWN_HEADERS = {
+    b"connection": 0,
+    b"content-length": 1,
+    b"expect": 2,
+    b"host": 3,
+    b"transfer-encoding": 4,
+    b"range": 5,
+    b"if-range": 6,
+    b"if-none-match": 7,
+    b"if-modified-since": 8,
+}
+HEADER_UNKNOWN = len(KNOWN_HEADERS)
+KNOWN_HEADERS_TABLE_SIZE = 16
+
+
+class StringView(ctypes.Structure):
+    _fields_ = [
+        ("data", ctypes.c_void_p),
+        ("length", ctypes.c_size_t),
+    ]
+
+
+@pytest.fixture
+def http_header_lib():
+    lib = ctypes.CDLL("build/test_http_header.so")
+
+    lib.classify_header.argtypes = [StringView]
+    lib.classify_header.restype = ctypes.c_int
+
+    lib.is_view_equal.argtypes = [StringView, ctypes.c_char_p]
+    lib.is_view_equal.restype = ctypes.c_int
+
+    return lib
+
+
+def classify(lib, name, length=None):
+    """Classifies a view of name, the view may cover only its prefix, as a view into a request."""
+    buffer = ctypes.create_string_buffer(name, len(name))
+    return lib.classify_header(StringView(ctypes.addressof(buffer), len(name) if length is None else length))
+
+
+def get_slot(name):
+    return (len(name) * 2 + name[:1].lower()[0]) % KNOWN_HEADERS_TABLE_SIZE
+
+
+def test_known_slots_are_unique():
+    assert len({get_slot(name) for name in KNOWN_HEADERS}) == len(KNOWN_HEADERS)
+
+
+@pytest.mark.parametrize("name,header", list(KNOWN_HEADERS.items()))
+def test_known_headers(http_header_lib, name, header):
+    assert classify(http_header_lib, name) == header
+    assert classify(http_header_lib, name.upper()) == header
+    assert classify(http_header_lib, name.title()) == header
+    assert classify(http_header_lib, bytes(c ^ 0x20 if i % 2 and 0x61 <= c <= 0x7a else c
+                                           for i, c in enumerate(name))) == header
+
+
+@pytest.mark.parametrize("name", list(KNOWN_HEADERS))
+def test_near_miss_names(http_header_lib, name):
+    near_misses = [
+        name[:-1],                              # prefix
+        name + b"s",                            # longer
+        b"x" + name,
+        name[:-1] + b"x",                       # last character differs
+        b"x" + name[1:],                        # first character differs
+        name.replace(b"-", b"_"),
+        name + b" ",                            # whitespace is part of the name here
+        name[:1] + b"\0" + name[2:],
+    ]
+    for near_miss in near_misses:
+        if near_miss in KNOWN_HEADERS:
+            continue
+        assert classify(http_header_lib, near_miss) == HEADER_UNKNOWN, near_miss
+
+
+@pytest.mark.parametrize("name", list(KNOWN_HEADERS))
+def test_same_slot_names_are_unknown(http_header_lib, name):
+    # Same length and first character hash to the same slot, only the comparison rejects them.
+    generator = random.Random(name)
+    for _ in range(50):
+        candidate = name[:1] + bytes(generator.choice(b"abcdefghijklmnopqrstuvwxyz-") for _ in name[1:])
+        if candidate.lower() in KNOWN_HEADERS:
+            continue
+        assert get_slot(candidate) == get_slot(name)
+        assert classify(http_header_lib, candidate) == HEADER_UNKNOWN, candidate
+
+
+@pytest.mark.parametrize(
+    "name",
+    [b"", b"a", b"Accept", b"Accept-Encoding", b"User-Agent", b"Cookie", b"Content-Type", b"Cache-Control",
+     b"Origin", b"Referer", b"Authorization", b"If-Match", b"If-Unmodified-Since", b"Keep-Alive", b"TE", b"Trailer",
+     b"Upgrade", b"Via", b"X-Forwarded-For", b"Hosts", b"Ranges", b"Content-Lengths"]
+)
+def test_other_headers_are_unknown(http_header_lib, name):
+    assert classify(http_header_lib, name) == HEADER_UNKNOWN
+
+
+def test_view_is_not_read_past_its_length(http_header_lib):
+    assert classify(http_header_lib, b"Host: localhost", 4) == KNOWN_HEADERS[b"host"]
+    assert classify(http_header_lib, b"Hostname", 4) == KNOWN_HEADERS[b"host"]
+    assert classify(http_header_lib, b"Range", 4) == HEADER_UNKNOWN
+    assert classify(http_header_lib, b"If-Range", 2) == HEADER_UNKNOWN
+
+
+def test_random_names_match_reference(http_header_lib):
+    generator = random.Random(20)
+    alphabet = b"aceghilmnorstxAEHRCT-"
+    for _ in range(20000):
+        name = bytes(generator.choice(alphabet) for _ in range(generator.randrange(0, 19)))
+        assert classify(http_header_lib, name) == KNOWN_HEADERS.get(name.lower(), HEADER_UNKNOWN), name
+
+
+def test_view_equal(http_header_lib):
+    buffer = ctypes.create_string_buffer(b"Keep-Alive, close", 17)
+    view = StringView(ctypes.addressof(buffer), 10)
+    assert http_header_lib.is_view_equal(view, b"keep-alive") == 1
+    assert http_header_lib.is_view_equal(view, b"keep-alive,") == 0
+    assert http_header_lib.is_view_equal(view, b"keep-aliv") == 0
+    assert http_header_lib.is_view_equal(StringView(None, 0), b"") == 0
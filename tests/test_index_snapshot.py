@@ -0,0 +1,141 @@
+import ctypes
+import os
+import pytest
+
+
+RET_SUCCESS = 0
+RET_ERROR = -1
+RET_FILE_NOT_OPENED = -4
+
+
+class Timespec(ctypes.Structure):
+    _fields_ = [
+        ("tv_sec", ctypes.c_long),
+        ("tv_nsec", ctypes.c_long),
+    ]
+
+
+class FileMetadata(ctypes.Structure):
+    _fields_ = [
+        ("size", ctypes.c_long),
+        ("mtime", Timespec),
+        ("inode", ctypes.c_ulong),
+        ("is_regular", ctypes.c_int),
+    ]
+
+
+METADATA_VISITOR = ctypes.CFUNCTYPE(None, ctypes.c_char_p, ctypes.POINTER(FileMetadata),
+                                    ctypes.c_int, ctypes.c_void_p)
+
+
+@pytest.fixture
+def index_snapshot_lib():
+    lib = ctypes.CDLL("build/test_index_snapshot.so")
+
+    lib.build_metadata_index.argtypes = [ctypes.c_char_p]
+    lib.build_metadata_index.restype = ctypes.c_int
+
+    lib.save_index_snapshot.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+    lib.save_index_snapshot.restype = ctypes.c_int
+
+    lib.load_index_snapshot.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+    lib.load_index_snapshot.restype = ctypes.c_int
+
+    lib.for_each_metadata.argtypes = [METADATA_VISITOR, ctypes.c_void_p]
+    lib.for_each_metadata.restype = None
+
+    lib.clear_metadata_index.argtypes = []
+    lib.clear_metadata_index.restype = None
+
+    lib.clear_metadata_index()
+    yield lib
+    lib.clear_metadata_index()
+
+
+def list_entries(lib):
+    entries = {}
+
+    def visit(path, metadata, is_directory, context):
+        value = metadata.contents
+        entries[path.decode()] = (value.size, value.mtime.tv_sec, value.mtime.tv_nsec,
+                                  value.inode, is_directory)
+
+    lib.for_each_metadata(METADATA_VISITOR(visit), None)
+    return entries
+
+
+@pytest.fixture
+def indexed_root(index_snapshot_lib, tmp_path):
+    root = tmp_path / "storage"
+    (root / "nested" / "deeper").mkdir(parents=True)
+    (root / "a.txt").write_bytes(b"a" * 10)
+    (root / "nested" / "b.bin").write_bytes(b"b" * 1000)
+    (root / "nested" / "deeper" / "c").write_bytes(b"")
+    assert index_snapshot_lib.build_metadata_index(str(root).encode()) == RET_SUCCESS
+    return str(root).encode()
+
+
+@pytest.fixture
+def snapshot_file(index_snapshot_lib, indexed_root, tmp_path):
+    snapshot_file = tmp_path / "index.snapshot"
+    assert index_snapshot_lib.save_index_snapshot(str(snapshot_file).encode(), indexed_root) == RET_SUCCESS
+    return snapshot_file
+
+
+def test_snapshot_round_trip(index_snapshot_lib, indexed_root, tmp_path):
+    expected = list_entries(index_snapshot_lib)
+    assert any(path.endswith("/nested/b.bin") for path in expected)
+
+    snapshot_file = tmp_path / "index.snapshot"
+    assert index_snapshot_lib.save_index_snapshot(str(snapshot_file).encode(), indexed_root) == RET_SUCCESS
+    assert not os.path.exists(str(snapshot_file) + ".tmp")
+
+    index_snapshot_lib.clear_metadata_index()
+    assert list_entries(index_snapshot_lib) == {}
+
+    assert index_snapshot_lib.load_index_snapshot(str(snapshot_file).encode(), indexed_root) == RET_SUCCESS
+    assert list_entries(index_snapshot_lib) == expected
+
+
+def test_missing_snapshot_is_rejected(index_snapshot_lib, indexed_root, tmp_path):
+    index_snapshot_lib.clear_metadata_index()
+    missing_file = str(tmp_path / "missing.snapshot").encode()
+    assert index_snapshot_lib.load_index_snapshot(missing_file, indexed_root) == RET_FILE_NOT_OPENED
+    assert list_entries(index_snapshot_lib) == {}
+
+
+def test_snapshot_of_other_root_is_rejected(index_snapshot_lib, snapshot_file):
+    index_snapshot_lib.clear_metadata_index()
+    assert index_snapshot_lib.load_index_snapshot(str(snapshot_file).encode(), b"/other/root") == RET_ERROR
+    assert list_entries(index_snapshot_lib) == {}
+
+
+@pytest.mark.parametrize("offset", [0, 8, -1])
+def test_corrupted_snapshot_is_rejected(index_snapshot_lib, indexed_root, snapshot_file, offset):
+    """Flips a byte of the magic, the version and the last record."""
+    data = bytearray(snapshot_file.read_bytes())
+    data[offset] ^= 0xff
+    snapshot_file.write_bytes(bytes(data))
+
+    index_snapshot_lib.clear_metadata_index()
+    assert index_snapshot_lib.load_index_snapshot(str(snapshot_file).encode(), indexed_root) == RET_ERROR
+    assert list_entries(index_snapshot_lib) == {}
+
+
+@pytest.mark.parametrize("removed_bytes", [1, 8])
+def test_truncated_snapshot_is_rejected(index_snapshot_lib, indexed_root, snapshot_file, removed_bytes):
+    data = snapshot_file.read_bytes()
+    snapshot_file.write_bytes(data[:-removed_bytes])
+
+    index_snapshot_lib.clear_metadata_index()
+    assert index_snapshot_lib.load_index_snapshot(str(snapshot_file).encode(), indexed_root) == RET_ERROR
+    assert list_entries(index_snapshot_lib) == {}
+
+
+def test_too_short_snapshot_is_rejected(index_snapshot_lib, indexed_root, tmp_path):
+    snapshot_file = tmp_path / "short.snapshot"
+    snapshot_file.write_bytes(b"HTTPIDX\0")
+
+    index_snapshot_lib.clear_metadata_index()
+    assert index_snapshot_lib.load_index_snapshot(str(snapshot_file).encode(), indexed_root) == RET_ERROR
+    assert list_entries(index_snapshot_lib) == {}
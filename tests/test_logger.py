@@ -1,5 +1,7 @@
 import pytest
 import ctypes
+import re
+import threading
 
 
 def get_last_line():
@@ -27,6 +29,17 @@ def logger_lib():
     lib.log_message.argtypes = [ctypes.c_int, ctypes.c_char_p]
     lib.log_message.restype = None
 
+    lib.initialize_logger.argtypes = []
+    lib.initialize_logger.restype = ctypes.c_int
+
+    lib.deinitialize_logger.argtypes = []
+    lib.deinitialize_logger.restype = None
+
+    lib.set_log_level.argtypes = [ctypes.c_int]
+    lib.set_log_level.restype = None
+
+    lib.log_formatted.restype = None
+
     return lib
 
 
@@ -62,4 +75,81 @@ def test_log_none_message(logger_lib):
 
     logger_lib.log_message(0, None)
     line = get_last_line()
-    assert line == ""
\ No newline at end of file
+    assert line == ""
+
+def start_logger(lib, tmp_path, policy, level="debug"):
+    log_file = tmp_path / "async.log"
+    config = tmp_path / "config.json"
+    config.write_text('{"log_file": "%s", "log_buffer_records": 16, "log_overflow_policy": "%s", "log_level": "%s"}'
+                      % (log_file, policy, level))
+    lib.load_config(str(config).encode())
+    assert lib.initialize_logger() == 0
+    return log_file
+
+
+def log_from_threads(lib, threads_count, messages_count):
+    def log():
+        for i in range(messages_count):
+            lib.log_message(1, b"record %d" % i)
+
+    threads = [threading.Thread(target=log) for _ in range(threads_count)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join(10)
+
+
+def test_block_policy_keeps_every_record(logger_lib, tmp_path):
+    log_file = start_logger(logger_lib, tmp_path, "block")
+    # The ring holds 16 records, producers sleep until the flush thread frees slots.
+    log_from_threads(logger_lib, 4, 500)
+    logger_lib.deinitialize_logger()
+
+    lines = log_file.read_text().splitlines()
+    assert len([line for line in lines if "[INFO] record" in line]) == 2000
+    assert not any("dropped" in line for line in lines)
+
+
+def test_drop_policy_reports_dropped_records(logger_lib, tmp_path):
+    log_file = start_logger(logger_lib, tmp_path, "drop")
+    log_from_threads(logger_lib, 4, 500)
+    logger_lib.deinitialize_logger()
+
+    lines = log_file.read_text().splitlines()
+    written = len([line for line in lines if "[INFO] record" in line])
+    dropped = sum(int(re.search(r"(\d+) log records were dropped", line).group(1))
+                  for line in lines if "were dropped" in line)
+    assert written + dropped == 2000
+
+
+def test_long_message_is_marked_truncated(logger_lib, tmp_path):
+    log_file = start_logger(logger_lib, tmp_path, "block")
+    logger_lib.log_message(1, b"A" * 1000)
+    logger_lib.log_message(1, b"B" * 511)
+    logger_lib.deinitialize_logger()
+
+    lines = log_file.read_text().splitlines()
+    assert lines[-2].endswith("] " + "A" * 508 + "...")
+    assert lines[-1].endswith("] " + "B" * 511)
+
+
+def test_log_level_comes_from_config(logger_lib, tmp_path):
+    start_logger(logger_lib, tmp_path, "block", level="warn")
+    log_level = ctypes.c_int.in_dll(logger_lib, "g_log_level")
+    assert log_level.value == 2
+
+    logger_lib.set_log_level(3)
+    assert log_level.value == 3
+    logger_lib.set_log_level(0)
+    logger_lib.deinitialize_logger()
+
+
+def test_formatted_message(logger_lib, tmp_path):
+    log_file = start_logger(logger_lib, tmp_path, "block")
+    logger_lib.log_formatted(ctypes.c_int(2), b"%s has %d bytes", b"file.txt", ctypes.c_int(42))
+    logger_lib.log_formatted(ctypes.c_int(2), b"%s", b"C" * 1000)
+    logger_lib.deinitialize_logger()
+
+    lines = log_file.read_text().splitlines()
+    assert lines[-2].endswith("[WARN] file.txt has 42 bytes")
+    assert lines[-1].endswith("] " + "C" * 508 + "...")
@@ -0,0 +1,205 @@
+import ctypes
+import os
+import time
+import pytest
+
+
+MISSING_ENTRY_TTL_SEC = 1
+
+STAT_HOOK = ctypes.CFUNCTYPE(None, ctypes.c_char_p)
+
+
+class Timespec(ctypes.Structure):
+    _fields_ = [
+        ("tv_sec", ctypes.c_long),
+        ("tv_nsec", ctypes.c_long),
+    ]
+
+
+class FileMetadata(ctypes.Structure):
+    _fields_ = [
+        ("size", ctypes.c_long),
+        ("mtime", Timespec),
+        ("inode", ctypes.c_ulong),
+        ("is_regular", ctypes.c_int),
+    ]
+
+
+@pytest.fixture
+def metadata_index_lib():
+    lib = ctypes.CDLL("build/test_metadata_index.so")
+
+    lib.build_metadata_index.argtypes = [ctypes.c_char_p]
+    lib.build_metadata_index.restype = ctypes.c_int
+
+    lib.lookup_metadata.argtypes = [ctypes.c_char_p, ctypes.POINTER(FileMetadata)]
+    lib.lookup_metadata.restype = ctypes.c_int
+
+    lib.update_metadata.argtypes = [ctypes.c_char_p, ctypes.c_void_p]
+    lib.update_metadata.restype = None
+
+    lib.invalidate_metadata.argtypes = [ctypes.c_char_p]
+    lib.invalidate_metadata.restype = None
+
+    lib.clear_metadata_index.argtypes = []
+    lib.clear_metadata_index.restype = None
+
+    lib.set_stat_hook.argtypes = [STAT_HOOK]
+    lib.set_stat_hook.restype = None
+
+    lib.clear_metadata_index()
+    yield lib
+    lib.clear_metadata_index()
+
+
+@pytest.fixture
+def libc():
+    libc = ctypes.CDLL(None, use_errno=True)
+    libc.stat.argtypes = [ctypes.c_char_p, ctypes.c_void_p]
+    libc.stat.restype = ctypes.c_int
+    return libc
+
+
+def stat_buffer(libc, path):
+    """Returns the raw struct stat of path, as update_metadata() receives it after fstat()."""
+    buffer = ctypes.create_string_buffer(256)
+    assert libc.stat(os.fsencode(path), buffer) == 0
+    return buffer
+
+
+def lookup(lib, path):
+    metadata = FileMetadata()
+    if lib.lookup_metadata(os.fsencode(path), ctypes.byref(metadata)) != 0:
+        return None
+    return metadata
+
+
+def test_indexed_file_is_answered_from_memory(metadata_index_lib, tmp_path):
+    (tmp_path / "nested").mkdir()
+    file = tmp_path / "nested" / "file.txt"
+    file.write_bytes(b"x" * 123)
+    assert metadata_index_lib.build_metadata_index(os.fsencode(tmp_path)) == 0
+
+    metadata = lookup(metadata_index_lib, file)
+    assert metadata.size == 123
+    assert metadata.inode == file.stat().st_ino
+    assert metadata.is_regular == 1
+
+    # Changes behind the server's back aren't seen, the filesystem isn't consulted.
+    file.unlink()
+    assert lookup(metadata_index_lib, file).size == 123
+
+    metadata_index_lib.invalidate_metadata(os.fsencode(file))
+    assert lookup(metadata_index_lib, file) is None
+
+
+def test_directory_is_not_a_file(metadata_index_lib, tmp_path):
+    (tmp_path / "directory").mkdir()
+    metadata_index_lib.build_metadata_index(os.fsencode(tmp_path))
+
+    # Directories are indexed for rescans, but they aren't files.
+    assert lookup(metadata_index_lib, tmp_path / "directory") is None
+
+
+def test_miss_is_remembered(metadata_index_lib, tmp_path):
+    file = tmp_path / "late.txt"
+    assert lookup(metadata_index_lib, file) is None
+
+    # A file created behind the server's back stays missing until the miss expires.
+    file.write_bytes(b"late")
+    assert lookup(metadata_index_lib, file) is None
+
+    time.sleep(MISSING_ENTRY_TTL_SEC + 0.2)
+    assert lookup(metadata_index_lib, file).size == 4
+
+
+def test_unindexed_file_is_found_once_and_indexed(metadata_index_lib, tmp_path):
+    file = tmp_path / "unindexed.txt"
+    file.write_bytes(b"abc")
+
+    assert lookup(metadata_index_lib, file).size == 3
+    file.unlink()
+    assert lookup(metadata_index_lib, file).size == 3
+
+
+def test_update_replaces_miss(metadata_index_lib, libc, tmp_path):
+    file = tmp_path / "uploaded.txt"
+    assert lookup(metadata_index_lib, file) is None
+
+    file.write_bytes(b"uploaded")
+    metadata_index_lib.update_metadata(os.fsencode(file), stat_buffer(libc, file))
+    assert lookup(metadata_index_lib, file).size == 8
+
+
+def test_invalidate_forgets_miss(metadata_index_lib, tmp_path):
+    file = tmp_path / "renamed.txt"
+    assert lookup(metadata_index_lib, file) is None
+
+    file.write_bytes(b"renamed")
+    metadata_index_lib.invalidate_metadata(os.fsencode(file))
+    assert lookup(metadata_index_lib, file).size == 7
+
+
+def run_with_stat_hook(lib, hook, action):
+    """Runs action, calling hook(path) after every stat() it makes before the index is updated."""
+    callback = STAT_HOOK(lambda path: hook(os.fsdecode(path)))
+    lib.set_stat_hook(callback)
+    try:
+        return action()
+    finally:
+        lib.set_stat_hook(STAT_HOOK())
+
+
+def test_stale_miss_does_not_hide_update(metadata_index_lib, libc, tmp_path):
+    source = tmp_path / "source.txt"
+    source.write_bytes(b"source")
+    file = tmp_path / "uploaded.txt"
+
+    def upload(path):
+        # The file is uploaded after stat() missed it.
+        os.rename(source, file)
+        metadata_index_lib.update_metadata(os.fsencode(file), stat_buffer(libc, file))
+
+    assert run_with_stat_hook(metadata_index_lib, upload, lambda: lookup(metadata_index_lib, file)) is None
+    assert lookup(metadata_index_lib, file).size == 6
+
+
+def test_stale_hit_does_not_hide_deletion(metadata_index_lib, tmp_path):
+    file = tmp_path / "deleted.txt"
+    file.write_bytes(b"deleted")
+
+    def delete(path):
+        # The file is deleted after stat() found it.
+        file.unlink()
+        metadata_index_lib.invalidate_metadata(os.fsencode(file))
+
+    assert run_with_stat_hook(metadata_index_lib, delete, lambda: lookup(metadata_index_lib, file)) is not None
+    assert lookup(metadata_index_lib, file) is None
+
+
+def test_scan_does_not_restore_deleted_file(metadata_index_lib, tmp_path):
+    file = tmp_path / "deleted.txt"
+    file.write_bytes(b"deleted")
+
+    def delete(path):
+        if path == str(file):
+            file.unlink()
+            metadata_index_lib.invalidate_metadata(os.fsencode(file))
+
+    root = os.fsencode(tmp_path)
+    assert run_with_stat_hook(metadata_index_lib, delete, lambda: metadata_index_lib.build_metadata_index(root)) == 0
+    assert lookup(metadata_index_lib, file) is None
+
+
+def test_scan_does_not_overwrite_upload(metadata_index_lib, libc, tmp_path):
+    file = tmp_path / "uploaded.txt"
+    file.write_bytes(b"old")
+
+    def upload(path):
+        if path == str(file):
+            file.write_bytes(b"new content")
+            metadata_index_lib.update_metadata(os.fsencode(file), stat_buffer(libc, file))
+
+    root = os.fsencode(tmp_path)
+    assert run_with_stat_hook(metadata_index_lib, upload, lambda: metadata_index_lib.build_metadata_index(root)) == 0
+    assert lookup(metadata_index_lib, file).size == 11
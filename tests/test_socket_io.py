@@ -0,0 +1,161 @@
+import ctypes
+import errno
+import os
+import socket
+import pytest
+
+
+class IoVec(ctypes.Structure):
+    _fields_ = [
+        ("iov_base", ctypes.c_void_p),
+        ("iov_len", ctypes.c_size_t),
+    ]
+
+
+@pytest.fixture
+def socket_io_lib():
+    lib = ctypes.CDLL("build/test_socket_io.so", use_errno=True)
+
+    lib.socket_writev.argtypes = [ctypes.c_int, ctypes.POINTER(IoVec), ctypes.c_int]
+    lib.socket_writev.restype = ctypes.c_ssize_t
+
+    lib.socket_sendfile.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_long), ctypes.c_size_t]
+    lib.socket_sendfile.restype = ctypes.c_ssize_t
+
+    lib.get_zero_copy_bytes_count.argtypes = []
+    lib.get_zero_copy_bytes_count.restype = ctypes.c_ulonglong
+
+    return lib
+
+
+@pytest.fixture
+def connection():
+    """Returns a connected pair of TCP sockets: (server side, client side)."""
+    listener = socket.create_server(("127.0.0.1", 0))
+    client = socket.create_connection(listener.getsockname())
+    server, _ = listener.accept()
+    listener.close()
+    yield server, client
+    server.close()
+    client.close()
+
+
+def make_iov(pieces):
+    """Builds an iovec array over pieces, the buffers must outlive the array."""
+    buffers = [ctypes.create_string_buffer(piece, len(piece)) for piece in pieces]
+    iov = (IoVec * len(pieces))()
+    for i, buffer in enumerate(buffers):
+        iov[i].iov_base = ctypes.addressof(buffer)
+        iov[i].iov_len = len(pieces[i])
+    return iov, buffers
+
+
+def receive_exactly(sock, size):
+    data = b""
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        assert chunk
+        data += chunk
+    return data
+
+
+def test_writev_keeps_nul_bytes(socket_io_lib, connection):
+    server, client = connection
+    pieces = [b"HTTP/1.1 200 OK\r\n\r\n", b"", b"a\x00b", b"\x00\x00\x00", b"end\x00"]
+    iov, buffers = make_iov(pieces)
+
+    sent_bytes = socket_io_lib.socket_writev(server.fileno(), iov, len(pieces))
+    assert sent_bytes == sum(len(piece) for piece in pieces)
+    assert receive_exactly(client, sent_bytes) == b"".join(pieces)
+    # Sent buffers are advanced, so the array tells nothing is left.
+    assert all(entry.iov_len == 0 for entry in iov)
+
+
+def test_writev_resumes_after_partial_send(socket_io_lib, connection):
+    server, client = connection
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, 16384)
+    server.setblocking(False)
+
+    pieces = [b"head\x00", bytes(range(256)) * 1024, b"\x00tail"]
+    expected = b"".join(pieces)
+    iov, buffers = make_iov(pieces)
+
+    received = b""
+    total_sent = 0
+    calls_count = 0
+    while total_sent < len(expected):
+        sent_bytes = socket_io_lib.socket_writev(server.fileno(), iov, len(pieces))
+        calls_count += 1
+        if sent_bytes == -1:
+            assert ctypes.get_errno() == errno.EAGAIN
+        else:
+            total_sent += sent_bytes
+            assert sum(entry.iov_len for entry in iov) == len(expected) - total_sent
+        received += client.recv(1 << 20)
+
+    received += receive_exactly(client, len(expected) - len(received))
+    assert received == expected
+    assert calls_count > 1
+
+
+def send_file_range(lib, sock, fd, offset, count):
+    """Calls socket_sendfile() until count bytes are sent or it stops, returns (sent, offset)."""
+    file_offset = ctypes.c_long(offset)
+    total_sent = 0
+    while total_sent < count:
+        sent_bytes = lib.socket_sendfile(sock.fileno(), fd, ctypes.byref(file_offset), count - total_sent)
+        assert sent_bytes >= 0
+        if sent_bytes == 0:
+            break
+        total_sent += sent_bytes
+    return total_sent, file_offset.value
+
+
+def test_sendfile_counts_sent_bytes(socket_io_lib, connection, tmp_path):
+    server, client = connection
+    content = os.urandom(300000)
+    (tmp_path / "file.bin").write_bytes(content)
+    fd = os.open(tmp_path / "file.bin", os.O_RDONLY)
+
+    zero_copy_bytes = socket_io_lib.get_zero_copy_bytes_count()
+    sent_bytes, offset = send_file_range(socket_io_lib, server, fd, 1000, 100000)
+    received = receive_exactly(client, sent_bytes)
+    os.close(fd)
+
+    assert sent_bytes == 100000
+    assert offset == 101000
+    assert received == content[1000:101000]
+    assert socket_io_lib.get_zero_copy_bytes_count() - zero_copy_bytes == 100000
+
+
+def test_sendfile_stops_at_end_of_file(socket_io_lib, connection, tmp_path):
+    server, client = connection
+    content = b"tail\x00of file"
+    (tmp_path / "file.bin").write_bytes(content)
+    fd = os.open(tmp_path / "file.bin", os.O_RDONLY)
+
+    zero_copy_bytes = socket_io_lib.get_zero_copy_bytes_count()
+    sent_bytes, offset = send_file_range(socket_io_lib, server, fd, 5, 1000)
+    received = receive_exactly(client, sent_bytes)
+    os.close(fd)
+
+    assert sent_bytes == len(content) - 5
+    assert offset == len(content)
+    assert received == content[5:]
+    assert socket_io_lib.get_zero_copy_bytes_count() - zero_copy_bytes == len(content) - 5
+
+
+def test_sendfile_of_pipe_is_not_counted(socket_io_lib, connection):
+    server, client = connection
+    read_fd, write_fd = os.pipe()
+    os.write(write_fd, b"piped\x00bytes")
+    os.close(write_fd)
+
+    zero_copy_bytes = socket_io_lib.get_zero_copy_bytes_count()
+    file_offset = ctypes.c_long(0)
+    sent_bytes = socket_io_lib.socket_sendfile(server.fileno(), read_fd, ctypes.byref(file_offset), 100)
+    os.close(read_fd)
+
+    # A pipe can't be read with pread() either, nothing is sent and nothing is counted.
+    assert sent_bytes == -1
+    assert socket_io_lib.get_zero_copy_bytes_count() == zero_copy_bytes
@@ -0,0 +1,104 @@
+import ctypes
+import threading
+import pytest
+
+
+RET_SUCCESS = 0
+RET_ERROR = -1
+RET_ARGUMENT_IS_NULL = -2
+
+TASK_FUNCTION = ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+
+
+@pytest.fixture
+def thread_pool_lib():
+    lib = ctypes.CDLL("build/test_thread_pool.so")
+
+    lib.initialize_thread_pool.argtypes = [ctypes.c_uint]
+    lib.initialize_thread_pool.restype = ctypes.c_int
+
+    lib.submit_task.argtypes = [TASK_FUNCTION, ctypes.c_void_p]
+    lib.submit_task.restype = ctypes.c_int
+
+    lib.deinitialize_thread_pool.argtypes = []
+    lib.deinitialize_thread_pool.restype = None
+
+    yield lib
+    lib.deinitialize_thread_pool()
+
+
+def test_submit_without_pool_fails(thread_pool_lib):
+    task = TASK_FUNCTION(lambda arg: None)
+    assert thread_pool_lib.submit_task(task, None) == RET_ERROR
+
+
+def test_null_task_is_rejected(thread_pool_lib):
+    assert thread_pool_lib.initialize_thread_pool(2) == RET_SUCCESS
+    assert thread_pool_lib.submit_task(TASK_FUNCTION(), None) == RET_ARGUMENT_IS_NULL
+
+
+@pytest.mark.parametrize("workers_count", [0, 1, 4])
+def test_deinitialize_drains_queued_tasks(thread_pool_lib, workers_count):
+    executed = []
+    lock = threading.Lock()
+
+    def run(arg):
+        with lock:
+            executed.append(arg)
+
+    task = TASK_FUNCTION(run)
+    assert thread_pool_lib.initialize_thread_pool(workers_count) == RET_SUCCESS
+    for i in range(1, 1001):
+        assert thread_pool_lib.submit_task(task, i) == RET_SUCCESS
+    thread_pool_lib.deinitialize_thread_pool()
+
+    assert sorted(executed) == list(range(1, 1001))
+
+
+def test_tasks_submitted_by_workers_are_drained(thread_pool_lib):
+    executed = []
+    lock = threading.Lock()
+
+    def child(arg):
+        with lock:
+            executed.append(arg)
+
+    child_task = TASK_FUNCTION(child)
+
+    def parent(arg):
+        for i in range(10):
+            assert thread_pool_lib.submit_task(child_task, arg * 100 + i) == RET_SUCCESS
+
+    parent_task = TASK_FUNCTION(parent)
+    assert thread_pool_lib.initialize_thread_pool(3) == RET_SUCCESS
+    for i in range(1, 21):
+        assert thread_pool_lib.submit_task(parent_task, i) == RET_SUCCESS
+    thread_pool_lib.deinitialize_thread_pool()
+
+    assert sorted(executed) == sorted(parent * 100 + i for parent in range(1, 21) for i in range(10))
+
+
+def test_idle_workers_steal_from_busy_worker(thread_pool_lib):
+    children_done = threading.Semaphore(0)
+    child_threads = set()
+
+    def child(arg):
+        child_threads.add(threading.get_ident())
+        children_done.release()
+
+    child_task = TASK_FUNCTION(child)
+    all_stolen = []
+
+    def parent(arg):
+        # Children go to the deque of this worker, which is busy until they are done.
+        for _ in range(10):
+            thread_pool_lib.submit_task(child_task, None)
+        all_stolen.append(all(children_done.acquire(timeout=5) for _ in range(10)))
+        all_stolen.append(threading.get_ident() not in child_threads)
+
+    parent_task = TASK_FUNCTION(parent)
+    assert thread_pool_lib.initialize_thread_pool(2) == RET_SUCCESS
+    assert thread_pool_lib.submit_task(parent_task, None) == RET_SUCCESS
+    thread_pool_lib.deinitialize_thread_pool()
+
+    assert all_stolen == [True, True]
@@ -0,0 +1,138 @@
+/**
+    * @file: access_log_decoder.c
+    * @author: Dmytro Kovalchuk
+    *
+    * This file contains the offline decoder of binary access logs
+    * written by the server.
+    *
+    * Every record is printed as one line of text, or as a CSV row
+    * when --csv is given:
+    *
+    *     access_log_decoder [--csv] <access log file>...
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include "../include/access_log.h"
+
+#define TIMESTAMP_SIZE 32
+#define CLIENT_ADDRESS_SIZE 32
+
+enum OutputFormat {
+    OUTPUT_FORMAT_TEXT,
+    OUTPUT_FORMAT_CSV
+};
+
+static const char* get_method_string(uint8_t method) {
+    switch (method) {
+        case GET:    return "GET";
+        case POST:   return "POST";
+        case DELETE: return "DELETE";
+        default:     return "UNKNOWN";
+    }
+}
+
+static void format_timestamp(uint64_t timestamp_us, char* output, size_t size) {
+    time_t seconds = (time_t)(timestamp_us / 1000000);
+    struct tm utc_time;
+    gmtime_r(&seconds, &utc_time);
+
+    size_t length = strftime(output, size, "%Y-%m-%dT%H:%M:%S", &utc_time);
+    snprintf(output + length, size - length, ".%06uZ", (unsigned)(timestamp_us % 1000000));
+}
+
+static void format_client_address(const struct AccessLogRecord* record, char* output, size_t size) {
+    if (record->client_ip == 0) {
+        snprintf(output, size, "-");
+        return;
+    }
+
+    char ip[INET_ADDRSTRLEN];
+    struct in_addr address = { .s_addr = record->client_ip };
+    inet_ntop(AF_INET, &address, ip, sizeof(ip));
+    snprintf(output, size, "%s:%u", ip, (unsigned)record->client_port);
+}
+
+static void print_csv_field(const char* field, size_t length) {
+    putchar('"');
+    for (size_t i = 0; i < length; ++i) {
+        if (field[i] == '"') putchar('"');
+        putchar(field[i]);
+    }
+    putchar('"');
+}
+
+static void print_record(const struct AccessLogRecord* record, const char* path, enum OutputFormat format) {
+    char timestamp[TIMESTAMP_SIZE];
+    char client[CLIENT_ADDRESS_SIZE];
+    format_timestamp(record->timestamp_us, timestamp, sizeof(timestamp));
+    format_client_address(record, client, sizeof(client));
+
+    if (format == OUTPUT_FORMAT_CSV) {
+        printf("%s,%s,%s,", timestamp, client, get_method_string(record->method));
+        print_csv_field(path, record->path_length);
+        printf(",%u,%llu,%u\n", (unsigned)record->status_code, (unsigned long long)record->bytes_sent,
+               (unsigned)record->latency_us);
+        return;
+    }
+
+    printf("%s %s %s %.*s %u %llu bytes %u us\n", timestamp, client, get_method_string(record->method),
+           (int)record->path_length, path, (unsigned)record->status_code,
+           (unsigned long long)record->bytes_sent, (unsigned)record->latency_us);
+}
+
+static int decode_file(const char* filename, enum OutputFormat format) {
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "%s: couldn't open file\n", filename);
+        return 1;
+    }
+
+    struct AccessLogHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, ACCESS_LOG_MAGIC, sizeof(ACCESS_LOG_MAGIC)) != 0 ||
+        header.version != ACCESS_LOG_VERSION || header.record_size != sizeof(struct AccessLogRecord)) {
+        fprintf(stderr, "%s: not an access log of version %d\n", filename, ACCESS_LOG_VERSION);
+        fclose(file);
+        return 1;
+    }
+
+    struct AccessLogRecord record;
+    char path[MAX_PATH_LEN];
+    int return_code = 0;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        if (record.path_length > sizeof(path) || fread(path, 1, record.path_length, file) != record.path_length) {
+            fprintf(stderr, "%s: truncated record\n", filename);
+            return_code = 1;
+            break;
+        }
+        print_record(&record, path, format);
+    }
+
+    fclose(file);
+    return return_code;
+}
+
+int main(int argc, char** argv) {
+    enum OutputFormat format = OUTPUT_FORMAT_TEXT;
+    int first_file = 1;
+    if (argc > 1 && strcmp(argv[1], "--csv") == 0) {
+        format = OUTPUT_FORMAT_CSV;
+        first_file = 2;
+    }
+
+    if (first_file >= argc) {
+        fprintf(stderr, "Usage: %s [--csv] <access log file>...\n", argv[0]);
+        return 1;
+    }
+
+    if (format == OUTPUT_FORMAT_CSV) puts("timestamp,client,method,path,status,bytes,latency_us");
+
+    int return_code = 0;
+    for (int i = first_file; i < argc; ++i) {
+        return_code |= decode_file(argv[i], format);
+    }
+    return return_code;
+}